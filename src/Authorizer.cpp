@@ -1,6 +1,9 @@
 #include <amore++/nondeterministic_finite_automaton.h>
 #include <amore++/finite_automaton.h>
 #include <amore_alf_glue.h>
+#include <chrono>
+#include <cstring>
+#include <limits>
 #include <libalf/basic_string.h>
 #include <memory>
 #include <string>
@@ -10,6 +13,8 @@
 #include "Launcher.h"
 #include "ProcessSyscallExit.h"
 #include "ProcessTermination.h"
+#include "SequenceModel.h"
+#include "SyscallNameResolver.h"
 
 using namespace std;
 
@@ -20,6 +25,26 @@ const int Authorizer::NOT_AUTHORISED = -1;
 // Returned when a ProcessState is not a final state as it should be
 const int Authorizer::NOT_FINAL = -2;
 
+/**
+ * Converts a violation policy name, as given in the command line, in its value.
+ *
+ * @param name          One of: kill, deny, learn, ask, shadow.
+ * @return The corresponding violation policy.
+ * @throw runtime_error If the name is not a valid policy.
+ */
+Authorizer::ViolationPolicy Authorizer::parseViolationPolicy(const string& name) {
+  static const map<string, ViolationPolicy> policies = { { "kill", Authorizer::KILL },
+                                                         { "deny", Authorizer::DENY },
+                                                         { "learn", Authorizer::LEARN },
+                                                         { "ask", Authorizer::ASK },
+                                                         { "shadow", Authorizer::SHADOW } };
+  auto it = policies.find(name);
+  if (it == policies.end()) {
+    throw runtime_error("Unknown violation policy " + name + ", it must be one of: kill, deny, learn, ask, shadow");
+  }
+  return it->second;
+}
+
 /**
  * Create a new Authorizer specifying used files path.
  * This object assumes that TracingManager has already been initialised.
@@ -27,220 +52,503 @@ const int Authorizer::NOT_FINAL = -2;
  * @param graphPath The path where a serialised NFA is expected, if it does not exist will be created.
  * @param associationsPath The associations file path, if it does not exist will be created.
  * @param learning   Specify if the Authorizer will act in learning mode or not.
+ * @param determinize Specify if the automaton should be determinised before enforcing, so that every check is a single lookup.
+ * @param policy     What to do in enforce mode when a syscall is not authorised or a tracee terminates in a non final state.
+ * @param threads    Number of threads that check the notifications in enforce mode, each one handles a shard of the traced
+ *                   threads, if 0 every check is performed by the caller of Authorizer::process.
+ * @param policyPath A policy bundle compiled from graphPath and associationsPath, if not empty it is enforced in their place
+ *                   and they are only used to save the changes to the policy. It cannot be used in learning mode.
+ * @param resume     In learning mode start from the last checkpoint of graphPath and associationsPath, if any.
+ * @param sequenceModel If not nullptr it is learned or enforced in place of the NFA, graphPath is then the path
+ *                   where it is expected and saved.
+ * @param store      If not nullptr its per-executable policies are enforced in place of the NFA, they are never changed
+ *                   hence it cannot be used in learning mode nor with the learn violation policy.
  */
-Authorizer::Authorizer(const string graphPath, const string associationsPath, const bool learning) : graphPath    (graphPath),
-																												                                             learning     (learning),
-																												                                             associations (associationsPath) {
-  if (!this->importAutomaton()) {
-    ERROR("Initial automata not imported");
-    this->automata = nullptr;
+Authorizer::Authorizer(const string graphPath,
+                       const string associationsPath,
+                       const bool learning,
+                       const bool determinize,
+                       const ViolationPolicy policy,
+                       const unsigned int threads,
+                       const string& policyPath,
+                       const bool resume,
+                       unique_ptr<SequenceModel> sequenceModel,
+                       unique_ptr<ModelStore> store) : graphPath        (graphPath),
+                                                   associationsPath (associationsPath),
+                                                   learning         (learning),
+                                                   determinize      (determinize),
+                                                   policy           (policy),
+                                                   shadow           (policy == Authorizer::SHADOW && !learning) {
+  if (sequenceModel != nullptr) {
+    assert(policyPath.empty());
+    this->sequenceModel = std::move(sequenceModel);
+    this->associations = make_unique<Mapper>(this->associationsPath);
+    if (ifstream(this->graphPath).good()) {
+      if (!this->sequenceModel->load(this->graphPath)) {
+        ERROR("The " + this->sequenceModel->getName() + " model in " + this->graphPath + " cannot be imported");
+        exit(1);
+      }
+    } else if (!this->learning) {
+      ERROR("A valid " + this->sequenceModel->getName() + " model is needed in enforce mode");
+      exit(1);
+    }
+  } else if (store != nullptr) {
+    assert(policyPath.empty());
+    if (this->learning || this->policy == Authorizer::LEARN) {
+      ERROR("The policies of a model directory can only be enforced, they are never changed");
+      exit(1);
+    }
+    this->store = std::move(store);
+  } else if (!policyPath.empty()) {
+    assert(!this->learning);
+    auto start = chrono::steady_clock::now();
+    this->bundle = make_unique<PolicyBundle>();
+    if (!this->bundle->load(policyPath)) {
+      ERROR("A valid policy is needed in enforce mode");
+      exit(1);
+    }
+    cout << "Policy " << policyPath << " with " << this->bundle->getAssociationCount() << " associations loaded in "
+         << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() << " us" << endl;
+  } else if (resume && ifstream(Checkpointer::getCheckpointPath(this->graphPath)).good() &&
+             ifstream(Checkpointer::getCheckpointPath(this->associationsPath)).good()) {
+    ifstream associationsCheckpoint(Checkpointer::getCheckpointPath(this->associationsPath));
+    cout << "Resuming from the checkpoint of " << this->graphPath << " and " << this->associationsPath << endl;
+    this->associations = make_unique<Mapper>(this->associationsPath, associationsCheckpoint);
+    this->automata = Authorizer::readAutomaton(Checkpointer::getCheckpointPath(this->graphPath));
+  } else {
+    if (resume) {
+      cout << "No checkpoint found for " << this->graphPath << ", the learning starts from it" << endl;
+    }
+    this->associations = make_unique<Mapper>(this->associationsPath);
+    if (!this->importAutomaton()) {
+      ERROR("Initial automata not imported");
+      this->automata = nullptr;
+    }
   }
-	if (!this->learning && this->automata == nullptr) {
+	if (!this->learning && this->automata == nullptr && this->bundle == nullptr && this->sequenceModel == nullptr &&
+	    this->store == nullptr) {
 		ERROR("A valid automaton is needed in enforce mode");
 		exit(1);
 	}
+	// The learning and the shadow modes need every notification in order hence they are never sharded
+	for (unsigned int i = 0; i < (this->learning || this->shadow ? 1 : max(threads, 1U)); i++) {
+		this->shards.push_back(make_unique<Shard>(this->compact));
+	}
+	if (!this->learning && this->sequenceModel == nullptr && this->store == nullptr) {
+		this->buildCompactAutomaton(this->determinize);
+	} else if (this->automata != nullptr) {
+		map<int, map<int, set<int>>> preTransitions;
+		if (!CompactAutomaton::fromAmore(*this->automata).hasLabelledStates()) {
+			ERROR("The automaton " + this->graphPath + " has been optimised, it can only be enforced: learn from the original one");
+			exit(1);
+		}
+		this->automata->get_transition_maps(preTransitions, this->learnedTransitions);
+		this->learnedInitials = this->automata->get_initial_states();
+		this->learnedFinals = this->automata->get_final_states();
+		for (const auto& i : this->learnedTransitions) {
+			this->learnedTransitionCount += i.second.size();
+		}
+	} else {
+		// State 0 does not correspond to any Syscall
+		this->learnedInitials = { 0 };
+	}
+	TracingManager::setNewTraceeCallback([this](pid_t fatherSpid, pid_t childPid, pid_t childSpid) {
+		this->newTracee(fatherSpid, childSpid);
+	});
+	if (this->shadow) {
+		this->shadowThread = make_unique<boost::thread>(&Authorizer::shadowLoop, this);
+	} else if (!this->learning && threads > 0) {
+		for (auto& shard : this->shards) {
+			shard->thread = make_unique<boost::thread>(&Authorizer::shardLoop, this, boost::ref(*shard));
+		}
+	}
+	// The operator is asked on a dedicated thread so that a pending decision stops only the offending tracee
+	if (!this->learning && this->policy == Authorizer::ASK) {
+		this->operatorThread = make_unique<boost::thread>(&Authorizer::operatorLoop, this);
+	}
+}
+
+Authorizer::~Authorizer() {
+	TracingManager::setNewTraceeCallback(nullptr);
+	this->stopShadow();
+	this->stopShards();
+	this->stopOperator();
 }
 
+/**
+ * Checks a notification, if the Authorizer has been created with some threads the check is performed
+ * asynchronously by the shard of the notification SPID.
+ * In shadow mode the notification proceeds immediately and a copy of it is checked later by the shadow thread.
+ *
+ * @param syscall The notification that will be checked.
+ */
 void Authorizer::process(std::shared_ptr<ProcessNotification> syscall) {
-	// If the Syscall is NOT authorized, and we are NOT allowed to continue
-	int returnValue = this->isAuthorized(syscall);
-	if (returnValue == Authorizer::NOT_AUTHORISED && !this->handleUnauthorised(syscall)) {
+	if (this->shadow) {
+		// Once the tracee proceeds the Tracer fills in the result and the child of the entry, the check must see it as it
+		// was, and it must be queued before the child of a clone can be
+		shared_ptr<ProcessNotification> copy = Authorizer::snapshot(syscall);
+		this->shadowQueue.push([this, copy]() {
+			this->check(copy);
+		});
+		this->shadowBacklog = max(this->shadowBacklog, (unsigned long) this->shadowQueue.size());
+		Authorizer::proceed(syscall);
 		return;
 	}
-	if (returnValue == Authorizer::NOT_FINAL && !this->handleNonFinal(syscall)) {
+	Shard& shard = this->getShard(syscall->getSpid());
+	if (shard.thread) {
+		shard.queue.push(syscall);
 		return;
 	}
-	shared_ptr<ProcessSyscallEntry> entry = dynamic_pointer_cast<ProcessSyscallEntry>(syscall);
-	if (entry != nullptr) {
-		if (!TracingManager::authorize(entry)) {
-			cerr << "Error occurred while trying to authorize a system call for SPID " << syscall->getSpid() << endl;
-		}
-	}
+	this->check(syscall);
 }
 
 void Authorizer::terminate() {
+	// Every pending check and decision has to be completed before checking the final states
+	this->stopShadow();
+	this->stopShards();
+	this->stopOperator();
+	// The model is never changed in shadow mode, there is nothing to save
+	if (this->shadow) {
+		this->checkFinalStates();
+		this->printShadowReport();
+		return;
+	}
+	// Every policy of a model directory is read only
+	if (this->store != nullptr) {
+		this->checkFinalStates();
+		cout << string(*this->store);
+		return;
+	}
+	if (this->sequenceModel != nullptr) {
+		if (this->learning) {
+			// In case of an unexpected termination we still want to learn the termination of every thread
+			for (const auto& shard : this->shards) {
+				for (const auto& i : shard->histories) {
+					this->sequenceModel->learn(i.second.executableName,
+					                           this->sequenceModel->getWindow(i.second.labels, SequenceModel::TERMINATION));
+				}
+			}
+		} else {
+			this->checkFinalStates();
+		}
+		if (!this->sequenceModel->save(this->graphPath)) {
+			ERROR("Error occurred while saving the " + this->sequenceModel->getName() + " model in " + this->graphPath);
+		} else if (!this->associations->save()) {
+			ERROR("Error occurred while saving the associations");
+		}
+		return;
+	}
 	if (!this->learning) {
 		this->checkFinalStates();
+		for (const auto& shard : this->shards) {
+			cout << string(shard->cache);
+		}
 	} else {
+		// The learned model is saved in its final location, a checkpoint written meanwhile would be stale
+		if (this->checkpointer) {
+			this->checkpointer->stop();
+		}
 		this->buildAutomata();
 	}
+	// A policy bundle is materialised only if it has been changed
+	if (this->automata == nullptr) {
+		return;
+	}
+	if (this->bundle != nullptr && (this->graphPath.empty() || this->associationsPath.empty())) {
+		ERROR("The policy has been changed but no NFA and associations paths have been given, the changes are lost");
+		return;
+	}
 	if(!this->save()) {
 		ERROR("Error occurred while saving the automata in " + this->graphPath);
+		return;
 	}
-	if (!this->associations.save()) {
+	if (!this->associations->save()) {
 		ERROR("Error occurred while saving the associations");
+		return;
+	}
+	if (this->learning) {
+		Checkpointer::removeCheckpoint(this->graphPath, this->associationsPath);
 	}
 }
 
 /**
- * Create a DOT representation of the NFA.
- * 
- * @param filePath The output file where the DOT representation will be stored.
- * @return True if the DOT representation generation was successful, False otherwise.
+ * Starts writing checkpoints of the automaton being learned next to Authorizer::graphPath and the associations path,
+ * so that the learning can be resumed if ptracer does not terminate cleanly.
+ *
+ * @param interval    Seconds between two checkpoints, 0 to disable the periodic checkpoints.
+ * @param transitions Number of new transitions that triggers a checkpoint, 0 to disable it.
+ * @return True if the checkpoints have been enabled, False if the Authorizer is not in learning mode.
  */
-bool Authorizer::dotOutput(const string& filePath) const {
-  ofstream dotFile;
-  if (this->automata == nullptr) {
-    cerr << "No automaton has been generated" << endl;
+bool Authorizer::enableCheckpoints(unsigned int interval, unsigned int transitions) {
+  if (!this->learning || this->sequenceModel != nullptr) {
+    ERROR("Checkpoints can be written only while learning an NFA");
     return false;
   }
-  try {
-    dotFile.open(filePath, ios::out);
-  } catch (ios_base::failure& e) {
-    ERROR("Impossible to open " + filePath + " in write mode: " + e.what());
+  this->checkpointer = make_unique<Checkpointer>(this->graphPath, this->associationsPath, interval, transitions);
+  this->checkpointer->start(this->learnedTransitions, this->learnedInitials, this->learnedFinals, *this->associations);
+  return true;
+}
+
+/**
+ * Checks that the model has been learned with the same limits the Tracer collects the stack traces with, otherwise its
+ * associations would never match. New associations are learned with them, so that they are saved with the model.
+ * It must be called before the tracing begins and before enabling the checkpoints.
+ *
+ * @param limits The limits of the stack traces of the Tracer.
+ * @return True if the model can be used with limits, False otherwise.
+ */
+bool Authorizer::setStackLimits(const StackLimits& limits) {
+  if (this->store != nullptr) {
+    return this->store->checkStackLimits(limits);
+  }
+  StackLimits learned;
+  if (this->associations != nullptr) {
+    if (this->associations->getSize() == 0) {
+      this->associations->setStackLimits(limits);
+      return true;
+    }
+    learned = this->associations->getStackLimits();
+  } else if (this->bundle != nullptr) {
+    learned = this->bundle->getStackLimits();
+  }
+  if (learned != limits) {
+    ERROR("The model has been learned with " + (string) learned + " while the stack traces are collected with " + (string) limits);
     return false;
   }
-  cout << "Generation of automaton DOT format..." << endl;
-  string dotString = this->automata->visualize();
-  if (dotString.empty()) {
-    ERROR("Error in the dot format generation");
+  return true;
+}
+
+/**
+ * Enforces the automaton through a SyscallMatrix, it must be called when the Tracer does not collect backtraces and
+ * before the tracing begins. The matrix is used only if the automaton has been learned without backtraces as well,
+ * otherwise the NFA is kept.
+ *
+ * @return True if the matrix will be used, False otherwise.
+ */
+bool Authorizer::useSyscallMatrix() {
+  if (this->learning || this->sequenceModel != nullptr || this->store != nullptr) {
+    ERROR("A system call matrix can be used only to enforce a single NFA");
+    return false;
+  }
+  assert(all_of(this->shards.begin(), this->shards.end(), [](const unique_ptr<Shard>& shard) {
+    return shard->currentStates.empty();
+  }));
+  this->matrixRequested = true;
+  this->buildSyscallMatrix();
+  if (this->matrix == nullptr) {
+    cout << "The automaton has been learned with backtraces or for many executables, the NFA will be used" << endl;
+    return false;
+  }
+  cout << "The automaton will be enforced as a system call matrix with " << this->matrix->getTransitionCount()
+       << " transitions" << endl;
+  return true;
+}
+
+/**
+ * Exports the NFA in a file, the states are labelled with the name of the system call that leads to them.
+ *
+ * @param filePath The output file where the representation will be stored.
+ * @param format   The output format.
+ * @return True if the export was successful, False otherwise.
+ */
+bool Authorizer::exportAutomaton(const string& filePath, AutomatonExporter::Format format) const {
+  if (this->automata == nullptr && this->bundle == nullptr) {
+    cerr << "No automaton has been generated" << endl;
     return false;
   }
-  cout << "Automaton DOT format successfully generated" << endl;
-  // The last visible character is a ';' but it is not part of the dot format
-  if (dotString.at(dotString.size() - 2) == ';') {
-    dotString.erase(dotString.end() - 2);
-  }
-  cout << "Writing DOT output file..." << endl;
-  dotFile << dotString;
-  dotFile.flush();
-  if (!dotFile.good()) {
-    ERROR("Error occurred during DOT file write");
-    dotFile.close();
+  cout << "Exporting the automaton..." << endl;
+  // The enforced copy may be determinised or have transparent labels, the exported one must match the saved NFA
+  CompactAutomaton automaton = this->getAutomaton();
+  vector<string> labelNames = this->getLabelNames();
+  AutomatonExporter exporter(automaton, labelNames);
+  if (!exporter.write(filePath, format)) {
+    ERROR("Error occurred while exporting the automaton in " + filePath);
     return false;
   }
-  dotFile.close();
-  cout << "Automaton in DOT format saved in " << filePath << endl;
+  cout << "Automaton with " << exporter.getWrittenStates() << " states and " << exporter.getWrittenTransitions()
+       << " transitions saved in " << filePath << endl;
   return true;
 }
 
+/**
+ * Compiles the automaton in a seccomp filter that will be installed in the tracee, it must be called before the tracing begins.
+ * The system calls let pass by the filter will never be observed, hence their labels become transparent for the enforcement.
+ * The system calls that the automaton never allows are killed by the kernel only with the kill violation policy and
+ * denied only with the deny one, with the others they are traced so that the policy is applied by the Authorizer.
+ *
+ * @return The BPF program of the filter, empty if it cannot be generated.
+ */
+vector<sock_filter> Authorizer::compileSeccompFilter() {
+  if (this->learning || (this->automata == nullptr && this->bundle == nullptr)) {
+    ERROR("A seccomp filter can be generated only to enforce an NFA");
+    return {};
+  }
+  assert(all_of(this->shards.begin(), this->shards.end(), [](const unique_ptr<Shard>& shard) {
+    return shard->currentStates.empty();
+  }));
+  map<int, set<int>> syscallLabels = this->getSyscallLabels();
+  // The kernel can apply only the kill and the deny policies by itself, otherwise the violations have to be traced
+  SeccompFilter::Action unknown = this->policy == Authorizer::KILL ? SeccompFilter::KILL
+                                : this->policy == Authorizer::DENY ? SeccompFilter::DENY : SeccompFilter::TRACE;
+  SeccompFilter filter = SeccompFilter::fromAutomaton(this->getAutomaton(), syscallLabels, unknown);
+  this->transparentLabels.clear();
+  for (const auto& i : syscallLabels) {
+    if (filter.getAction(i.first) == SeccompFilter::ALLOW) {
+      this->transparentLabels.insert(i.second.begin(), i.second.end());
+    }
+  }
+  cout << "Seccomp filter generated: " << filter.count(SeccompFilter::ALLOW) << " system calls allowed, "
+       << filter.count(SeccompFilter::TRACE) << " traced, " << filter.count(SeccompFilter::KILL) << " killed, "
+       << filter.count(SeccompFilter::DENY) << " denied" << endl;
+  this->buildCompactAutomaton(this->determinize);
+  return filter.compile();
+}
+
 Authorizer::operator string() const {
 	stringstream result;
 	result << "Learning: " << (this->learning ? "true" : "false") << endl;
+	result << "Determinize: " << (this->determinize ? "true" : "false") << endl;
+	result << "Authorizer threads: " << (this->shards.front()->thread ? this->shards.size() : 0) << endl;
+	result << "Model: " << (this->sequenceModel != nullptr ? this->sequenceModel->getName() + " of " +
+	                        to_string(this->sequenceModel->getWindowSize()) + " system calls" : "nfa") << endl;
+	result << "System call matrix: " << (this->matrix != nullptr ? "true" : "false") << endl;
+	result << "Violation policy: " << vector<string>({ "kill", "deny", "learn", "ask", "shadow" })[this->policy] << endl;
 	result << "NFA Path: " << this->graphPath << endl;
-	result << "Associations Path: " << this->associations.getAssociationsFile() << endl;
+	result << "Associations Path: " << this->associationsPath << endl;
+	result << "Policy bundle: " << (this->bundle != nullptr ? to_string(this->bundle->getSize()) + " bytes mapped" : "none") << endl;
+	result << "Model directory: " << (this->store != nullptr ? this->store->getDirectory() + " with " +
+	                                  to_string(this->store->getModelCount()) + " policies" : "none") << endl;
 	return result.str();
 }
 
-// TODO: Automata should be build on the fly, it should not be necessary to store all the states
-
 /**
- * It builds a new NFA automata starting from the input automata (taken from a previous execution), if it exists.
+ * It builds the NFA automata learned from every notification, starting from the input automata (taken from a previous
+ * execution), if it exists.
  * This is called at the end of the tracee execution.
  */
 void Authorizer::buildAutomata() {
-  // Set of initial and final states
-  set<int> initials, finals;
-  int stateOld, stateNew;
-  // Map containing the last inserted state for every traced thread
-  map<pid_t, map<pid_t, int>> lastStates;
-  // Map containing transitions in the form < origin, < transition_label, { destination_nodes } > >
-  map<int, map<int, set<int>>> transitions, preTransitions;
-  shared_ptr<ProcessSyscallEntry> syscall;
-  shared_ptr<ProcessTermination> termination;
+  set<int> finals = this->learnedFinals;
   cout << "Building the NFA automata..." << endl;
-  if (this->automata != nullptr) {
-    this->automata->get_transition_maps(preTransitions, transitions);
-    initials = this->automata->get_initial_states();
-    finals = this->automata->get_final_states();
-  } else {
+  if (this->automata == nullptr) {
     this->automata = make_unique<amore::nondeterministic_finite_automaton>();
-		// State 0 does not correspond to any Syscall
-    initials = { 0 };
-    stateOld = 0;
-  }
-	lastStates[(*this->processStates.begin())->getPid()][(*this->processStates.begin())->getSpid()] = 0;
-  assert(initials.size() == 1);
-  for (const shared_ptr<ProcessNotification>& i : this->processStates) {
-		if (dynamic_pointer_cast<ProcessSyscallExit>(i)) {
-			// Not interested in exit notifications
-			continue;
-		}
-	  termination = dynamic_pointer_cast<ProcessTermination>(i);
-    if (termination) {
-      finals.insert(lastStates[termination->getPid()][termination->getSpid()]);
-      continue;
-    }
-		// Handling of ProcessSyscallEntry
-		syscall = dynamic_pointer_cast<ProcessSyscallEntry>(i);
-    assert(lastStates.find(syscall->getPid()) != lastStates.end());
-    assert(lastStates[syscall->getPid()].find(syscall->getSpid()) != lastStates[syscall->getPid()].end());
-    stateOld = lastStates[syscall->getPid()][syscall->getSpid()];
-    // Insert a new Process State to the Mapper file
-    stateNew = this->associations.insert(syscall);
-    if (stateNew < 0) {
-      ERROR("Error occurred during automaton transitions generation!");
-      break;
-    }
-    transitions[stateOld][stateNew] = { stateNew };
-    // If this is a clone syscall -> bifurcate the graph
-    if (syscall->getChildPid() > 0) {
-      assert(syscall->getChildPid() > 0 && syscall->getChildPid() < Tracer::MAX_PID);
-      assert(syscall->getReturnValue() > 0 && syscall->getReturnValue() < Tracer::MAX_PID);
-      // A clone return value contains the newly created thread or process
-      lastStates[syscall->getChildPid()][(pid_t) syscall->getReturnValue()] = stateNew;
-    }
-	  lastStates[syscall->getPid()][syscall->getSpid()] = stateNew;
   }
+  assert(this->learnedInitials.size() == 1);
   // In case of an unexpected termination we still want to set every last state as final
-  for (const auto& pid_it : lastStates) {
-    for (const auto& spid_it : pid_it.second) {
-      finals.insert(spid_it.second);
-    }
+  for (const auto& i : this->learningStates) {
+    finals.insert(i.second);
   }
   if (this->automata->construct(false,
-                                (int) this->associations.getSize() + 1,
-                                (int) this->associations.getSize() + 1,
-                                initials,
+                                (int) this->associations->getSize() + 1,
+                                (int) this->associations->getSize() + 1,
+                                this->learnedInitials,
                                 finals,
-                                transitions)) {
-    //this->automaton->determinize();
-    //this->automaton->minimize();
+                                this->learnedTransitions)) {
+    // The learned automaton is not reduced so that its states stay named after their labels and it can be learned
+    // further, see the optimize-policy command
     cout << "Automaton construction finished" << endl;
 		cout << "Number of states: " << this->automata->get_alphabet_size() << endl;
-		// TODO: Reimplement the NFA library, DOT generation is very slow and this is a horrible way of finding the total number of transactions
-		int transitionNumber = 0;
-	  for (const auto& item : transitions) {
-		  for (const auto& item : item.second) {
-				transitionNumber += item.second.size();
-			}
-		}
-	  cout << "Number of transitions: " << transitionNumber << endl;
+	  cout << "Number of transitions: " << this->learnedTransitionCount << endl;
 		cout << "Final states: " << finals.size() << endl;
-    if (!this->save()) {
-      ERROR("Error occurred while saving the automata in " + this->graphPath);
-    }
   } else {
     ERROR("Impossible to create the automaton");
   }
 }
 
+/**
+ * Adds a notification to the automaton being learned: every system call is a transition from the state reached by
+ * the previous system call of the same thread to the state of its association.
+ *
+ * @param state The notification that will be learned.
+ */
+void Authorizer::learn(const shared_ptr<ProcessNotification>& state) {
+  if (dynamic_pointer_cast<ProcessSyscallExit>(state)) {
+    // Not interested in exit notifications
+    return;
+  }
+  auto current = this->learningStates.find(state->getSpid());
+  if (dynamic_pointer_cast<ProcessTermination>(state)) {
+    if (current != this->learningStates.end()) {
+      this->learnedFinals.insert(current->second);
+      if (this->checkpointer) {
+        this->checkpointer->addFinal(current->second);
+      }
+      this->learningStates.erase(current);
+    }
+    return;
+  }
+  shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(state);
+  assert(syscall != nullptr);
+  if (current == this->learningStates.end()) {
+    StateSet startingStates;
+    if (!this->takeStartingStates(syscall->getSpid(), startingStates)) {
+      cout << "The traced thread " << syscall->getSpid() << " has not been generated by an observed clone, it starts from the initial state" << endl;
+      startingStates = { *this->learnedInitials.begin() };
+    }
+    current = this->learningStates.emplace(syscall->getSpid(), startingStates.front()).first;
+  }
+  unsigned int associationsCount = this->associations->getSize();
+  int label = (int) this->associations->insert(syscall);
+  if (this->checkpointer && this->associations->getSize() > associationsCount) {
+    this->checkpointer->addAssociation(syscall->getExecutableName(), (unsigned int) label, ProcessSyscallEntryDTO(*syscall));
+  }
+  if (this->learnedTransitions[current->second].emplace(label, set<int>({ label })).second) {
+    this->learnedTransitionCount++;
+    if (this->checkpointer) {
+      this->checkpointer->addTransition(current->second, label);
+    }
+  }
+  // The clone is executed only after this notification has been learned, so the child always finds its starting state
+  if (syscall->getChildPid() == ProcessSyscallEntry::POSSIBLE_CHILD) {
+    boost::mutex::scoped_lock lock(this->handoffMutex);
+    this->cloneGenerators[syscall->getSpid()] = { label };
+  }
+  current->second = label;
+}
+
 /**
  * It saves the NFA automaton in Authorizer::automaton in the path specified in Authorizer::graphPath.
  * 
  * @return True if the automaton was successfully written, False otherwise.
  */
 bool Authorizer::save() {
-  ofstream automaton_file;
   cout << "Saving automaton..." << endl;
+  if (!Authorizer::writeAutomaton(*this->automata, this->graphPath)) {
+    return false;
+  }
+  cout << "Automaton saved in " << this->graphPath << endl;
+  return true;
+}
+
+/**
+ * Serialises an NFA in a file, it is written in a temporary file that is then renamed so that graphPath is always complete.
+ *
+ * @param automaton The NFA that will be written.
+ * @param graphPath The output file, if it exists it will be overwritten.
+ * @return True if the automaton was successfully written, False otherwise.
+ */
+bool Authorizer::writeAutomaton(const amore::finite_automaton& automaton, const string& graphPath) {
+  ofstream automaton_file;
+  string temporaryPath = graphPath + ".tmp";
   try {
-    automaton_file.open(this->graphPath, ios::out);
+    automaton_file.open(temporaryPath, ios::out | ios::binary | ios::trunc);
   } catch (ios_base::failure& e) {
-    ERROR("Impossible to open " + this->graphPath + " in write/binary mode: " + e.what());
+    ERROR("Impossible to open " + temporaryPath + " in write/binary mode: " + e.what());
     return false;
   }
-  basic_string<int32_t> aut_serialized = this->automata->serialize();
-  for (int32_t i : aut_serialized) {
-    automaton_file.write((char*) &i, sizeof (i));
-  }
+  basic_string<int32_t> aut_serialized = automaton.serialize();
+  automaton_file.write((const char*) aut_serialized.data(), (streamsize) (aut_serialized.size() * sizeof(int32_t)));
   automaton_file.flush();
   if (!automaton_file.good()) {
-    ERROR("Error occurred while writing the automaton in " + this->graphPath);
+    ERROR("Error occurred while writing the automaton in " + temporaryPath);
     automaton_file.close();
     return false;
   }
   automaton_file.close();
-  cout << "Automaton saved in " << this->graphPath << endl;
+  if (rename(temporaryPath.c_str(), graphPath.c_str()) < 0) {
+    ERROR("Impossible to move " + temporaryPath + " to " + graphPath + ": " + strerror(errno));
+    errno = 0;
+    return false;
+  }
   return true;
 }
 
@@ -253,29 +561,81 @@ bool Authorizer::save() {
  */
 bool Authorizer::addTransition(shared_ptr<ProcessSyscallEntry> state) {
   int label;
-  bool new_state = false;
-  assert(this->automata != nullptr);
+  set<int> targets;
   map< int, map<int, set<int> > > pre_transitions, transitions;
+  if (!this->loadModel()) {
+    return false;
+  }
   this->automata->get_transition_maps(pre_transitions, transitions);  // TODO: Very time consuming operation, shall be optimized
-  new_state = this->associations.find(state) == Mapper::NOT_FOUND;
-  label = this->associations.insert(state);
-  for (const int& i : this->currentStates[state->getSpid()]) {
-    transitions[i][label] = { label };
+  label = this->associations->insert(state);
+  // In a learned automaton the state of a label is the label itself, an optimised one may have merged it with others:
+  // the new transitions lead where the label already leads or, if it is new, to a new state
+  if (CompactAutomaton::fromAmore(*this->automata).hasLabelledStates()) {
+    targets = { label };
+  } else {
+    for (const auto& i : transitions) {
+      auto j = i.second.find(label);
+      if (j != i.second.end()) {
+        targets.insert(j->second.begin(), j->second.end());
+      }
+    }
+    if (targets.empty()) {
+      targets = { (int) this->automata->get_state_count() };
+    }
+  }
+  for (const int& i : this->getNfaStates(state->getSpid())) {
+    transitions[i][label].insert(targets.begin(), targets.end());
     cout << "Added a new transition from " << i << " to " << label << endl;
   }
-  this->currentStates[state->getSpid()] = { label };
+  // The rebuilt automaton is not determinised and it may not fit a matrix anymore, so every tracee has to be moved
+  // back on the NFA states
+  vector<unordered_map<pid_t, set<int>>> threadStates(this->shards.size());
+  unordered_map<pid_t, set<int>> generatorStates, childStates;
+  for (unsigned int i = 0; i < this->shards.size(); i++) {
+    for (const auto& j : this->shards[i]->currentStates) {
+      threadStates[i][j.first] = this->compact.expand(this->shards[i]->cache.getStates(j.second));
+    }
+    for (const auto& j : this->shards[i]->lastSyscalls) {
+      threadStates[i][j.first] = this->matrix->getStates(j.second);
+    }
+  }
+  boost::mutex::scoped_lock handoffLock(this->handoffMutex);
+  for (const auto& i : this->cloneGenerators) {
+    generatorStates[i.first] = this->expand(i.second);
+  }
+  for (const auto& i : this->pendingChildren) {
+    childStates[i.first] = this->expand(i.second);
+  }
+  threadStates[(unsigned int) state->getSpid() % this->shards.size()][state->getSpid()] = targets;
+  if (state->getChildPid() == ProcessSyscallEntry::POSSIBLE_CHILD) {
+    generatorStates[state->getSpid()] = targets;
+  }
   set<int> initial_states = this->automata->get_initial_states();
   set<int> final_states = this->automata->get_final_states();
   // Rebuild the automata
   if (!this->automata->construct(false,
-                                 (int) this->automata->get_alphabet_size() + (new_state ? 1 : 0),
-                                 (int) this->automata->get_state_count() + (new_state ? 1 : 0),
+                                 max((int) this->automata->get_alphabet_size(), label + 1),
+                                 max((int) this->automata->get_state_count(), *targets.rbegin() + 1),
                                  initial_states,
                                  final_states,
                                  transitions)) {
     ERROR("Impossible to build a new automaton after the new transition insertion");
     return false;
   }
+  this->buildCompactAutomaton(false);
+  for (unsigned int i = 0; i < this->shards.size(); i++) {
+    this->shards[i]->currentStates.clear();
+    this->shards[i]->lastSyscalls.clear();
+    for (const auto& j : threadStates[i]) {
+      this->setNfaStates(*this->shards[i], j.first, j.second);
+    }
+  }
+  for (const auto& i : generatorStates) {
+    this->cloneGenerators[i.first] = this->lift(i.second);
+  }
+  for (const auto& i : childStates) {
+    this->pendingChildren[i.first] = this->lift(i.second);
+  }
   return true;
 }
 
@@ -287,18 +647,29 @@ bool Authorizer::addTransition(shared_ptr<ProcessSyscallEntry> state) {
  * @return True if the automata import was successful otherwise print an error and return False
  */
 bool Authorizer::importAutomaton() {
-  assert(this->graphPath.size() > 0);
+  this->automata = Authorizer::readAutomaton(this->graphPath);
+  return this->automata != nullptr;
+}
+
+/**
+ * Reads an NFA serialised by Authorizer::save.
+ *
+ * @param graphPath The path of the serialised NFA.
+ * @return The imported NFA, nullptr if it does not exist or it cannot be deserialised.
+ */
+unique_ptr<amore::nondeterministic_finite_automaton> Authorizer::readAutomaton(const string& graphPath) {
+  assert(graphPath.size() > 0);
   ifstream aut_file;
   cout << "Importing the specified graph..." << endl;
   try {
-    aut_file.open(this->graphPath, ios::in | ios::binary);
+    aut_file.open(graphPath, ios::in | ios::binary);
   } catch (ios_base::failure &e) {
-    ERROR("Impossible to open input graph file " + this->graphPath + ": " + e.what());
-    return false;
+    ERROR("Impossible to open input graph file " + graphPath + ": " + e.what());
+    return nullptr;
   }
 	if(aut_file.fail()) {
 		ERROR("Input graph file does not exist, skipping import");
-		return false;
+		return nullptr;
 	}
   basic_string<int32_t> aut_string;
   int32_t t;
@@ -308,16 +679,109 @@ bool Authorizer::importAutomaton() {
   }
   basic_string<int32_t>::const_iterator begin = aut_string.begin();
   basic_string<int32_t>::const_iterator end = aut_string.end();
-  this->automata = std::make_unique<amore::nondeterministic_finite_automaton>();
-  if (this->automata->deserialize(begin, end)) {
+  unique_ptr<amore::nondeterministic_finite_automaton> automaton = std::make_unique<amore::nondeterministic_finite_automaton>();
+  if (automaton->deserialize(begin, end)) {
     aut_file.close();
-    cout << "Automaton successfully imported from " << this->graphPath << endl;
-    return true;
+    cout << "Automaton successfully imported from " << graphPath << endl;
+    return automaton;
   } else {
-    ERROR("Error while trying to import the graph from " + this->graphPath);
+    ERROR("Error while trying to import the graph from " + graphPath);
     aut_file.close();
+    return nullptr;
+  }
+}
+
+/**
+ * Makes sure that Authorizer::automata and Authorizer::associations exist, so that they can be changed.
+ * When a policy bundle is enforced they are built from it the first time they are needed.
+ * It must be called holding Authorizer::modelMutex exclusively.
+ *
+ * @return True if the model can be changed, False otherwise.
+ */
+bool Authorizer::loadModel() {
+  if (this->automata != nullptr) {
+    return true;
+  }
+  assert(this->bundle != nullptr);
+  stringstream associationsText;
+  cout << "Loading the policy in order to change it..." << endl;
+  this->automata = this->bundle->getAutomaton().toAmore();
+  if (this->automata == nullptr) {
+    ERROR("Impossible to build the automaton of the policy");
     return false;
   }
+  this->bundle->writeAssociations(associationsText);
+  this->associations = make_unique<Mapper>(this->associationsPath, associationsText);
+  return true;
+}
+
+/**
+ * Gets the NFA as it would be saved, without transparent labels nor determinisation.
+ *
+ * @return The compact copy of the NFA.
+ */
+CompactAutomaton Authorizer::getAutomaton() const {
+  return this->automata != nullptr ? CompactAutomaton::fromAmore(*this->automata) : this->bundle->getAutomaton();
+}
+
+/**
+ * Looks for the association number of a system call in the associations or, if they have not been loaded, in the policy bundle.
+ *
+ * @param syscall The system call that will be searched.
+ * @return The association number of syscall, Mapper::NOT_FOUND if it has not been found.
+ */
+int Authorizer::findLabel(const shared_ptr<ProcessSyscallEntry>& syscall) const {
+  return this->associations != nullptr ? (int) this->associations->find(syscall) : this->bundle->find(syscall);
+}
+
+map<int, set<int>> Authorizer::getSyscallLabels() const {
+  return this->associations != nullptr ? this->associations->getSyscallLabels() : this->bundle->getSyscallLabels();
+}
+
+/**
+ * Builds the compact copy of Authorizer::automata used to enforce, it has to be called every time the
+ * transitions of Authorizer::automata change.
+ * Every state set ID previously returned by the shards caches becomes invalid.
+ *
+ * @param determinise If True the compact copy is determinised, unless it would have too many states.
+ */
+void Authorizer::buildCompactAutomaton(bool determinise) {
+  CompactAutomaton deterministic;
+  // Every cached state set refers to the previous automaton
+  for (auto& shard : this->shards) {
+    shard->cache.clear();
+  }
+  this->compact = this->getAutomaton().withTransparentLabels(this->transparentLabels);
+  this->buildSyscallMatrix();
+  if (!determinise || this->compact.isDeterministic()) {
+    return;
+  }
+  cout << "Determinising the automaton..." << endl;
+  if (!this->compact.determinize(CompactAutomaton::DEFAULT_MAX_DFA_STATES, deterministic)) {
+    cerr << "The determinised automaton would have more than " << CompactAutomaton::DEFAULT_MAX_DFA_STATES
+         << " states, the NFA will be used" << endl;
+    return;
+  }
+  cout << "Automaton determinised from " << this->compact.getStateCount() << " to "
+       << deterministic.getStateCount() << " states" << endl;
+  this->compact = std::move(deterministic);
+}
+
+/**
+ * Builds Authorizer::matrix if it has been requested and the automaton can be represented by a matrix, it has to be
+ * called every time the transitions or the final states of Authorizer::automata change.
+ */
+void Authorizer::buildSyscallMatrix() {
+  SyscallMatrix base;
+  this->matrix = nullptr;
+  if (!this->matrixRequested) {
+    return;
+  }
+  // A bundle contains the matrix of its automaton, if any, so that its associations do not need to be loaded
+  if (this->associations != nullptr ? SyscallMatrix::fromAutomaton(this->getAutomaton(), *this->associations, base)
+                                    : this->bundle->getSyscallMatrix(base)) {
+    this->matrix = make_unique<SyscallMatrix>(base.withTransparentLabels(this->transparentLabels));
+  }
 }
 
 /**
@@ -330,25 +794,35 @@ bool Authorizer::importAutomaton() {
  */
 int Authorizer::isAuthorized(const shared_ptr<ProcessNotification>& state) {
   assert(state != nullptr);
-  set<int> futureStates, intersection, temp;
+  unsigned int futureStates;
   int label;
-  bool found = false;
-  // In learning mode we only want to acquire every produced state, exiting syscalls do not need to be checked
-  if (this->learning || dynamic_pointer_cast<ProcessSyscallExit>(state)) {
-    this->processStates.push_back(state);
+  if (this->sequenceModel != nullptr) {
+    return dynamic_pointer_cast<ProcessSyscallExit>(state) ? Authorizer::AUTHORISED
+                                                           : this->checkSequence(this->getShard(state->getSpid()), state, this->learning);
+  }
+  // In learning mode we only want to acquire every produced state
+  if (this->learning) {
+    this->learn(state);
     return Authorizer::AUTHORISED;
   }
+  // Exiting syscalls do not need to be checked
+  if (dynamic_pointer_cast<ProcessSyscallExit>(state)) {
+    return Authorizer::AUTHORISED;
+  }
+  Shard& shard = this->getShard(state->getSpid());
+  if (this->store != nullptr) {
+    return this->isAuthorizedByStore(shard, state);
+  }
+  if (this->matrix != nullptr) {
+    return this->isAuthorizedByMatrix(shard, state);
+  }
   shared_ptr<ProcessTermination> termination = dynamic_pointer_cast<ProcessTermination>(state);
   if (termination) {
-	  futureStates = this->currentStates[termination->getSpid()];
-    temp = this->automata->get_final_states();
+    auto terminationStates = shard.currentStates.find(termination->getSpid());
     // Check if this tracee is in a final state
-    set_intersection(futureStates.begin(), futureStates.end(),
-                     temp.begin(), temp.end(),
-                     inserter(intersection, intersection.begin()));
-    if (intersection.empty()) {
-      cout << "The traced thread is on the association numbers ";
-	    this->printSet(futureStates);
+    if (terminationStates == shard.currentStates.end() || !shard.cache.isFinal(terminationStates->second)) {
+      cout << "The traced thread is on the states ";
+	    this->printSet(this->getCurrentStates(termination->getSpid()));
       cout << endl << "But none of those states is final and the tracee is terminated" << endl;
       return Authorizer::NOT_FINAL;
     }
@@ -356,196 +830,923 @@ int Authorizer::isAuthorized(const shared_ptr<ProcessNotification>& state) {
   }
   shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(state);
   // In enforce mode we want to check that every transition has been already seen
-  assert(this->automata != nullptr);
   assert(syscall != nullptr);
-  if (this->currentStates.find(syscall->getSpid()) == this->currentStates.end()) {
-    if (this->currentStates.empty()) {
-			// If this is the first traced process
-      this->currentStates[syscall->getSpid()] = this->automata->get_initial_states();
-    } else {
-			// If an unknown SPID has been received
-      for (auto it = this->childGenerators.begin();
-           it != this->childGenerators.end() && !found;
-           it++) {
-        if ((*it)->getChildPid() > 0 && (*it)->getReturnValue() == syscall->getSpid()) {
-          label = this->associations.find(*it);
-          assert(label != Mapper::NOT_FOUND && label > 0);
-          this->currentStates[syscall->getSpid()] = { label };
-          this->childGenerators.erase(it);
-          found = true;
-        }
-      }
-      if (!found) {
-        cout << "This state come from an unknown thread -> Not authorised" << endl;
-        return Authorizer::NOT_AUTHORISED;
-      }
+  auto current = shard.currentStates.find(syscall->getSpid());
+  if (current == shard.currentStates.end()) {
+    StateSet startingStates;
+    if (!this->takeStartingStates(syscall->getSpid(), startingStates)) {
+      cout << "This state come from an unknown thread -> Not authorised" << endl;
+      return Authorizer::NOT_AUTHORISED;
     }
+    current = shard.currentStates.emplace(syscall->getSpid(), shard.cache.intern(startingStates)).first;
   }
-  if ((label = this->associations.find(syscall)) == Mapper::NOT_FOUND) {
+  if ((label = this->findLabel(syscall)) == Mapper::NOT_FOUND) {
     cout << "State not found in the list of associations -> Not authorised" << endl;
     return Authorizer::NOT_AUTHORISED;
   }
-	futureStates = this->automata->transition({this->currentStates[syscall->getSpid()] }, label);
-  if (futureStates.empty()) {
+  if (!shard.cache.step(current->second, label, futureStates)) {
     cout << "There are no possible transitions from ";
-	  this->printSet(this->currentStates[syscall->getSpid()]);
+	  this->printSet(shard.cache.getStates(current->second));
     cout << " to " << label << endl;
     cout << "System call NOT authorised" << endl;
     return Authorizer::NOT_AUTHORISED;
   }
-  cout << "Transition from ";
-	this->printSet(this->currentStates[syscall->getSpid()]);
-  this->currentStates[syscall->getSpid()] = futureStates;
-  cout << " to ";
-	this->printSet(futureStates);
-  cout << " has been authorised" << endl;
-  if (syscall->getChildPid() > 0) {
-    assert(syscall->getReturnValue() > 0 && syscall->getReturnValue() < Tracer::MAX_PID);
-    this->currentStates[(int) syscall->getReturnValue()] = this->currentStates[syscall->getSpid()];
-  }
+  current->second = futureStates;
+  this->trimCache(shard);
+  // The clone is executed only after its authorisation, so these states are recorded before the child creation
   if (syscall->getChildPid() == ProcessSyscallEntry::POSSIBLE_CHILD) {
-    this->childGenerators.emplace_back(syscall);
+    boost::mutex::scoped_lock lock(this->handoffMutex);
+    this->cloneGenerators[syscall->getSpid()] = shard.cache.getStates(current->second);
   }
   // Check if this should be a final state -> possible automaton creation error
-  if (ProcessSyscallEntry::exitSyscalls.find(syscall->getSyscall()) != ProcessSyscallEntry::exitSyscalls.end()) {
-    temp = this->automata->get_final_states();
-    if (temp.find(label) == temp.end()) {
+  if (ProcessSyscallEntry::exitSyscalls.find(syscall->getSyscall()) != ProcessSyscallEntry::exitSyscalls.end() &&
+      !shard.cache.isFinal(current->second)) {
+    return Authorizer::NOT_FINAL;
+  }
+  return Authorizer::AUTHORISED;
+}
+
+/**
+ * Checks a ProcessState on Authorizer::matrix, as Authorizer::isAuthorized does on the automaton: the row of the last
+ * system call of the thread is the only state kept, so every check is a single bit test.
+ *
+ * @param shard The shard of the thread that generated state.
+ * @param state The ProcessNotification that will be tested, it is not a syscall exit.
+ * @return The same values of Authorizer::isAuthorized.
+ */
+int Authorizer::isAuthorizedByMatrix(Shard& shard, const shared_ptr<ProcessNotification>& state) {
+  auto current = shard.lastSyscalls.find(state->getSpid());
+  if (dynamic_pointer_cast<ProcessTermination>(state)) {
+    if (current == shard.lastSyscalls.end() || !this->matrix->isFinal(current->second)) {
+      set<int> states = this->getNfaStates(state->getSpid());
+      cout << "The traced thread is on the states ";
+      this->printSet(StateSet(states.begin(), states.end()));
+      cout << endl << "But none of those states is final and the tracee is terminated" << endl;
       return Authorizer::NOT_FINAL;
     }
+    return Authorizer::AUTHORISED;
+  }
+  shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(state);
+  assert(syscall != nullptr);
+  if (current == shard.lastSyscalls.end()) {
+    StateSet startingStates;
+    if (!this->takeStartingStates(syscall->getSpid(), startingStates) || startingStates.empty()) {
+      cout << "This state come from an unknown thread -> Not authorised" << endl;
+      return Authorizer::NOT_AUTHORISED;
+    }
+    current = shard.lastSyscalls.emplace(syscall->getSpid(), startingStates.front()).first;
+  }
+  if (syscall->getExecutableName() != this->matrix->getExecutable() || !this->matrix->step(current->second, syscall->getSyscall())) {
+    set<int> states = this->matrix->getStates(current->second);
+    cout << "There are no possible transitions from ";
+    this->printSet(StateSet(states.begin(), states.end()));
+    cout << " with the system call " << syscall->getSyscall() << " of " << syscall->getExecutableName() << endl;
+    cout << "System call NOT authorised" << endl;
+    return Authorizer::NOT_AUTHORISED;
+  }
+  if (syscall->getChildPid() == ProcessSyscallEntry::POSSIBLE_CHILD) {
+    boost::mutex::scoped_lock lock(this->handoffMutex);
+    this->cloneGenerators[syscall->getSpid()] = { current->second };
+  }
+  if (ProcessSyscallEntry::exitSyscalls.find(syscall->getSyscall()) != ProcessSyscallEntry::exitSyscalls.end() &&
+      !this->matrix->isFinal(current->second)) {
+    return Authorizer::NOT_FINAL;
   }
   return Authorizer::AUTHORISED;
 }
 
 /**
- * Handle such a situation where an unauthorised process state occurs.
- * 
- * @param state The current ProcessState that is not authorised.
- * @return True if the target process can go on, False otherwise.
+ * Checks a ProcessState on the policy of its executable in Authorizer::store, as Authorizer::isAuthorized does on the
+ * automaton. A thread acquires the policy of its executable at its first system call and again every time it runs
+ * another executable, after an execve, starting from its initial states; it releases it when it terminates, so that
+ * the policies that no traced thread runs are unloaded.
+ *
+ * @param shard The shard of the thread that generated state.
+ * @param state The ProcessNotification that will be tested, it is not a syscall exit.
+ * @return The same values of Authorizer::isAuthorized.
  */
-bool Authorizer::handleUnauthorised(shared_ptr<ProcessNotification> state) {
-  int choice;
+int Authorizer::isAuthorizedByStore(Shard& shard, const shared_ptr<ProcessNotification>& state) {
+  auto current = shard.storeStates.find(state->getSpid());
+  if (dynamic_pointer_cast<ProcessTermination>(state)) {
+    if (current == shard.storeStates.end()) {
+      cout << "The traced thread is terminated without any system call checked" << endl;
+      return Authorizer::NOT_FINAL;
+    }
+    StoreState terminated = std::move(current->second);
+    shard.storeStates.erase(current);
+    if (terminated.model == nullptr || !terminated.model->automaton.isFinal(terminated.states)) {
+      cout << "The traced thread of " << terminated.executableName << " is on the states ";
+      this->printSet(terminated.states);
+      cout << endl << "But none of those states is final and the tracee is terminated" << endl;
+      return Authorizer::NOT_FINAL;
+    }
+    return Authorizer::AUTHORISED;
+  }
+  shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(state);
+  assert(syscall != nullptr);
+  if (current == shard.storeStates.end()) {
+    StateSet startingStates;
+    if (!this->takeStartingStates(syscall->getSpid(), startingStates)) {
+      cout << "This state come from an unknown thread -> Not authorised" << endl;
+      return Authorizer::NOT_AUTHORISED;
+    }
+    current = shard.storeStates.emplace(syscall->getSpid(), StoreState { "", nullptr, startingStates }).first;
+  }
+  StoreState& thread = current->second;
+  if (thread.executableName != syscall->getExecutableName()) {
+    // A thread handed over by a clone keeps the states of its father, after an execve it starts from the beginning
+    bool restart = !thread.executableName.empty() || thread.states.empty();
+    thread.executableName = syscall->getExecutableName();
+    thread.model = this->store->acquire(thread.executableName, syscall->getPid());
+    if (restart) {
+      thread.states = thread.model != nullptr ? thread.model->automaton.getInitialStates() : StateSet();
+    }
+  }
+  if (thread.model == nullptr) {
+    cout << "No policy has been learned for " << thread.executableName << " -> Not authorised" << endl;
+    return Authorizer::NOT_AUTHORISED;
+  }
+  int label = thread.model->find(syscall);
+  if (label == Mapper::NOT_FOUND) {
+    cout << "State not found in the associations of " << thread.executableName << " -> Not authorised" << endl;
+    return Authorizer::NOT_AUTHORISED;
+  }
+  StateSet futureStates;
+  if (!thread.model->automaton.step(thread.states, label, futureStates)) {
+    cout << "There are no possible transitions from ";
+    this->printSet(thread.states);
+    cout << " to " << label << " in the policy of " << thread.executableName << endl;
+    cout << "System call NOT authorised" << endl;
+    return Authorizer::NOT_AUTHORISED;
+  }
+  thread.states = std::move(futureStates);
+  if (syscall->getChildPid() == ProcessSyscallEntry::POSSIBLE_CHILD) {
+    boost::mutex::scoped_lock lock(this->handoffMutex);
+    this->cloneGenerators[syscall->getSpid()] = thread.states;
+  }
+  if (ProcessSyscallEntry::exitSyscalls.find(syscall->getSyscall()) != ProcessSyscallEntry::exitSyscalls.end() &&
+      !thread.model->automaton.isFinal(thread.states)) {
+    return Authorizer::NOT_FINAL;
+  }
+  return Authorizer::AUTHORISED;
+}
+
+/**
+ * Checks or learns a ProcessState with Authorizer::sequenceModel: a system call is authorised if the window of the
+ * last association numbers of its thread, ending with its own, is in the model and a termination if the window that
+ * ends with SequenceModel::TERMINATION is.
+ *
+ * @param shard The shard of the thread that generated state.
+ * @param state The ProcessNotification that will be tested, it is not a syscall exit.
+ * @param learn If True every window is added to the model instead of being checked.
+ * @return The same values of Authorizer::isAuthorized.
+ */
+int Authorizer::checkSequence(Shard& shard, const shared_ptr<ProcessNotification>& state, bool learn) {
+  auto current = shard.histories.find(state->getSpid());
+  if (dynamic_pointer_cast<ProcessTermination>(state)) {
+    if (current == shard.histories.end() && this->learning) {
+      return Authorizer::AUTHORISED;
+    }
+    LabelWindow window = this->sequenceModel->getWindow(current != shard.histories.end() ? current->second.labels : LabelWindow(),
+                                                        SequenceModel::TERMINATION);
+    if (learn) {
+      this->sequenceModel->learn(state->getExecutableName(), window);
+    } else if (current == shard.histories.end() || !this->sequenceModel->accepts(state->getExecutableName(), window)) {
+      cout << "The traced thread terminated after the system calls ";
+      this->printSet(StateSet(window.begin(), window.end() - 1));
+      cout << endl << "But this termination has never been observed" << endl;
+      return Authorizer::NOT_FINAL;
+    }
+    if (current != shard.histories.end()) {
+      shard.histories.erase(current);
+    }
+    return Authorizer::AUTHORISED;
+  }
   shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(state);
   assert(syscall != nullptr);
-  cout << "Warning! Found a Process syscall that has never been observed before!" << endl << endl;
+  if (current == shard.histories.end()) {
+    StateSet startingStates;
+    if (!this->takeStartingStates(syscall->getSpid(), startingStates)) {
+      if (!learn) {
+        cout << "This state come from an unknown thread -> Not authorised" << endl;
+        return Authorizer::NOT_AUTHORISED;
+      }
+      cout << "The traced thread " << syscall->getSpid() << " has not been generated by an observed clone, it starts from the initial state" << endl;
+    }
+    current = shard.histories.emplace(syscall->getSpid(), History { "", LabelWindow(startingStates.begin(), startingStates.end()) }).first;
+  }
+  int label = learn ? (int) this->associations->insert(syscall) : this->findLabel(syscall);
+  if (label == Mapper::NOT_FOUND) {
+    cout << "State not found in the list of associations -> Not authorised" << endl;
+    return Authorizer::NOT_AUTHORISED;
+  }
+  LabelWindow window = this->sequenceModel->getWindow(current->second.labels, label);
+  if (learn) {
+    this->sequenceModel->learn(syscall->getExecutableName(), window);
+  } else if (!this->sequenceModel->accepts(syscall->getExecutableName(), window)) {
+    cout << "The system calls ";
+    this->printSet(StateSet(window.begin(), window.end()));
+    cout << " have never been observed in this order" << endl;
+    cout << "System call NOT authorised" << endl;
+    return Authorizer::NOT_AUTHORISED;
+  }
+  current->second.executableName = syscall->getExecutableName();
+  this->sequenceModel->advance(current->second.labels, label);
+  // The child starts from the history of its father, as it would from the states reached by the clone
+  if (syscall->getChildPid() == ProcessSyscallEntry::POSSIBLE_CHILD) {
+    boost::mutex::scoped_lock lock(this->handoffMutex);
+    this->cloneGenerators[syscall->getSpid()] = StateSet(current->second.labels.begin(), current->second.labels.end());
+  }
+  if (!learn && ProcessSyscallEntry::exitSyscalls.find(syscall->getSyscall()) != ProcessSyscallEntry::exitSyscalls.end() &&
+      !this->sequenceModel->accepts(syscall->getExecutableName(),
+                                    this->sequenceModel->getWindow(current->second.labels, SequenceModel::TERMINATION))) {
+    return Authorizer::NOT_FINAL;
+  }
+  return Authorizer::AUTHORISED;
+}
+
+/**
+ * Adds a violation to Authorizer::sequenceModel, as Authorizer::addTransition and Authorizer::markFinal do for the NFA.
+ * It must be called holding Authorizer::modelMutex exclusively.
+ *
+ * @param state     The ProcessNotification that is not authorised or not final.
+ * @param violation Either Authorizer::NOT_AUTHORISED or Authorizer::NOT_FINAL.
+ */
+void Authorizer::learnSequence(const shared_ptr<ProcessNotification>& state, int violation) {
+  Shard& shard = this->getShard(state->getSpid());
+  auto current = shard.histories.find(state->getSpid());
+  // An exit syscall has already been authorised, only the termination that follows it is missing
+  if (violation == Authorizer::NOT_FINAL && dynamic_pointer_cast<ProcessSyscallEntry>(state) && current != shard.histories.end()) {
+    this->sequenceModel->learn(state->getExecutableName(),
+                               this->sequenceModel->getWindow(current->second.labels, SequenceModel::TERMINATION));
+    return;
+  }
+  this->checkSequence(shard, state, true);
+}
+
+/**
+ * Applies a decision to a violation found by Authorizer::isAuthorized, unless it is killed or the decision is
+ * left to the operator the offending tracee is let go on.
+ * It must be called holding Authorizer::modelMutex exclusively.
+ *
+ * @param state     The ProcessNotification that is not authorised or not final.
+ * @param violation Either Authorizer::NOT_AUTHORISED or Authorizer::NOT_FINAL.
+ * @param decision  What to do with state.
+ */
+void Authorizer::handleViolation(const shared_ptr<ProcessNotification>& state, int violation, ViolationPolicy decision) {
+  assert(violation == Authorizer::NOT_AUTHORISED || violation == Authorizer::NOT_FINAL);
+  shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(state);
+  assert(violation != Authorizer::NOT_AUTHORISED || syscall != nullptr);
+  switch (decision) {
+    case Authorizer::KILL:
+      // A terminated tracee has nothing left to kill
+      if (syscall != nullptr) {
+        cout << "The tracee SPID " << state->getSpid() << " will be killed" << endl;
+        TracingManager::kill_process(state->getSpid());
+      }
+      break;
+    case Authorizer::DENY:
+      if (violation == Authorizer::NOT_AUTHORISED) {
+        if (!TracingManager::deny(syscall)) {
+          cerr << "Error occurred while trying to deny a system call for SPID " << state->getSpid() << endl;
+        }
+      } else {
+        // A termination cannot be prevented, it only stays out of the automaton
+        cout << "The state of SPID " << state->getSpid() << " will not be marked as final" << endl;
+        Authorizer::proceed(state);
+      }
+      break;
+    case Authorizer::LEARN:
+      if (this->store != nullptr) {
+        // The policies of a model directory are read only, the violation is only let go once
+        cout << "The policies of a model directory cannot be changed, the violation of SPID " << state->getSpid()
+             << " is allowed only this time" << endl;
+        if (violation == Authorizer::NOT_AUTHORISED) {
+          this->followViolation(this->getShard(state->getSpid()), syscall);
+        }
+      } else if (this->sequenceModel != nullptr) {
+        this->learnSequence(state, violation);
+      } else if (violation == Authorizer::NOT_AUTHORISED) {
+        this->addTransition(syscall);
+      } else {
+        this->markFinal(state);
+      }
+      Authorizer::proceed(state);
+      break;
+    case Authorizer::ASK:
+      this->operatorQueue.push({ state, violation });
+      break;
+    case Authorizer::SHADOW:
+      // The notification has already proceeded
+      this->recordViolation(state->getExecutableName(),
+                            syscall != nullptr ? SyscallNameResolver::resolve((unsigned int) syscall->getSyscall()) : "termination",
+                            violation);
+      if (violation == Authorizer::NOT_AUTHORISED) {
+        this->followViolation(this->getShard(state->getSpid()), syscall);
+      }
+      break;
+  }
+}
+
+/**
+ * Asks the operator what to do with a violation, it must be called without holding Authorizer::modelMutex so that
+ * the other tracees are not stopped while waiting for an answer.
+ *
+ * @param state     The ProcessNotification that is not authorised or not final.
+ * @param violation Either Authorizer::NOT_AUTHORISED or Authorizer::NOT_FINAL.
+ * @return The operator decision, Authorizer::DENY if the standard input is closed.
+ */
+Authorizer::ViolationPolicy Authorizer::askOperator(const shared_ptr<ProcessNotification>& state, int violation) {
+  int choice;
+  if (violation == Authorizer::NOT_AUTHORISED) {
+    cout << "Warning! Found a Process syscall that has never been observed before!" << endl << endl;
+  } else {
+    cout << "Warning! Found a Process state that should has been marked as final state but it is not" << endl << endl;
+  }
   cout << "State observed:" << endl;
-  syscall->print();
-  do {
+  state->print();
+  while (true) {
     cout << "Possible actions:" << endl;
     cout << "1 - Kill the target process" << endl;
-    cout << "2 - Add the new state in the graph and allow it" << endl;
+    if (violation == Authorizer::NOT_AUTHORISED) {
+      cout << "2 - Add the new state in the graph and allow it" << endl;
+      cout << "3 - Deny the system call and let the target process go on" << endl;
+    } else {
+      cout << "2 - Set the state as final" << endl;
+      cout << "3 - Let the target process go on without changing the graph" << endl;
+    }
     cout << "Choice: ";
-    cin >> choice;
+    if (!(cin >> choice)) {
+      if (cin.eof()) {
+        cout << "No operator available, the violation will be denied" << endl;
+        return Authorizer::DENY;
+      }
+      cin.clear();
+      cin.ignore(numeric_limits<streamsize>::max(), '\n');
+      choice = 0;
+    }
     switch (choice) {
       case 1:
-        TracingManager::kill_process();
-        return false;
+        return Authorizer::KILL;
       case 2:
-	      this->addTransition(syscall);
-        break;
+        return Authorizer::LEARN;
+      case 3:
+        return Authorizer::DENY;
       default:
         cout << "Invalid choice" << endl;
         break;
     }
-  } while (choice < 1 || choice > 2);
-  return true;
+  }
 }
 
 /**
- * Handle such a situation where a state that is going to terminate the Tracee is not
- * marked as final in the automaton.
- * 
- * @param state The current ProcessState that is not marked as final.
- * @return True if the target process can go on, False otherwise.
+ * Operator thread entry point, it takes a decision for every violation in Authorizer::operatorQueue until
+ * a nullptr notification is received.
  */
-bool Authorizer::handleNonFinal(shared_ptr<ProcessNotification> state) {
-  int choice;
+void Authorizer::operatorLoop() {
+  pair<shared_ptr<ProcessNotification>, int> violation;
+  while ((violation = this->operatorQueue.pop()).first != nullptr) {
+    ViolationPolicy decision = Authorizer::askOperator(violation.first, violation.second);
+    boost::unique_lock<boost::shared_mutex> lock(this->modelMutex);
+    this->handleViolation(violation.first, violation.second, decision);
+  }
+}
+
+/**
+ * Waits for the operator to decide on every pending violation and then stops the operator thread, if any.
+ */
+void Authorizer::stopOperator() {
+  if (this->operatorThread) {
+    this->operatorQueue.push({ nullptr, Authorizer::AUTHORISED });
+    this->operatorThread->join();
+    this->operatorThread = nullptr;
+  }
+}
+
+/**
+ * Shadow thread entry point, it runs every task of Authorizer::shadowQueue until an empty one is received.
+ */
+void Authorizer::shadowLoop() {
+  function<void ()> task;
+  while ((task = this->shadowQueue.pop())) {
+    task();
+  }
+}
+
+/**
+ * Waits for the shadow thread to check every pending notification and then stops it.
+ */
+void Authorizer::stopShadow() {
+  if (this->shadowThread) {
+    this->shadowQueue.push(nullptr);
+    this->shadowThread->join();
+    this->shadowThread = nullptr;
+  }
+}
+
+/**
+ * Counts a violation found in shadow mode, the first one of every system call of every executable is also printed.
+ * It must be called holding Authorizer::modelMutex exclusively or after the shadow thread has been stopped.
+ *
+ * @param executableName The executable of the offending tracee, empty if it is not known.
+ * @param event          The system call name or "termination".
+ * @param violation      Either Authorizer::NOT_AUTHORISED or Authorizer::NOT_FINAL.
+ */
+void Authorizer::recordViolation(const string& executableName, const string& event, int violation) {
+  if (violation == Authorizer::NOT_AUTHORISED) {
+    this->shadowNotAuthorised++;
+  } else {
+    this->shadowNotFinal++;
+  }
+  if (this->shadowViolations[{ executableName, event }]++ == 0) {
+    cout << "Shadow violation: " << (violation == Authorizer::NOT_AUTHORISED ? "not authorised " : "not final ") << event
+         << " of " << (executableName.empty() ? "an unknown executable" : executableName) << endl;
+  }
+}
+
+/**
+ * In shadow mode, or when a violation is allowed once, a system call that is not authorised is executed anyway, so its
+ * thread is moved where the system call leads, as it would be if it had been authorised; otherwise every following
+ * system call would be a violation too.
+ * It must be called holding Authorizer::modelMutex exclusively.
+ *
+ * @param shard   The shard of the thread that executed syscall.
+ * @param syscall The system call that has not been authorised.
+ */
+void Authorizer::followViolation(Shard& shard, const shared_ptr<ProcessSyscallEntry>& syscall) {
+  StateSet states;
+  if (this->store != nullptr) {
+    StoreState& thread = shard.storeStates.emplace(syscall->getSpid(), StoreState { "", nullptr, StateSet() }).first->second;
+    if (thread.executableName != syscall->getExecutableName()) {
+      thread.executableName = syscall->getExecutableName();
+      thread.model = this->store->acquire(thread.executableName, syscall->getPid());
+    }
+    int label = thread.model != nullptr ? thread.model->find(syscall) : Mapper::NOT_FOUND;
+    if (label == Mapper::NOT_FOUND || (states = thread.model->automaton.getTargets(label)).empty()) {
+      return;
+    }
+    thread.states = states;
+  } else if (this->matrix != nullptr) {
+    if (syscall->getExecutableName() != this->matrix->getExecutable() || syscall->getSyscall() < 0 ||
+        syscall->getSyscall() >= SyscallMatrix::INITIAL) {
+      return;
+    }
+    shard.lastSyscalls[syscall->getSpid()] = (int) syscall->getSyscall();
+    states = { (int) syscall->getSyscall() };
+  } else {
+    int label = this->findLabel(syscall);
+    if (label == Mapper::NOT_FOUND) {
+      return;
+    }
+    if (this->sequenceModel != nullptr) {
+      History& history = shard.histories.emplace(syscall->getSpid(), History { "", LabelWindow() }).first->second;
+      history.executableName = syscall->getExecutableName();
+      this->sequenceModel->advance(history.labels, label);
+      states = StateSet(history.labels.begin(), history.labels.end());
+    } else {
+      // Every state entered by the label of the system call
+      states = this->compact.getTargets(label);
+      if (states.empty()) {
+        return;
+      }
+      shard.currentStates[syscall->getSpid()] = shard.cache.intern(states);
+      this->trimCache(shard);
+    }
+  }
+  if (syscall->getChildPid() == ProcessSyscallEntry::POSSIBLE_CHILD) {
+    boost::mutex::scoped_lock lock(this->handoffMutex);
+    this->cloneGenerators[syscall->getSpid()] = states;
+  }
+}
+
+/**
+ * Prints the violations found in shadow mode, grouped by executable and system call.
+ */
+void Authorizer::printShadowReport() const {
+  cout << "Shadow enforcement: " << this->shadowChecks << " notifications checked, "
+       << this->shadowNotAuthorised << " system calls not authorised, " << this->shadowNotFinal << " non final terminations, "
+       << "at most " << this->shadowBacklog << " checks pending" << endl;
+  for (const auto& i : this->shadowViolations) {
+    cout << "  " << (i.first.first.empty() ? "unknown executable" : i.first.first) << " " << i.first.second << ": " << i.second << endl;
+  }
+}
+
+/**
+ * Marks as final the state reached by a tracee that is going to terminate.
+ *
+ * @param state Either the exit syscall entry or the termination of the tracee.
+ * @return True if the final states have been updated, False otherwise.
+ */
+bool Authorizer::markFinal(const shared_ptr<ProcessNotification>& state) {
   int state_label;
   set<int> new_final_states, final_states, temp;
   shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(state);
   shared_ptr<ProcessTermination> termination = dynamic_pointer_cast<ProcessTermination>(state);
-  cout << "Warning! Found a Process state that should has been marked as final state but it is not" << endl << endl;
-  cout << "State observed:" << endl;
-  state->print();
-  do {
-    cout << "Possible actions:" << endl;
-    cout << "1 - Kill the target process" << endl;
-    cout << "2 - Set the state as final" << endl;
-    cout << "Choice: ";
-    cin >> choice;
-    switch (choice) {
-      case 1:
-        TracingManager::kill_process();
-        return false;
-      case 2:
-        new_final_states = this->automata->get_final_states();
-        if (syscall != nullptr) {
-          state_label = this->associations.find(syscall);
-          if (state_label == Mapper::NOT_FOUND) {
-            ERROR("Trying to set a state as final but it is not in the associations file");
-            return false;
-          }
-          cout << "The association number " << state_label << " will be marked as final" << endl;
-          new_final_states.insert(state_label);
-          this->automata->set_final_states(new_final_states);
-        } else {
-          // In this case every state where termination->getSpid() lays will be marked as final
-          temp = this->currentStates[termination->getSpid()];
-          for (const int& i : temp) {
-            cout << "The association number " << i << " will be marked as final" << endl;
-          }
-          final_states = this->automata->get_final_states();
-          set_union(final_states.begin(), final_states.end(),
-                    temp.begin(), temp.end(),
-                    inserter(new_final_states, new_final_states.begin()));
-          this->automata->set_final_states(new_final_states);
-        }
-        break;
-      default:
-        cout << "Invalid choice" << endl;
-        break;
+  if (!this->loadModel()) {
+    return false;
+  }
+  new_final_states = this->automata->get_final_states();
+  if (syscall != nullptr) {
+    state_label = (int) this->associations->find(syscall);
+    if (state_label == Mapper::NOT_FOUND) {
+      ERROR("Trying to set a state as final but it is not in the associations file");
+      return false;
+    }
+    cout << "The association number " << state_label << " will be marked as final" << endl;
+    new_final_states.insert(state_label);
+    this->automata->set_final_states(new_final_states);
+  } else {
+    // In this case every state where termination->getSpid() lays will be marked as final
+    temp = this->getNfaStates(termination->getSpid());
+    for (const int& i : temp) {
+      cout << "The association number " << i << " will be marked as final" << endl;
     }
-  } while (choice < 1 || choice > 2);
+    final_states = this->automata->get_final_states();
+    set_union(final_states.begin(), final_states.end(),
+              temp.begin(), temp.end(),
+              inserter(new_final_states, new_final_states.begin()));
+    this->automata->set_final_states(new_final_states);
+  }
+  this->compact.setFinalStates(new_final_states);
+  for (auto& shard : this->shards) {
+    shard->cache.invalidate();
+  }
+  this->buildSyscallMatrix();
   return true;
 }
 
+/**
+ * Lets a syscall entry proceed, other notifications do not wait for any authorisation.
+ *
+ * @param state The notification that has been authorised.
+ */
+void Authorizer::proceed(const shared_ptr<ProcessNotification>& state) {
+  shared_ptr<ProcessSyscallEntry> entry = dynamic_pointer_cast<ProcessSyscallEntry>(state);
+  if (entry != nullptr && !TracingManager::authorize(entry)) {
+    cerr << "Error occurred while trying to authorize a system call for SPID " << state->getSpid() << endl;
+  }
+}
+
+/**
+ * Copies a syscall entry as it is before proceeding, the Tracer keeps changing the original one until its exit.
+ *
+ * @param state The notification that is about to proceed.
+ * @return A copy of state if it is a syscall entry, state itself otherwise.
+ */
+shared_ptr<ProcessNotification> Authorizer::snapshot(const shared_ptr<ProcessNotification>& state) {
+  shared_ptr<ProcessSyscallEntry> entry = dynamic_pointer_cast<ProcessSyscallEntry>(state);
+  return entry != nullptr ? make_shared<ProcessSyscallEntry>(*entry) : state;
+}
+
 /**
  * This performs a final check when every tracee is dead in order to ensure that every
  * current_state is marked as final.
  */
 void Authorizer::checkFinalStates() {
-  assert(this->automata != nullptr);
-  string choice;
-  set<int> intersection, temp, final_states;
-  final_states = this->automata->get_final_states();
-  for (auto& i : this->currentStates) {
-    temp = i.second;
-    set_intersection(final_states.begin(), final_states.end(),
-                     temp.begin(), temp.end(),
-                     inserter(intersection, intersection.begin()));
-    if (intersection.empty()) {
-      cout << "Warning! The tracee SPID " << i.first << " has terminated in a non final set of states ";
-	    this->printSet(temp);
-      cout << endl;
-      do {
-        cout << "Do you want to mark them as final? [yes/no] ";
-        cin >> choice;
-      } while (choice != "yes" && choice != "no");
-      if (choice == "yes") {
-        set_union(final_states.begin(), final_states.end(),
-                  temp.begin(), temp.end(),
-                  inserter(intersection, intersection.begin()));
-        this->automata->set_final_states(intersection);
+  set<int> temp, final_states;
+  if (this->sequenceModel != nullptr) {
+    for (auto& shard : this->shards) {
+      for (const auto& i : shard->histories) {
+        LabelWindow window = this->sequenceModel->getWindow(i.second.labels, SequenceModel::TERMINATION);
+        if (!this->sequenceModel->accepts(i.second.executableName, window)) {
+          if (this->shadow) {
+            this->recordViolation(i.second.executableName, "termination", Authorizer::NOT_FINAL);
+            continue;
+          }
+          cout << "Warning! The tracee SPID " << i.first << " has terminated after the system calls ";
+          this->printSet(StateSet(window.begin(), window.end() - 1));
+          cout << endl;
+          if (this->askMarkFinal()) {
+            this->sequenceModel->learn(i.second.executableName, window);
+          }
+        }
+      }
+    }
+    return;
+  }
+  // The policies of a model directory cannot be changed, the tracees are only reported
+  if (this->store != nullptr) {
+    for (auto& shard : this->shards) {
+      for (const auto& i : shard->storeStates) {
+        if (i.second.model != nullptr && i.second.model->automaton.isFinal(i.second.states)) {
+          continue;
+        }
+        if (this->shadow) {
+          this->recordViolation(i.second.executableName, "termination", Authorizer::NOT_FINAL);
+          continue;
+        }
+        cout << "Warning! The tracee SPID " << i.first << " of " << i.second.executableName
+             << " has terminated in a non final set of states ";
+        this->printSet(i.second.states);
+        cout << endl;
+      }
+    }
+    return;
+  }
+  for (auto& shard : this->shards) {
+    vector<pid_t> spids;
+    for (const auto& i : shard->currentStates) {
+      spids.push_back(i.first);
+    }
+    for (const auto& i : shard->lastSyscalls) {
+      spids.push_back(i.first);
+    }
+    for (pid_t spid : spids) {
+      if (!this->isFinal(*shard, spid)) {
+        if (this->shadow) {
+          this->recordViolation(this->matrix != nullptr ? this->matrix->getExecutable() : "", "termination", Authorizer::NOT_FINAL);
+          continue;
+        }
+        temp = this->getNfaStates(spid);
+        cout << "Warning! The tracee SPID " << spid << " has terminated in a non final set of states ";
+        this->printSet(StateSet(temp.begin(), temp.end()));
+        cout << endl;
+        if (this->askMarkFinal() && this->loadModel()) {
+          final_states = this->automata->get_final_states();
+          final_states.insert(temp.begin(), temp.end());
+          this->automata->set_final_states(final_states);
+          this->compact.setFinalStates(final_states);
+          for (auto& j : this->shards) {
+            j->cache.invalidate();
+          }
+          this->buildSyscallMatrix();
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Decides if a non final termination found by Authorizer::checkFinalStates has to be learned, asking the operator
+ * if the violation policy is Authorizer::ASK.
+ *
+ * @return True if the termination has to be learned, False otherwise.
+ */
+bool Authorizer::askMarkFinal() const {
+  string choice = this->policy == Authorizer::LEARN ? "yes" : "no";
+  while (this->policy == Authorizer::ASK && cin.good()) {
+    cout << "Do you want to mark them as final? [yes/no] ";
+    cin >> choice;
+    if (choice == "yes" || choice == "no") {
+      break;
+    }
+  }
+  return choice == "yes";
+}
+
+/**
+ * Gets the name of the system call of every association number.
+ *
+ * @return The system call names indexed by association number, empty for the numbers without an association.
+ */
+vector<string> Authorizer::getLabelNames() const {
+  if (this->associations == nullptr) {
+    return this->bundle->getLabelNames();
+  }
+  vector<string> names(this->associations->getSize() + 1);
+  for (const auto& i : this->associations->getSyscallLabels()) {
+    string name = SyscallNameResolver::resolve((unsigned int) i.first);
+    if (name.empty()) {
+      name = to_string(i.first);
+    }
+    for (int label : i.second) {
+      if (label >= 0 && (unsigned int) label < names.size()) {
+        names[label] = name;
       }
     }
-    intersection.clear();
+  }
+  return names;
+}
+
+/**
+ * Gets the current set of states of a traced thread.
+ *
+ * @param spid The traced thread SPID.
+ * @return The set of states where spid lays, empty if it has never been seen.
+ */
+StateSet Authorizer::getCurrentStates(pid_t spid) const {
+  const Shard& shard = this->getShard(spid);
+  auto it = shard.currentStates.find(spid);
+  return it != shard.currentStates.end() ? shard.cache.getStates(it->second) : StateSet();
+}
+
+/**
+ * Gets the NFA states where a traced thread lays, whether it is checked on the compact automaton or on the matrix.
+ *
+ * @param spid The traced thread SPID.
+ * @return The set of NFA states of spid, empty if it has never been seen.
+ */
+set<int> Authorizer::getNfaStates(pid_t spid) const {
+  if (this->matrix == nullptr) {
+    return this->compact.expand(this->getCurrentStates(spid));
+  }
+  const Shard& shard = this->getShard(spid);
+  auto it = shard.lastSyscalls.find(spid);
+  return it != shard.lastSyscalls.end() ? this->matrix->getStates(it->second) : set<int>();
+}
+
+/**
+ * Moves a traced thread on a set of NFA states, the inverse of Authorizer::getNfaStates.
+ *
+ * @param shard  The shard of spid.
+ * @param spid   The traced thread SPID.
+ * @param states The NFA states, if they do not correspond to any row of the matrix the thread is forgotten.
+ */
+void Authorizer::setNfaStates(Shard& shard, pid_t spid, const set<int>& states) {
+  StateSet lifted = this->lift(states);
+  if (this->matrix == nullptr) {
+    shard.currentStates[spid] = shard.cache.intern(lifted);
+    this->trimCache(shard);
+  } else if (!lifted.empty()) {
+    shard.lastSyscalls[spid] = lifted.front();
+  }
+}
+
+bool Authorizer::isFinal(Shard& shard, pid_t spid) {
+  if (this->matrix == nullptr) {
+    auto it = shard.currentStates.find(spid);
+    return it != shard.currentStates.end() && shard.cache.isFinal(it->second);
+  }
+  auto it = shard.lastSyscalls.find(spid);
+  return it != shard.lastSyscalls.end() && this->matrix->isFinal(it->second);
+}
+
+/**
+ * Clears the TransitionCache of a shard once it is full, the current states of its traced threads are interned again
+ * so that their IDs stay valid.
+ *
+ * @param shard The shard whose cache has just been used.
+ */
+void Authorizer::trimCache(Shard& shard) {
+  if (!shard.cache.isFull()) {
+    return;
+  }
+  vector<pair<pid_t, StateSet>> live;
+  live.reserve(shard.currentStates.size());
+  for (const auto& i : shard.currentStates) {
+    live.emplace_back(i.first, shard.cache.getStates(i.second));
+  }
+  shard.cache.clear();
+  for (const auto& i : live) {
+    shard.currentStates[i.first] = shard.cache.intern(i.second);
+  }
+}
+
+/**
+ * Converts the states handed to a new tracee in NFA states, when the matrix is enforced they are a single row.
+ *
+ * @param states Either a set of Authorizer::compact states or a matrix row.
+ * @return The NFA states.
+ */
+set<int> Authorizer::expand(const StateSet& states) const {
+  if (this->matrix == nullptr) {
+    return this->compact.expand(states);
+  }
+  return states.empty() ? set<int>() : this->matrix->getStates(states.front());
+}
+
+/**
+ * Converts NFA states in the states enforced, the inverse of Authorizer::expand.
+ *
+ * @param states The NFA states.
+ * @return The Authorizer::compact states or the matrix row, empty if states do not correspond to any row.
+ */
+StateSet Authorizer::lift(const set<int>& states) const {
+  if (this->matrix == nullptr) {
+    return this->compact.lift(states);
+  }
+  int row = this->matrix->getRow(states);
+  return row >= 0 ? StateSet({ row }) : StateSet();
+}
+
+/**
+ * Gets the shard that checks every notification of a traced thread.
+ *
+ * @param spid The traced thread SPID.
+ * @return The shard of spid.
+ */
+Authorizer::Shard& Authorizer::getShard(pid_t spid) const {
+  return *this->shards[(unsigned int) spid % this->shards.size()];
+}
+
+/**
+ * Gets the states from where a traced thread never seen before starts: the first traced thread starts from the
+ * initial states while every other one from the states reached by the clone syscall that generated it.
+ *
+ * @param spid   The traced thread SPID.
+ * @param states Where the starting states will be written.
+ * @return True if spid is expected, False if it has not been generated by an authorised syscall.
+ */
+bool Authorizer::takeStartingStates(pid_t spid, StateSet& states) {
+  boost::mutex::scoped_lock lock(this->handoffMutex);
+  if (this->firstTracee) {
+    this->firstTracee = false;
+    // The initial states of a policy of a model directory are known only once the executable is
+    if (this->sequenceModel != nullptr || this->store != nullptr) {
+      states.clear();
+    } else if (this->learning) {
+      states = StateSet(this->learnedInitials.begin(), this->learnedInitials.end());
+    } else {
+      states = this->matrix != nullptr ? StateSet({ SyscallMatrix::INITIAL }) : this->compact.getInitialStates();
+    }
+    return true;
+  }
+  auto it = this->pendingChildren.find(spid);
+  if (it == this->pendingChildren.end()) {
+    return false;
+  }
+  states = std::move(it->second);
+  this->pendingChildren.erase(it);
+  return true;
+}
+
+/**
+ * Called by the TracingManager worker thread every time a new tracee is generated. In shadow mode the handoff is
+ * queued after the check of the clone that generated the child, which may not have been performed yet.
+ *
+ * @param fatherSpid The SPID of the thread that executed the clone syscall.
+ * @param childSpid  The SPID of the new tracee.
+ */
+void Authorizer::newTracee(pid_t fatherSpid, pid_t childSpid) {
+  if (this->shadow) {
+    this->shadowQueue.push([this, fatherSpid, childSpid]() {
+      this->handleNewTracee(fatherSpid, childSpid);
+    });
+  } else {
+    this->handleNewTracee(fatherSpid, childSpid);
   }
 }
 
+/**
+ * Hands the states reached by the clone syscall of a father to its child.
+ *
+ * @param fatherSpid The SPID of the thread that executed the clone syscall.
+ * @param childSpid  The SPID of the new tracee.
+ */
+void Authorizer::handleNewTracee(pid_t fatherSpid, pid_t childSpid) {
+  boost::mutex::scoped_lock lock(this->handoffMutex);
+  auto it = this->cloneGenerators.find(fatherSpid);
+  if (it == this->cloneGenerators.end()) {
+    return;
+  }
+  this->pendingChildren[childSpid] = std::move(it->second);
+  this->cloneGenerators.erase(it);
+}
 
-void Authorizer::printSet(set<int>& store) {
+/**
+ * Checks a notification and lets it proceed if it is authorised, otherwise the violation policy is applied.
+ * The checks of different shards run concurrently while a violation is handled exclusively.
+ *
+ * @param state The notification that will be checked.
+ */
+void Authorizer::check(const shared_ptr<ProcessNotification>& state) {
+  int returnValue;
+  {
+    boost::shared_lock<boost::shared_mutex> lock(this->modelMutex);
+    returnValue = this->isAuthorized(state);
+  }
+  if (this->shadow) {
+    this->shadowChecks++;
+  }
+  if (returnValue != Authorizer::AUTHORISED) {
+    boost::unique_lock<boost::shared_mutex> lock(this->modelMutex);
+    this->handleViolation(state, returnValue, this->policy);
+    return;
+  }
+  if (!this->shadow) {
+    Authorizer::proceed(state);
+  }
+}
+
+/**
+ * Shard thread entry point, it checks every notification of the shard queue until a nullptr one is received.
+ *
+ * @param shard The shard handled by this thread.
+ */
+void Authorizer::shardLoop(Shard& shard) {
+  shared_ptr<ProcessNotification> notification;
+  while ((notification = shard.queue.pop()) != nullptr) {
+    this->check(notification);
+  }
+}
+
+/**
+ * Waits for every shard thread to check its pending notifications and then stops it.
+ */
+void Authorizer::stopShards() {
+  for (auto& shard : this->shards) {
+    if (shard->thread) {
+      shard->queue.push(nullptr);
+      shard->thread->join();
+      shard->thread = nullptr;
+    }
+  }
+}
+
+void Authorizer::printSet(const StateSet& store) {
   cout << "( ";
   for (const int i : store) {
     cout << i << " ";
   }
   cout << ")";
-}
\ No newline at end of file
+}
@@ -14,18 +14,56 @@
 #include <amore++/nondeterministic_finite_automaton.h>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <boost/thread.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include "AutomatonExporter.h"
+#include "Checkpointer.h"
+#include "CompactAutomaton.h"
+#include "ConcurrentQueue.h"
+#include "ModelStore.h"
+#include "PolicyBundle.h"
+#include "SeccompFilter.h"
+#include "SequenceModel.h"
+#include "SyscallMatrix.h"
+#include "TransitionCache.h"
 #include "Mapper.h"
 #include "TracingManager.h"
 
 class Authorizer {
+  friend class AuthorizerTest;
 public:
   static const int AUTHORISED;
   static const int NOT_AUTHORISED;
   static const int NOT_FINAL;
-  Authorizer(const std::string graphPath, const std::string associationsPath, bool learning);
+  enum ViolationPolicy {
+    KILL,   // The offending tracee is killed
+    DENY,   // The offending syscall is skipped failing with EPERM, the automaton is not changed
+    LEARN,  // The offending syscall is allowed and added to the automaton
+    ASK,    // An operator decides, meanwhile only the offending tracee waits
+    SHADOW  // The violation is only recorded, every notification proceeds before being checked on a separate thread
+  };
+  static ViolationPolicy parseViolationPolicy(const std::string& name);
+  static std::unique_ptr<amore::nondeterministic_finite_automaton> readAutomaton(const std::string& graphPath);
+  static bool writeAutomaton(const amore::finite_automaton& automaton, const std::string& graphPath);
+  Authorizer(const std::string graphPath,
+             const std::string associationsPath,
+             bool learning,
+             bool determinize,
+             ViolationPolicy policy = Authorizer::ASK,
+             unsigned int threads = 0,
+             const std::string& policyPath = "",
+             bool resume = false,
+             std::unique_ptr<SequenceModel> sequenceModel = nullptr,
+             std::unique_ptr<ModelStore> store = nullptr);
+  ~Authorizer();
 	void process(std::shared_ptr<ProcessNotification> syscall);
 	void terminate();
-  bool dotOutput(const std::string& filePath) const;
+  bool setStackLimits(const StackLimits& limits);
+  bool enableCheckpoints(unsigned int interval, unsigned int transitions);
+  bool useSyscallMatrix();
+  bool exportAutomaton(const std::string& filePath, AutomatonExporter::Format format) const;
+  std::vector<sock_filter> compileSeccompFilter();
 	operator std::string() const;
 
 protected:
@@ -34,19 +72,133 @@ protected:
   bool addTransition(std::shared_ptr<ProcessSyscallEntry> state);
 
 private:
+  // Last association numbers of a traced thread, used when a SequenceModel is enforced or learned
+  struct History {
+    std::string executableName;
+    LabelWindow labels;
+  };
+  // Policy and states of a traced thread, used when a ModelStore is enforced
+  struct StoreState {
+    // The executable the thread was running at its last system call, its policy is switched when it changes
+    std::string executableName;
+    std::shared_ptr<const ModelStore::Model> model;
+    StateSet states;
+  };
+  // Enforcement state of a subset of the traced threads, a thread is always checked by the same shard
+  struct Shard {
+    explicit Shard(const CompactAutomaton& automaton) : cache(automaton) { }
+    TransitionCache cache;
+    // Every traced thread is associated with the ID of its current set of states in Shard::cache
+    std::unordered_map<pid_t, unsigned int> currentStates;
+    // Row of the last system call of every traced thread, in place of Shard::currentStates when a matrix is enforced
+    std::unordered_map<pid_t, int> lastSyscalls;
+    // History of every traced thread, in place of Shard::currentStates when a SequenceModel is used
+    std::unordered_map<pid_t, History> histories;
+    // Policy and states of every traced thread, in place of Shard::currentStates when a ModelStore is enforced
+    std::unordered_map<pid_t, StoreState> storeStates;
+    // Notifications waiting to be checked by the shard thread, a nullptr notification stops it
+    ConcurrentQueue<std::shared_ptr<ProcessNotification>> queue;
+    std::unique_ptr<boost::thread> thread;
+  };
+  // In enforce mode with a policy bundle it stays nullptr until the automaton has to be changed
   std::unique_ptr<amore::nondeterministic_finite_automaton> automata;
-  std::map<pid_t, std::set<int>> currentStates;
-  std::vector<std::shared_ptr<ProcessSyscallEntry>> childGenerators;
+  // Compiled policy enforced in place of the NFA and associations files, if any
+  std::unique_ptr<PolicyBundle> bundle;
+  // Copy of the automaton used during the enforcement, every check is performed on it
+  CompactAutomaton compact;
+  // Enforced in place of Authorizer::compact when the automaton and the Tracer do not use backtraces, nullptr otherwise
+  std::unique_ptr<SyscallMatrix> matrix;
+  bool matrixRequested = false;
+  // Learned or enforced in place of the NFA, if any, it is saved in Authorizer::graphPath
+  std::unique_ptr<SequenceModel> sequenceModel;
+  // Enforced in place of the NFA, if any, every executable has its own policy; it has to outlive the shards
+  std::unique_ptr<ModelStore> store;
+  std::vector<std::unique_ptr<Shard>> shards;
+  // Labels of the system calls that a seccomp filter lets pass without notifying the tracer
+  std::set<int> transparentLabels;
+  // States reached by the last clone syscall of a thread, they are moved to the child as soon as it is created
+  std::unordered_map<pid_t, StateSet> cloneGenerators;
+  // States of the new tracees that have not produced any notification yet, indexed by child SPID
+  std::unordered_map<pid_t, StateSet> pendingChildren;
+  // True until the first traced thread, which starts from the initial states, has been seen
+  bool firstTracee = true;
+  // Guards Authorizer::cloneGenerators, Authorizer::pendingChildren and Authorizer::firstTracee
+  boost::mutex handoffMutex;
   const std::string graphPath;
+  const std::string associationsPath;
   const bool learning;
-  Mapper associations;
-  std::vector<std::shared_ptr<ProcessNotification>> processStates;
+  const bool determinize;
+  const ViolationPolicy policy;
+  // True if the policy is Authorizer::SHADOW in enforce mode: the tracees are never stopped by the checks
+  const bool shadow;
+  // Shared by the checks of the shards, exclusive when the automaton is changed or a violation is handled
+  boost::shared_mutex modelMutex;
+  // Violations waiting for an operator decision, a nullptr notification stops the operator thread
+  ConcurrentQueue<std::pair<std::shared_ptr<ProcessNotification>, int>> operatorQueue;
+  std::unique_ptr<boost::thread> operatorThread;
+  // In shadow mode the checks and the clone handoffs in the order they happened, an empty task stops the shadow thread
+  ConcurrentQueue<std::function<void ()>> shadowQueue;
+  std::unique_ptr<boost::thread> shadowThread;
+  // Violations recorded in shadow mode in the form < < executable_name, system_call_name >, count >
+  std::map<std::pair<std::string, std::string>, unsigned long> shadowViolations;
+  unsigned long shadowChecks = 0;
+  unsigned long shadowNotAuthorised = 0;
+  unsigned long shadowNotFinal = 0;
+  // Maximum number of tasks waiting for the shadow thread
+  unsigned long shadowBacklog = 0;
+  // In enforce mode with a policy bundle it stays nullptr until the associations have to be changed
+  std::unique_ptr<Mapper> associations;
+  // Automaton being learned, built while the notifications arrive starting from the imported one
+  std::map<int, std::map<int, std::set<int>>> learnedTransitions;
+  std::set<int> learnedInitials;
+  std::set<int> learnedFinals;
+  unsigned long learnedTransitionCount = 0;
+  // State of every traced thread while learning
+  std::unordered_map<pid_t, int> learningStates;
+  std::unique_ptr<Checkpointer> checkpointer;
   bool importAutomaton();
+  bool loadModel();
+  [[nodiscard]] CompactAutomaton getAutomaton() const;
+  [[nodiscard]] int findLabel(const std::shared_ptr<ProcessSyscallEntry>& syscall) const;
+  [[nodiscard]] std::map<int, std::set<int>> getSyscallLabels() const;
+  void buildCompactAutomaton(bool determinise);
+  void buildSyscallMatrix();
+  [[nodiscard]] Shard& getShard(pid_t spid) const;
+  [[nodiscard]] std::vector<std::string> getLabelNames() const;
+  [[nodiscard]] StateSet getCurrentStates(pid_t spid) const;
+  [[nodiscard]] std::set<int> getNfaStates(pid_t spid) const;
+  void setNfaStates(Shard& shard, pid_t spid, const std::set<int>& states);
+  [[nodiscard]] bool isFinal(Shard& shard, pid_t spid);
+  void trimCache(Shard& shard);
+  [[nodiscard]] std::set<int> expand(const StateSet& states) const;
+  [[nodiscard]] StateSet lift(const std::set<int>& states) const;
+  bool takeStartingStates(pid_t spid, StateSet& states);
+  void newTracee(pid_t fatherSpid, pid_t childSpid);
+  void handleNewTracee(pid_t fatherSpid, pid_t childSpid);
+  void check(const std::shared_ptr<ProcessNotification>& state);
+  void shardLoop(Shard& shard);
+  void stopShards();
   int isAuthorized(const std::shared_ptr<ProcessNotification>& state);
-  bool handleUnauthorised(std::shared_ptr<ProcessNotification> state);
-  bool handleNonFinal(std::shared_ptr<ProcessNotification> state);
+  int isAuthorizedByMatrix(Shard& shard, const std::shared_ptr<ProcessNotification>& state);
+  int isAuthorizedByStore(Shard& shard, const std::shared_ptr<ProcessNotification>& state);
+  int checkSequence(Shard& shard, const std::shared_ptr<ProcessNotification>& state, bool learn);
+  void learnSequence(const std::shared_ptr<ProcessNotification>& state, int violation);
+  void handleViolation(const std::shared_ptr<ProcessNotification>& state, int violation, ViolationPolicy decision);
+  static ViolationPolicy askOperator(const std::shared_ptr<ProcessNotification>& state, int violation);
+  void operatorLoop();
+  void stopOperator();
+  void shadowLoop();
+  void stopShadow();
+  void recordViolation(const std::string& executableName, const std::string& event, int violation);
+  void followViolation(Shard& shard, const std::shared_ptr<ProcessSyscallEntry>& syscall);
+  void printShadowReport() const;
+  bool markFinal(const std::shared_ptr<ProcessNotification>& state);
+  static void proceed(const std::shared_ptr<ProcessNotification>& state);
+  static std::shared_ptr<ProcessNotification> snapshot(const std::shared_ptr<ProcessNotification>& state);
   void checkFinalStates();
-  static void printSet(std::set<int>& store) ;
+  [[nodiscard]] bool askMarkFinal() const;
+  void learn(const std::shared_ptr<ProcessNotification>& state);
+  static void printSet(const StateSet& store);
 };
 
 #endif /* PTRACER_AUTHORIZER_H */
\ No newline at end of file
@@ -0,0 +1,167 @@
+/*
+ * The AutomatonExporter writes a CompactAutomaton in DOT, GraphML or JSON format walking its transitions only once
+ * and streaming them to a buffered file, hence it does not build the whole representation in memory.
+ * States are named after the label of their incoming transitions, that in a learned automaton is the system call
+ * that leads to them.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include "AutomatonExporter.h"
+
+using namespace std;
+
+// Size of the output file buffer
+const unsigned int AutomatonExporter::BUFFER_SIZE = 1 << 20;
+
+/**
+ * @param automaton  The automaton that will be exported, it must outlive the exporter.
+ * @param labelNames The name of every label, labels without a name are written as numbers.
+ */
+AutomatonExporter::AutomatonExporter(const CompactAutomaton& automaton, const vector<string>& labelNames) : automaton(automaton),
+                                                                                                           labelNames(labelNames),
+                                                                                                           stateLabels(automaton.getStateCount(), -1) {
+	for (unsigned int state = 0; state < this->automaton.getStateCount(); state++) {
+		unsigned int first = this->automaton.getFirstTransition((int) state);
+		for (unsigned int i = first; i < first + this->automaton.getOutDegree((int) state); i++) {
+			int& target = this->stateLabels[this->automaton.getTransitionTarget(i)];
+			int label = this->automaton.getTransitionLabel(i);
+			target = target == -1 || target == label ? label : -2;
+		}
+	}
+}
+
+/**
+ * Writes the automaton in a file.
+ *
+ * @param filePath The output file, if it exists it will be overwritten.
+ * @param format   The output format.
+ * @return True if the file has been successfully written, False otherwise.
+ */
+bool AutomatonExporter::write(const string& filePath, Format format) {
+	vector<char> buffer(AutomatonExporter::BUFFER_SIZE);
+	ofstream file;
+	file.rdbuf()->pubsetbuf(buffer.data(), (streamsize) buffer.size());
+	file.open(filePath, ios::out | ios::trunc);
+	if (!file.is_open()) {
+		cerr << "Impossible to open " << filePath << " in write mode" << endl;
+		return false;
+	}
+	this->writtenStates = 0;
+	this->writtenTransitions = 0;
+	switch (format) {
+		case AutomatonExporter::DOT:
+			this->writeDot(file);
+			break;
+		case AutomatonExporter::GRAPHML:
+			this->writeGraphml(file);
+			break;
+		case AutomatonExporter::JSON:
+			this->writeJson(file);
+			break;
+	}
+	file.flush();
+	if (!file.good()) {
+		cerr << "Error occurred while writing the automaton in " << filePath << endl;
+		return false;
+	}
+	file.close();
+	return true;
+}
+
+unsigned long AutomatonExporter::getWrittenStates() const {
+	return this->writtenStates;
+}
+
+unsigned long AutomatonExporter::getWrittenTransitions() const {
+	return this->writtenTransitions;
+}
+
+void AutomatonExporter::writeDot(ostream& out) {
+	out << "digraph automaton {\n\trankdir=LR;\n\tnode [shape=circle];\n\tstart [shape=point];\n";
+	for (int state : this->automaton.getInitialStates()) {
+		out << "\tstart -> " << state << ";\n";
+	}
+	for (unsigned int state = 0; state < this->automaton.getStateCount(); state++) {
+		const string& name = this->getStateName((int) state);
+		out << '\t' << state << " [label=\"" << state;
+		if (!name.empty()) {
+			out << "\\n" << name;
+		}
+		out << '"' << (this->automaton.isFinalState((int) state) ? ", shape=doublecircle" : "") << "];\n";
+		this->writtenStates++;
+	}
+	for (unsigned int state = 0; state < this->automaton.getStateCount(); state++) {
+		unsigned int first = this->automaton.getFirstTransition((int) state);
+		for (unsigned int i = first; i < first + this->automaton.getOutDegree((int) state); i++) {
+			out << '\t' << state << " -> " << this->automaton.getTransitionTarget(i)
+			    << " [label=\"" << this->automaton.getTransitionLabel(i) << "\"];\n";
+			this->writtenTransitions++;
+		}
+	}
+	out << "}\n";
+}
+
+void AutomatonExporter::writeGraphml(ostream& out) {
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	       "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+	       "  <key id=\"name\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n"
+	       "  <key id=\"initial\" for=\"node\" attr.name=\"initial\" attr.type=\"boolean\"/>\n"
+	       "  <key id=\"final\" for=\"node\" attr.name=\"final\" attr.type=\"boolean\"/>\n"
+	       "  <key id=\"label\" for=\"edge\" attr.name=\"label\" attr.type=\"int\"/>\n"
+	       "  <key id=\"syscall\" for=\"edge\" attr.name=\"syscall\" attr.type=\"string\"/>\n"
+	       "  <graph id=\"automaton\" edgedefault=\"directed\">\n";
+	for (unsigned int state = 0; state < this->automaton.getStateCount(); state++) {
+		out << "    <node id=\"n" << state << "\"><data key=\"name\">" << this->getStateName((int) state)
+		    << "</data><data key=\"initial\">" << (this->isInitial((int) state) ? "true" : "false")
+		    << "</data><data key=\"final\">" << (this->automaton.isFinalState((int) state) ? "true" : "false") << "</data></node>\n";
+		this->writtenStates++;
+	}
+	for (unsigned int state = 0; state < this->automaton.getStateCount(); state++) {
+		unsigned int first = this->automaton.getFirstTransition((int) state);
+		for (unsigned int i = first; i < first + this->automaton.getOutDegree((int) state); i++) {
+			int label = this->automaton.getTransitionLabel(i);
+			out << "    <edge source=\"n" << state << "\" target=\"n" << this->automaton.getTransitionTarget(i)
+			    << "\"><data key=\"label\">" << label << "</data><data key=\"syscall\">" << this->getLabelName(label)
+			    << "</data></edge>\n";
+			this->writtenTransitions++;
+		}
+	}
+	out << "  </graph>\n</graphml>\n";
+}
+
+void AutomatonExporter::writeJson(ostream& out) {
+	out << "{\"states\":[";
+	for (unsigned int state = 0; state < this->automaton.getStateCount(); state++) {
+		out << (state > 0 ? ",\n" : "\n") << "{\"id\":" << state << ",\"name\":\"" << this->getStateName((int) state)
+		    << "\",\"initial\":" << (this->isInitial((int) state) ? "true" : "false")
+		    << ",\"final\":" << (this->automaton.isFinalState((int) state) ? "true" : "false") << '}';
+		this->writtenStates++;
+	}
+	out << "],\n\"transitions\":[";
+	for (unsigned int state = 0; state < this->automaton.getStateCount(); state++) {
+		unsigned int first = this->automaton.getFirstTransition((int) state);
+		for (unsigned int i = first; i < first + this->automaton.getOutDegree((int) state); i++) {
+			int label = this->automaton.getTransitionLabel(i);
+			out << (this->writtenTransitions > 0 ? ",\n" : "\n") << "{\"from\":" << state << ",\"to\":" << this->automaton.getTransitionTarget(i)
+			    << ",\"label\":" << label << ",\"syscall\":\"" << this->getLabelName(label) << "\"}";
+			this->writtenTransitions++;
+		}
+	}
+	out << "]}\n";
+}
+
+const string& AutomatonExporter::getLabelName(int label) const {
+	static const string unknown;
+	return label >= 0 && (unsigned int) label < this->labelNames.size() ? this->labelNames[label] : unknown;
+}
+
+const string& AutomatonExporter::getStateName(int state) const {
+	return this->getLabelName(this->stateLabels[state]);
+}
+
+bool AutomatonExporter::isInitial(int state) const {
+	const StateSet& initials = this->automaton.getInitialStates();
+	return find(initials.begin(), initials.end(), state) != initials.end();
+}
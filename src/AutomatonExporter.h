@@ -0,0 +1,37 @@
+#ifndef PTRACER_AUTOMATONEXPORTER_H
+#define PTRACER_AUTOMATONEXPORTER_H
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CompactAutomaton.h"
+
+class AutomatonExporter {
+public:
+	enum Format {
+		DOT,
+		GRAPHML,
+		JSON
+	};
+	static const unsigned int BUFFER_SIZE;
+	AutomatonExporter(const CompactAutomaton& automaton, const std::vector<std::string>& labelNames);
+	bool write(const std::string& filePath, Format format);
+	[[nodiscard]] unsigned long getWrittenStates() const;
+	[[nodiscard]] unsigned long getWrittenTransitions() const;
+
+private:
+	const CompactAutomaton& automaton;
+	// Human readable name of every label, usually the syscall name
+	const std::vector<std::string>& labelNames;
+	// For every state the label of all its incoming transitions, -1 if there are none and -2 if they differ
+	std::vector<int> stateLabels;
+	unsigned long writtenStates = 0;
+	unsigned long writtenTransitions = 0;
+	void writeDot(std::ostream& out);
+	void writeGraphml(std::ostream& out);
+	void writeJson(std::ostream& out);
+	[[nodiscard]] const std::string& getLabelName(int label) const;
+	[[nodiscard]] const std::string& getStateName(int state) const;
+	[[nodiscard]] bool isInitial(int state) const;
+};
+
+#endif //PTRACER_AUTOMATONEXPORTER_H
@@ -1,6 +1,7 @@
 #ifndef PTRACER_BACKTRACER_H
 #define PTRACER_BACKTRACER_H
 #include <memory>
+#include <string>
 #include <vector>
 #include "StackFrame.h"
 
@@ -13,8 +14,32 @@ public:
 	Backtracer& operator = (const Backtracer& other) = delete;
 	static std::unique_ptr<Backtracer> getInstance();
 
+	/**
+	 * Limits the frames returned by Backtracer::unwind, it must be called before Backtracer::init.
+	 *
+	 * @param depth           The maximum number of innermost frames, the unwinding stops as soon as they are found;
+	 *                        0 keeps every frame up to the implementation limit.
+	 * @param excludedModules The frames of the modules which path contains one of these strings are neither returned
+	 *                        nor counted.
+	 */
+	void setLimits(unsigned int depth, const std::vector<std::string>& excludedModules) {
+		this->maxDepth = depth;
+		this->excludedModules = excludedModules;
+	}
+
 protected:
+	unsigned int maxDepth = 0;
+	std::vector<std::string> excludedModules;
 	Backtracer() { }
+
+	[[nodiscard]] bool isExcluded(const std::string& moduleName) const {
+		for (const std::string& excluded : this->excludedModules) {
+			if (moduleName.find(excluded) != std::string::npos) {
+				return true;
+			}
+		}
+		return false;
+	}
 };
 
 #endif //PTRACER_BACKTRACER_H
\ No newline at end of file
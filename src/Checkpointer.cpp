@@ -0,0 +1,215 @@
+/*
+ * The Checkpointer periodically saves the automaton being learned, so that a long learning session that is killed or
+ * crashes can be resumed. The learner only appends its changes to a delta under a short critical section, while the
+ * checkpoint thread applies them to its own copy of the model and writes it, hence learning is never paused by a write.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include "Authorizer.h"
+#include "Checkpointer.h"
+
+using namespace std;
+
+// Appended to the NFA and associations paths to get the paths of their checkpoints
+const string Checkpointer::SUFFIX = ".checkpoint";
+const unsigned int Checkpointer::POLL_MS = 200;
+atomic<Checkpointer*> Checkpointer::active(nullptr);
+
+/**
+ * @param graphPath        The NFA path, the checkpoint is written next to it.
+ * @param associationsPath The associations path, the checkpoint is written next to it.
+ * @param interval         Seconds between two checkpoints, 0 to disable the periodic checkpoints.
+ * @param transitions      Number of new transitions that triggers a checkpoint, 0 to disable it.
+ */
+Checkpointer::Checkpointer(const string& graphPath,
+                           const string& associationsPath,
+                           unsigned int interval,
+                           unsigned int transitions) : graphPath(graphPath),
+                                                       associationsPath(associationsPath),
+                                                       interval(interval),
+                                                       transitions(transitions) {
+}
+
+Checkpointer::~Checkpointer() {
+	this->stop();
+}
+
+/**
+ * Copies the model the learning starts from and starts the checkpoint thread.
+ *
+ * @param transitions  Transitions in the form < origin, < transition_label, { destination_nodes } > >.
+ * @param initials     The initial states.
+ * @param finals       The final states.
+ * @param associations The associations of the model.
+ */
+void Checkpointer::start(const map<int, map<int, set<int>>>& transitions,
+                         const set<int>& initials,
+                         const set<int>& finals,
+                         const Mapper& associations) {
+	assert(!this->thread);
+	stringstream associationsText;
+	this->model = transitions;
+	this->initials = initials;
+	this->finals = finals;
+	associations.write(associationsText);
+	this->associations = make_unique<Mapper>(Checkpointer::getCheckpointPath(this->associationsPath), associationsText);
+	this->thread = make_unique<boost::thread>(&Checkpointer::loop, this);
+	Checkpointer::active = this;
+}
+
+/**
+ * Stops the checkpoint thread, the changes not written yet are discarded.
+ */
+void Checkpointer::stop() {
+	Checkpointer* self = this;
+	Checkpointer::active.compare_exchange_strong(self, nullptr);
+	if (!this->thread) {
+		return;
+	}
+	{
+		boost::mutex::scoped_lock lock(this->deltaMutex);
+		this->stopping = true;
+	}
+	this->deltaCondition.notify_one();
+	this->thread->join();
+	this->thread = nullptr;
+}
+
+void Checkpointer::addTransition(int from, int to) {
+	boost::mutex::scoped_lock lock(this->deltaMutex);
+	this->delta.transitions.emplace_back(from, to);
+	if (this->transitions > 0 && this->delta.transitions.size() >= this->transitions) {
+		lock.unlock();
+		this->deltaCondition.notify_one();
+	}
+}
+
+void Checkpointer::addFinal(int state) {
+	boost::mutex::scoped_lock lock(this->deltaMutex);
+	this->delta.finals.push_back(state);
+}
+
+void Checkpointer::addAssociation(const string& executableName, unsigned int associationId, const ProcessSyscallEntryDTO& state) {
+	boost::mutex::scoped_lock lock(this->deltaMutex);
+	this->delta.associations.emplace_back(executableName, associationId, state);
+}
+
+/**
+ * Removes the checkpoint files of a model, called when the learned model has been saved in its final location.
+ *
+ * @param graphPath        The NFA path.
+ * @param associationsPath The associations path.
+ * @return True if no checkpoint file is left, False otherwise.
+ */
+bool Checkpointer::removeCheckpoint(const string& graphPath, const string& associationsPath) {
+	bool result = true;
+	for (const string& path : { graphPath, associationsPath }) {
+		string checkpoint = Checkpointer::getCheckpointPath(path);
+		if (unlink(checkpoint.c_str()) < 0 && errno != ENOENT) {
+			cerr << "Impossible to remove the checkpoint " << checkpoint << ": " << strerror(errno) << endl;
+			result = false;
+		}
+		errno = 0;
+	}
+	return result;
+}
+
+string Checkpointer::getCheckpointPath(const string& path) {
+	return path + Checkpointer::SUFFIX;
+}
+
+/**
+ * Asks the running checkpointer, if any, to write a checkpoint and waits for it.
+ * It does not take any lock, so that it can be called while the learner is stopped anywhere, as on termination.
+ *
+ * @param timeoutMs The maximum time to wait for the checkpoint.
+ */
+void Checkpointer::flushActive(unsigned int timeoutMs) {
+	Checkpointer* checkpointer = Checkpointer::active;
+	if (checkpointer == nullptr) {
+		return;
+	}
+	unsigned long written = checkpointer->written;
+	checkpointer->flushRequested = true;
+	for (unsigned int waited = 0; waited < timeoutMs && (checkpointer->flushRequested || checkpointer->written == written); waited += 10) {
+		usleep(10000);
+	}
+	if (checkpointer->flushRequested || checkpointer->written == written) {
+		cerr << "The last checkpoint has not been completed in " << timeoutMs << " ms" << endl;
+	}
+}
+
+/**
+ * Checkpoint thread entry point, it writes a checkpoint every Checkpointer::interval seconds, every
+ * Checkpointer::transitions new transitions and every time a flush is requested.
+ */
+void Checkpointer::loop() {
+	auto last = chrono::steady_clock::now();
+	boost::mutex::scoped_lock lock(this->deltaMutex);
+	while (!this->stopping) {
+		this->deltaCondition.timed_wait(lock, boost::posix_time::milliseconds(Checkpointer::POLL_MS));
+		bool flush = this->flushRequested;
+		bool due = this->interval > 0 && chrono::steady_clock::now() - last >= chrono::seconds(this->interval);
+		bool full = this->transitions > 0 && this->delta.transitions.size() >= this->transitions;
+		if (this->stopping || (!flush && !due && !full)) {
+			continue;
+		}
+		lock.unlock();
+		if (!this->write()) {
+			cerr << "Error occurred while writing the learning checkpoint" << endl;
+		}
+		last = chrono::steady_clock::now();
+		this->written++;
+		if (flush) {
+			this->flushRequested = false;
+		}
+		lock.lock();
+	}
+}
+
+/**
+ * Applies the pending changes to the private copy of the model and writes it.
+ * The associations are written before the NFA, so that the NFA checkpoint never refers to missing associations.
+ *
+ * @return True if the checkpoint has been written or there was nothing new to write, False otherwise.
+ */
+bool Checkpointer::write() {
+	Delta changes;
+	{
+		boost::mutex::scoped_lock lock(this->deltaMutex);
+		swap(changes, this->delta);
+	}
+	if (changes.transitions.empty() && changes.finals.empty() && changes.associations.empty()) {
+		return true;
+	}
+	for (const auto& i : changes.associations) {
+		this->associations->insert(get<0>(i), get<1>(i), get<2>(i));
+	}
+	for (const auto& i : changes.transitions) {
+		this->model[i.first][i.second] = { i.second };
+	}
+	this->finals.insert(changes.finals.begin(), changes.finals.end());
+	set<int> initialStates = this->initials, finalStates = this->finals;
+	amore::nondeterministic_finite_automaton automaton;
+	if (!automaton.construct(false,
+	                         (int) this->associations->getSize() + 1,
+	                         (int) this->associations->getSize() + 1,
+	                         initialStates,
+	                         finalStates,
+	                         this->model)) {
+		cerr << "Impossible to build the checkpoint automaton" << endl;
+		return false;
+	}
+	if (!this->associations->saveAs(Checkpointer::getCheckpointPath(this->associationsPath)) ||
+	    !Authorizer::writeAutomaton(automaton, Checkpointer::getCheckpointPath(this->graphPath))) {
+		return false;
+	}
+	cout << "Learning checkpoint written: " << this->associations->getSize() << " associations, "
+	     << changes.transitions.size() << " new transitions" << endl;
+	return true;
+}
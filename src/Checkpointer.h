@@ -0,0 +1,65 @@
+#ifndef PTRACER_CHECKPOINTER_H
+#define PTRACER_CHECKPOINTER_H
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <boost/thread.hpp>
+#include "Mapper.h"
+
+class Checkpointer {
+public:
+	static const std::string SUFFIX;
+	Checkpointer(const std::string& graphPath,
+	             const std::string& associationsPath,
+	             unsigned int interval,
+	             unsigned int transitions);
+	~Checkpointer();
+	void start(const std::map<int, std::map<int, std::set<int>>>& transitions,
+	           const std::set<int>& initials,
+	           const std::set<int>& finals,
+	           const Mapper& associations);
+	void stop();
+	void addTransition(int from, int to);
+	void addFinal(int state);
+	void addAssociation(const std::string& executableName, unsigned int associationId, const ProcessSyscallEntryDTO& state);
+	static bool removeCheckpoint(const std::string& graphPath, const std::string& associationsPath);
+	static std::string getCheckpointPath(const std::string& path);
+	static void flushActive(unsigned int timeoutMs);
+
+private:
+	// Changes made by the learner since the last checkpoint
+	struct Delta {
+		std::vector<std::pair<int, int>> transitions;
+		std::vector<int> finals;
+		std::vector<std::tuple<std::string, unsigned int, ProcessSyscallEntryDTO>> associations;
+	};
+	// The running checkpointer, if any, flushed on termination
+	static std::atomic<Checkpointer*> active;
+	// Maximum time the checkpoint thread sleeps before checking for a flush request
+	static const unsigned int POLL_MS;
+	const std::string graphPath;
+	const std::string associationsPath;
+	const unsigned int interval;
+	const unsigned int transitions;
+	// Guards Checkpointer::delta, it is held by the learner only to append a change
+	boost::mutex deltaMutex;
+	boost::condition_variable deltaCondition;
+	Delta delta;
+	bool stopping = false;
+	// Private copy of the model owned by the checkpoint thread, the learner never waits for it to be written
+	std::map<int, std::map<int, std::set<int>>> model;
+	std::set<int> initials;
+	std::set<int> finals;
+	std::unique_ptr<Mapper> associations;
+	std::unique_ptr<boost::thread> thread;
+	std::atomic<bool> flushRequested{false};
+	std::atomic<unsigned long> written{0};
+	void loop();
+	bool write();
+};
+
+#endif //PTRACER_CHECKPOINTER_H
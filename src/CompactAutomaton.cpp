@@ -0,0 +1,653 @@
+#include <algorithm>
+#include <assert.h>
+#include "CompactAutomaton.h"
+
+using namespace std;
+
+// Maximum number of states that a determinised automaton can have before giving up
+const unsigned int CompactAutomaton::DEFAULT_MAX_DFA_STATES = 1 << 16;
+// Maximum number of entries (states * alphabet size) of the dense lookup table of a deterministic automaton
+const unsigned long CompactAutomaton::DENSE_TABLE_MAX_ENTRIES = 1 << 22;
+
+/**
+ * Builds a compact automaton from the transition maps used by libAMoRE.
+ * Every state outgoing transitions are stored contiguously and sorted by label, so that a transition
+ * lookup is a binary search in a small contiguous slice.
+ *
+ * @param initials     The set of initial states.
+ * @param finals       The set of final states.
+ * @param transitions  Transitions in the form < origin, < transition_label, { destination_nodes } > >.
+ * @param stateCount   The number of states, grown if any state ID exceeds it.
+ * @param alphabetSize The number of labels, grown if any label exceeds it.
+ */
+CompactAutomaton::CompactAutomaton(const set<int>& initials,
+                                   const set<int>& finals,
+                                   const map<int, map<int, set<int>>>& transitions,
+                                   int stateCount,
+                                   int alphabetSize) : alphabetSize(max(alphabetSize, 0)) {
+	stateCount = max(stateCount, 0);
+	for (int state : initials) {
+		stateCount = max(stateCount, state + 1);
+	}
+	for (int state : finals) {
+		stateCount = max(stateCount, state + 1);
+	}
+	for (const auto& origin : transitions) {
+		stateCount = max(stateCount, origin.first + 1);
+		for (const auto& label : origin.second) {
+			this->alphabetSize = max(this->alphabetSize, label.first + 1);
+			for (int destination : label.second) {
+				stateCount = max(stateCount, destination + 1);
+			}
+		}
+	}
+	this->rowOffsets.assign(stateCount + 1, 0);
+	this->finals.assign(stateCount, 0);
+	this->deterministic = initials.size() <= 1;
+	auto origin = transitions.begin();
+	for (int state = 0; state < stateCount; state++) {
+		this->rowOffsets[state] = (unsigned int) this->labels.size();
+		if (origin == transitions.end() || origin->first != state) {
+			continue;
+		}
+		// std::map iterates labels and destinations already sorted
+		for (const auto& label : origin->second) {
+			if (label.second.size() > 1) {
+				this->deterministic = false;
+			}
+			for (int destination : label.second) {
+				this->labels.push_back(label.first);
+				this->targets.push_back(destination);
+			}
+		}
+		origin++;
+	}
+	this->rowOffsets[stateCount] = (unsigned int) this->labels.size();
+	for (int state : finals) {
+		this->finals[state] = 1;
+	}
+	this->initials.assign(initials.begin(), initials.end());
+	this->buildDenseTable();
+}
+
+/**
+ * Converts an automaton imported or built with libAMoRE in its compact representation.
+ *
+ * @param automaton The libAMoRE automaton.
+ * @return The equivalent compact automaton.
+ */
+CompactAutomaton CompactAutomaton::fromAmore(const amore::finite_automaton& automaton) {
+	map<int, map<int, set<int>>> preTransitions, transitions;
+	automaton.get_transition_maps(preTransitions, transitions);
+	return {automaton.get_initial_states(),
+	        automaton.get_final_states(),
+	        transitions,
+	        automaton.get_state_count(),
+	        automaton.get_alphabet_size()};
+}
+
+/**
+ * Builds a compact automaton copying its CSR tables, as stored in a compiled policy, without any parsing.
+ * The tables are assumed to be consistent: every row sorted by label then target and every ID in range.
+ *
+ * @param rowOffsets   stateCount + 1 offsets of the outgoing transitions of every state.
+ * @param stateCount   The number of states.
+ * @param labels       The label of every transition.
+ * @param targets      The destination of every transition.
+ * @param finals       For every state 1 if it is final, 0 otherwise.
+ * @param initials     The sorted initial states.
+ * @param initialCount The number of initial states.
+ * @param alphabetSize The number of labels.
+ * @return The compact automaton.
+ */
+CompactAutomaton CompactAutomaton::fromTables(const unsigned int* rowOffsets,
+                                              unsigned int stateCount,
+                                              const int* labels,
+                                              const int* targets,
+                                              const unsigned char* finals,
+                                              const int* initials,
+                                              unsigned int initialCount,
+                                              int alphabetSize) {
+	CompactAutomaton result;
+	unsigned int transitionCount = rowOffsets[stateCount];
+	result.rowOffsets.assign(rowOffsets, rowOffsets + stateCount + 1);
+	result.labels.assign(labels, labels + transitionCount);
+	result.targets.assign(targets, targets + transitionCount);
+	result.finals.assign(finals, finals + stateCount);
+	result.initials.assign(initials, initials + initialCount);
+	result.alphabetSize = max(alphabetSize, 0);
+	result.deterministic = initialCount <= 1;
+	for (unsigned int state = 0; state < stateCount && result.deterministic; state++) {
+		for (unsigned int i = rowOffsets[state] + 1; i < rowOffsets[state + 1]; i++) {
+			if (labels[i] == labels[i - 1]) {
+				result.deterministic = false;
+				break;
+			}
+		}
+	}
+	result.buildDenseTable();
+	return result;
+}
+
+/**
+ * Converts this automaton back to libAMoRE, so that it can be serialised or visualised in the usual formats.
+ *
+ * @return The equivalent libAMoRE automaton, nullptr if its construction failed.
+ */
+unique_ptr<amore::nondeterministic_finite_automaton> CompactAutomaton::toAmore() const {
+	set<int> initialStates(this->initials.begin(), this->initials.end());
+	set<int> finalStates;
+	map<int, map<int, set<int>>> transitions;
+	for (unsigned int state = 0; state < this->getStateCount(); state++) {
+		if (this->finals[state]) {
+			finalStates.insert((int) state);
+		}
+		for (unsigned int i = this->rowOffsets[state]; i < this->rowOffsets[state + 1]; i++) {
+			transitions[(int) state][this->labels[i]].insert(this->targets[i]);
+		}
+	}
+	unique_ptr<amore::nondeterministic_finite_automaton> automaton = make_unique<amore::nondeterministic_finite_automaton>();
+	if (!automaton->construct(false,
+	                          this->alphabetSize,
+	                          (int) this->getStateCount(),
+	                          initialStates,
+	                          finalStates,
+	                          transitions)) {
+		return nullptr;
+	}
+	return automaton;
+}
+
+/**
+ * Computes the set of states reachable from a set of states reading a label.
+ * It does not allocate as long as the resulting set fits in the StateSet inline storage.
+ *
+ * @param from  The sorted set of current states.
+ * @param label The transition label.
+ * @param to    Where the sorted set of destination states will be written.
+ * @return True if at least one destination state exists, False otherwise.
+ */
+bool CompactAutomaton::step(const StateSet& from, int label, StateSet& to) const {
+	to.clear();
+	if (label < 0 || label >= this->alphabetSize) {
+		return false;
+	}
+	if (this->deterministic && from.size() == 1) {
+		int target = this->stepDeterministic(from.front(), label);
+		if (target < 0) {
+			return false;
+		}
+		to.push_back(target);
+		return true;
+	}
+	for (int state : from) {
+		if (state < 0 || (unsigned int) state >= this->getStateCount()) {
+			continue;
+		}
+		auto rowBegin = this->labels.begin() + this->rowOffsets[state];
+		auto rowEnd = this->labels.begin() + this->rowOffsets[state + 1];
+		for (auto it = lower_bound(rowBegin, rowEnd, label); it != rowEnd && *it == label; it++) {
+			int target = this->targets[it - this->labels.begin()];
+			auto position = lower_bound(to.begin(), to.end(), target);
+			if (position == to.end() || *position != target) {
+				to.insert(position, target);
+			}
+		}
+	}
+	return !to.empty();
+}
+
+/**
+ * Tells if at least one of the given states is final.
+ *
+ * @param states The set of states to check.
+ * @return True if at least one state is final, False otherwise.
+ */
+bool CompactAutomaton::isFinal(const StateSet& states) const {
+	return any_of(states.begin(), states.end(), [this](int state) {
+		return state >= 0 && (unsigned int) state < this->finals.size() && this->finals[state];
+	});
+}
+
+const StateSet& CompactAutomaton::getInitialStates() const {
+	return this->initials;
+}
+
+bool CompactAutomaton::isDeterministic() const {
+	return this->deterministic;
+}
+
+bool CompactAutomaton::isEmpty() const {
+	return this->rowOffsets.empty();
+}
+
+/**
+ * Builds an equivalent deterministic automaton through the subset construction.
+ * Every state of the resulting automaton remembers the set of states of this automaton it represents.
+ *
+ * @param maxStates The maximum number of states that the deterministic automaton can have.
+ * @param result    Where the deterministic automaton will be stored.
+ * @return True if the deterministic automaton has been built, False if it would exceed maxStates.
+ */
+bool CompactAutomaton::determinize(unsigned int maxStates, CompactAutomaton& result) const {
+	map<StateSet, int> ids;
+	vector<StateSet> dfaSubsets;
+	set<int> dfaFinals;
+	map<int, map<int, set<int>>> transitions;
+	ids.emplace(this->initials, 0);
+	dfaSubsets.push_back(this->initials);
+	for (unsigned int i = 0; i < dfaSubsets.size(); i++) {
+		const StateSet current = dfaSubsets[i];
+		if (this->isFinal(current)) {
+			dfaFinals.insert((int) i);
+		}
+		map<int, StateSet> moves;
+		for (int state : current) {
+			for (unsigned int edge = this->rowOffsets[state]; edge < this->rowOffsets[state + 1]; edge++) {
+				StateSet& destination = moves[this->labels[edge]];
+				auto position = lower_bound(destination.begin(), destination.end(), this->targets[edge]);
+				if (position == destination.end() || *position != this->targets[edge]) {
+					destination.insert(position, this->targets[edge]);
+				}
+			}
+		}
+		for (const auto& move : moves) {
+			auto it = ids.find(move.second);
+			if (it == ids.end()) {
+				if (dfaSubsets.size() >= maxStates) {
+					return false;
+				}
+				it = ids.emplace(move.second, (int) dfaSubsets.size()).first;
+				dfaSubsets.push_back(move.second);
+			}
+			transitions[(int) i][move.first] = { it->second };
+		}
+	}
+	result = CompactAutomaton({ 0 }, dfaFinals, transitions, (int) dfaSubsets.size(), this->alphabetSize);
+	result.subsets = move(dfaSubsets);
+	return true;
+}
+
+/**
+ * Replaces the set of final states, the transitions are left untouched.
+ * If this automaton has been determinised the final states refer to the original automaton states.
+ *
+ * @param finalStates The new set of final states.
+ */
+void CompactAutomaton::setFinalStates(const set<int>& finalStates) {
+	for (unsigned int state = 0; state < this->finals.size(); state++) {
+		if (this->subsets.empty()) {
+			this->finals[state] = finalStates.contains((int) state);
+		} else {
+			this->finals[state] = any_of(this->subsets[state].begin(), this->subsets[state].end(), [&finalStates](int nfaState) {
+				return finalStates.contains(nfaState);
+			});
+		}
+	}
+}
+
+/**
+ * Translates a set of states of this automaton in the states of the automaton it has been determinised from.
+ *
+ * @param states The set of states of this automaton.
+ * @return The corresponding original states, the same states if this automaton has not been determinised.
+ */
+set<int> CompactAutomaton::expand(const StateSet& states) const {
+	if (this->subsets.empty()) {
+		return {states.begin(), states.end()};
+	}
+	set<int> result;
+	for (int state : states) {
+		result.insert(this->subsets.at(state).begin(), this->subsets.at(state).end());
+	}
+	return result;
+}
+
+/**
+ * Inverse of CompactAutomaton::expand.
+ *
+ * @param states The set of states of the original automaton.
+ * @return The corresponding set of states in this automaton, empty if a determinised automaton has no such subset.
+ */
+StateSet CompactAutomaton::lift(const set<int>& states) const {
+	StateSet result(states.begin(), states.end());
+	if (this->subsets.empty()) {
+		return result;
+	}
+	auto it = find(this->subsets.begin(), this->subsets.end(), result);
+	if (it == this->subsets.end()) {
+		return {};
+	}
+	return { (int) (it - this->subsets.begin()) };
+}
+
+/**
+ * Builds an automaton that accepts the same sequences of this one once every transparent label is removed from them.
+ * It is needed when some labels are never observed, like the system calls allowed directly by a seccomp filter:
+ * every state gets the transitions of the states reachable from it through transparent labels only.
+ * State IDs are preserved.
+ *
+ * @param transparentLabels The labels that will never be observed.
+ * @return The automaton without transparent labels, a copy of this one if the set is empty.
+ */
+CompactAutomaton CompactAutomaton::withTransparentLabels(const set<int>& transparentLabels) const {
+	if (transparentLabels.empty()) {
+		return *this;
+	}
+	set<int> initialStates(this->initials.begin(), this->initials.end());
+	set<int> finalStates;
+	map<int, map<int, set<int>>> transitions;
+	vector<unsigned char> closure(this->getStateCount());
+	vector<int> pending;
+	for (unsigned int state = 0; state < this->getStateCount(); state++) {
+		// Every state reachable from state through transparent labels only
+		fill(closure.begin(), closure.end(), 0);
+		closure[state] = 1;
+		pending.assign(1, (int) state);
+		while (!pending.empty()) {
+			int current = pending.back();
+			pending.pop_back();
+			if (this->finals[current]) {
+				finalStates.insert((int) state);
+			}
+			for (unsigned int i = this->rowOffsets[current]; i < this->rowOffsets[current + 1]; i++) {
+				if (!transparentLabels.contains(this->labels[i])) {
+					transitions[(int) state][this->labels[i]].insert(this->targets[i]);
+				} else if (!closure[this->targets[i]]) {
+					closure[this->targets[i]] = 1;
+					pending.push_back(this->targets[i]);
+				}
+			}
+		}
+	}
+	return {initialStates, finalStates, transitions, (int) this->getStateCount(), this->alphabetSize};
+}
+
+/**
+ * Computes the states that can be reached from the initial states.
+ *
+ * @return A vector indexed by state ID which elements are 1 if that state is reachable, 0 otherwise.
+ */
+vector<unsigned char> CompactAutomaton::getReachableStates() const {
+	vector<unsigned char> reachable(this->getStateCount(), 0);
+	vector<int> pending(this->initials.begin(), this->initials.end());
+	for (int state : pending) {
+		reachable[state] = 1;
+	}
+	while (!pending.empty()) {
+		int current = pending.back();
+		pending.pop_back();
+		for (unsigned int i = this->rowOffsets[current]; i < this->rowOffsets[current + 1]; i++) {
+			if (!reachable[this->targets[i]]) {
+				reachable[this->targets[i]] = 1;
+				pending.push_back(this->targets[i]);
+			}
+		}
+	}
+	return reachable;
+}
+
+/**
+ * Builds the smallest automaton bisimilar to this one: unreachable states are removed and the states with the same
+ * finality whose transitions lead, label by label, to the same classes of states are merged, refining the partition
+ * until it is stable. Merged states accept the same sequences, so every check gives the same result as before.
+ * The states are renumbered in breadth first order from the initial states and the determinisation subsets are lost.
+ *
+ * @return The reduced automaton.
+ */
+CompactAutomaton CompactAutomaton::minimize() const {
+	vector<unsigned char> reachable = this->getReachableStates();
+	vector<int> blocks(this->getStateCount(), -1);
+	unsigned int blockCount = 0, previousCount;
+	for (unsigned int state = 0; state < this->getStateCount(); state++) {
+		if (reachable[state]) {
+			blocks[state] = this->finals[state];
+		}
+	}
+	do {
+		// The signature includes the current block, so that a refinement can only split blocks
+		map<pair<int, vector<pair<int, int>>>, int> signatures;
+		vector<int> refined(blocks.size(), -1);
+		previousCount = blockCount;
+		for (unsigned int state = 0; state < this->getStateCount(); state++) {
+			if (!reachable[state]) {
+				continue;
+			}
+			vector<pair<int, int>> moves;
+			for (unsigned int i = this->rowOffsets[state]; i < this->rowOffsets[state + 1]; i++) {
+				moves.emplace_back(this->labels[i], blocks[this->targets[i]]);
+			}
+			sort(moves.begin(), moves.end());
+			moves.erase(unique(moves.begin(), moves.end()), moves.end());
+			refined[state] = signatures.emplace(make_pair(blocks[state], std::move(moves)), (int) signatures.size()).first->second;
+		}
+		blocks = std::move(refined);
+		blockCount = (unsigned int) signatures.size();
+	} while (blockCount != previousCount);
+	// Breadth first numbering of the blocks
+	vector<int> ids(blockCount, -1), representatives;
+	for (int state : this->initials) {
+		if (ids[blocks[state]] < 0) {
+			ids[blocks[state]] = (int) representatives.size();
+			representatives.push_back(state);
+		}
+	}
+	for (unsigned int i = 0; i < representatives.size(); i++) {
+		int state = representatives[i];
+		for (unsigned int edge = this->rowOffsets[state]; edge < this->rowOffsets[state + 1]; edge++) {
+			if (ids[blocks[this->targets[edge]]] < 0) {
+				ids[blocks[this->targets[edge]]] = (int) representatives.size();
+				representatives.push_back(this->targets[edge]);
+			}
+		}
+	}
+	set<int> initialStates, finalStates;
+	map<int, map<int, set<int>>> transitions;
+	for (int state : this->initials) {
+		initialStates.insert(ids[blocks[state]]);
+	}
+	for (unsigned int i = 0; i < representatives.size(); i++) {
+		int state = representatives[i];
+		if (this->finals[state]) {
+			finalStates.insert((int) i);
+		}
+		for (unsigned int edge = this->rowOffsets[state]; edge < this->rowOffsets[state + 1]; edge++) {
+			transitions[(int) i][this->labels[edge]].insert(ids[blocks[this->targets[edge]]]);
+		}
+	}
+	return {initialStates, finalStates, transitions, (int) representatives.size(), this->alphabetSize};
+}
+
+/**
+ * Builds a copy of this automaton with new state and label IDs.
+ *
+ * @param stateMap The new ID of every state, every state must have one.
+ * @param labelMap The new ID of every label, the transitions of the labels mapped on -1 are removed.
+ * @return The renumbered automaton, its alphabet size is the greatest new label plus one.
+ */
+CompactAutomaton CompactAutomaton::renumber(const vector<int>& stateMap, const vector<int>& labelMap) const {
+	assert(stateMap.size() >= this->getStateCount());
+	set<int> initialStates, finalStates;
+	map<int, map<int, set<int>>> transitions;
+	int stateCount = 0;
+	for (int state : this->initials) {
+		initialStates.insert(stateMap[state]);
+	}
+	for (unsigned int state = 0; state < this->getStateCount(); state++) {
+		stateCount = max(stateCount, stateMap[state] + 1);
+		if (this->finals[state]) {
+			finalStates.insert(stateMap[state]);
+		}
+		for (unsigned int i = this->rowOffsets[state]; i < this->rowOffsets[state + 1]; i++) {
+			if (labelMap.at(this->labels[i]) >= 0) {
+				transitions[stateMap[state]][labelMap[this->labels[i]]].insert(stateMap[this->targets[i]]);
+			}
+		}
+	}
+	return {initialStates, finalStates, transitions, stateCount, 0};
+}
+
+/**
+ * Tells if this automaton has the shape of a learned one: every transition leads to the state named after its label
+ * and no initial state is the label of a transition.
+ * Only such automata can be learned further, since the Authorizer names every new state after its label.
+ *
+ * @return True if every state is named after the label of its incoming transitions, False otherwise.
+ */
+bool CompactAutomaton::hasLabelledStates() const {
+	for (unsigned int i = 0; i < this->targets.size(); i++) {
+		if (this->targets[i] != this->labels[i]) {
+			return false;
+		}
+	}
+	return none_of(this->initials.begin(), this->initials.end(), [this](int state) {
+		return state < this->alphabetSize && find(this->labels.begin(), this->labels.end(), state) != this->labels.end();
+	});
+}
+
+/**
+ * Renames every state after the label of its incoming transitions and the initial state as 0, so that the result has
+ * the shape of a learned automaton. It is possible only if there is a single initial state without incoming
+ * transitions, every other state is entered by a single label and every label enters a single state.
+ *
+ * @param result Where the renamed automaton will be stored.
+ * @return True if the states have been renamed, False if this automaton cannot have labelled states.
+ */
+bool CompactAutomaton::labelStates(CompactAutomaton& result) const {
+	vector<int> stateMap(this->getStateCount(), -1), labelTargets(this->alphabetSize, -1);
+	if (this->initials.size() != 1 || this->alphabetSize <= 0) {
+		return false;
+	}
+	stateMap[this->initials.front()] = 0;
+	for (unsigned int i = 0; i < this->targets.size(); i++) {
+		int label = this->labels[i], target = this->targets[i];
+		if (label == 0 || target == this->initials.front() ||
+		    (labelTargets[label] >= 0 && labelTargets[label] != target) || (stateMap[target] >= 0 && stateMap[target] != label)) {
+			return false;
+		}
+		labelTargets[label] = target;
+		stateMap[target] = label;
+	}
+	// States that are never entered are unreachable, they get the IDs after the labels
+	int nextState = this->alphabetSize;
+	for (int& state : stateMap) {
+		if (state < 0) {
+			state = nextState++;
+		}
+	}
+	vector<int> labelMap(this->alphabetSize);
+	for (int label = 0; label < this->alphabetSize; label++) {
+		labelMap[label] = label;
+	}
+	result = this->renumber(stateMap, labelMap);
+	return true;
+}
+
+bool CompactAutomaton::hasTransition(int state, int label) const {
+	if (state < 0 || (unsigned int) state >= this->getStateCount()) {
+		return false;
+	}
+	auto rowBegin = this->labels.begin() + this->rowOffsets[state];
+	auto rowEnd = this->labels.begin() + this->rowOffsets[state + 1];
+	return binary_search(rowBegin, rowEnd, label);
+}
+
+/**
+ * Gets every state entered by a label, whatever state the transition starts from.
+ *
+ * @param label The transition label.
+ * @return The sorted targets of the transitions labelled label, empty if there are none.
+ */
+StateSet CompactAutomaton::getTargets(int label) const {
+	StateSet result;
+	for (unsigned int i = 0; i < this->labels.size(); i++) {
+		if (this->labels[i] == label) {
+			auto position = lower_bound(result.begin(), result.end(), this->targets[i]);
+			if (position == result.end() || *position != this->targets[i]) {
+				result.insert(position, this->targets[i]);
+			}
+		}
+	}
+	return result;
+}
+
+unsigned int CompactAutomaton::getOutDegree(int state) const {
+	if (state < 0 || (unsigned int) state >= this->getStateCount()) {
+		return 0;
+	}
+	return this->rowOffsets[state + 1] - this->rowOffsets[state];
+}
+
+/**
+ * Gets the index of the first outgoing transition of a state, the following CompactAutomaton::getOutDegree
+ * transitions start from the same state and are sorted by label and target.
+ *
+ * @param state The origin state.
+ * @return The index of its first transition.
+ */
+unsigned int CompactAutomaton::getFirstTransition(int state) const {
+	assert(state >= 0 && (unsigned int) state < this->getStateCount());
+	return this->rowOffsets[state];
+}
+
+int CompactAutomaton::getTransitionLabel(unsigned int transition) const {
+	assert(transition < this->labels.size());
+	return this->labels[transition];
+}
+
+int CompactAutomaton::getTransitionTarget(unsigned int transition) const {
+	assert(transition < this->targets.size());
+	return this->targets[transition];
+}
+
+bool CompactAutomaton::isFinalState(int state) const {
+	return state >= 0 && (unsigned int) state < this->finals.size() && this->finals[state];
+}
+
+unsigned int CompactAutomaton::getStateCount() const {
+	return this->rowOffsets.empty() ? 0 : (unsigned int) this->rowOffsets.size() - 1;
+}
+
+unsigned int CompactAutomaton::getTransitionCount() const {
+	return (unsigned int) this->targets.size();
+}
+
+int CompactAutomaton::getAlphabetSize() const {
+	return this->alphabetSize;
+}
+
+/**
+ * For deterministic automata that are small enough, it builds a table that resolves a transition with a single lookup.
+ */
+void CompactAutomaton::buildDenseTable() {
+	this->denseTable.clear();
+	if (!this->deterministic || (unsigned long) this->getStateCount() * this->alphabetSize > CompactAutomaton::DENSE_TABLE_MAX_ENTRIES) {
+		return;
+	}
+	this->denseTable.assign((unsigned long) this->getStateCount() * this->alphabetSize, -1);
+	for (unsigned int state = 0; state < this->getStateCount(); state++) {
+		for (unsigned int i = this->rowOffsets[state]; i < this->rowOffsets[state + 1]; i++) {
+			this->denseTable[(unsigned long) state * this->alphabetSize + this->labels[i]] = this->targets[i];
+		}
+	}
+}
+
+/**
+ * Transition lookup for deterministic automata, it assumes 0 <= label < alphabetSize.
+ *
+ * @param from  The current state.
+ * @param label The transition label.
+ * @return The destination state or -1 if there is no such transition.
+ */
+int CompactAutomaton::stepDeterministic(int from, int label) const {
+	if (from < 0 || (unsigned int) from >= this->getStateCount()) {
+		return -1;
+	}
+	if (!this->denseTable.empty()) {
+		return this->denseTable[(unsigned long) from * this->alphabetSize + label];
+	}
+	auto rowBegin = this->labels.begin() + this->rowOffsets[from];
+	auto rowEnd = this->labels.begin() + this->rowOffsets[from + 1];
+	auto it = lower_bound(rowBegin, rowEnd, label);
+	return it != rowEnd && *it == label ? this->targets[it - this->labels.begin()] : -1;
+}
@@ -0,0 +1,77 @@
+#ifndef PTRACER_COMPACTAUTOMATON_H
+#define PTRACER_COMPACTAUTOMATON_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include <boost/container/small_vector.hpp>
+#include <amore++/nondeterministic_finite_automaton.h>
+
+// Sorted set of automaton states, small sets are kept inline so that enforcing does not allocate
+typedef boost::container::small_vector<int, 4> StateSet;
+
+class CompactAutomaton {
+public:
+	static const unsigned int DEFAULT_MAX_DFA_STATES;
+	static const unsigned long DENSE_TABLE_MAX_ENTRIES;
+	CompactAutomaton() = default;
+	CompactAutomaton(const std::set<int>& initials,
+	                 const std::set<int>& finals,
+	                 const std::map<int, std::map<int, std::set<int>>>& transitions,
+	                 int stateCount,
+	                 int alphabetSize);
+	static CompactAutomaton fromAmore(const amore::finite_automaton& automaton);
+	static CompactAutomaton fromTables(const unsigned int* rowOffsets,
+	                                   unsigned int stateCount,
+	                                   const int* labels,
+	                                   const int* targets,
+	                                   const unsigned char* finals,
+	                                   const int* initials,
+	                                   unsigned int initialCount,
+	                                   int alphabetSize);
+	[[nodiscard]] std::unique_ptr<amore::nondeterministic_finite_automaton> toAmore() const;
+	bool step(const StateSet& from, int label, StateSet& to) const;
+	[[nodiscard]] bool isFinal(const StateSet& states) const;
+	[[nodiscard]] const StateSet& getInitialStates() const;
+	[[nodiscard]] bool isDeterministic() const;
+	[[nodiscard]] bool isEmpty() const;
+	bool determinize(unsigned int maxStates, CompactAutomaton& result) const;
+	void setFinalStates(const std::set<int>& finals);
+	[[nodiscard]] std::set<int> expand(const StateSet& states) const;
+	[[nodiscard]] StateSet lift(const std::set<int>& states) const;
+	[[nodiscard]] CompactAutomaton withTransparentLabels(const std::set<int>& transparentLabels) const;
+	[[nodiscard]] std::vector<unsigned char> getReachableStates() const;
+	[[nodiscard]] CompactAutomaton minimize() const;
+	[[nodiscard]] CompactAutomaton renumber(const std::vector<int>& stateMap, const std::vector<int>& labelMap) const;
+	[[nodiscard]] bool hasLabelledStates() const;
+	bool labelStates(CompactAutomaton& result) const;
+	[[nodiscard]] bool hasTransition(int state, int label) const;
+	[[nodiscard]] StateSet getTargets(int label) const;
+	[[nodiscard]] unsigned int getOutDegree(int state) const;
+	[[nodiscard]] unsigned int getFirstTransition(int state) const;
+	[[nodiscard]] int getTransitionLabel(unsigned int transition) const;
+	[[nodiscard]] int getTransitionTarget(unsigned int transition) const;
+	[[nodiscard]] bool isFinalState(int state) const;
+	[[nodiscard]] unsigned int getStateCount() const;
+	[[nodiscard]] unsigned int getTransitionCount() const;
+	[[nodiscard]] int getAlphabetSize() const;
+
+private:
+	// CSR layout: the outgoing edges of state s are in [rowOffsets[s], rowOffsets[s + 1]) sorted by label then target
+	std::vector<unsigned int> rowOffsets;
+	std::vector<int> labels;
+	std::vector<int> targets;
+	std::vector<unsigned char> finals;
+	StateSet initials;
+	int alphabetSize = 0;
+	bool deterministic = false;
+	// Only for deterministic automata small enough: state * alphabetSize + label -> target or -1
+	std::vector<int> denseTable;
+	// Only for determinised automata: DFA state -> set of NFA states it represents
+	std::vector<StateSet> subsets;
+	void buildDenseTable();
+	[[nodiscard]] int stepDeterministic(int from, int label) const;
+};
+
+#endif //PTRACER_COMPACTAUTOMATON_H
@@ -34,6 +34,19 @@ public:
 		return popped_value;
 	}
 
+	bool timed_pop(Data& popped_value, unsigned int timeoutMs) {
+		boost::mutex::scoped_lock lock(mutex);
+		boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(timeoutMs);
+		while (queue.empty()) {
+			if (!condition_variable.timed_wait(lock, deadline)) {
+				return false;
+			}
+		}
+		popped_value = queue.front();
+		queue.pop();
+		return true;
+	}
+
 	int size() const {
 		boost::mutex::scoped_lock lock(mutex);
 		return this->queue.size();
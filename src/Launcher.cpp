@@ -1,8 +1,11 @@
 #include <boost/program_options.hpp>
+#include <csignal>
 #include <iostream>
 #include "Launcher.h"
 #include "TracingManager.h"
 #include "SyscallDecoderMapper.h"
+#include "decoders/PayloadCapture.h"
+#include "decoders/PayloadWriter.h"
 
 using namespace std;
 using namespace boost::program_options;
@@ -16,18 +19,45 @@ const string Launcher::FOLLOW_THREADS_OPT = "follow-threads";
 const string Launcher::FOLLOW_CHILDREN_OPT = "follow-children";
 const string Launcher::JAIL_OPT = "jail";
 const string Launcher::DECODERS_OPT = "decoders";
+const string Launcher::PAYLOAD_ARCHIVE_OPT = "payload-archive";
+const string Launcher::CAPTURE_SYSCALL_BYTES_OPT = "capture-syscall-bytes";
+const string Launcher::CAPTURE_FD_BYTES_OPT = "capture-fd-bytes";
+const string Launcher::CAPTURE_PROCESS_BYTES_OPT = "capture-process-bytes";
+const string Launcher::CAPTURE_WINDOW_OPT = "capture-window";
+const string Launcher::CAPTURE_INCLUDE_OPT = "capture-include";
+const string Launcher::CAPTURE_EXCLUDE_OPT = "capture-exclude";
+const string Launcher::CAPTURE_METADATA_OPT = "capture-metadata-only";
 const string Launcher::BACKTRACE_OPT = "backtrace";
+const string Launcher::STACK_DEPTH_OPT = "stack-depth";
+const string Launcher::STACK_EXCLUDE_OPT = "stack-exclude";
 const string Launcher::AUTHORIZER_OPT = "authorizer";
 const string Launcher::LEARN_OPT = "learn";
+const string Launcher::DETERMINIZE_OPT = "determinize";
+const string Launcher::SECCOMP_OPT = "seccomp";
+const string Launcher::VIOLATION_POLICY_OPT = "violation-policy";
+const string Launcher::AUTHORIZER_THREADS_OPT = "authorizer-threads";
+const string Launcher::CHECKPOINT_INTERVAL_OPT = "checkpoint-interval";
+const string Launcher::CHECKPOINT_TRANSITIONS_OPT = "checkpoint-transitions";
+const string Launcher::RESUME_OPT = "resume";
+const string Launcher::MODEL_OPT = "model";
+const string Launcher::NGRAM_SIZE_OPT = "ngram-size";
+const string Launcher::MODEL_PATH_OPT = "model-path";
 const string Launcher::NFA_PATH_OPT = "nfa";
+const string Launcher::POLICY_PATH_OPT = "policy";
+const string Launcher::MODEL_DIR_OPT = "model-dir";
 const string Launcher::DOT_PATH_OPT = "dot";
+const string Launcher::GRAPHML_PATH_OPT = "graphml";
+const string Launcher::JSON_PATH_OPT = "json";
 const string Launcher::ASSOCIATIONS_PATH_OPT = "associations";
 const string Launcher::TRACEE_NAME = "name";
+// Maximum time the main loop waits for a notification before checking for a termination request
+const unsigned int Launcher::TERMINATION_POLL_MS = 100;
+
+// Set by the SIGINT handler, the main loop terminates ptracer as soon as it sees it
+static volatile sig_atomic_t terminationRequested = 0;
 
 void terminationHandler(int signum) {
-	cout << "Termination signal received" << endl;
-	SyscallDecoderMapper::printReport();
-	exit(1);
+	terminationRequested = 1;
 }
 
 /**
@@ -47,11 +77,35 @@ Launcher::Launcher(int argc, const char** argv) {
 			(Launcher::FOLLOW_CHILDREN_OPT.c_str(), value<bool>()->default_value(true), "Trace also child processes")
 			(Launcher::JAIL_OPT.c_str(), value<bool>()->default_value(false), "Kill the traced process and all its children if ptracer is killed")
 			(Launcher::DECODERS_OPT.c_str(), value<bool>()->default_value(true), "Enables or disables system call decoders")
+			(Launcher::PAYLOAD_ARCHIVE_OPT.c_str(), value<string>(), "Write the payloads captured by the decoders in this single archive instead of a file per file descriptor, they can be extracted with the extract-payloads command")
+			(Launcher::CAPTURE_SYSCALL_BYTES_OPT.c_str(), value<unsigned long>()->default_value(0), "Maximum payload bytes captured for every system call, 0 for no limit")
+			(Launcher::CAPTURE_FD_BYTES_OPT.c_str(), value<unsigned long>()->default_value(0), "Maximum payload bytes captured for every file descriptor, 0 for no limit")
+			(Launcher::CAPTURE_PROCESS_BYTES_OPT.c_str(), value<unsigned long>()->default_value(0), "Maximum payload bytes captured for every process, 0 for no limit")
+			(Launcher::CAPTURE_WINDOW_OPT.c_str(), value<string>()->default_value("head"), "Which bytes of a payload over budget are captured: head, tail or head-tail (half each)")
+			(Launcher::CAPTURE_INCLUDE_OPT.c_str(), value<vector<string>>()->composing(), "Capture only the payloads of the files which path, or of the sockets which peer (address:port), matches this glob pattern, it can be repeated")
+			(Launcher::CAPTURE_EXCLUDE_OPT.c_str(), value<vector<string>>()->composing(), "Never capture the payloads of the files which path, or of the sockets which peer, matches this glob pattern, it can be repeated")
+			(Launcher::CAPTURE_METADATA_OPT.c_str(), value<bool>()->default_value(false), "Never read the payloads, count only the bytes, the calls and their sizes for every path and socket peer")
 			(Launcher::BACKTRACE_OPT.c_str(), value<bool>()->default_value(true), "Extract the full stacktrace that lead to a systemcall")
+			(Launcher::STACK_DEPTH_OPT.c_str(), value<unsigned int>()->default_value(0), "Keep only the innermost frames of every stacktrace, 0 keeps them all")
+			(Launcher::STACK_EXCLUDE_OPT.c_str(), value<vector<string>>()->composing(), "Drop the stacktrace frames of the modules which path contains this string (e.g. libc.so), it can be repeated")
 			(Launcher::AUTHORIZER_OPT.c_str(), value<bool>()->default_value(false), "Enable or disables the Authorizer module and all its options")
 			(Launcher::LEARN_OPT.c_str(), value<bool>()->default_value(true), "Sets the Authorizer module in learning mode")
+			(Launcher::DETERMINIZE_OPT.c_str(), value<bool>()->default_value(false), "Determinise the NFA before enforcing it, every check becomes a single lookup at the cost of a slower start")
+			(Launcher::SECCOMP_OPT.c_str(), value<bool>()->default_value(false), "In enforce mode compile the NFA in a seccomp filter, system calls that loop on every state are not traced; never allowed ones are killed by the kernel with the kill violation policy, fail with EPERM with the deny one and are traced with the others")
+			(Launcher::VIOLATION_POLICY_OPT.c_str(), value<string>()->default_value("ask"), "In enforce mode what to do with a system call that is not authorised or a non final termination: kill, deny (the system call fails with EPERM), learn (it is added to the NFA), ask (only the offending tracee waits for the operator) or shadow (nothing waits, the model is evaluated on a separate thread and violations are only reported)")
+			(Launcher::AUTHORIZER_THREADS_OPT.c_str(), value<unsigned int>()->default_value(0), "In enforce mode the number of threads that check the system calls, each one handles a shard of the traced threads, 0 to check them in the main thread; ignored in learning and shadow mode")
+			(Launcher::CHECKPOINT_INTERVAL_OPT.c_str(), value<unsigned int>()->default_value(0), "In learning mode save a checkpoint of the NFA and the associations every given number of seconds, 0 to disable it")
+			(Launcher::CHECKPOINT_TRANSITIONS_OPT.c_str(), value<unsigned int>()->default_value(0), "In learning mode save a checkpoint of the NFA and the associations every given number of new transitions, 0 to disable it")
+			(Launcher::RESUME_OPT.c_str(), value<bool>()->default_value(false), "In learning mode start from the last checkpoint of the NFA and the associations, if any")
+			(Launcher::MODEL_OPT.c_str(), value<string>()->default_value("nfa"), "The model learned or enforced by the Authorizer: nfa or ngram (the windows of the last system calls of every thread)")
+			(Launcher::NGRAM_SIZE_OPT.c_str(), value<unsigned int>()->default_value(3), "Number of system calls of every window of the ngram model")
+			(Launcher::MODEL_PATH_OPT.c_str(), value<string>(), "Specifies the path where the model managed by the Authorizer is present or will be created, when it is not an NFA")
 			(Launcher::NFA_PATH_OPT.c_str(), value<string>(), "Specifies the path where the NFA managed by the Auhtorizer is present or will be created")
+			(Launcher::POLICY_PATH_OPT.c_str(), value<string>(), "In enforce mode use a policy compiled with the compile-policy command in place of the NFA and the associations, which are then only needed to save its changes")
+			(Launcher::MODEL_DIR_OPT.c_str(), value<string>(), "In enforce mode use the per-executable policies written by the split-policy command, each one is loaded when a tracee starts running its executable and unloaded when no tracee does anymore")
 			(Launcher::DOT_PATH_OPT.c_str(), value<string>(), "Specifies the path where the DOT representation of the NFA managed by the Auhtorizer will be created")
+			(Launcher::GRAPHML_PATH_OPT.c_str(), value<string>(), "Specifies the path where the GraphML representation of the NFA managed by the Auhtorizer will be created")
+			(Launcher::JSON_PATH_OPT.c_str(), value<string>(), "Specifies the path where the JSON representation of the NFA managed by the Auhtorizer will be created")
 			(Launcher::ASSOCIATIONS_PATH_OPT.c_str(), value<string>(), "Specifies the path where the associations between state IDs and System Calls is present or will be created by the Authorizer")
 			(Launcher::TRACEE_NAME.c_str(), value<string>(), "Name of the executable to attach to, used only when a PID is specified")
 	;
@@ -87,17 +141,132 @@ Launcher::Launcher(int argc, const char** argv) {
 	this->follow_children = option_values[Launcher::FOLLOW_CHILDREN_OPT].as<bool>();
 	this->tracee_jail = option_values[Launcher::JAIL_OPT].as<bool>();
 	SyscallDecoderMapper::enabled = option_values[Launcher::DECODERS_OPT].as<bool>();
+	if (option_values.count(Launcher::PAYLOAD_ARCHIVE_OPT) > 0) {
+		PayloadWriter::setArchive(option_values[Launcher::PAYLOAD_ARCHIVE_OPT].as<string>());
+	}
+	PayloadCapture::Policy capturePolicy;
+	capturePolicy.syscallBytes = option_values[Launcher::CAPTURE_SYSCALL_BYTES_OPT].as<unsigned long>();
+	capturePolicy.fdBytes = option_values[Launcher::CAPTURE_FD_BYTES_OPT].as<unsigned long>();
+	capturePolicy.processBytes = option_values[Launcher::CAPTURE_PROCESS_BYTES_OPT].as<unsigned long>();
+	capturePolicy.window = PayloadCapture::parseWindow(option_values[Launcher::CAPTURE_WINDOW_OPT].as<string>());
+	if (option_values.count(Launcher::CAPTURE_INCLUDE_OPT) > 0) {
+		capturePolicy.include = option_values[Launcher::CAPTURE_INCLUDE_OPT].as<vector<string>>();
+	}
+	if (option_values.count(Launcher::CAPTURE_EXCLUDE_OPT) > 0) {
+		capturePolicy.exclude = option_values[Launcher::CAPTURE_EXCLUDE_OPT].as<vector<string>>();
+	}
+	capturePolicy.metadataOnly = option_values[Launcher::CAPTURE_METADATA_OPT].as<bool>();
+	PayloadCapture::setPolicy(capturePolicy);
+	// The decoders read the capture policy when they register
+	SyscallDecoderMapper::init();
 	this->backtrace = option_values[Launcher::BACKTRACE_OPT].as<bool>();
+	this->stackDepth = option_values[Launcher::STACK_DEPTH_OPT].as<unsigned int>();
+	if (option_values.count(Launcher::STACK_EXCLUDE_OPT) > 0) {
+		this->excludedModules = option_values[Launcher::STACK_EXCLUDE_OPT].as<vector<string>>();
+	}
+	if (!this->backtrace && (this->stackDepth > 0 || !this->excludedModules.empty())) {
+		cerr << "Stacktraces are not extracted, the stack depth and the excluded modules will not be used" << endl;
+	}
 	if (option_values[Launcher::AUTHORIZER_OPT].as<bool>()) {
-		if (option_values.count(Launcher::NFA_PATH_OPT) <= 0 || option_values.count(Launcher::ASSOCIATIONS_PATH_OPT) <= 0) {
+		string nfaPath, associationsPath, policyPath;
+		unique_ptr<SequenceModel> sequenceModel;
+		unique_ptr<ModelStore> modelStore;
+		bool modelDirectory = option_values.count(Launcher::MODEL_DIR_OPT) > 0;
+		if (option_values[Launcher::MODEL_OPT].as<string>() != "nfa") {
+			sequenceModel = SequenceModel::create(option_values[Launcher::MODEL_OPT].as<string>(),
+			                                      option_values[Launcher::NGRAM_SIZE_OPT].as<unsigned int>());
+			if (option_values.count(Launcher::POLICY_PATH_OPT) > 0 || modelDirectory) {
+				throw runtime_error("A compiled policy or a model directory can be used only with the nfa model");
+			}
+			if (option_values.count(Launcher::MODEL_PATH_OPT) <= 0 || option_values.count(Launcher::ASSOCIATIONS_PATH_OPT) <= 0) {
+				throw runtime_error("The " + sequenceModel->getName() + " model requires to specify a path where it is saved and retrieved (if exists) and a path where to store the IDs <-> syscalls associations");
+			}
+			nfaPath = option_values[Launcher::MODEL_PATH_OPT].as<string>();
+		} else if (modelDirectory) {
+			if (option_values[Launcher::LEARN_OPT].as<bool>()) {
+				throw runtime_error("A model directory can be used only in enforce mode");
+			}
+			modelStore = make_unique<ModelStore>(option_values[Launcher::MODEL_DIR_OPT].as<string>(),
+			                                     option_values[Launcher::DETERMINIZE_OPT].as<bool>());
+			if (!modelStore->load()) {
+				throw runtime_error("Invalid model directory " + option_values[Launcher::MODEL_DIR_OPT].as<string>());
+			}
+		} else if (option_values.count(Launcher::POLICY_PATH_OPT) > 0) {
+			if (option_values[Launcher::LEARN_OPT].as<bool>()) {
+				throw runtime_error("A compiled policy can be used only in enforce mode");
+			}
+			policyPath = option_values[Launcher::POLICY_PATH_OPT].as<string>();
+		} else if (option_values.count(Launcher::NFA_PATH_OPT) <= 0 || option_values.count(Launcher::ASSOCIATIONS_PATH_OPT) <= 0) {
 			throw runtime_error("The Authorizer module requires to specify a path where the NFA is saved and retrieved (if exists) and a path where to store the IDs <-> syscalls associations");
 		}
-		this->authorizer = make_unique<Authorizer>(option_values[Launcher::NFA_PATH_OPT].as<string>(),
-		                                           option_values[Launcher::ASSOCIATIONS_PATH_OPT].as<string>(),
-		                                           option_values[Launcher::LEARN_OPT].as<bool>());
+		if (option_values.count(Launcher::NFA_PATH_OPT) > 0 && sequenceModel == nullptr) {
+			nfaPath = option_values[Launcher::NFA_PATH_OPT].as<string>();
+		}
+		if (option_values.count(Launcher::ASSOCIATIONS_PATH_OPT) > 0) {
+			associationsPath = option_values[Launcher::ASSOCIATIONS_PATH_OPT].as<string>();
+		}
+		unsigned int authorizerThreads = option_values[Launcher::AUTHORIZER_THREADS_OPT].as<unsigned int>();
+		if (option_values[Launcher::LEARN_OPT].as<bool>() && authorizerThreads > 0) {
+			cerr << "The Authorizer threads are available only in enforce mode, the system calls will be learned in the main thread" << endl;
+			authorizerThreads = 0;
+		} else if (option_values[Launcher::VIOLATION_POLICY_OPT].as<string>() == "shadow" && authorizerThreads > 0) {
+			cerr << "In shadow mode the system calls are checked by a single thread, the Authorizer threads will not be used" << endl;
+			authorizerThreads = 0;
+		}
+		this->authorizer = make_unique<Authorizer>(nfaPath,
+		                                           associationsPath,
+		                                           option_values[Launcher::LEARN_OPT].as<bool>(),
+		                                           option_values[Launcher::DETERMINIZE_OPT].as<bool>(),
+		                                           Authorizer::parseViolationPolicy(option_values[Launcher::VIOLATION_POLICY_OPT].as<string>()),
+		                                           authorizerThreads,
+		                                           policyPath,
+		                                           option_values[Launcher::LEARN_OPT].as<bool>() && option_values[Launcher::RESUME_OPT].as<bool>(),
+		                                           std::move(sequenceModel),
+		                                           std::move(modelStore));
+		StackLimits stackLimits;
+		if (this->backtrace) {
+			stackLimits.depth = this->stackDepth;
+			stackLimits.excludedModules = this->excludedModules;
+		}
+		if (!this->authorizer->setStackLimits(stackLimits)) {
+			throw runtime_error("The model has to be learned again with the same --" + Launcher::STACK_DEPTH_OPT + " and --" +
+			                    Launcher::STACK_EXCLUDE_OPT + " options");
+		}
+		unsigned int checkpointInterval = option_values[Launcher::CHECKPOINT_INTERVAL_OPT].as<unsigned int>();
+		unsigned int checkpointTransitions = option_values[Launcher::CHECKPOINT_TRANSITIONS_OPT].as<unsigned int>();
+		if (!option_values[Launcher::LEARN_OPT].as<bool>() &&
+		    (checkpointInterval > 0 || checkpointTransitions > 0 || option_values[Launcher::RESUME_OPT].as<bool>())) {
+			cerr << "Checkpoints are available only in learning mode, they will not be used" << endl;
+		} else if (checkpointInterval > 0 || checkpointTransitions > 0) {
+			this->authorizer->enableCheckpoints(checkpointInterval, checkpointTransitions);
+		}
+		// Without backtraces every association is a system call number, a matrix of them is enough to enforce
+		if (!this->backtrace && !option_values[Launcher::LEARN_OPT].as<bool>() && option_values[Launcher::MODEL_OPT].as<string>() == "nfa" &&
+		    !modelDirectory) {
+			this->authorizer->useSyscallMatrix();
+		}
 		if (option_values.count(Launcher::DOT_PATH_OPT) > 0) {
 			this->dotPath = option_values[Launcher::DOT_PATH_OPT].as<string>();
 		}
+		if (option_values.count(Launcher::GRAPHML_PATH_OPT) > 0) {
+			this->graphmlPath = option_values[Launcher::GRAPHML_PATH_OPT].as<string>();
+		}
+		if (option_values.count(Launcher::JSON_PATH_OPT) > 0) {
+			this->jsonPath = option_values[Launcher::JSON_PATH_OPT].as<string>();
+		}
+		if (option_values[Launcher::SECCOMP_OPT].as<bool>()) {
+			if (option_values[Launcher::LEARN_OPT].as<bool>()) {
+				cerr << "A seccomp filter can be used only in enforce mode, it will not be installed" << endl;
+			} else if (option_values.count(Launcher::PID_OPT) > 0) {
+				cerr << "A seccomp filter cannot be installed in an already running process, it will not be installed" << endl;
+			} else if (modelDirectory) {
+				cerr << "A seccomp filter is compiled from a single NFA, it cannot be installed with a model directory" << endl;
+			} else if (option_values[Launcher::VIOLATION_POLICY_OPT].as<string>() == "shadow") {
+				cerr << "A seccomp filter would enforce the NFA in shadow mode, it will not be installed" << endl;
+			} else {
+				this->seccompFilter = this->authorizer->compileSeccompFilter();
+			}
+		}
 	}
 	if (option_values.count(Launcher::PID_OPT) > 0) {
 		if (option_values.count(Launcher::TRACEE_NAME) > 0) {
@@ -116,10 +285,19 @@ void Launcher::start() {
 	cout << "Follow threads: " << (this->follow_threads ? "true" : "false") << endl;
 	cout << "Follow children: " << (this->follow_children ? "true" : "false") << endl;
 	cout << "Tracee jail: " << (this->tracee_jail ? "true" : "false") << endl;
+	if (this->backtrace) {
+		cout << "Stack depth: " << (this->stackDepth > 0 ? to_string(this->stackDepth) : "unlimited") << endl;
+		for (const string& module : this->excludedModules) {
+			cout << "Excluded stack frames of: " << module << endl;
+		}
+	}
 	cout << "Authorizer module is " << (this->authorizer ? "active" : "NOT active") << endl;
 	if (this->authorizer) {
 		cout << string(*this->authorizer);
 		cout << "DOT Output: " << this->dotPath << endl;
+		cout << "GraphML Output: " << this->graphmlPath << endl;
+		cout << "JSON Output: " << this->jsonPath << endl;
+		cout << "Seccomp filter: " << (this->seccompFilter.empty() ? "NOT installed" : "installed") << endl;
 	}
 	if (this->tracee_argv != nullptr) {
 		cout << "Executable to trace: " << this->tracee_argv[0] << endl;
@@ -129,20 +307,27 @@ void Launcher::start() {
 			cout << "[" << i << "] -> " << this->tracee_argv[i] << endl;
 			i++;
 		}
-		TracingManager::init(make_shared<Tracer>(const_cast<char*> (this->tracee_argv[0]),
-																						 const_cast<char const* const*> (this->tracee_argv),
-		                                         this->follow_children,
-																						 this->follow_threads,
-																						 this->tracee_jail,
-																						 this->backtrace));
+		shared_ptr<Tracer> tracer = make_shared<Tracer>(const_cast<char*> (this->tracee_argv[0]),
+		                                                const_cast<char const* const*> (this->tracee_argv),
+		                                                this->follow_children,
+		                                                this->follow_threads,
+		                                                this->tracee_jail,
+		                                                this->backtrace);
+		if (!this->seccompFilter.empty()) {
+			tracer->setSeccompFilter(this->seccompFilter);
+		}
+		tracer->setStackLimits(this->stackDepth, this->excludedModules);
+		TracingManager::init(tracer);
 	} else {
 		cout << "PID to trace: " << this->traced_pid << endl;
-		TracingManager::init(make_shared<Tracer>(this->tracee_name,
-																			       this->traced_pid,
-																						 this->follow_children,
-																						 this->follow_threads,
-																						 this->tracee_jail,
-																						 this->backtrace));
+		shared_ptr<Tracer> tracer = make_shared<Tracer>(this->tracee_name,
+		                                                this->traced_pid,
+		                                                this->follow_children,
+		                                                this->follow_threads,
+		                                                this->tracee_jail,
+		                                                this->backtrace);
+		tracer->setStackLimits(this->stackDepth, this->excludedModules);
+		TracingManager::init(tracer);
 	}
 	signal(SIGINT, terminationHandler);
 	TracingManager::start();
@@ -152,7 +337,16 @@ void Launcher::start() {
 void Launcher::processSyscalls() const {
 	shared_ptr<ProcessNotification> notification;
 	map<pid_t, unsigned long long> timestamps;
-	while ((notification = TracingManager::nextNotification()) != nullptr) {
+	while (true) {
+		if (terminationRequested) {
+			Launcher::terminate();
+		}
+		if (!TracingManager::nextNotification(notification, Launcher::TERMINATION_POLL_MS)) {
+			continue;
+		}
+		if (notification == nullptr) {
+			break;
+		}
 		// TODO: There should be no need to cast down
 		// TODO: Find a better way to register syscalls to the Authorizer module as well as the Decoders
 		shared_ptr<ProcessSyscallEntry> syscall = dynamic_pointer_cast<ProcessSyscallEntry>(notification);
@@ -184,8 +378,25 @@ void Launcher::processSyscalls() const {
 	if (this->authorizer) {
 		this->authorizer->terminate();
 		if (!this->dotPath.empty()) {
-			this->authorizer->dotOutput(this->dotPath);
+			this->authorizer->exportAutomaton(this->dotPath, AutomatonExporter::DOT);
+		}
+		if (!this->graphmlPath.empty()) {
+			this->authorizer->exportAutomaton(this->graphmlPath, AutomatonExporter::GRAPHML);
+		}
+		if (!this->jsonPath.empty()) {
+			this->authorizer->exportAutomaton(this->jsonPath, AutomatonExporter::JSON);
 		}
 	}
 	SyscallDecoderMapper::printReport();
 }
+
+/**
+ * Handles a termination signal outside the signal handler, which only sets a flag: the running checkpoint, if any, is
+ * written so that whatever has been learned so far can be resumed with the --resume option.
+ */
+void Launcher::terminate() {
+	cout << "Termination signal received" << endl;
+	Checkpointer::flushActive(5000);
+	SyscallDecoderMapper::printReport();
+	exit(1);
+}
@@ -18,23 +18,54 @@ private:
 	static const std::string FOLLOW_CHILDREN_OPT;
 	static const std::string JAIL_OPT;
 	static const std::string DECODERS_OPT;
+	static const std::string PAYLOAD_ARCHIVE_OPT;
+	static const std::string CAPTURE_SYSCALL_BYTES_OPT;
+	static const std::string CAPTURE_FD_BYTES_OPT;
+	static const std::string CAPTURE_PROCESS_BYTES_OPT;
+	static const std::string CAPTURE_WINDOW_OPT;
+	static const std::string CAPTURE_INCLUDE_OPT;
+	static const std::string CAPTURE_EXCLUDE_OPT;
+	static const std::string CAPTURE_METADATA_OPT;
 	static const std::string BACKTRACE_OPT;
+	static const std::string STACK_DEPTH_OPT;
+	static const std::string STACK_EXCLUDE_OPT;
 	static const std::string AUTHORIZER_OPT;
 	static const std::string LEARN_OPT;
+	static const std::string DETERMINIZE_OPT;
+	static const std::string SECCOMP_OPT;
+	static const std::string VIOLATION_POLICY_OPT;
+	static const std::string AUTHORIZER_THREADS_OPT;
+	static const std::string CHECKPOINT_INTERVAL_OPT;
+	static const std::string CHECKPOINT_TRANSITIONS_OPT;
+	static const std::string RESUME_OPT;
+	static const std::string MODEL_OPT;
+	static const std::string NGRAM_SIZE_OPT;
+	static const std::string MODEL_PATH_OPT;
 	static const std::string NFA_PATH_OPT;
+	static const std::string POLICY_PATH_OPT;
+	static const std::string MODEL_DIR_OPT;
 	static const std::string DOT_PATH_OPT;
+	static const std::string GRAPHML_PATH_OPT;
+	static const std::string JSON_PATH_OPT;
 	static const std::string ASSOCIATIONS_PATH_OPT;
 	static const std::string TRACEE_NAME;
+	static const unsigned int TERMINATION_POLL_MS;
 	pid_t traced_pid = -1;
 	char** tracee_argv = nullptr;
 	bool follow_threads;
 	bool follow_children;
 	bool tracee_jail;
 	bool backtrace;
+	unsigned int stackDepth = 0;
+	std::vector<std::string> excludedModules;
 	std::unique_ptr<Authorizer> authorizer;
 	std::string dotPath;
+	std::string graphmlPath;
+	std::string jsonPath;
+	std::vector<sock_filter> seccompFilter;
 	std::string tracee_name;
 	void processSyscalls() const;
+	[[noreturn]] static void terminate();
 };
 
 
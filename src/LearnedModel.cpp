@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include "Authorizer.h"
+#include "LearnedModel.h"
+
+using namespace std;
+
+boost::mutex LearnedModel::amoreMutex;
+
+/**
+ * Creates an empty model, only the initial state 0 that does not correspond to any Syscall.
+ */
+LearnedModel::LearnedModel() : initials({ 0 }) {
+	stringstream empty;
+	this->associations = make_unique<Mapper>("", empty);
+}
+
+/**
+ * Loads a model saved by the Authorizer.
+ *
+ * @param graphPath        The NFA path.
+ * @param associationsPath The associations path.
+ * @return The loaded model, nullptr if one of the files does not exist or cannot be imported.
+ */
+unique_ptr<LearnedModel> LearnedModel::load(const string& graphPath, const string& associationsPath) {
+	unique_ptr<LearnedModel> model = make_unique<LearnedModel>();
+	ifstream associationsFile(associationsPath);
+	if (!associationsFile.good()) {
+		cerr << "Associations file " << associationsPath << " not found" << endl;
+		return nullptr;
+	}
+	{
+		boost::mutex::scoped_lock lock(LearnedModel::amoreMutex);
+		map<int, map<int, set<int>>> preTransitions;
+		unique_ptr<amore::nondeterministic_finite_automaton> automaton = Authorizer::readAutomaton(graphPath);
+		if (automaton == nullptr) {
+			return nullptr;
+		}
+		if (!CompactAutomaton::fromAmore(*automaton).hasLabelledStates()) {
+			cerr << "The automaton " << graphPath << " has been optimised, only learned automata can be merged" << endl;
+			return nullptr;
+		}
+		automaton->get_transition_maps(preTransitions, model->transitions);
+		model->initials = automaton->get_initial_states();
+		model->finals = automaton->get_final_states();
+	}
+	model->associations = make_unique<Mapper>(associationsPath, associationsFile);
+	return model;
+}
+
+/**
+ * Adds every transition, initial and final state of another model to this one.
+ * The states of a learned automaton are its association numbers, which are local to the learning run that assigned
+ * them, hence the states of that are renumbered looking for the same system call of the same executable in this model.
+ * The initial states of that are mapped on the initial state of this model.
+ *
+ * @param that The model that will be merged in this one, it is not changed.
+ * @return True if the models have been merged, False if that is not a learned automaton and this has not been changed.
+ */
+bool LearnedModel::merge(const LearnedModel& that) {
+	unordered_map<int, int> remap;
+	set<int> known(that.initials.begin(), that.initials.end());
+	auto check = [&known](int state) {
+		if (known.find(state) == known.end()) {
+			cerr << "The state " << state << " has no association, only learned automata can be merged" << endl;
+			return false;
+		}
+		return true;
+	};
+	for (const auto& executableIt : that.associations->getAssociations()) {
+		for (const auto& i : executableIt.second.left) {
+			known.insert((int) i.first);
+		}
+	}
+	for (const auto& origin : that.transitions) {
+		if (!check(origin.first)) {
+			return false;
+		}
+		for (const auto& label : origin.second) {
+			if (!check(label.first) || !all_of(label.second.begin(), label.second.end(), check)) {
+				return false;
+			}
+		}
+	}
+	if (!all_of(that.finals.begin(), that.finals.end(), check)) {
+		return false;
+	}
+	// The stack traces of the two models must have been cut in the same way, or their associations would never match
+	if (this->associations->getSize() == 0) {
+		this->associations->setStackLimits(that.associations->getStackLimits());
+	} else if (this->associations->getStackLimits() != that.associations->getStackLimits()) {
+		cerr << "A model has been learned with " << (string) that.associations->getStackLimits() << " while the others with "
+		     << (string) this->associations->getStackLimits() << ", they cannot be merged" << endl;
+		return false;
+	}
+	for (int state : that.initials) {
+		remap[state] = *this->initials.begin();
+	}
+	for (const auto& executableIt : that.associations->getAssociations()) {
+		for (const auto& i : executableIt.second.left) {
+			remap[(int) i.first] = (int) this->associations->insert(executableIt.first, i.second);
+		}
+	}
+	for (const auto& origin : that.transitions) {
+		map<int, set<int>>& row = this->transitions[remap[origin.first]];
+		for (const auto& label : origin.second) {
+			set<int>& destinations = row[remap[label.first]];
+			for (int destination : label.second) {
+				destinations.insert(remap[destination]);
+			}
+		}
+	}
+	for (int state : that.finals) {
+		this->finals.insert(remap[state]);
+	}
+	return true;
+}
+
+/**
+ * Saves the model in the Authorizer format.
+ *
+ * @param graphPath        Where the NFA will be written.
+ * @param associationsPath Where the associations will be written.
+ * @return True if both files have been written, False otherwise.
+ */
+bool LearnedModel::save(const string& graphPath, const string& associationsPath) const {
+	unique_ptr<amore::nondeterministic_finite_automaton> automaton = this->toAutomaton();
+	if (automaton == nullptr) {
+		cerr << "Impossible to build the automaton of the model" << endl;
+		return false;
+	}
+	boost::mutex::scoped_lock lock(LearnedModel::amoreMutex);
+	return this->associations->saveAs(associationsPath) && Authorizer::writeAutomaton(*automaton, graphPath);
+}
+
+/**
+ * Builds the libAMoRE automaton of the model, as Authorizer::buildAutomata does.
+ *
+ * @return The NFA, nullptr if its construction failed.
+ */
+unique_ptr<amore::nondeterministic_finite_automaton> LearnedModel::toAutomaton() const {
+	boost::mutex::scoped_lock lock(LearnedModel::amoreMutex);
+	set<int> initialStates = this->initials, finalStates = this->finals;
+	map<int, map<int, set<int>>> transitionMaps = this->transitions;
+	unique_ptr<amore::nondeterministic_finite_automaton> automaton = make_unique<amore::nondeterministic_finite_automaton>();
+	if (!automaton->construct(false,
+	                          (int) this->associations->getSize() + 1,
+	                          (int) this->associations->getSize() + 1,
+	                          initialStates,
+	                          finalStates,
+	                          transitionMaps)) {
+		return nullptr;
+	}
+	return automaton;
+}
+
+const Mapper& LearnedModel::getAssociations() const {
+	return *this->associations;
+}
+
+unsigned long LearnedModel::getTransitionCount() const {
+	unsigned long count = 0;
+	for (const auto& origin : this->transitions) {
+		for (const auto& label : origin.second) {
+			count += label.second.size();
+		}
+	}
+	return count;
+}
@@ -0,0 +1,32 @@
+#ifndef PTRACER_LEARNEDMODEL_H
+#define PTRACER_LEARNEDMODEL_H
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <amore++/nondeterministic_finite_automaton.h>
+#include <boost/thread/mutex.hpp>
+#include "Mapper.h"
+
+// An NFA learned by the Authorizer together with its associations, detached from any tracing session
+class LearnedModel {
+public:
+	LearnedModel();
+	static std::unique_ptr<LearnedModel> load(const std::string& graphPath, const std::string& associationsPath);
+	bool merge(const LearnedModel& that);
+	bool save(const std::string& graphPath, const std::string& associationsPath) const;
+	[[nodiscard]] std::unique_ptr<amore::nondeterministic_finite_automaton> toAutomaton() const;
+	[[nodiscard]] const Mapper& getAssociations() const;
+	[[nodiscard]] unsigned long getTransitionCount() const;
+
+private:
+	// libAMoRE is not known to be thread safe, every call to it is serialised
+	static boost::mutex amoreMutex;
+	// Transitions in the form < origin, < transition_label, { destination_nodes } > >
+	std::map<int, std::map<int, std::set<int>>> transitions;
+	std::set<int> initials;
+	std::set<int> finals;
+	std::unique_ptr<Mapper> associations;
+};
+
+#endif //PTRACER_LEARNEDMODEL_H
@@ -5,6 +5,7 @@
  * Created on 18 November 2016, 10:53
  */
 
+#include <cstring>
 #include <iostream>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -34,9 +35,10 @@ Mapper::Mapper(const string& storeFile) : storeFile(storeFile) {
   try {
     this->storeIn.open(this->storeFile, ios::in);
     if (this->storeIn.good()) {
-      if (!this->import()) {
+      if (!this->import(this->storeIn)) {
         cout << "Error occurred while trying to import previously stored associations, start from scratch" << endl;
         this->associations.clear();
+        this->stackLimits = StackLimits();
       }
     } else {
       cout << "Previously stored associations not found in " << this->storeFile << endl;
@@ -49,6 +51,21 @@ Mapper::Mapper(const string& storeFile) : storeFile(storeFile) {
   }
 }
 
+/**
+ * Construct a Mapper importing the associations from a stream instead of its store file, which is only
+ * used when the associations are saved.
+ *
+ * @param storeFile The file path where the Mapper serialised version will be stored.
+ * @param source    A stream containing associations in the store file format.
+ */
+Mapper::Mapper(const string& storeFile, istream& source) : storeFile(storeFile) {
+  if (!this->import(source)) {
+    cout << "Error occurred while trying to import the given associations, start from scratch" << endl;
+    this->associations.clear();
+    this->stackLimits = StackLimits();
+  }
+}
+
 /**
  * Make sure that at the object destruction the store file is safe.
  */
@@ -63,15 +80,23 @@ Mapper::~Mapper() {
  * It assumes the file line format: "(association_number)(Mapper::FIELD_SEPARATOR)(serialized ProcessState)".
  * Called by the constructor in order to import an initial set of associations.
  * 
+ * @param source The stream the associations are read from.
  * @return True if there were no I/O errors nor format problems.
  */
-bool Mapper::import() {
+bool Mapper::import(istream& source) {
   string cur_line;
   string executableName;
   int associationId;
   vector<string> tokens;
-  assert(this->storeIn.is_open());
-  while (getline(this->storeIn, cur_line)) {
+  while (getline(source, cur_line)) {
+    // The stack limits, if any, precede every section
+    if (cur_line.compare(0, StackLimits::HEADER.size(), StackLimits::HEADER) == 0 && this->associations.empty()) {
+      if (!StackLimits::parse(cur_line.substr(StackLimits::HEADER.size()), this->stackLimits)) {
+        cerr << "Malformed stack limits: " << cur_line << endl;
+        return false;
+      }
+      continue;
+    }
 	  // Expects a section start
     if (cur_line.find(Mapper::SECTION_START) >= cur_line.size()) {
       cerr << "Cannot find a section begin" << endl;
@@ -81,7 +106,7 @@ bool Mapper::import() {
     assert(!executableName.empty());
     assert(executableName.find(Mapper::SECTION_START) >= executableName.size());
     cout << "Importing associations for executable: " << executableName << endl;
-    while (getline(this->storeIn, cur_line) && cur_line.find(Mapper::SECTION_END.c_str(), 0, Mapper::SECTION_END.size()) >= cur_line.size()) {
+    while (getline(source, cur_line) && cur_line.find(Mapper::SECTION_END.c_str(), 0, Mapper::SECTION_END.size()) >= cur_line.size()) {
       tokens.clear();
       boost::split(tokens, cur_line, boost::is_any_of(Mapper::FIELD_SEPARATOR));
       if (tokens.size() != 2) {
@@ -116,39 +141,69 @@ bool Mapper::import() {
 }
 
 /**
- * It saves all the stored associations in Mapper::store_out.
+ * It saves all the stored associations in Mapper::storeFile.
  * Every association will be stored in the format: "(association_number)(Mapper::FIELD_SEPARATOR)(serialized ProcessState)".
  * 
  * @return True if there were no I/O errors nor format problems.
  */
 bool Mapper::save() {
-  if (!this->storeOut.is_open()) {
-    try {
-      this->storeOut.open(this->storeFile, ios::out);
-    } catch (ios_base::failure& e) {
-      cerr << "Error while trying to open " << this->storeFile << " in write mode: " << e.what() << endl;
-      errno = 0;
-      return false;
-    }
-  }
   cout << "Saving associations in " << this->storeFile << endl;
-  for (auto& executableIt : this->associations) {
-    cout << "Saving associations for the executable " << executableIt.first << "..." << endl;
-    this->storeOut << Mapper::SECTION_START << executableIt.first << endl;
-    for (auto& i : this->associations[executableIt.first].left) {
-      this->storeOut << i.first << Mapper::FIELD_SEPARATOR << i.second.serialize();
-    }
-    this->storeOut << Mapper::SECTION_END << endl;
-    this->storeOut.flush();
-    cout << "For the executable " << executableIt.first << " " << this->associations[executableIt.first].size() << " associations has been saved" << endl;
+  if (!this->saveAs(this->storeFile)) {
+    return false;
+  }
+  for (const auto& executableIt : this->associations) {
+    cout << "For the executable " << executableIt.first << " " << executableIt.second.size() << " associations has been saved" << endl;
   }
-  if (!this->storeOut.good()) {
-    cerr << "Error occurred while writing associations in " << this->storeFile << endl;
+  return true;
+}
+
+/**
+ * It saves all the stored associations in a file other than Mapper::storeFile, the file is overwritten.
+ * The associations are written in a temporary file that is then renamed, so that filePath is always complete.
+ *
+ * @param filePath The file where the associations will be written.
+ * @return True if there were no I/O errors.
+ */
+bool Mapper::saveAs(const string& filePath) const {
+  string temporaryPath = filePath + ".tmp";
+  ofstream out(temporaryPath, ios::out | ios::trunc);
+  if (!out.is_open()) {
+    cerr << "Error while trying to open " << temporaryPath << " in write mode" << endl;
+    return false;
+  }
+  this->write(out);
+  out.close();
+  if (out.fail()) {
+    cerr << "Error occurred while writing associations in " << temporaryPath << endl;
+    return false;
+  }
+  if (rename(temporaryPath.c_str(), filePath.c_str()) < 0) {
+    cerr << "Error while trying to move " << temporaryPath << " to " << filePath << ": " << strerror(errno) << endl;
+    errno = 0;
     return false;
   }
   return true;
 }
 
+/**
+ * Writes all the stored associations in the store file format, grouped by executable and sorted by association number,
+ * after the stack limits they have been learned with, unless the whole stack traces have been used.
+ *
+ * @param out The stream where the associations will be written.
+ */
+void Mapper::write(ostream& out) const {
+  if (!this->stackLimits.isUnlimited()) {
+    out << StackLimits::HEADER << this->stackLimits.serialize() << endl;
+  }
+  for (const auto& executableIt : this->associations) {
+    out << Mapper::SECTION_START << executableIt.first << endl;
+    for (const auto& i : executableIt.second.left) {
+      out << i.first << Mapper::FIELD_SEPARATOR << i.second.serialize();
+    }
+    out << Mapper::SECTION_END << endl;
+  }
+}
+
 /**
  * Insert a new ProcessSyscallDTO in the associations map.
  * If that state is already present no action will be performed.
@@ -157,12 +212,34 @@ bool Mapper::save() {
  * @return The association number related to the provided state or a negative number if fails.
  */
 unsigned int Mapper::insert(const shared_ptr<ProcessSyscallEntry>& state) {
+  return this->insert(state->getExecutableName(), ProcessSyscallEntryDTO(*state));
+}
+
+/**
+ * Insert a new ProcessSyscallDTO in the associations map, if it is already present no action will be performed.
+ *
+ * @param executableName The executable name which the association refers to.
+ * @param state          The system call that will be added to the associations map.
+ * @return The association number related to the provided state.
+ */
+unsigned int Mapper::insert(const string& executableName, const ProcessSyscallEntryDTO& state) {
   unsigned int nextId = this->getSize() + 1;
-	ProcessSyscallEntryDTO stateDTO(*state);
-	auto it = this->associations[state->getExecutableName()].right.insert(AssociationType::right_value_type(stateDTO, nextId));
+	auto it = this->associations[executableName].right.insert(AssociationType::right_value_type(state, nextId));
   return it.first->get_left();
 }
 
+/**
+ * Insert an association with a given number, used to copy associations between Mappers.
+ *
+ * @param executableName The executable name which the association refers to.
+ * @param associationId  The association number.
+ * @param state          The system call associated with associationId.
+ * @return True if the association has been inserted, False if the number or the system call are already present.
+ */
+bool Mapper::insert(const string& executableName, unsigned int associationId, const ProcessSyscallEntryDTO& state) {
+  return this->associations[executableName].insert(AssociationType::value_type(associationId, state)).second;
+}
+
 /**
  * It looks for a ProcessState in the association map and returns its key.
  * 
@@ -180,6 +257,23 @@ unsigned int Mapper::find(const shared_ptr<ProcessSyscallEntry>& state) const {
   return result != it->second.right.end() ? (int) result->second : Mapper::NOT_FOUND;
 }
 
+/**
+ * It looks for a system call of an executable in the association map and returns its key.
+ *
+ * @param executableName The executable name which the system call refers to.
+ * @param state          The system call that will be searched.
+ * @return Returns: The association number (or map key) of the specified system call.
+ *                  Mapper::NOT_FOUND If the given system call has not been found.
+ */
+unsigned int Mapper::find(const string& executableName, const ProcessSyscallEntryDTO& state) const {
+	auto it = this->associations.find(executableName);
+  if (it == this->associations.end()) {
+    return Mapper::NOT_FOUND;
+  }
+  AssociationType::right_map::const_iterator result = it->second.right.find(state);
+  return result != it->second.right.end() ? (int) result->second : Mapper::NOT_FOUND;
+}
+
 /**
  * It looks for an association number and return its associated ProcessSyscallEntry.
  * 
@@ -209,6 +303,41 @@ unsigned int Mapper::getSize() const {
   return total_size;
 }
 
+/**
+ * Groups the association numbers of every executable by their system call number.
+ *
+ * @return A map in the form < syscall_number, { association_numbers } >.
+ */
+map<int, set<int>> Mapper::getSyscallLabels() const {
+  map<int, set<int>> result;
+  for (const auto& executableIt : this->associations) {
+    for (const auto& i : executableIt.second.left) {
+      result[i.second.getSyscall()].insert((int) i.first);
+    }
+  }
+  return result;
+}
+
+/**
+ * Gives access to every association, grouped by executable name.
+ *
+ * @return A map in the form < executable_name, { association_number <-> ProcessSyscallEntryDTO } >.
+ */
+const map<string, AssociationType>& Mapper::getAssociations() const {
+  return this->associations;
+}
+
+const StackLimits& Mapper::getStackLimits() const {
+  return this->stackLimits;
+}
+
+/**
+ * @param limits The limits of the stack traces of the associations, they are saved with them.
+ */
+void Mapper::setStackLimits(const StackLimits& limits) {
+  this->stackLimits = limits;
+}
+
 std::string Mapper::getAssociationsFile() const {
 	return this->storeFile;
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <boost/bimap.hpp>
 #include <fstream>
 #include "dto/ProcessSyscallEntryDto.h"
+#include "StackLimits.h"
 #include "Tracer.h"
 
 //TODO: Is a bimap really necessary? When is it necessary to retrieve the id given a ProcessSyscallEntry?
@@ -22,22 +23,34 @@ public:
   static const std::string SECTION_END;
   static const int NOT_FOUND;
   Mapper(const std::string& storeFile);
+  Mapper(const std::string& storeFile, std::istream& source);
   ~Mapper();
   unsigned int insert(const std::shared_ptr<ProcessSyscallEntry>& state);
+  unsigned int insert(const std::string& executableName, const ProcessSyscallEntryDTO& state);
+  bool insert(const std::string& executableName, unsigned int associationId, const ProcessSyscallEntryDTO& state);
   unsigned int find(const std::shared_ptr<ProcessSyscallEntry>& state) const;
+  unsigned int find(const std::string& executableName, const ProcessSyscallEntryDTO& state) const;
   std::shared_ptr<ProcessSyscallEntryDTO> find(const std::string& executableName, int associationId) const;
   bool save();
+  bool saveAs(const std::string& filePath) const;
+  void write(std::ostream& out) const;
   unsigned int getSize() const;
+  std::map<int, std::set<int>> getSyscallLabels() const;
+  const std::map<std::string, AssociationType>& getAssociations() const;
+  const StackLimits& getStackLimits() const;
+  void setStackLimits(const StackLimits& limits);
 	std::string getAssociationsFile() const;
   
 protected:
-  bool import();
+  bool import(std::istream& source);
   
 private:
   const std::string storeFile;
   std::ifstream storeIn;
   std::ofstream storeOut;
   std::map<std::string, AssociationType> associations;
+  // Limits of the stack traces of the associations, saved only when they are not the default ones
+  StackLimits stackLimits;
 };
 
 #endif /* PTRACER_MAPPER_H */
\ No newline at end of file
@@ -0,0 +1,311 @@
+/*
+ * A ModelStore lets the Authorizer enforce the policies of many executables without loading all of them: every line
+ * of the index file names the compiled policy of an executable, together with its ELF build-id if it was available
+ * when the policy has been written. The policy of an executable is looked up by build-id first, so that it is found
+ * whatever path the binary is executed from, and then by path.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "ModelStore.h"
+
+using namespace std;
+
+// Name of the index file in the model directory
+const string ModelStore::INDEX_FILE = "index";
+
+/**
+ * Collects the file ranges of the PT_NOTE segments of an ELF file.
+ *
+ * @param file  The ELF file, its identification has already been checked.
+ * @param notes Where the < offset, < size, alignment > > of every note segment will be added.
+ * @return True if the program headers have been read, False otherwise.
+ */
+template <typename Ehdr, typename Phdr>
+static bool readNoteSegments(ifstream& file, vector<pair<uint64_t, pair<uint64_t, uint64_t>>>& notes) {
+	Ehdr header = {};
+	file.seekg(0);
+	if (!file.read((char*) &header, sizeof(header)) || header.e_phentsize < sizeof(Phdr)) {
+		return false;
+	}
+	for (unsigned int i = 0; i < header.e_phnum; i++) {
+		Phdr segment = {};
+		file.seekg((streamoff) (header.e_phoff + (uint64_t) i * header.e_phentsize));
+		if (!file.read((char*) &segment, sizeof(segment))) {
+			return false;
+		}
+		if (segment.p_type == PT_NOTE) {
+			notes.push_back({ segment.p_offset, { segment.p_filesz, segment.p_align } });
+		}
+	}
+	return true;
+}
+
+/**
+ * @param directory   The directory written by the split-policy command.
+ * @param determinize If True every policy is determinised when it is loaded, unless it would have too many states.
+ */
+ModelStore::ModelStore(const string& directory, bool determinize) : directory(directory), determinize(determinize) {
+}
+
+/**
+ * Reads the index of the model directory, no policy is loaded until it is needed.
+ *
+ * @return True if the index has been read, False if it does not exist or it is malformed.
+ */
+bool ModelStore::load() {
+	ifstream index(this->directory + "/" + ModelStore::INDEX_FILE);
+	string line;
+	if (!index.good()) {
+		cerr << "The model directory " << this->directory << " has no " << ModelStore::INDEX_FILE << " file" << endl;
+		return false;
+	}
+	while (getline(index, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		size_t first = line.find('\t');
+		size_t second = first != string::npos ? line.find('\t', first + 1) : string::npos;
+		// The stack limits column is written only when the stack traces have been limited
+		size_t third = second != string::npos ? line.find('\t', second + 1) : string::npos;
+		IndexEntry entry;
+		if (second == string::npos ||
+		    (third != string::npos && !StackLimits::parse(line.substr(third + 1), entry.stackLimits))) {
+			cerr << "Malformed line in the index of " << this->directory << ": " << line << endl;
+			return false;
+		}
+		entry.buildId = line.substr(0, first);
+		entry.file = line.substr(first + 1, second - first - 1);
+		entry.executableName = line.substr(second + 1, third == string::npos ? string::npos : third - second - 1);
+		if (entry.buildId == "-") {
+			entry.buildId.clear();
+		}
+		this->byExecutable[entry.executableName] = this->entries.size();
+		if (!entry.buildId.empty()) {
+			this->byBuildId[entry.buildId] = this->entries.size();
+		}
+		this->entries.push_back(std::move(entry));
+	}
+	cout << "Model directory " << this->directory << " with " << this->entries.size() << " policies indexed" << endl;
+	return true;
+}
+
+/**
+ * Checks that every policy of the index has been learned with the same stack limits the Tracer collects the stack
+ * traces with, otherwise their associations would never match. The bundles are checked again when they are loaded.
+ *
+ * @param tracerLimits The limits of the stack traces of the Tracer.
+ * @return True if every policy has been learned with tracerLimits, False otherwise.
+ */
+bool ModelStore::checkStackLimits(const StackLimits& tracerLimits) {
+	boost::mutex::scoped_lock lock(this->storeMutex);
+	this->expectedLimits = tracerLimits;
+	bool result = true;
+	for (const IndexEntry& entry : this->entries) {
+		if (entry.stackLimits != tracerLimits) {
+			cerr << "The policy of " << entry.executableName << " has been learned with " << (string) entry.stackLimits
+			     << " while the stack traces are collected with " << (string) tracerLimits << endl;
+			result = false;
+		}
+	}
+	return result;
+}
+
+/**
+ * Gets the policy of an executable, it is loaded if no traced thread is using it and it is unloaded as soon as the
+ * returned pointer and every other copy of it are released.
+ *
+ * @param executableName The executable run by the traced thread.
+ * @param pid            The PID of the traced thread, its executable is used to read the build-id.
+ * @return The policy of executableName, nullptr if it has none or it cannot be loaded.
+ */
+shared_ptr<const ModelStore::Model> ModelStore::acquire(const string& executableName, pid_t pid) {
+	boost::mutex::scoped_lock lock(this->storeMutex);
+	if (this->missing.find(executableName) != this->missing.end()) {
+		return nullptr;
+	}
+	long index = this->findEntry(executableName, pid);
+	if (index < 0) {
+		cout << "No policy has been learned for " << executableName << " in " << this->directory << endl;
+		this->missing.insert(executableName);
+		return nullptr;
+	}
+	shared_ptr<const Model> model = this->loaded[(unsigned long) index].lock();
+	if (model != nullptr) {
+		return model;
+	}
+	auto start = chrono::steady_clock::now();
+	const IndexEntry& entry = this->entries[(unsigned long) index];
+	unique_ptr<Model> created = make_unique<Model>();
+	if (!created->bundle.load(this->directory + "/" + entry.file)) {
+		this->missing.insert(executableName);
+		return nullptr;
+	}
+	if (created->bundle.getStackLimits() != this->expectedLimits) {
+		cerr << "The policy " << entry.file << " has been learned with " << (string) created->bundle.getStackLimits()
+		     << " while the stack traces are collected with " << (string) this->expectedLimits << endl;
+		this->missing.insert(executableName);
+		return nullptr;
+	}
+	created->executableName = entry.executableName;
+	created->automaton = created->bundle.getAutomaton();
+	if (this->determinize && !created->automaton.isDeterministic()) {
+		CompactAutomaton deterministic;
+		if (created->automaton.determinize(CompactAutomaton::DEFAULT_MAX_DFA_STATES, deterministic)) {
+			created->automaton = std::move(deterministic);
+		}
+	}
+	cout << "Policy of " << entry.executableName << " with " << created->bundle.getAssociationCount() << " associations loaded in "
+	     << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() << " us" << endl;
+	// The deleter may run on any thread releasing the last copy, it must not take ModelStore::storeMutex
+	model = shared_ptr<const Model>(created.release(), [this](Model* unused) {
+		cout << "Policy of " << unused->executableName << " unloaded, no traced thread runs it anymore" << endl;
+		this->evictions++;
+		delete unused;
+	});
+	this->loaded[(unsigned long) index] = model;
+	this->loads++;
+	unsigned long live = 0;
+	for (const auto& i : this->loaded) {
+		live += i.second.expired() ? 0 : 1;
+	}
+	this->peakLoaded = max(this->peakLoaded, live);
+	return model;
+}
+
+/**
+ * Looks for the index entry of an executable, by the build-id of the binary run by pid and then by path.
+ * It must be called holding ModelStore::storeMutex.
+ *
+ * @param executableName The executable run by the traced thread.
+ * @param pid            The PID of the traced thread.
+ * @return The position of the entry in ModelStore::entries, -1 if there is none.
+ */
+long ModelStore::findEntry(const string& executableName, pid_t pid) {
+	string buildId = ModelStore::readBuildId("/proc/" + to_string(pid) + "/exe");
+	if (buildId.empty()) {
+		buildId = ModelStore::readBuildId(executableName);
+	}
+	auto it = buildId.empty() ? this->byBuildId.end() : this->byBuildId.find(buildId);
+	if (it != this->byBuildId.end()) {
+		return (long) it->second;
+	}
+	it = this->byExecutable.find(executableName);
+	if (it == this->byExecutable.end()) {
+		return -1;
+	}
+	// The stack traces of another build would not match, every system call would probably be a violation
+	const IndexEntry& entry = this->entries[it->second];
+	if (!entry.buildId.empty() && !buildId.empty()) {
+		cerr << "The policy of " << executableName << " has been learned on the build " << entry.buildId
+		     << " while the traced one is " << buildId << endl;
+	}
+	return (long) it->second;
+}
+
+/**
+ * Writes the index of a model directory, it replaces the previous one.
+ *
+ * @param directory The model directory, it must exist.
+ * @param entries   The policy of every executable, the files are relative to directory.
+ * @return True if the index has been written, False otherwise.
+ */
+bool ModelStore::writeIndex(const string& directory, const vector<IndexEntry>& entries) {
+	string indexPath = directory + "/" + ModelStore::INDEX_FILE;
+	ofstream index(indexPath, ios::out | ios::trunc);
+	for (const IndexEntry& entry : entries) {
+		index << (entry.buildId.empty() ? "-" : entry.buildId) << '\t' << entry.file << '\t' << entry.executableName;
+		if (!entry.stackLimits.isUnlimited()) {
+			index << '\t' << entry.stackLimits.serialize();
+		}
+		index << endl;
+	}
+	index.flush();
+	if (!index.good()) {
+		cerr << "Error occurred while writing the index " << indexPath << endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Reads the GNU build-id note of an ELF file.
+ *
+ * @param path The ELF file.
+ * @return The build-id as a hexadecimal string, empty if the file cannot be read or it has no build-id.
+ */
+string ModelStore::readBuildId(const string& path) {
+	// Note segments are small, a larger one is not worth reading
+	static const uint64_t MAX_NOTES_SIZE = 1 << 16;
+	unsigned char identification[EI_NIDENT];
+	vector<pair<uint64_t, pair<uint64_t, uint64_t>>> notes;
+	ifstream file(path, ios::in | ios::binary);
+	if (!file.read((char*) identification, EI_NIDENT) || memcmp(identification, ELFMAG, SELFMAG) != 0) {
+		return "";
+	}
+	if (!(identification[EI_CLASS] == ELFCLASS64 ? readNoteSegments<Elf64_Ehdr, Elf64_Phdr>(file, notes)
+	                                            : identification[EI_CLASS] == ELFCLASS32 && readNoteSegments<Elf32_Ehdr, Elf32_Phdr>(file, notes))) {
+		return "";
+	}
+	for (const auto& segment : notes) {
+		uint64_t size = min(segment.second.first, MAX_NOTES_SIZE);
+		uint64_t alignment = segment.second.second == 8 ? 8 : 4;
+		vector<char> bytes(size);
+		file.seekg((streamoff) segment.first);
+		if (!file.read(bytes.data(), (streamsize) size)) {
+			file.clear();
+			continue;
+		}
+		// Elf32_Nhdr and Elf64_Nhdr have the same layout
+		for (uint64_t position = 0; position + sizeof(Elf64_Nhdr) <= size;) {
+			Elf64_Nhdr note;
+			memcpy(&note, bytes.data() + position, sizeof(note));
+			uint64_t name = position + sizeof(note);
+			uint64_t description = name + ((note.n_namesz + alignment - 1) & ~(alignment - 1));
+			uint64_t next = description + ((note.n_descsz + alignment - 1) & ~(alignment - 1));
+			if (description + note.n_descsz > size) {
+				break;
+			}
+			if (note.n_type == NT_GNU_BUILD_ID && note.n_namesz == 4 && memcmp(bytes.data() + name, "GNU", 4) == 0) {
+				stringstream result;
+				for (uint64_t i = description; i < description + note.n_descsz; i++) {
+					result << hex << setw(2) << setfill('0') << (unsigned int) (unsigned char) bytes[i];
+				}
+				return result.str();
+			}
+			position = next;
+		}
+	}
+	return "";
+}
+
+const string& ModelStore::getDirectory() const {
+	return this->directory;
+}
+
+unsigned long ModelStore::getModelCount() const {
+	return this->entries.size();
+}
+
+ModelStore::operator string() const {
+	stringstream result;
+	result << "Model directory " << this->directory << ": " << this->entries.size() << " policies, " << this->loads
+	       << " loads, " << this->evictions << " unloads, at most " << this->peakLoaded << " loaded at once" << endl;
+	return result.str();
+}
+
+/**
+ * Looks for the association number of a system call, as it was named when the policy has been learned: the same
+ * binary may be executed from another path.
+ *
+ * @param syscall The system call that will be searched.
+ * @return The association number of syscall, Mapper::NOT_FOUND if it has not been found.
+ */
+int ModelStore::Model::find(const shared_ptr<ProcessSyscallEntry>& syscall) const {
+	return this->bundle.find(this->executableName, ProcessSyscallEntryDTO(*syscall));
+}
@@ -0,0 +1,68 @@
+#ifndef PTRACER_MODELSTORE_H
+#define PTRACER_MODELSTORE_H
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include "CompactAutomaton.h"
+#include "PolicyBundle.h"
+
+// Directory of policies compiled for a single executable each, indexed by executable path and ELF build-id.
+// A policy is mapped when a traced thread starts running its executable and unmapped when no traced thread does anymore.
+class ModelStore {
+public:
+	static const std::string INDEX_FILE;
+	// A line of the index file
+	struct IndexEntry {
+		std::string buildId;
+		std::string file;
+		std::string executableName;
+		// The limits of the stack traces the policy has been learned with
+		StackLimits stackLimits;
+	};
+	// The policy of an executable, it is never changed once loaded
+	struct Model {
+		// The executable the policy has been learned for, as its associations name it
+		std::string executableName;
+		PolicyBundle bundle;
+		CompactAutomaton automaton;
+		[[nodiscard]] int find(const std::shared_ptr<ProcessSyscallEntry>& syscall) const;
+	};
+	ModelStore(const std::string& directory, bool determinize);
+	ModelStore(const ModelStore&) = delete;
+	ModelStore& operator=(const ModelStore&) = delete;
+	bool load();
+	bool checkStackLimits(const StackLimits& tracerLimits);
+	std::shared_ptr<const Model> acquire(const std::string& executableName, pid_t pid);
+	static bool writeIndex(const std::string& directory, const std::vector<IndexEntry>& entries);
+	static std::string readBuildId(const std::string& path);
+	[[nodiscard]] const std::string& getDirectory() const;
+	[[nodiscard]] unsigned long getModelCount() const;
+	operator std::string() const;
+
+private:
+	const std::string directory;
+	const bool determinize;
+	std::vector<IndexEntry> entries;
+	// Index of ModelStore::entries by executable path and by build-id
+	std::unordered_map<std::string, unsigned long> byExecutable;
+	std::unordered_map<std::string, unsigned long> byBuildId;
+	// Loaded policies by index entry, they expire as soon as the last traced thread running them releases them
+	std::unordered_map<unsigned long, std::weak_ptr<const Model>> loaded;
+	// Executables without a policy or whose policy cannot be loaded, so that they are reported only once
+	std::set<std::string> missing;
+	// The limits of the stack traces collected by the Tracer, every policy must have been learned with them
+	StackLimits expectedLimits;
+	// Guards every member above, the models are shared by the checks of every shard
+	boost::mutex storeMutex;
+	unsigned long loads = 0;
+	std::atomic<unsigned long> evictions { 0 };
+	unsigned long peakLoaded = 0;
+	long findEntry(const std::string& executableName, pid_t pid);
+};
+
+#endif //PTRACER_MODELSTORE_H
@@ -0,0 +1,269 @@
+/*
+ * An NGramModel authorises a system call if the window made of the last n association numbers of its thread, the
+ * current one included, has already been observed for the same executable. Every window is stored as a 64 bit
+ * fingerprint in an open addressing set, hence a check is a hash and a few probes, and two models learned with the
+ * same associations file are merged by simply uniting their sets.
+ */
+
+#include <assert.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include "NGramModel.h"
+
+using namespace std;
+
+// Identifies an n-gram model file
+const char NGramModel::MAGIC[8] = { 'P', 'T', 'R', 'N', 'G', 'R', 'A', 'M' };
+// Incremented every time the file layout changes
+const uint32_t NGramModel::VERSION = 1;
+// Longer windows rarely repeat, so the model would never stop learning
+const unsigned int NGramModel::MAX_SIZE = 16;
+
+/**
+ * @param size The number of association numbers of every window.
+ */
+NGramModel::NGramModel(unsigned int size) : size(size) {
+	assert(size >= 1 && size <= NGramModel::MAX_SIZE);
+}
+
+string NGramModel::getName() const {
+	return "ngram";
+}
+
+unsigned int NGramModel::getWindowSize() const {
+	return this->size;
+}
+
+/**
+ * Adds a window to the model.
+ *
+ * @param executableName The executable that produced the window.
+ * @param window         NGramModel::size association numbers.
+ * @return True if the window was not in the model, False otherwise.
+ */
+bool NGramModel::learn(const string& executableName, const LabelWindow& window) {
+	assert(window.size() == this->size);
+	return this->windows[executableName].insert(NGramModel::fingerprint(window));
+}
+
+/**
+ * Checks if a window has been learned.
+ *
+ * @param executableName The executable that produced the window.
+ * @param window         NGramModel::size association numbers.
+ * @return True if the window has been learned for executableName, False otherwise.
+ */
+bool NGramModel::accepts(const string& executableName, const LabelWindow& window) const {
+	assert(window.size() == this->size);
+	auto it = this->windows.find(executableName);
+	return it != this->windows.end() && it->second.contains(NGramModel::fingerprint(window));
+}
+
+/**
+ * Adds every window of another model to this one, the association numbers of both must come from the same
+ * associations file.
+ *
+ * @param that The model that will be merged in this one, it is not changed.
+ * @return True if the models have been merged, False if that is not an n-gram model of the same size.
+ */
+bool NGramModel::merge(const SequenceModel& that) {
+	auto other = dynamic_cast<const NGramModel*>(&that);
+	if (other == nullptr || other->size != this->size) {
+		cerr << "Only n-gram models of size " << this->size << " can be merged" << endl;
+		return false;
+	}
+	for (const auto& executableIt : other->windows) {
+		WindowSet& set = this->windows[executableIt.first];
+		for (uint64_t fingerprint : executableIt.second.getSlots()) {
+			if (fingerprint != 0) {
+				set.insert(fingerprint);
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Reads a model written by NGramModel::save, the windows already in this model are kept.
+ * Every length is checked against the bytes left in the file before anything is allocated for it.
+ *
+ * @param path The model file.
+ * @return True if the model has been read, False if the file cannot be read, it is corrupted or its n-gram size is
+ *         different.
+ */
+bool NGramModel::load(const string& path) {
+	ifstream file(path, ios::in | ios::binary);
+	char magic[sizeof(NGramModel::MAGIC)];
+	uint32_t version, size, executableCount;
+	if (!file.is_open()) {
+		cerr << "Impossible to open the n-gram model " << path << endl;
+		return false;
+	}
+	file.seekg(0, ios::end);
+	uint64_t fileSize = (uint64_t) file.tellg();
+	file.seekg(0);
+	auto remaining = [&file, fileSize]() -> uint64_t {
+		return file.good() ? fileSize - (uint64_t) file.tellg() : 0;
+	};
+	file.read(magic, sizeof(magic));
+	file.read((char*) &version, sizeof(version));
+	file.read((char*) &size, sizeof(size));
+	file.read((char*) &executableCount, sizeof(executableCount));
+	if (!file.good() || memcmp(magic, NGramModel::MAGIC, sizeof(magic)) != 0 || version != NGramModel::VERSION) {
+		cerr << path << " is not an n-gram model" << endl;
+		return false;
+	}
+	if (size != this->size) {
+		cerr << path << " has windows of " << size << " system calls while " << this->size << " are expected" << endl;
+		return false;
+	}
+	for (uint32_t i = 0; i < executableCount && file.good(); i++) {
+		uint32_t nameLength = 0;
+		uint64_t count = 0;
+		file.read((char*) &nameLength, sizeof(nameLength));
+		if (nameLength > remaining()) {
+			cerr << "The n-gram model " << path << " is corrupted, an executable name exceeds the file" << endl;
+			return false;
+		}
+		string executableName(nameLength, '\0');
+		file.read(executableName.data(), nameLength);
+		file.read((char*) &count, sizeof(count));
+		if (count > remaining() / sizeof(uint64_t)) {
+			cerr << "The n-gram model " << path << " is corrupted, the windows of " << executableName << " exceed the file" << endl;
+			return false;
+		}
+		vector<uint64_t> fingerprints(count);
+		file.read((char*) fingerprints.data(), (streamsize) (fingerprints.size() * sizeof(uint64_t)));
+		WindowSet& set = this->windows[executableName];
+		for (uint64_t fingerprint : fingerprints) {
+			if (fingerprint != 0) {
+				set.insert(fingerprint);
+			}
+		}
+	}
+	if (!file.good()) {
+		cerr << "The n-gram model " << path << " is truncated" << endl;
+		return false;
+	}
+	cout << "N-gram model with " << this->getSize() << " windows imported from " << path << endl;
+	return true;
+}
+
+/**
+ * Writes the model in a temporary file that is then renamed, so that path is always complete.
+ * Only the fingerprints are written, their sets are rebuilt when the model is loaded.
+ *
+ * @param path The output file, if it exists it will be overwritten.
+ * @return True if the model has been written, False otherwise.
+ */
+bool NGramModel::save(const string& path) const {
+	string temporaryPath = path + ".tmp";
+	ofstream file(temporaryPath, ios::out | ios::binary | ios::trunc);
+	uint32_t header[3] = { NGramModel::VERSION, this->size, (uint32_t) this->windows.size() };
+	if (!file.is_open()) {
+		cerr << "Impossible to open " << temporaryPath << " in write mode" << endl;
+		return false;
+	}
+	file.write(NGramModel::MAGIC, sizeof(NGramModel::MAGIC));
+	file.write((const char*) header, sizeof(header));
+	for (const auto& executableIt : this->windows) {
+		uint32_t nameLength = (uint32_t) executableIt.first.size();
+		uint64_t count = executableIt.second.size();
+		file.write((const char*) &nameLength, sizeof(nameLength));
+		file.write(executableIt.first.data(), nameLength);
+		file.write((const char*) &count, sizeof(count));
+		for (uint64_t fingerprint : executableIt.second.getSlots()) {
+			if (fingerprint != 0) {
+				file.write((const char*) &fingerprint, sizeof(fingerprint));
+			}
+		}
+	}
+	file.close();
+	if (file.fail()) {
+		cerr << "Error occurred while writing the n-gram model in " << temporaryPath << endl;
+		unlink(temporaryPath.c_str());
+		return false;
+	}
+	if (rename(temporaryPath.c_str(), path.c_str()) < 0) {
+		cerr << "Impossible to move " << temporaryPath << " to " << path << ": " << strerror(errno) << endl;
+		unlink(temporaryPath.c_str());
+		return false;
+	}
+	cout << "N-gram model with " << this->getSize() << " windows saved in " << path << endl;
+	return true;
+}
+
+unsigned long NGramModel::getSize() const {
+	unsigned long total = 0;
+	for (const auto& i : this->windows) {
+		total += i.second.size();
+	}
+	return total;
+}
+
+/**
+ * Hashes a window with the splitmix64 finaliser, 0 is reserved for the empty slots.
+ *
+ * @param window The association numbers.
+ * @return The fingerprint of window, never 0.
+ */
+uint64_t NGramModel::fingerprint(const LabelWindow& window) {
+	uint64_t hash = window.size();
+	for (int label : window) {
+		hash += (uint64_t) (uint32_t) label + 0x9e3779b97f4a7c15ULL;
+		hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+		hash ^= hash >> 31;
+	}
+	return hash != 0 ? hash : 1;
+}
+
+bool NGramModel::WindowSet::insert(uint64_t fingerprint) {
+	assert(fingerprint != 0);
+	if ((this->count + 1) * 2 > this->slots.size()) {
+		this->grow();
+	}
+	unsigned long mask = this->slots.size() - 1;
+	for (unsigned long position = fingerprint & mask; ; position = (position + 1) & mask) {
+		if (this->slots[position] == fingerprint) {
+			return false;
+		}
+		if (this->slots[position] == 0) {
+			this->slots[position] = fingerprint;
+			this->count++;
+			return true;
+		}
+	}
+}
+
+bool NGramModel::WindowSet::contains(uint64_t fingerprint) const {
+	unsigned long mask = this->slots.size() - 1;
+	for (unsigned long position = fingerprint & mask; this->slots[position] != 0; position = (position + 1) & mask) {
+		if (this->slots[position] == fingerprint) {
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned long NGramModel::WindowSet::size() const {
+	return this->count;
+}
+
+const vector<uint64_t>& NGramModel::WindowSet::getSlots() const {
+	return this->slots;
+}
+
+void NGramModel::WindowSet::grow() {
+	vector<uint64_t> previous(this->slots.size() * 2, 0);
+	swap(previous, this->slots);
+	this->count = 0;
+	for (uint64_t fingerprint : previous) {
+		if (fingerprint != 0) {
+			this->insert(fingerprint);
+		}
+	}
+}
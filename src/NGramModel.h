@@ -0,0 +1,43 @@
+#ifndef PTRACER_NGRAMMODEL_H
+#define PTRACER_NGRAMMODEL_H
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SequenceModel.h"
+
+// Set of the windows of n association numbers observed for every executable
+class NGramModel : public SequenceModel {
+public:
+	static const char MAGIC[8];
+	static const uint32_t VERSION;
+	static const unsigned int MAX_SIZE;
+	explicit NGramModel(unsigned int size);
+	[[nodiscard]] std::string getName() const override;
+	[[nodiscard]] unsigned int getWindowSize() const override;
+	bool learn(const std::string& executableName, const LabelWindow& window) override;
+	[[nodiscard]] bool accepts(const std::string& executableName, const LabelWindow& window) const override;
+	bool merge(const SequenceModel& that) override;
+	bool load(const std::string& path) override;
+	[[nodiscard]] bool save(const std::string& path) const override;
+	[[nodiscard]] unsigned long getSize() const override;
+
+private:
+	// Open addressing set of 64 bit window fingerprints, at most half full, 0 marks an empty slot
+	class WindowSet {
+	public:
+		bool insert(uint64_t fingerprint);
+		[[nodiscard]] bool contains(uint64_t fingerprint) const;
+		[[nodiscard]] unsigned long size() const;
+		[[nodiscard]] const std::vector<uint64_t>& getSlots() const;
+	private:
+		std::vector<uint64_t> slots = std::vector<uint64_t>(16, 0);
+		unsigned long count = 0;
+		void grow();
+	};
+	const unsigned int size;
+	std::unordered_map<std::string, WindowSet> windows;
+	static uint64_t fingerprint(const LabelWindow& window);
+};
+
+#endif //PTRACER_NGRAMMODEL_H
@@ -0,0 +1,511 @@
+/*
+ * A PolicyBundle is the compiled form of an NFA together with its associations file: the automaton CSR tables,
+ * an open addressing hash table of the associations and the syscall names are laid out in a single file that
+ * is mapped in memory and used as it is, hence loading it does not parse anything.
+ * When the automaton has been learned without backtraces its SyscallMatrix is compiled in the bundle as well, otherwise
+ * the StackLimits of the associations are recorded so that they can be checked against the ones of the Tracer.
+ * Every table is aligned to 8 bytes and stored in the byte order of the machine that compiled it.
+ */
+
+#include <algorithm>
+#include <assert.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "PolicyBundle.h"
+#include "SyscallNameResolver.h"
+
+using namespace std;
+
+struct PolicyBundle::Range {
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct PolicyBundle::Entry {
+	// Hash of executable name, Mapper::FIELD_SEPARATOR and serialised ProcessSyscallEntryDTO
+	uint64_t hash;
+	uint32_t executable;
+	uint32_t label;
+	int32_t syscall;
+	// The serialised ProcessSyscallEntryDTO in the strings table
+	Range key;
+	uint32_t reserved;
+};
+
+struct PolicyBundle::Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t fileSize;
+	uint32_t stateCount;
+	int32_t alphabetSize;
+	uint32_t transitionCount;
+	uint32_t initialCount;
+	uint32_t entryCount;
+	uint32_t bucketCount;
+	uint32_t executableCount;
+	uint32_t labelNameCount;
+	uint64_t stringsSize;
+	// File offsets of every table
+	uint64_t rowOffsets;
+	uint64_t labels;
+	uint64_t targets;
+	uint64_t finals;
+	uint64_t initials;
+	uint64_t entries;
+	uint64_t buckets;
+	uint64_t executables;
+	uint64_t labelNames;
+	uint64_t strings;
+	// Serialised SyscallMatrix, matrixSize is 0 if the automaton cannot be represented by a matrix
+	uint64_t matrix;
+	uint64_t matrixSize;
+	// Serialised StackLimits the associations have been learned with
+	Range stackLimits;
+	uint32_t reserved;
+};
+
+// Identifies a policy bundle file
+const char PolicyBundle::MAGIC[8] = { 'P', 'T', 'R', 'P', 'O', 'L', 'I', 'C' };
+// Incremented every time the layout changes, bundles with a different version must be compiled again
+const uint32_t PolicyBundle::VERSION = 3;
+// Written in the machine byte order, a bundle compiled on a machine with a different one is rejected
+const uint32_t PolicyBundle::ENDIANNESS = 0x01020304;
+// 64 bit FNV-1a parameters
+const uint64_t PolicyBundle::FNV_OFFSET = 0xcbf29ce484222325ULL;
+const uint64_t PolicyBundle::FNV_PRIME = 0x100000001b3ULL;
+
+PolicyBundle::~PolicyBundle() {
+	this->unmap();
+}
+
+/**
+ * Compiles an automaton and its associations in a policy bundle file.
+ * The file is written aside and then renamed, so that a running ptracer never maps a partial bundle.
+ *
+ * @param automaton    The NFA whose states are the association numbers.
+ * @param associations The associations between association numbers and system calls.
+ * @param bundlePath   The output file, if it exists it will be overwritten.
+ * @return True if the bundle has been written, False otherwise.
+ */
+bool PolicyBundle::compile(const amore::finite_automaton& automaton, const Mapper& associations, const string& bundlePath) {
+	CompactAutomaton nfa = CompactAutomaton::fromAmore(automaton);
+	Header header = {};
+	vector<unsigned int> rowOffsets(nfa.getStateCount() + 1, 0);
+	vector<int> labels, targets;
+	vector<unsigned char> finals(nfa.getStateCount(), 0);
+	vector<Entry> entries;
+	vector<uint32_t> buckets;
+	vector<Range> executables, labelNames;
+	map<int, Range> syscallNames;
+	string strings, matrixData;
+	SyscallMatrix matrix;
+	auto addString = [&strings](const string& value) {
+		Range range = { (uint32_t) strings.size(), (uint32_t) value.size() };
+		strings += value;
+		return range;
+	};
+	for (unsigned int state = 0; state < nfa.getStateCount(); state++) {
+		unsigned int first = nfa.getFirstTransition((int) state);
+		for (unsigned int i = first; i < first + nfa.getOutDegree((int) state); i++) {
+			labels.push_back(nfa.getTransitionLabel(i));
+			targets.push_back(nfa.getTransitionTarget(i));
+		}
+		rowOffsets[state + 1] = (unsigned int) labels.size();
+		finals[state] = nfa.isFinalState((int) state) ? 1 : 0;
+	}
+	labelNames.resize((unsigned int) nfa.getAlphabetSize(), Range { 0, 0 });
+	for (const auto& executableIt : associations.getAssociations()) {
+		uint64_t executableHash = PolicyBundle::hash(Mapper::FIELD_SEPARATOR.data(),
+		                                             Mapper::FIELD_SEPARATOR.size(),
+		                                             PolicyBundle::hash(executableIt.first.data(), executableIt.first.size()));
+		executables.push_back(addString(executableIt.first));
+		for (const auto& i : executableIt.second.left) {
+			string flat = i.second.serialize();
+			Entry entry = {};
+			entry.hash = PolicyBundle::hash(flat.data(), flat.size(), executableHash);
+			entry.executable = (uint32_t) executables.size() - 1;
+			entry.label = i.first;
+			entry.syscall = i.second.getSyscall();
+			entry.key = addString(flat);
+			entries.push_back(entry);
+			if (syscallNames.find(entry.syscall) == syscallNames.end()) {
+				string name = SyscallNameResolver::resolve((unsigned int) entry.syscall);
+				syscallNames[entry.syscall] = addString(name.empty() ? to_string(entry.syscall) : name);
+			}
+			if (entry.label >= labelNames.size()) {
+				labelNames.resize(entry.label + 1, Range { 0, 0 });
+			}
+			labelNames[entry.label] = syscallNames[entry.syscall];
+		}
+	}
+	header.stackLimits = addString(associations.getStackLimits().serialize());
+	// At most half full, so that a lookup of a missing association stops early on an empty bucket
+	uint32_t bucketCount = 2;
+	while (bucketCount < entries.size() * 2) {
+		bucketCount <<= 1;
+	}
+	buckets.assign(bucketCount, 0);
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		uint32_t position = (uint32_t) entries[i].hash & (bucketCount - 1);
+		while (buckets[position] != 0) {
+			position = (position + 1) & (bucketCount - 1);
+		}
+		buckets[position] = i + 1;
+	}
+
+	if (SyscallMatrix::fromAutomaton(nfa, associations, matrix)) {
+		matrix.serialize(matrixData);
+	}
+
+	vector<char> output(sizeof(Header), 0);
+	auto append = [&output](const void* table, unsigned long bytes) {
+		output.resize((output.size() + 7) & ~7UL, 0);
+		uint64_t offset = output.size();
+		output.insert(output.end(), (const char*) table, (const char*) table + bytes);
+		return offset;
+	};
+	memcpy(header.magic, PolicyBundle::MAGIC, sizeof(header.magic));
+	header.version = PolicyBundle::VERSION;
+	header.byteOrder = PolicyBundle::ENDIANNESS;
+	header.stateCount = nfa.getStateCount();
+	header.alphabetSize = nfa.getAlphabetSize();
+	header.transitionCount = (uint32_t) labels.size();
+	header.initialCount = (uint32_t) nfa.getInitialStates().size();
+	header.entryCount = (uint32_t) entries.size();
+	header.bucketCount = bucketCount;
+	header.executableCount = (uint32_t) executables.size();
+	header.labelNameCount = (uint32_t) labelNames.size();
+	header.stringsSize = strings.size();
+	header.rowOffsets = append(rowOffsets.data(), rowOffsets.size() * sizeof(unsigned int));
+	header.labels = append(labels.data(), labels.size() * sizeof(int));
+	header.targets = append(targets.data(), targets.size() * sizeof(int));
+	header.finals = append(finals.data(), finals.size());
+	header.initials = append(nfa.getInitialStates().data(), nfa.getInitialStates().size() * sizeof(int));
+	header.entries = append(entries.data(), entries.size() * sizeof(Entry));
+	header.buckets = append(buckets.data(), buckets.size() * sizeof(uint32_t));
+	header.executables = append(executables.data(), executables.size() * sizeof(Range));
+	header.labelNames = append(labelNames.data(), labelNames.size() * sizeof(Range));
+	header.strings = append(strings.data(), strings.size());
+	header.matrixSize = matrixData.size();
+	header.matrix = append(matrixData.data(), matrixData.size());
+	header.fileSize = output.size();
+	memcpy(output.data(), &header, sizeof(Header));
+
+	string temporaryPath = bundlePath + ".tmp";
+	ofstream file(temporaryPath, ios::out | ios::binary | ios::trunc);
+	if (!file.is_open()) {
+		cerr << "Impossible to open " << temporaryPath << " in write mode" << endl;
+		return false;
+	}
+	file.write(output.data(), (streamsize) output.size());
+	file.close();
+	if (file.fail()) {
+		cerr << "Error occurred while writing the policy in " << temporaryPath << endl;
+		unlink(temporaryPath.c_str());
+		return false;
+	}
+	if (rename(temporaryPath.c_str(), bundlePath.c_str()) < 0) {
+		cerr << "Impossible to move " << temporaryPath << " to " << bundlePath << ": " << strerror(errno) << endl;
+		unlink(temporaryPath.c_str());
+		return false;
+	}
+	cout << "Policy with " << header.stateCount << " states, " << header.transitionCount << " transitions and "
+	     << header.entryCount << " associations compiled in " << bundlePath << " (" << header.fileSize << " bytes)" << endl;
+	if (!associations.getStackLimits().isUnlimited()) {
+		cout << "The associations have been learned with " << (string) associations.getStackLimits() << endl;
+	}
+	if (header.matrixSize > 0) {
+		cout << "The automaton has no backtraces, its system call matrix with " << matrix.getTransitionCount()
+		     << " transitions has been compiled as well" << endl;
+	}
+	return true;
+}
+
+/**
+ * Maps a policy bundle in memory, the previously loaded one, if any, is released.
+ *
+ * @param bundlePath The bundle compiled by PolicyBundle::compile.
+ * @return True if the bundle has been mapped and it is valid, False otherwise.
+ */
+bool PolicyBundle::load(const string& bundlePath) {
+	struct stat info = {};
+	this->unmap();
+	int fd = open(bundlePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		cerr << "Impossible to open the policy " << bundlePath << ": " << strerror(errno) << endl;
+		return false;
+	}
+	if (fstat(fd, &info) < 0 || (unsigned long) info.st_size < sizeof(Header)) {
+		cerr << bundlePath << " is not a policy bundle" << endl;
+		close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		cerr << "Impossible to map the policy " << bundlePath << ": " << strerror(errno) << endl;
+		return false;
+	}
+	this->data = (const char*) mapped;
+	this->size = (unsigned long) info.st_size;
+	this->header = (const Header*) this->data;
+	if (!this->validate()) {
+		cerr << bundlePath << " is not a valid policy bundle, it has to be compiled again" << endl;
+		this->unmap();
+		return false;
+	}
+	this->rowOffsets = (const unsigned int*) (this->data + this->header->rowOffsets);
+	this->labels = (const int*) (this->data + this->header->labels);
+	this->targets = (const int*) (this->data + this->header->targets);
+	this->finals = (const unsigned char*) (this->data + this->header->finals);
+	this->initials = (const int*) (this->data + this->header->initials);
+	this->entries = (const Entry*) (this->data + this->header->entries);
+	this->buckets = (const uint32_t*) (this->data + this->header->buckets);
+	this->executables = (const Range*) (this->data + this->header->executables);
+	this->labelNames = (const Range*) (this->data + this->header->labelNames);
+	this->strings = this->data + this->header->strings;
+	return true;
+}
+
+/**
+ * Looks for the association number of a system call, like Mapper::find.
+ *
+ * @param state The system call that will be searched.
+ * @return The association number of state, Mapper::NOT_FOUND if it has not been found.
+ */
+int PolicyBundle::find(const shared_ptr<ProcessSyscallEntry>& state) const {
+	return this->find(state->getExecutableName(), ProcessSyscallEntryDTO(*state));
+}
+
+/**
+ * Looks for the association number of a system call of an executable, like Mapper::find.
+ *
+ * @param executableName The executable that performed the system call.
+ * @param state          The system call that will be searched.
+ * @return The association number of state, Mapper::NOT_FOUND if it has not been found.
+ */
+int PolicyBundle::find(const string& executableName, const ProcessSyscallEntryDTO& state) const {
+	if (this->header == nullptr) {
+		return Mapper::NOT_FOUND;
+	}
+	const string flat = state.serialize();
+	uint64_t value = PolicyBundle::hash(flat.data(),
+	                                    flat.size(),
+	                                    PolicyBundle::hash(Mapper::FIELD_SEPARATOR.data(),
+	                                                       Mapper::FIELD_SEPARATOR.size(),
+	                                                       PolicyBundle::hash(executableName.data(), executableName.size())));
+	uint32_t mask = this->header->bucketCount - 1;
+	for (uint32_t position = (uint32_t) value & mask; this->buckets[position] != 0; position = (position + 1) & mask) {
+		const Entry& entry = this->entries[this->buckets[position] - 1];
+		const Range& executable = this->executables[entry.executable];
+		if (entry.hash == value &&
+		    entry.key.length == flat.size() &&
+		    executable.length == executableName.size() &&
+		    memcmp(this->strings + entry.key.offset, flat.data(), flat.size()) == 0 &&
+		    memcmp(this->strings + executable.offset, executableName.data(), executableName.size()) == 0) {
+			return (int) entry.label;
+		}
+	}
+	return Mapper::NOT_FOUND;
+}
+
+/**
+ * Copies the automaton tables in a CompactAutomaton.
+ *
+ * @return The NFA compiled in the bundle.
+ */
+CompactAutomaton PolicyBundle::getAutomaton() const {
+	assert(this->header != nullptr);
+	return CompactAutomaton::fromTables(this->rowOffsets,
+	                                    this->header->stateCount,
+	                                    this->labels,
+	                                    this->targets,
+	                                    this->finals,
+	                                    this->initials,
+	                                    this->header->initialCount,
+	                                    this->header->alphabetSize);
+}
+
+/**
+ * Reads the system call matrix compiled in the bundle, if any.
+ *
+ * @param result Where the matrix will be written.
+ * @return True if the bundle contains a matrix, False if its automaton has been learned with backtraces.
+ */
+bool PolicyBundle::getSyscallMatrix(SyscallMatrix& result) const {
+	return this->header != nullptr && this->header->matrixSize > 0 &&
+	       SyscallMatrix::deserialize(this->data + this->header->matrix, this->header->matrixSize, result);
+}
+
+/**
+ * Groups the association numbers by their system call number, like Mapper::getSyscallLabels.
+ *
+ * @return A map in the form < syscall_number, { association_numbers } >.
+ */
+map<int, set<int>> PolicyBundle::getSyscallLabels() const {
+	map<int, set<int>> result;
+	for (uint32_t i = 0; this->header != nullptr && i < this->header->entryCount; i++) {
+		result[this->entries[i].syscall].insert((int) this->entries[i].label);
+	}
+	return result;
+}
+
+/**
+ * Gets the name of the system call of every association number, as resolved when the bundle was compiled.
+ *
+ * @return The system call names indexed by association number, empty for the numbers without an association.
+ */
+vector<string> PolicyBundle::getLabelNames() const {
+	vector<string> names;
+	for (uint32_t i = 0; this->header != nullptr && i < this->header->labelNameCount; i++) {
+		names.push_back(this->getString(this->labelNames[i]));
+	}
+	return names;
+}
+
+/**
+ * @return The limits of the stack traces the associations have been learned with.
+ */
+StackLimits PolicyBundle::getStackLimits() const {
+	StackLimits limits;
+	if (this->header != nullptr) {
+		StackLimits::parse(this->getString(this->header->stackLimits), limits);
+	}
+	return limits;
+}
+
+/**
+ * Writes the associations in the format of the Mapper store file, so that a Mapper can be built from them.
+ * Entries are compiled grouped by executable and sorted by association number, as Mapper::save writes them.
+ *
+ * @param out The stream where the associations will be written.
+ */
+void PolicyBundle::writeAssociations(ostream& out) const {
+	StackLimits limits = this->getStackLimits();
+	if (!limits.isUnlimited()) {
+		out << StackLimits::HEADER << limits.serialize() << endl;
+	}
+	for (uint32_t i = 0; this->header != nullptr && i < this->header->entryCount; i++) {
+		const Entry& entry = this->entries[i];
+		if (i == 0 || entry.executable != this->entries[i - 1].executable) {
+			if (i > 0) {
+				out << Mapper::SECTION_END << endl;
+			}
+			out << Mapper::SECTION_START << this->getString(this->executables[entry.executable]) << endl;
+		}
+		out << entry.label << Mapper::FIELD_SEPARATOR << this->getString(entry.key);
+	}
+	if (this->header != nullptr && this->header->entryCount > 0) {
+		out << Mapper::SECTION_END << endl;
+	}
+}
+
+unsigned int PolicyBundle::getAssociationCount() const {
+	return this->header != nullptr ? this->header->entryCount : 0;
+}
+
+unsigned long PolicyBundle::getSize() const {
+	return this->size;
+}
+
+uint64_t PolicyBundle::hash(const char* bytes, unsigned long length, uint64_t seed) {
+	for (unsigned long i = 0; i < length; i++) {
+		seed = (seed ^ (unsigned char) bytes[i]) * PolicyBundle::FNV_PRIME;
+	}
+	return seed;
+}
+
+/**
+ * Checks that the mapped file is a bundle of this version and that every table and every index it contains
+ * is within the file, so that the lookups never need to check them.
+ *
+ * @return True if the mapped file can be used, False otherwise.
+ */
+bool PolicyBundle::validate() const {
+	const Header& h = *this->header;
+	if (memcmp(h.magic, PolicyBundle::MAGIC, sizeof(h.magic)) != 0 || h.version != PolicyBundle::VERSION ||
+	    h.byteOrder != PolicyBundle::ENDIANNESS || h.fileSize != this->size || h.alphabetSize < 0 ||
+	    h.bucketCount == 0 || (h.bucketCount & (h.bucketCount - 1)) != 0 || h.bucketCount <= h.entryCount) {
+		return false;
+	}
+	if (!this->inFile(h.rowOffsets, (uint64_t) h.stateCount + 1, sizeof(unsigned int)) ||
+	    !this->inFile(h.labels, h.transitionCount, sizeof(int)) ||
+	    !this->inFile(h.targets, h.transitionCount, sizeof(int)) ||
+	    !this->inFile(h.finals, h.stateCount, 1) ||
+	    !this->inFile(h.initials, h.initialCount, sizeof(int)) ||
+	    !this->inFile(h.entries, h.entryCount, sizeof(Entry)) ||
+	    !this->inFile(h.buckets, h.bucketCount, sizeof(uint32_t)) ||
+	    !this->inFile(h.executables, h.executableCount, sizeof(Range)) ||
+	    !this->inFile(h.labelNames, h.labelNameCount, sizeof(Range)) ||
+	    !this->inFile(h.strings, h.stringsSize, 1) ||
+	    !this->inFile(h.matrix, h.matrixSize, 1)) {
+		return false;
+	}
+	auto rows = (const unsigned int*) (this->data + h.rowOffsets);
+	auto transitionLabels = (const int*) (this->data + h.labels);
+	auto transitionTargets = (const int*) (this->data + h.targets);
+	auto initialStates = (const int*) (this->data + h.initials);
+	auto associations = (const Entry*) (this->data + h.entries);
+	auto hashTable = (const uint32_t*) (this->data + h.buckets);
+	auto stringRanges = [&h](const Range* ranges, uint32_t count) {
+		return all_of(ranges, ranges + count, [&h](const Range& range) {
+			return (uint64_t) range.offset + range.length <= h.stringsSize;
+		});
+	};
+	if (rows[0] != 0 || rows[h.stateCount] != h.transitionCount) {
+		return false;
+	}
+	for (uint32_t state = 0; state < h.stateCount; state++) {
+		if (rows[state] > rows[state + 1]) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < h.transitionCount; i++) {
+		if (transitionLabels[i] < 0 || transitionLabels[i] >= h.alphabetSize ||
+		    transitionTargets[i] < 0 || (uint32_t) transitionTargets[i] >= h.stateCount) {
+			return false;
+		}
+	}
+	if (any_of(initialStates, initialStates + h.initialCount, [&h](int state) {
+		return state < 0 || (uint32_t) state >= h.stateCount;
+	})) {
+		return false;
+	}
+	for (uint32_t i = 0; i < h.entryCount; i++) {
+		if (associations[i].executable >= h.executableCount || !stringRanges(&associations[i].key, 1)) {
+			return false;
+		}
+	}
+	if (any_of(hashTable, hashTable + h.bucketCount, [&h](uint32_t bucket) { return bucket > h.entryCount; })) {
+		return false;
+	}
+	StackLimits limits;
+	return stringRanges((const Range*) (this->data + h.executables), h.executableCount) &&
+	       stringRanges((const Range*) (this->data + h.labelNames), h.labelNameCount) &&
+	       stringRanges(&h.stackLimits, 1) &&
+	       StackLimits::parse(string(this->data + h.strings + h.stackLimits.offset, h.stackLimits.length), limits);
+}
+
+bool PolicyBundle::inFile(uint64_t offset, uint64_t count, uint64_t elementSize) const {
+	return offset % 8 == 0 && offset <= this->size && count <= (this->size - offset) / elementSize;
+}
+
+string PolicyBundle::getString(const Range& range) const {
+	return string(this->strings + range.offset, range.length);
+}
+
+void PolicyBundle::unmap() {
+	if (this->data != nullptr) {
+		munmap((void*) this->data, this->size);
+	}
+	this->data = nullptr;
+	this->size = 0;
+	this->header = nullptr;
+}
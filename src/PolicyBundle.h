@@ -0,0 +1,65 @@
+#ifndef PTRACER_POLICYBUNDLE_H
+#define PTRACER_POLICYBUNDLE_H
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <amore++/finite_automaton.h>
+#include "CompactAutomaton.h"
+#include "Mapper.h"
+#include "SyscallMatrix.h"
+
+class PolicyBundle {
+public:
+	static const char MAGIC[8];
+	static const uint32_t VERSION;
+	PolicyBundle() = default;
+	PolicyBundle(const PolicyBundle&) = delete;
+	PolicyBundle& operator=(const PolicyBundle&) = delete;
+	~PolicyBundle();
+	static bool compile(const amore::finite_automaton& automaton, const Mapper& associations, const std::string& bundlePath);
+	bool load(const std::string& bundlePath);
+	[[nodiscard]] int find(const std::shared_ptr<ProcessSyscallEntry>& state) const;
+	[[nodiscard]] int find(const std::string& executableName, const ProcessSyscallEntryDTO& state) const;
+	[[nodiscard]] CompactAutomaton getAutomaton() const;
+	bool getSyscallMatrix(SyscallMatrix& result) const;
+	[[nodiscard]] std::map<int, std::set<int>> getSyscallLabels() const;
+	[[nodiscard]] std::vector<std::string> getLabelNames() const;
+	[[nodiscard]] StackLimits getStackLimits() const;
+	void writeAssociations(std::ostream& out) const;
+	[[nodiscard]] unsigned int getAssociationCount() const;
+	[[nodiscard]] unsigned long getSize() const;
+
+private:
+	struct Header;
+	struct Entry;
+	struct Range;
+	static const uint32_t ENDIANNESS;
+	static const uint64_t FNV_OFFSET;
+	static const uint64_t FNV_PRIME;
+	// The whole file mapped read only, every table below points inside it
+	const char* data = nullptr;
+	unsigned long size = 0;
+	const Header* header = nullptr;
+	const unsigned int* rowOffsets = nullptr;
+	const int* labels = nullptr;
+	const int* targets = nullptr;
+	const unsigned char* finals = nullptr;
+	const int* initials = nullptr;
+	const Entry* entries = nullptr;
+	// Open addressing hash table of the associations: entry index + 1, 0 if the bucket is empty
+	const uint32_t* buckets = nullptr;
+	const Range* executables = nullptr;
+	const Range* labelNames = nullptr;
+	const char* strings = nullptr;
+	static uint64_t hash(const char* bytes, unsigned long length, uint64_t seed = PolicyBundle::FNV_OFFSET);
+	[[nodiscard]] bool validate() const;
+	[[nodiscard]] bool inFile(uint64_t offset, uint64_t count, uint64_t elementSize) const;
+	[[nodiscard]] std::string getString(const Range& range) const;
+	void unmap();
+};
+
+#endif //PTRACER_POLICYBUNDLE_H
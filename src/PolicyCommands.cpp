@@ -0,0 +1,728 @@
+#include <assert.h>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include "Authorizer.h"
+#include "LearnedModel.h"
+#include "ModelStore.h"
+#include "PolicyBundle.h"
+#include "PolicyCommands.h"
+#include "SequenceModel.h"
+#include "TransitionCache.h"
+#include "decoders/PayloadArchive.h"
+
+using namespace std;
+using namespace boost::program_options;
+
+// Every available command, the first command line argument selects one of them
+const map<string, function<int (int, const char**)>> PolicyCommands::commands = {
+		{ "compile-policy", PolicyCommands::compilePolicy },
+		{ "merge", PolicyCommands::merge },
+		{ "bench", PolicyCommands::bench },
+		{ "optimize-policy", PolicyCommands::optimizePolicy },
+		{ "split-policy", PolicyCommands::splitPolicy },
+		{ "extract-payloads", PolicyCommands::extractPayloads }
+};
+
+bool PolicyCommands::exists(const string& name) {
+	return PolicyCommands::commands.find(name) != PolicyCommands::commands.end();
+}
+
+/**
+ * Runs a command.
+ *
+ * @param name          The command name.
+ * @param argc          The number of arguments, the command name included.
+ * @param argv          The command arguments, the first one is the command name.
+ * @return The program exit code.
+ * @throw runtime_error In case of an error in the command line parameters parsing.
+ */
+int PolicyCommands::run(const string& name, int argc, const char** argv) {
+	assert(PolicyCommands::exists(name));
+	return PolicyCommands::commands.at(name)(argc, argv);
+}
+
+/**
+ * Compiles an NFA and its associations in a policy bundle that can be enforced with the --policy option.
+ */
+int PolicyCommands::compilePolicy(int argc, const char** argv) {
+	options_description description("Usage: ptracer compile-policy --nfa <file> --associations <file> --output <file>");
+	description.add_options()
+			("help", "Display this help message")
+			("nfa", value<string>(), "The NFA learned by the Authorizer")
+			("associations", value<string>(), "The associations learned together with the NFA")
+			("output", value<string>(), "Where the compiled policy will be written")
+	;
+	variables_map option_values;
+	try {
+		store(command_line_parser(argc, argv).options(description).run(), option_values);
+		notify(option_values);
+	} catch (boost::program_options::error& e) {
+		throw runtime_error(string(e.what()));
+	}
+	if (option_values.count("help") > 0) {
+		cout << description << endl;
+		return 0;
+	}
+	if (option_values.count("nfa") <= 0 || option_values.count("associations") <= 0 || option_values.count("output") <= 0) {
+		throw runtime_error("compile-policy requires the NFA, the associations and the output paths");
+	}
+	string associationsPath = option_values["associations"].as<string>();
+	if (!ifstream(associationsPath).good()) {
+		throw runtime_error("Associations file " + associationsPath + " not found");
+	}
+	auto start = chrono::steady_clock::now();
+	unique_ptr<amore::nondeterministic_finite_automaton> automaton = Authorizer::readAutomaton(option_values["nfa"].as<string>());
+	if (automaton == nullptr) {
+		return 1;
+	}
+	Mapper associations(associationsPath);
+	if (!PolicyBundle::compile(*automaton, associations, option_values["output"].as<string>())) {
+		return 1;
+	}
+	cout << "Compiled in " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+	return 0;
+}
+
+/**
+ * Merges the models learned by many runs in a single one: association numbers are remapped by system call identity and
+ * transitions, initial and final states are united.
+ * The models are loaded in parallel and then merged in pairs, every round of the reduction tree in parallel.
+ */
+int PolicyCommands::merge(int argc, const char** argv) {
+	options_description description("Usage: ptracer merge --nfa <file> --associations <file> [--policy <file>] <nfa> <associations> ...");
+	positional_options_description positional;
+	description.add_options()
+			("help", "Display this help message")
+			("nfa", value<string>(), "Where the merged NFA will be written")
+			("associations", value<string>(), "Where the merged associations will be written")
+			("policy", value<string>(), "Where the merged model will be written as a compiled policy, optional")
+			("threads", value<unsigned int>()->default_value(max(boost::thread::hardware_concurrency(), 1U)), "Number of threads used to load and merge the models")
+			("input", value<vector<string>>(), "NFA and associations paths of every model to merge")
+	;
+	positional.add("input", -1);
+	variables_map option_values;
+	try {
+		store(command_line_parser(argc, argv).options(description).positional(positional).run(), option_values);
+		notify(option_values);
+	} catch (boost::program_options::error& e) {
+		throw runtime_error(string(e.what()));
+	}
+	if (option_values.count("help") > 0) {
+		cout << description << endl;
+		return 0;
+	}
+	if (option_values.count("nfa") <= 0 || option_values.count("associations") <= 0) {
+		throw runtime_error("merge requires the paths where the merged NFA and associations will be written");
+	}
+	vector<string> inputs = option_values.count("input") > 0 ? option_values["input"].as<vector<string>>() : vector<string>();
+	if (inputs.empty() || inputs.size() % 2 != 0) {
+		throw runtime_error("merge requires a list of NFA and associations path pairs");
+	}
+	unsigned int threads = max(option_values["threads"].as<unsigned int>(), 1U);
+	vector<unique_ptr<LearnedModel>> models(inputs.size() / 2);
+	auto start = chrono::steady_clock::now();
+	if (!PolicyCommands::runParallel((unsigned int) models.size(), threads, [&inputs, &models](unsigned int i) {
+		models[i] = LearnedModel::load(inputs[2 * i], inputs[2 * i + 1]);
+		return models[i] != nullptr;
+	})) {
+		cerr << "Impossible to load every model" << endl;
+		return 1;
+	}
+	cout << models.size() << " models loaded in "
+	     << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+	// At every round model i absorbs model i + step, the result does not depend on the number of threads
+	for (unsigned int step = 1; step < models.size(); step *= 2) {
+		unsigned int pairs = ((unsigned int) models.size() - step + 2 * step - 1) / (2 * step);
+		if (!PolicyCommands::runParallel(pairs, threads, [&models, step](unsigned int pair) {
+			unsigned int i = pair * 2 * step;
+			bool result = models[i]->merge(*models[i + step]);
+			models[i + step] = nullptr;
+			return result;
+		})) {
+			cerr << "Impossible to merge the models" << endl;
+			return 1;
+		}
+	}
+	const LearnedModel& merged = *models.front();
+	cout << "Merged model: " << merged.getAssociations().getSize() << " associations, " << merged.getTransitionCount()
+	     << " transitions, in " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+	if (!merged.save(option_values["nfa"].as<string>(), option_values["associations"].as<string>())) {
+		return 1;
+	}
+	if (option_values.count("policy") > 0) {
+		unique_ptr<amore::nondeterministic_finite_automaton> automaton = merged.toAutomaton();
+		if (automaton == nullptr || !PolicyBundle::compile(*automaton, merged.getAssociations(), option_values["policy"].as<string>())) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Reduces an NFA offline: unreachable states are removed, equivalent states are merged and, optionally, the automaton
+ * is determinised; the associations that are not used anymore are removed and the others renumbered.
+ * Whenever the reduced automaton allows it its states are named after their labels, as in a learned automaton, so that
+ * it can still be learned, merged and enforced as a syscall matrix.
+ */
+int PolicyCommands::optimizePolicy(int argc, const char** argv) {
+	options_description description("Usage: ptracer optimize-policy --nfa <file> --associations <file> --output-nfa <file> --output-associations <file> [options]");
+	description.add_options()
+			("help", "Display this help message")
+			("nfa", value<string>(), "The NFA learned by the Authorizer")
+			("associations", value<string>(), "The associations learned together with the NFA")
+			("output-nfa", value<string>(), "Where the optimised NFA will be written, it can be the input one")
+			("output-associations", value<string>(), "Where the optimised associations will be written, it can be the input one")
+			("policy", value<string>(), "Where the optimised model will be written as a compiled policy, optional")
+			("determinize", value<bool>()->default_value(false), "Determinise the automaton, unless it would have more than --max-states states")
+			("max-states", value<unsigned int>()->default_value(CompactAutomaton::DEFAULT_MAX_DFA_STATES), "Maximum number of states of the determinised automaton")
+			("walks", value<unsigned int>()->default_value(1000), "Number of random walks used to measure the enforcement speedup")
+			("length", value<unsigned int>()->default_value(1000), "Maximum number of system calls of every random walk")
+	;
+	variables_map option_values;
+	try {
+		store(command_line_parser(argc, argv).options(description).run(), option_values);
+		notify(option_values);
+	} catch (boost::program_options::error& e) {
+		throw runtime_error(string(e.what()));
+	}
+	if (option_values.count("help") > 0) {
+		cout << description << endl;
+		return 0;
+	}
+	if (option_values.count("nfa") <= 0 || option_values.count("associations") <= 0 ||
+	    option_values.count("output-nfa") <= 0 || option_values.count("output-associations") <= 0) {
+		throw runtime_error("optimize-policy requires the NFA and associations paths, both of the input and of the output");
+	}
+	string associationsPath = option_values["associations"].as<string>();
+	ifstream associationsFile(associationsPath);
+	if (!associationsFile.good()) {
+		throw runtime_error("Associations file " + associationsPath + " not found");
+	}
+	unique_ptr<amore::nondeterministic_finite_automaton> amoreAutomaton = Authorizer::readAutomaton(option_values["nfa"].as<string>());
+	if (amoreAutomaton == nullptr) {
+		return 1;
+	}
+	Mapper associations(associationsPath, associationsFile);
+	CompactAutomaton original = CompactAutomaton::fromAmore(*amoreAutomaton);
+	auto start = chrono::steady_clock::now();
+	CompactAutomaton reduced = original.minimize();
+	if (option_values["determinize"].as<bool>() && !reduced.isDeterministic()) {
+		CompactAutomaton deterministic;
+		if (reduced.determinize(option_values["max-states"].as<unsigned int>(), deterministic)) {
+			reduced = deterministic.minimize();
+		} else {
+			cerr << "The determinised automaton would have more than " << option_values["max-states"].as<unsigned int>()
+			     << " states, it will not be determinised" << endl;
+		}
+	}
+	// Only the labels still used are kept, numbered from 1 in their previous order
+	vector<int> labelMap(reduced.getAlphabetSize(), -1), stateMap(reduced.getStateCount());
+	for (unsigned int i = 0; i < reduced.getTransitionCount(); i++) {
+		labelMap[reduced.getTransitionLabel(i)] = 0;
+	}
+	int labelCount = 0;
+	for (int& label : labelMap) {
+		label = label == 0 ? ++labelCount : -1;
+	}
+	for (unsigned int state = 0; state < reduced.getStateCount(); state++) {
+		stateMap[state] = (int) state;
+	}
+	stringstream emptyAssociations;
+	Mapper optimisedAssociations("", emptyAssociations);
+	optimisedAssociations.setStackLimits(associations.getStackLimits());
+	for (const auto& executableIt : associations.getAssociations()) {
+		for (const auto& i : executableIt.second.left) {
+			if (i.first < labelMap.size() && labelMap[i.first] > 0) {
+				optimisedAssociations.insert(executableIt.first, (unsigned int) labelMap[i.first], i.second);
+			}
+		}
+	}
+	if ((int) optimisedAssociations.getSize() != labelCount) {
+		cerr << "The automaton has transitions without an association" << endl;
+		return 1;
+	}
+	CompactAutomaton optimised = reduced.renumber(stateMap, labelMap), labelled;
+	if (optimised.labelStates(labelled)) {
+		optimised = std::move(labelled);
+	} else {
+		cout << "Some states have been merged, the optimised automaton can only be enforced" << endl;
+	}
+	cout << "Automaton optimised in " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+	cout << "States: " << original.getStateCount() << " -> " << optimised.getStateCount() << endl;
+	cout << "Transitions: " << original.getTransitionCount() << " -> " << optimised.getTransitionCount() << endl;
+	cout << "Associations: " << associations.getSize() << " -> " << optimisedAssociations.getSize() << endl;
+	// The same random walks are checked on both automata, with their labels renumbered on the optimised one
+	mt19937 random(0);
+	vector<vector<int>> traces = PolicyCommands::randomWalks(original, option_values["walks"].as<unsigned int>(), option_values["length"].as<unsigned int>(), random);
+	vector<vector<int>> optimisedTraces(traces);
+	for (vector<int>& trace : optimisedTraces) {
+		for (int& label : trace) {
+			label = labelMap[label];
+		}
+	}
+	double originalTime = PolicyCommands::measureChecks(original, traces);
+	double optimisedTime = PolicyCommands::measureChecks(optimised, optimisedTraces);
+	if (originalTime < 0 || optimisedTime < 0) {
+		cerr << "The optimised automaton does not accept the same system calls, it will not be saved" << endl;
+		return 1;
+	}
+	if (!traces.empty()) {
+		cout << "Enforcement: " << originalTime << " -> " << optimisedTime << " ns per system call, "
+		     << originalTime / max(optimisedTime, 0.001) << "x speedup" << endl;
+	}
+	unique_ptr<amore::nondeterministic_finite_automaton> result = optimised.toAmore();
+	if (result == nullptr) {
+		cerr << "Impossible to build the optimised automaton" << endl;
+		return 1;
+	}
+	if (!Authorizer::writeAutomaton(*result, option_values["output-nfa"].as<string>()) ||
+	    !optimisedAssociations.saveAs(option_values["output-associations"].as<string>())) {
+		return 1;
+	}
+	if (option_values.count("policy") > 0 && !PolicyBundle::compile(*result, optimisedAssociations, option_values["policy"].as<string>())) {
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Splits a learned NFA in a model directory, with a compiled policy for every executable, that can be enforced with the
+ * --model-dir option. The states of a learned automaton are its association numbers, so the policy of an executable
+ * keeps its own states and maps every state of the other executables on the initial one: the transitions that follow
+ * an execve start from the beginning of the policy of the new executable.
+ */
+int PolicyCommands::splitPolicy(int argc, const char** argv) {
+	options_description description("Usage: ptracer split-policy --nfa <file> --associations <file> --output-dir <directory>");
+	description.add_options()
+			("help", "Display this help message")
+			("nfa", value<string>(), "The NFA learned by the Authorizer")
+			("associations", value<string>(), "The associations learned together with the NFA")
+			("output-dir", value<string>(), "Where the policies and their index will be written, it is created if it does not exist")
+	;
+	variables_map option_values;
+	try {
+		store(command_line_parser(argc, argv).options(description).run(), option_values);
+		notify(option_values);
+	} catch (boost::program_options::error& e) {
+		throw runtime_error(string(e.what()));
+	}
+	if (option_values.count("help") > 0) {
+		cout << description << endl;
+		return 0;
+	}
+	if (option_values.count("nfa") <= 0 || option_values.count("associations") <= 0 || option_values.count("output-dir") <= 0) {
+		throw runtime_error("split-policy requires the NFA, the associations and the output directory paths");
+	}
+	string associationsPath = option_values["associations"].as<string>();
+	string directory = option_values["output-dir"].as<string>();
+	if (!ifstream(associationsPath).good()) {
+		throw runtime_error("Associations file " + associationsPath + " not found");
+	}
+	if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+		cerr << "Impossible to create the directory " << directory << ": " << strerror(errno) << endl;
+		return 1;
+	}
+	unique_ptr<amore::nondeterministic_finite_automaton> amoreAutomaton = Authorizer::readAutomaton(option_values["nfa"].as<string>());
+	if (amoreAutomaton == nullptr) {
+		return 1;
+	}
+	Mapper associations(associationsPath);
+	CompactAutomaton original = CompactAutomaton::fromAmore(*amoreAutomaton);
+	if (!original.hasLabelledStates()) {
+		cerr << "The automaton has been optimised, only learned automata can be split" << endl;
+		return 1;
+	}
+	bool initialFinal = original.isFinal(original.getInitialStates());
+	vector<ModelStore::IndexEntry> entries;
+	for (const auto& executableIt : associations.getAssociations()) {
+		// Association number -> label in the policy of the executable, 0 for the labels of the other executables
+		vector<int> labelMap(max(original.getAlphabetSize(), (int) original.getStateCount()), 0);
+		stringstream emptyAssociations;
+		Mapper executableAssociations("", emptyAssociations);
+		executableAssociations.setStackLimits(associations.getStackLimits());
+		int labelCount = 0;
+		for (const auto& i : executableIt.second.left) {
+			if (i.first < labelMap.size()) {
+				labelMap[i.first] = ++labelCount;
+				executableAssociations.insert(executableIt.first, (unsigned int) labelCount, i.second);
+			}
+		}
+		map<int, map<int, set<int>>> transitions;
+		set<int> finals;
+		if (initialFinal) {
+			finals.insert(0);
+		}
+		for (unsigned int state = 0; state < original.getStateCount(); state++) {
+			int origin = labelMap[state];
+			for (unsigned int i = original.getFirstTransition((int) state); i < original.getFirstTransition((int) state) + original.getOutDegree((int) state); i++) {
+				int label = labelMap[original.getTransitionLabel(i)];
+				if (label > 0) {
+					transitions[origin][label].insert(labelMap[original.getTransitionTarget(i)]);
+				}
+			}
+			if (origin > 0 && original.isFinalState((int) state)) {
+				finals.insert(origin);
+			}
+		}
+		CompactAutomaton policy({ 0 }, finals, transitions, labelCount + 1, labelCount + 1);
+		unique_ptr<amore::nondeterministic_finite_automaton> result = policy.toAmore();
+		string name = executableIt.first.substr(executableIt.first.find_last_of('/') + 1);
+		ModelStore::IndexEntry entry { ModelStore::readBuildId(executableIt.first),
+		                               to_string(entries.size()) + "-" + (name.empty() ? "executable" : name) + ".policy",
+		                               executableIt.first, associations.getStackLimits() };
+		if (result == nullptr || !PolicyBundle::compile(*result, executableAssociations, directory + "/" + entry.file)) {
+			cerr << "Impossible to compile the policy of " << executableIt.first << endl;
+			return 1;
+		}
+		cout << "Policy of " << executableIt.first << ": " << labelCount << " associations, " << policy.getTransitionCount()
+		     << " transitions, " << (entry.buildId.empty() ? "no build-id" : "build-id " + entry.buildId) << endl;
+		entries.push_back(std::move(entry));
+	}
+	if (!ModelStore::writeIndex(directory, entries)) {
+		return 1;
+	}
+	cout << entries.size() << " policies written in " << directory << endl;
+	return 0;
+}
+
+/**
+ * Lists the streams of a payload archive written with the --payload-archive option, or rebuilds the file of every
+ * selected stream as the decoders would have written it without the archive.
+ */
+int PolicyCommands::extractPayloads(int argc, const char** argv) {
+	options_description description("Usage: ptracer extract-payloads --archive <file> [--list] [--pid <pid>] [--fd <fd>] [--direction read|write] --output-dir <directory>");
+	description.add_options()
+			("help", "Display this help message")
+			("archive", value<string>(), "The archive written with the --payload-archive option")
+			("list", "Only list the streams of the archive")
+			("pid", value<int>(), "Extract only the streams of this process")
+			("fd", value<int>(), "Extract only the streams of this file descriptor")
+			("direction", value<string>(), "Extract only the payloads read or written by the processes")
+			("output-dir", value<string>(), "Where the streams will be written, every one at the path the decoder would have used")
+	;
+	variables_map option_values;
+	try {
+		store(command_line_parser(argc, argv).options(description).run(), option_values);
+		notify(option_values);
+	} catch (boost::program_options::error& e) {
+		throw runtime_error(string(e.what()));
+	}
+	if (option_values.count("help") > 0) {
+		cout << description << endl;
+		return 0;
+	}
+	bool list = option_values.count("list") > 0;
+	if (option_values.count("archive") <= 0 || (!list && option_values.count("output-dir") <= 0)) {
+		throw runtime_error("extract-payloads requires the archive and the output directory paths");
+	}
+	string direction = option_values.count("direction") > 0 ? option_values["direction"].as<string>() : "";
+	if (!direction.empty() && direction != "read" && direction != "write") {
+		throw runtime_error("The direction can be either read or write");
+	}
+	PayloadArchive archive(option_values["archive"].as<string>());
+	if (!archive.open()) {
+		return 1;
+	}
+	unsigned long extracted = 0;
+	unsigned long failed = 0;
+	for (const PayloadArchive::Stream& stream : archive.getStreams()) {
+		if ((option_values.count("pid") > 0 && stream.header.pid != option_values["pid"].as<int>()) ||
+		    (option_values.count("fd") > 0 && stream.header.fd != option_values["fd"].as<int>()) ||
+		    (!direction.empty() && (stream.header.direction == PayloadArchive::READ) != (direction == "read"))) {
+			continue;
+		}
+		if (list) {
+			cout << "PID " << stream.header.pid << ", file descriptor " << stream.header.fd << ", "
+			     << (stream.header.direction == PayloadArchive::READ ? "read" : "written") << ": " << stream.bytes << " bytes, " << stream.name << endl;
+			continue;
+		}
+		// The names come from the archive, they must not escape the output directory
+		filesystem::path name = filesystem::path(stream.name).relative_path();
+		if (find(name.begin(), name.end(), "..") != name.end()) {
+			cerr << "Stream " << stream.name << " skipped, its name is not a relative path" << endl;
+			failed++;
+			continue;
+		}
+		if (archive.extract(stream, option_values["output-dir"].as<string>() / name)) {
+			extracted++;
+		} else {
+			failed++;
+		}
+	}
+	if (!list) {
+		cout << extracted << " of " << archive.getStreams().size() << " streams extracted" << (archive.isIndexed() ? "" : " from an archive without index")
+		     << (failed > 0 ? ", " + to_string(failed) + " failed" : "") << endl;
+	}
+	return failed > 0 ? 1 : 0;
+}
+
+/**
+ * Compares an NFA with the n-gram model learned from the same system call sequences: time spent checking every system
+ * call, rate of detected anomalies on mutated sequences, size and merge time of the models.
+ * The sequences are read from a file, one thread per line as association numbers separated by spaces, or generated
+ * by random walks on the NFA.
+ */
+int PolicyCommands::bench(int argc, const char** argv) {
+	options_description description("Usage: ptracer bench --nfa <file> --associations <file> [--traces <file>] [options]");
+	description.add_options()
+			("help", "Display this help message")
+			("nfa", value<string>(), "The NFA learned by the Authorizer")
+			("associations", value<string>(), "The associations learned together with the NFA")
+			("traces", value<string>(), "The system call sequences, one thread per line, if missing they are random walks on the NFA")
+			("walks", value<unsigned int>()->default_value(1000), "Number of random walks generated when no traces are given")
+			("length", value<unsigned int>()->default_value(1000), "Maximum number of system calls of every random walk")
+			("ngram-size", value<unsigned int>()->default_value(3), "Number of system calls of every window of the n-gram model")
+			("repeat", value<unsigned int>()->default_value(10), "Number of times every sequence is checked while measuring the time")
+			("seed", value<unsigned int>()->default_value(0), "Seed of the random walks and of the mutations")
+			("model-path", value<string>(), "Where the learned n-gram model will be written, optional")
+	;
+	variables_map option_values;
+	try {
+		store(command_line_parser(argc, argv).options(description).run(), option_values);
+		notify(option_values);
+	} catch (boost::program_options::error& e) {
+		throw runtime_error(string(e.what()));
+	}
+	if (option_values.count("help") > 0) {
+		cout << description << endl;
+		return 0;
+	}
+	if (option_values.count("nfa") <= 0 || option_values.count("associations") <= 0) {
+		throw runtime_error("bench requires the NFA and the associations paths");
+	}
+	unique_ptr<SequenceModel> ngram = SequenceModel::create("ngram", option_values["ngram-size"].as<unsigned int>());
+	unique_ptr<LearnedModel> model = LearnedModel::load(option_values["nfa"].as<string>(), option_values["associations"].as<string>());
+	if (model == nullptr) {
+		return 1;
+	}
+	unique_ptr<amore::nondeterministic_finite_automaton> amoreAutomaton = model->toAutomaton();
+	if (amoreAutomaton == nullptr) {
+		return 1;
+	}
+	CompactAutomaton automaton = CompactAutomaton::fromAmore(*amoreAutomaton);
+	// Association numbers are global, every one of them belongs to a single executable
+	map<int, string> executables;
+	map<string, vector<int>> executableLabels;
+	for (const auto& executableIt : model->getAssociations().getAssociations()) {
+		for (const auto& association : executableIt.second.left) {
+			executables[(int) association.first] = executableIt.first;
+			executableLabels[executableIt.first].push_back((int) association.first);
+		}
+	}
+	mt19937 random(option_values["seed"].as<unsigned int>());
+	vector<vector<int>> traces;
+	if (option_values.count("traces") > 0) {
+		ifstream file(option_values["traces"].as<string>());
+		string line;
+		if (!file.is_open()) {
+			cerr << "Impossible to open the traces " << option_values["traces"].as<string>() << endl;
+			return 1;
+		}
+		while (getline(file, line)) {
+			istringstream labels(line);
+			vector<int> trace;
+			int label;
+			while (labels >> label) {
+				if (executables.find(label) == executables.end()) {
+					cerr << "Association " << label << " is not in " << option_values["associations"].as<string>() << endl;
+					return 1;
+				}
+				trace.push_back(label);
+			}
+			if (!trace.empty()) {
+				traces.push_back(std::move(trace));
+			}
+		}
+	} else {
+		traces = PolicyCommands::randomWalks(automaton, option_values["walks"].as<unsigned int>(), option_values["length"].as<unsigned int>(), random);
+	}
+	if (traces.empty()) {
+		cerr << "No system call sequence to check" << endl;
+		return 1;
+	}
+	unsigned long syscalls = 0;
+	auto start = chrono::steady_clock::now();
+	for (const vector<int>& trace : traces) {
+		LabelWindow history;
+		for (int label : trace) {
+			ngram->learn(executables[label], ngram->getWindow(history, label));
+			ngram->advance(history, label);
+		}
+		syscalls += trace.size();
+	}
+	cout << traces.size() << " sequences with " << syscalls << " system calls, n-gram model learned in "
+	     << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+	// Both checks return the number of system calls accepted before the first anomaly
+	TransitionCache cache(automaton);
+	auto checkNfa = [&automaton, &cache](const vector<int>& trace) {
+		// No ID is kept between two sequences
+		if (cache.isFull()) {
+			cache.clear();
+		}
+		unsigned int states = cache.intern(automaton.getInitialStates());
+		unsigned long accepted = 0;
+		while (accepted < trace.size() && cache.step(states, trace[accepted], states)) {
+			accepted++;
+		}
+		return accepted;
+	};
+	auto checkNgram = [&ngram, &executables](const vector<int>& trace) {
+		LabelWindow history;
+		unsigned long accepted = 0;
+		while (accepted < trace.size() &&
+		       ngram->accepts(executables[trace[accepted]], ngram->getWindow(history, trace[accepted]))) {
+			ngram->advance(history, trace[accepted]);
+			accepted++;
+		}
+		return accepted;
+	};
+	for (const auto& check : { make_pair(string("NFA"), function<unsigned long (const vector<int>&)>(checkNfa)),
+	                           make_pair(string("n-gram"), function<unsigned long (const vector<int>&)>(checkNgram)) }) {
+		unsigned long accepted = 0;
+		start = chrono::steady_clock::now();
+		for (unsigned int i = 0; i < option_values["repeat"].as<unsigned int>(); i++) {
+			accepted = 0;
+			for (const vector<int>& trace : traces) {
+				accepted += check.second(trace);
+			}
+		}
+		auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+		cout << check.first << ": " << accepted << "/" << syscalls << " system calls accepted, "
+		     << (double) elapsed / (double) max(syscalls * option_values["repeat"].as<unsigned int>(), 1UL) << " ns per system call" << endl;
+	}
+	// Every mutated sequence has a single system call replaced by another one of the same executable
+	unsigned long mutations = 0, nfaDetections = 0, ngramDetections = 0;
+	for (const vector<int>& trace : traces) {
+		unsigned long position = random() % trace.size();
+		const vector<int>& candidates = executableLabels[executables[trace[position]]];
+		if (candidates.size() < 2 || checkNfa(trace) < trace.size() || checkNgram(trace) < trace.size()) {
+			continue;
+		}
+		vector<int> mutated(trace);
+		while (mutated[position] == trace[position]) {
+			mutated[position] = candidates[random() % candidates.size()];
+		}
+		mutations++;
+		nfaDetections += checkNfa(mutated) < mutated.size() ? 1 : 0;
+		ngramDetections += checkNgram(mutated) < mutated.size() ? 1 : 0;
+	}
+	cout << "Anomalies detected on " << mutations << " mutated sequences: NFA " << nfaDetections << ", n-gram "
+	     << ngramDetections << endl;
+	cout << "NFA: " << automaton.getStateCount() << " states, " << automaton.getTransitionCount() << " transitions" << endl;
+	cout << "n-gram: " << ngram->getSize() << " windows" << endl;
+	// Merging a model with a copy of itself exercises the whole merge without changing the model
+	unique_ptr<LearnedModel> modelCopy = LearnedModel::load(option_values["nfa"].as<string>(), option_values["associations"].as<string>());
+	unique_ptr<SequenceModel> ngramCopy = SequenceModel::create("ngram", ngram->getWindowSize());
+	if (modelCopy == nullptr || !ngramCopy->merge(*ngram)) {
+		return 1;
+	}
+	start = chrono::steady_clock::now();
+	if (!model->merge(*modelCopy)) {
+		return 1;
+	}
+	auto nfaMerge = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+	start = chrono::steady_clock::now();
+	if (!ngram->merge(*ngramCopy)) {
+		return 1;
+	}
+	auto ngramMerge = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+	cout << "Merge with a copy: NFA " << nfaMerge << " us, n-gram " << ngramMerge << " us" << endl;
+	if (option_values.count("model-path") > 0 && !ngram->save(option_values["model-path"].as<string>())) {
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Generates system call sequences that an automaton accepts, every one follows random transitions from a random
+ * initial state until it reaches a state without transitions or the maximum length.
+ *
+ * @param automaton The automaton.
+ * @param count     The number of sequences.
+ * @param length    The maximum number of labels of every sequence.
+ * @param random    The random number generator.
+ * @return The non empty sequences of labels.
+ */
+vector<vector<int>> PolicyCommands::randomWalks(const CompactAutomaton& automaton, unsigned int count, unsigned int length, mt19937& random) {
+	vector<vector<int>> traces;
+	const StateSet& initials = automaton.getInitialStates();
+	for (unsigned int i = 0; i < count && !initials.empty(); i++) {
+		vector<int> trace;
+		int state = initials[random() % initials.size()];
+		while (trace.size() < length && automaton.getOutDegree(state) > 0) {
+			unsigned int transition = automaton.getFirstTransition(state) + (unsigned int) (random() % automaton.getOutDegree(state));
+			trace.push_back(automaton.getTransitionLabel(transition));
+			state = automaton.getTransitionTarget(transition);
+		}
+		if (!trace.empty()) {
+			traces.push_back(std::move(trace));
+		}
+	}
+	return traces;
+}
+
+/**
+ * Measures the time spent checking sequences as the Authorizer does, through a TransitionCache.
+ * The sequences are checked three times and the fastest round is taken, the first one mostly fills the cache.
+ *
+ * @param automaton The automaton.
+ * @param traces    The sequences of labels, every one of them must be accepted.
+ * @return The average nanoseconds per label, -1 if a sequence is not accepted.
+ */
+double PolicyCommands::measureChecks(const CompactAutomaton& automaton, const vector<vector<int>>& traces) {
+	TransitionCache cache(automaton);
+	double best = -1;
+	for (unsigned int round = 0; round < 3; round++) {
+		unsigned long labels = 0;
+		auto start = chrono::steady_clock::now();
+		for (const vector<int>& trace : traces) {
+			if (cache.isFull()) {
+				cache.clear();
+			}
+			unsigned int states = cache.intern(automaton.getInitialStates());
+			for (int label : trace) {
+				if (!cache.step(states, label, states)) {
+					return -1;
+				}
+			}
+			labels += trace.size();
+		}
+		double elapsed = (double) chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+		best = best < 0 ? elapsed / (double) max(labels, 1UL) : min(best, elapsed / (double) max(labels, 1UL));
+	}
+	return best;
+}
+
+/**
+ * Runs a task for every index in [0, count) on a pool of threads.
+ *
+ * @param count   The number of tasks.
+ * @param threads The maximum number of threads.
+ * @param task    The task, it receives its index and returns False if it failed.
+ * @return True if every task succeeded, False otherwise.
+ */
+bool PolicyCommands::runParallel(unsigned int count, unsigned int threads, const function<bool (unsigned int)>& task) {
+	atomic<unsigned int> next(0);
+	atomic<bool> result(true);
+	boost::thread_group pool;
+	for (unsigned int i = 0; i < min(threads, count); i++) {
+		pool.create_thread([&next, &result, &task, count]() {
+			unsigned int index;
+			while ((index = next++) < count) {
+				if (!task(index)) {
+					result = false;
+				}
+			}
+		});
+	}
+	pool.join_all();
+	return result;
+}
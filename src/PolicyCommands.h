@@ -0,0 +1,29 @@
+#ifndef PTRACER_POLICYCOMMANDS_H
+#define PTRACER_POLICYCOMMANDS_H
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "CompactAutomaton.h"
+
+// Offline commands working on the Authorizer and decoder files, invoked as "ptracer <command> [options]"
+class PolicyCommands {
+public:
+	static bool exists(const std::string& name);
+	static int run(const std::string& name, int argc, const char** argv);
+
+private:
+	static const std::map<std::string, std::function<int (int, const char**)>> commands;
+	static int compilePolicy(int argc, const char** argv);
+	static int merge(int argc, const char** argv);
+	static int bench(int argc, const char** argv);
+	static int optimizePolicy(int argc, const char** argv);
+	static int splitPolicy(int argc, const char** argv);
+	static int extractPayloads(int argc, const char** argv);
+	static std::vector<std::vector<int>> randomWalks(const CompactAutomaton& automaton, unsigned int count, unsigned int length, std::mt19937& random);
+	static double measureChecks(const CompactAutomaton& automaton, const std::vector<std::vector<int>>& traces);
+	static bool runParallel(unsigned int count, unsigned int threads, const std::function<bool (unsigned int)>& task);
+};
+
+#endif //PTRACER_POLICYCOMMANDS_H
@@ -28,7 +28,7 @@ ProcessNotification::ProcessNotification(string notification_origin, int pid, in
  * 
  * @return The executable name.
  */
-string ProcessNotification::getExecutableName() const {
+const string& ProcessNotification::getExecutableName() const {
   return this->notificationOrigin;
 }
 
@@ -136,6 +136,15 @@ shared_ptr<Tracer> ProcessSyscallEntry::getTracer() const {
   return this->tracer;
 }
 
+/**
+ * Tells if this system call has been denied, hence it will not be executed and it will fail with EPERM.
+ *
+ * @return True if the system call has been denied, False otherwise.
+ */
+bool ProcessSyscallEntry::isDenied() const {
+  return this->denied;
+}
+
 /**
  * This sets the syscall number, the list of call parameters and the ProcessState::regs_state pointer.
  * This is the first method to call after the ProcessState creation before the backtrace acquisition.
@@ -13,6 +13,7 @@ class Tracer;
 class ProcessSyscallEntry : public ProcessNotification {
   friend class Tracer;
   friend class TracingManager;
+  friend class AuthorizerTest;
 public:
   static const std::set<int> childGeneratingSyscalls;
   static const std::set<int> exitSyscalls;
@@ -27,6 +28,7 @@ public:
   [[nodiscard]] long long int getReturnValue() const;
   [[nodiscard]] pid_t getChildPid() const;
   [[nodiscard]] std::shared_ptr<Tracer> getTracer() const;
+  [[nodiscard]] bool isDenied() const;
 	[[nodiscard]] unsigned long long int argument(unsigned short int i) const;
 	[[nodiscard]] const std::vector<StackFrame>& getStackFrames() const;
 
@@ -36,6 +38,8 @@ private:
   std::shared_ptr<Registers> regs = nullptr;
 	std::vector<StackFrame> stackFrames;
   pid_t childPid = -1;
+  // When True the system call is skipped and the tracee receives -EPERM instead of its execution
+  bool denied = false;
   void setRegisters(std::shared_ptr<Registers> regs);
 };
 
@@ -20,6 +20,8 @@ public:
   long long int returnValue() const;
   unsigned long long int argument(unsigned short int i) const;
 	unsigned long long int flags() const;
+	void setSyscall(int number);
+	void setReturnValue(long long int value);
 	const iovec* getIovec() const;
   operator std::string() const;
 
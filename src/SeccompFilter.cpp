@@ -0,0 +1,220 @@
+/*
+ * A SeccompFilter compiles an enforced automaton into a seccomp-BPF program that is installed in the tracee
+ * before its execution begins, so that only the system calls that depend on the automaton current state
+ * reach the tracer.
+ * Every system call number is classified as:
+ * SeccompFilter::KILL:  No transition of the automaton is labelled with it, the kernel kills the tracee. This is only
+ *                       right with the kill violation policy: with the deny one it is SeccompFilter::DENY instead, the
+ *                       kernel fails it with EPERM, with the others it is traced so that the policy can be applied.
+ * SeccompFilter::ALLOW: It has a single label and, from every reachable state, all its transitions are self-loops: checking
+ *                       it can neither fail nor move the automaton, so the kernel lets it pass without any stop.
+ * SeccompFilter::TRACE: Everything else, the tracee stops and the Authorizer checks it as usual.
+ * A system call with several labels is always traced, since its labels also encode the stack and the arguments.
+ * Since the ALLOW system calls are never observed they must be treated as transparent labels by the Authorizer.
+ */
+
+#include <algorithm>
+#include <assert.h>
+#include <cerrno>
+#include <cstddef>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/audit.h>
+#include <linux/seccomp.h>
+#include "SeccompFilter.h"
+#include "Tracer.h"
+
+using namespace std;
+
+#if defined(__aarch64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#elif defined(__x86_64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_X86_64
+#endif
+#ifndef SECCOMP_RET_KILL_PROCESS
+#define SECCOMP_RET_KILL_PROCESS SECCOMP_RET_KILL
+#endif
+
+// System calls that the Tracer needs to observe in order to follow children, execve and terminations
+const set<int> SeccompFilter::alwaysTracedSyscalls = { SYS_clone,
+                                                       SYS_clone3,
+#ifdef SYS_fork
+                                                       SYS_fork,
+                                                       SYS_vfork,
+#endif
+                                                       SYS_execve,
+                                                       SYS_execveat,
+                                                       SYS_exit,
+                                                       SYS_exit_group };
+
+/**
+ * Creates a filter that applies the same action to every system call.
+ *
+ * @param unknown The action of every system call number, also of the ones above MAX_SYSCALL_NUMBER.
+ */
+SeccompFilter::SeccompFilter(Action unknown) : unknown(unknown), actions(MAX_SYSCALL_NUMBER + 1, unknown) {
+}
+
+/**
+ * Classifies every system call number according to the transitions of an automaton.
+ * States without outgoing transitions are not considered when looking for system calls allowed everywhere
+ * since they can only be followed by a termination.
+ * A system call is allowed only if the Authorizer would accept it without changing state, otherwise skipping it would
+ * leave the enforcement in a state different from the one the tracee is actually in.
+ *
+ * @param automaton     The automaton that will be enforced, it must not have transparent labels.
+ * @param syscallLabels The automaton labels grouped by system call number.
+ * @param unknown       The action of the system calls that the automaton never allows: SeccompFilter::KILL,
+ *                      SeccompFilter::DENY or SeccompFilter::TRACE, according to the violation policy.
+ * @return The filter with an action for every system call number.
+ */
+SeccompFilter SeccompFilter::fromAutomaton(const CompactAutomaton& automaton,
+                                           const map<int, set<int>>& syscallLabels,
+                                           Action unknown) {
+	assert(unknown != SeccompFilter::ALLOW);
+	SeccompFilter filter(unknown);
+	vector<unsigned char> reachable = automaton.getReachableStates();
+	for (const auto& syscallIt : syscallLabels) {
+		if (syscallIt.first < 0 || syscallIt.first > MAX_SYSCALL_NUMBER) {
+			continue;
+		}
+		// A self-loop from every state is only possible with a single label
+		bool used = false, selfLoops = syscallIt.second.size() == 1;
+		for (unsigned int state = 0; state < automaton.getStateCount(); state++) {
+			if (!reachable[state] || !automaton.getOutDegree((int) state)) {
+				continue;
+			}
+			bool allowed = any_of(syscallIt.second.begin(), syscallIt.second.end(), [&automaton, state](int label) {
+				return automaton.hasTransition((int) state, label);
+			});
+			used = used || allowed;
+			selfLoops = selfLoops && allowed && SeccompFilter::onlySelfLoops(automaton, (int) state, *syscallIt.second.begin());
+		}
+		if (!used) {
+			continue;
+		}
+		if (selfLoops && !SeccompFilter::alwaysTracedSyscalls.contains(syscallIt.first)) {
+			filter.setAction(syscallIt.first, SeccompFilter::ALLOW);
+		} else {
+			filter.setAction(syscallIt.first, SeccompFilter::TRACE);
+		}
+	}
+	return filter;
+}
+
+void SeccompFilter::setAction(int syscall, Action action) {
+	assert(syscall >= 0 && syscall <= MAX_SYSCALL_NUMBER);
+	this->actions[syscall] = action;
+}
+
+SeccompFilter::Action SeccompFilter::getAction(int syscall) const {
+	if (syscall < 0 || syscall > MAX_SYSCALL_NUMBER) {
+		return this->unknown;
+	}
+	return this->actions[syscall];
+}
+
+unsigned int SeccompFilter::count(Action action) const {
+	return (unsigned int) std::count(this->actions.begin(), this->actions.end(), action);
+}
+
+/**
+ * Generates the BPF program: after the architecture check, consecutive system call numbers with the same action
+ * are merged in ranges which are looked up through a binary search, so a system call costs a logarithmic number
+ * of comparisons.
+ *
+ * @return The BPF program ready to be installed with SeccompFilter::install.
+ */
+vector<sock_filter> SeccompFilter::compile() const {
+	vector<pair<unsigned int, Action>> ranges;
+	vector<sock_filter> program = {
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0),
+		BPF_STMT(BPF_RET | BPF_K, SeccompFilter::returnValue(SeccompFilter::KILL)),
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr))
+	};
+	for (unsigned int i = 0; i < this->actions.size(); i++) {
+		if (ranges.empty() || ranges.back().second != this->actions[i]) {
+			ranges.emplace_back(i, this->actions[i]);
+		}
+	}
+	// Every number above MAX_SYSCALL_NUMBER, including the x32 ABI ones, is never allowed
+	if (ranges.back().second != this->unknown) {
+		ranges.emplace_back(MAX_SYSCALL_NUMBER + 1, this->unknown);
+	}
+	SeccompFilter::compileRanges(ranges, 0, ranges.size(), program);
+	return program;
+}
+
+/**
+ * Installs a seccomp filter in the calling thread, it is inherited by every child and kept across execve.
+ * It is meant to be called by the tracee right after the fork.
+ *
+ * @param program The BPF program generated by SeccompFilter::compile.
+ * @return True if the filter has been installed, False otherwise and errno is set.
+ */
+bool SeccompFilter::install(const vector<sock_filter>& program) {
+	sock_fprog filter = { (unsigned short) program.size(), const_cast<sock_filter*>(program.data()) };
+	// Required to install a filter without CAP_SYS_ADMIN
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0)) {
+		return false;
+	}
+	return !syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, 0, &filter);
+}
+
+/**
+ * @param automaton The enforced automaton.
+ * @param state     A state of the automaton.
+ * @param label     A label with at least one transition from state.
+ * @return True if every transition labelled with label from state goes back to state, False otherwise.
+ */
+bool SeccompFilter::onlySelfLoops(const CompactAutomaton& automaton, int state, int label) {
+	unsigned int first = automaton.getFirstTransition(state);
+	for (unsigned int transition = first; transition < first + automaton.getOutDegree(state); transition++) {
+		if (automaton.getTransitionLabel(transition) == label && automaton.getTransitionTarget(transition) != state) {
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned int SeccompFilter::returnValue(Action action) {
+	switch (action) {
+		case SeccompFilter::ALLOW:
+			return SECCOMP_RET_ALLOW;
+		case SeccompFilter::TRACE:
+			return SECCOMP_RET_TRACE;
+		case SeccompFilter::DENY:
+			return SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA);
+		default:
+			return SECCOMP_RET_KILL_PROCESS;
+	}
+}
+
+/**
+ * Appends to program the binary search over ranges[begin, end), every range starts at its number and ends
+ * where the following one begins.
+ */
+void SeccompFilter::compileRanges(const vector<pair<unsigned int, Action>>& ranges,
+                                  unsigned long begin,
+                                  unsigned long end,
+                                  vector<sock_filter>& program) {
+	assert(begin < end);
+	if (end - begin == 1) {
+		program.push_back(BPF_STMT(BPF_RET | BPF_K, SeccompFilter::returnValue(ranges[begin].second)));
+		return;
+	}
+	unsigned long middle = begin + (end - begin) / 2;
+	vector<sock_filter> lower;
+	SeccompFilter::compileRanges(ranges, begin, middle, lower);
+	// Conditional jumps offsets are 8 bits long, bigger lower halves are skipped through an unconditional jump
+	if (lower.size() <= 0xFF) {
+		program.push_back(BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, ranges[middle].first, (unsigned char) lower.size(), 0));
+	} else {
+		program.push_back(BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, ranges[middle].first, 0, 1));
+		program.push_back(BPF_STMT(BPF_JMP | BPF_JA | BPF_K, (unsigned int) lower.size()));
+	}
+	program.insert(program.end(), lower.begin(), lower.end());
+	SeccompFilter::compileRanges(ranges, middle, end, program);
+}
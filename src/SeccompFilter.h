@@ -0,0 +1,41 @@
+#ifndef PTRACER_SECCOMPFILTER_H
+#define PTRACER_SECCOMPFILTER_H
+#include <map>
+#include <set>
+#include <vector>
+#include <linux/filter.h>
+#include "CompactAutomaton.h"
+
+class SeccompFilter {
+public:
+	enum Action {
+		KILL,   // The syscall is never allowed, the tracee is killed by the kernel
+		ALLOW,  // The syscall loops on every state with its only label, the tracee is not stopped
+		TRACE,  // The syscall depends on the current state, the tracee is stopped and the Authorizer is notified
+		DENY    // The syscall is never allowed, the kernel skips it and it fails with EPERM
+	};
+	static const std::set<int> alwaysTracedSyscalls;
+	explicit SeccompFilter(Action unknown = SeccompFilter::KILL);
+	static SeccompFilter fromAutomaton(const CompactAutomaton& automaton,
+	                                   const std::map<int, std::set<int>>& syscallLabels,
+	                                   Action unknown = SeccompFilter::KILL);
+	void setAction(int syscall, Action action);
+	[[nodiscard]] Action getAction(int syscall) const;
+	[[nodiscard]] unsigned int count(Action action) const;
+	[[nodiscard]] std::vector<sock_filter> compile() const;
+	static bool install(const std::vector<sock_filter>& program);
+
+private:
+	// Action of the system calls that the automaton never allows, and of every number above MAX_SYSCALL_NUMBER
+	Action unknown;
+	// Action for every syscall number up to MAX_SYSCALL_NUMBER
+	std::vector<Action> actions;
+	static bool onlySelfLoops(const CompactAutomaton& automaton, int state, int label);
+	static unsigned int returnValue(Action action);
+	static void compileRanges(const std::vector<std::pair<unsigned int, Action>>& ranges,
+	                          unsigned long begin,
+	                          unsigned long end,
+	                          std::vector<sock_filter>& program);
+};
+
+#endif //PTRACER_SECCOMPFILTER_H
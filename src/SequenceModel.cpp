@@ -0,0 +1,54 @@
+#include <stdexcept>
+#include "NGramModel.h"
+#include "SequenceModel.h"
+
+using namespace std;
+
+// Association numbers start from 1 and state 0 is the NFA initial state, hence negative labels are never observed
+const int SequenceModel::START = -1;
+const int SequenceModel::TERMINATION = -2;
+
+/**
+ * Creates an empty model given its name, as given in the command line.
+ *
+ * @param name       Currently only: ngram.
+ * @param windowSize Number of association numbers every check looks at, the current one included.
+ * @return The empty model.
+ * @throw runtime_error If the name is not a valid model or windowSize is not valid for it.
+ */
+unique_ptr<SequenceModel> SequenceModel::create(const string& name, unsigned int windowSize) {
+	if (name == "ngram") {
+		if (windowSize < 1 || windowSize > NGramModel::MAX_SIZE) {
+			throw runtime_error("The n-gram size must be between 1 and " + to_string(NGramModel::MAX_SIZE));
+		}
+		return make_unique<NGramModel>(windowSize);
+	}
+	throw runtime_error("Unknown model " + name + ", it must be one of: nfa, ngram");
+}
+
+/**
+ * Builds the window checked for a new label of a thread.
+ *
+ * @param history The last labels of the thread, as kept by SequenceModel::advance.
+ * @param label   The new label.
+ * @return SequenceModel::getWindowSize labels ending with label, SequenceModel::START where the history is too short.
+ */
+LabelWindow SequenceModel::getWindow(const LabelWindow& history, int label) const {
+	LabelWindow window(this->getWindowSize() - 1 - history.size(), SequenceModel::START);
+	window.insert(window.end(), history.begin(), history.end());
+	window.push_back(label);
+	return window;
+}
+
+/**
+ * Appends a label to the history of a thread, only the labels needed by the next window are kept.
+ *
+ * @param history The last labels of the thread.
+ * @param label   The new label.
+ */
+void SequenceModel::advance(LabelWindow& history, int label) const {
+	history.push_back(label);
+	if (history.size() >= this->getWindowSize()) {
+		history.erase(history.begin(), history.begin() + (long) (history.size() - this->getWindowSize() + 1));
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef PTRACER_SEQUENCEMODEL_H
+#define PTRACER_SEQUENCEMODEL_H
+#include <memory>
+#include <string>
+#include <boost/container/small_vector.hpp>
+
+// Association numbers in the order they have been observed, the oldest first
+typedef boost::container::small_vector<int, 8> LabelWindow;
+
+// A model that authorises every system call looking only at the last association numbers of its thread, the
+// Authorizer uses it in place of the NFA when one is given
+class SequenceModel {
+public:
+	// Placeholder for the labels before the first system call of a thread
+	static const int START;
+	// Label that follows the last system call of a thread, a window ending with it authorises the termination
+	static const int TERMINATION;
+	static std::unique_ptr<SequenceModel> create(const std::string& name, unsigned int windowSize);
+	virtual ~SequenceModel() = default;
+	[[nodiscard]] virtual std::string getName() const = 0;
+	[[nodiscard]] virtual unsigned int getWindowSize() const = 0;
+	virtual bool learn(const std::string& executableName, const LabelWindow& window) = 0;
+	[[nodiscard]] virtual bool accepts(const std::string& executableName, const LabelWindow& window) const = 0;
+	virtual bool merge(const SequenceModel& that) = 0;
+	virtual bool load(const std::string& path) = 0;
+	[[nodiscard]] virtual bool save(const std::string& path) const = 0;
+	[[nodiscard]] virtual unsigned long getSize() const = 0;
+	[[nodiscard]] LabelWindow getWindow(const LabelWindow& history, int label) const;
+	void advance(LabelWindow& history, int label) const;
+};
+
+#endif //PTRACER_SEQUENCEMODEL_H
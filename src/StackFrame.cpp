@@ -7,11 +7,13 @@ StackFrame::StackFrame(unsigned long long int pc,
 						           unsigned long long int relativePc,
 						           unsigned long long int sp,
 						           string functionName,
-						           unsigned long long int functionOffset) : pc(pc),
-                                                                relativePc(relativePc),
-                                                                sp(sp),
-                                                                functionName(functionName),
-                                                                functionOffset(functionOffset){
+						           unsigned long long int functionOffset,
+						           string moduleName) : pc(pc),
+                                                relativePc(relativePc),
+                                                sp(sp),
+                                                functionName(functionName),
+                                                functionOffset(functionOffset),
+                                                moduleName(moduleName) {
 }
 
 StackFrame::operator std::string() const {
@@ -19,5 +21,8 @@ StackFrame::operator std::string() const {
 	if (!this->functionName.empty()) {
 		result += (boost::format(" - %s @ %d") % this->functionName % this->functionOffset).str();
 	}
+	if (!this->moduleName.empty()) {
+		result += " in " + this->moduleName;
+	}
 	return result;
 }
\ No newline at end of file
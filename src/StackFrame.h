@@ -8,11 +8,14 @@ struct StackFrame {
 	const unsigned long long int sp;
 	const std::string functionName;
 	const unsigned long long int functionOffset;
+	// Path of the module the frame belongs to, empty if it has not been resolved
+	const std::string moduleName;
 	StackFrame(unsigned long long int pc,
 	           unsigned long long int relativePc,
 	           unsigned long long int sp,
 	           std::string functionName,
-	           unsigned long long int functionOffset);
+	           unsigned long long int functionOffset,
+	           std::string moduleName = "");
 	operator std::string() const;
 };
 
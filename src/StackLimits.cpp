@@ -0,0 +1,66 @@
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include "StackLimits.h"
+
+using namespace std;
+
+// Starts the line of an associations file that holds its limits, it precedes every section
+const string StackLimits::HEADER = "Stack limits: ";
+// Separates the depth and the excluded modules in the serialised form, it cannot appear in a path given on the command line
+static const char SEPARATOR = '\x1D';
+
+bool StackLimits::operator==(const StackLimits& other) const {
+	return this->depth == other.depth && this->excludedModules == other.excludedModules;
+}
+
+bool StackLimits::operator!=(const StackLimits& other) const {
+	return !(*this == other);
+}
+
+/**
+ * @return True if the whole stack traces are used, as before the limits existed.
+ */
+bool StackLimits::isUnlimited() const {
+	return this->depth == 0 && this->excludedModules.empty();
+}
+
+/**
+ * @return The depth followed by the excluded modules, in a single line without tabs.
+ */
+string StackLimits::serialize() const {
+	string result = to_string(this->depth);
+	for (const string& module : this->excludedModules) {
+		result += SEPARATOR + module;
+	}
+	return result;
+}
+
+/**
+ * @param serialized The output of StackLimits::serialize.
+ * @param result     Where the limits will be stored.
+ * @return True if serialized is well formed, False otherwise.
+ */
+bool StackLimits::parse(const string& serialized, StackLimits& result) {
+	vector<string> tokens;
+	boost::split(tokens, serialized, [](char c) { return c == SEPARATOR; });
+	try {
+		result.depth = boost::lexical_cast<unsigned int>(tokens.front());
+	} catch (boost::bad_lexical_cast&) {
+		return false;
+	}
+	result.excludedModules.assign(tokens.begin() + 1, tokens.end());
+	return true;
+}
+
+StackLimits::operator string() const {
+	if (this->isUnlimited()) {
+		return "whole stack traces";
+	}
+	stringstream result;
+	result << "stack depth " << (this->depth > 0 ? to_string(this->depth) : "unlimited");
+	if (!this->excludedModules.empty()) {
+		result << ", excluded modules " << boost::algorithm::join(this->excludedModules, ", ");
+	}
+	return result.str();
+}
@@ -0,0 +1,23 @@
+#ifndef PTRACER_STACKLIMITS_H
+#define PTRACER_STACKLIMITS_H
+#include <string>
+#include <vector>
+
+// Bounds applied to the stack traces that identify the associations, set with --stack-depth and --stack-exclude.
+// The associations learned with some limits are only matched by system calls unwound with the same ones, so the limits
+// are saved together with the associations, in the compiled policies and in the index of a model directory.
+struct StackLimits {
+	static const std::string HEADER;
+	// Maximum number of frames, 0 if unlimited
+	unsigned int depth = 0;
+	// The frames of the modules which path contains one of these strings are dropped
+	std::vector<std::string> excludedModules;
+	bool operator==(const StackLimits& other) const;
+	bool operator!=(const StackLimits& other) const;
+	[[nodiscard]] bool isUnlimited() const;
+	[[nodiscard]] std::string serialize() const;
+	static bool parse(const std::string& serialized, StackLimits& result);
+	operator std::string() const;
+};
+
+#endif //PTRACER_STACKLIMITS_H
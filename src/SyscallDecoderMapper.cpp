@@ -1,35 +1,90 @@
+#include <algorithm>
 #include <iostream>
+#include <vector>
 #include "SyscallDecoderMapper.h"
+#include "decoders/PayloadWriter.h"
+#include "decoders/SyscallDispatchTable.h"
 
 using namespace std;
 
-map<pid_t, ProcessSyscallDecoderMapper> SyscallDecoderMapper::decoders;
+unordered_map<pid_t, ProcessSyscallDecoderMapper> SyscallDecoderMapper::decoders;
 
 /**
- * Delegates decoding a system call entry to one of the SyscallDecoders registered in the map.
+ * Registers the decoders, if the decoding is enabled, once the capture policy is known.
+ */
+void SyscallDecoderMapper::init() {
+	if (SyscallDecoderMapper::enabled) {
+		SyscallDispatchTable::init();
+	}
+}
+
+/**
+ * Delegates decoding a system call entry to the SyscallDecoder registered for it, the decoders of a process are
+ * created only when it issues a system call that is decoded.
  *
  * @param syscall The syscall that needs to be decoded.
- * @return The result of decoding the syscall or False if any error occurred.
+ * @return The result of decoding the syscall or False if no decoder is registered or any error occurred.
  */
 bool SyscallDecoderMapper::decode(const ProcessSyscallEntry& syscall) {
 	if (!SyscallDecoderMapper::enabled) {
 		// TODO: Improve this
 		return true;
 	}
-	return SyscallDecoderMapper::decoders[syscall.getPid()].decode(syscall);
+	const SyscallDispatchTable::Slot& slot = SyscallDispatchTable::get(syscall.getSyscall());
+	if (slot.entry == nullptr) {
+		return false;
+	}
+	return slot.entry(SyscallDecoderMapper::decoders[syscall.getPid()].getDecoder(slot.entryDecoder), syscall);
 }
 
 /**
- * Delegates decoding a system call exit to one of the SyscallDecoders registered in the map.
+ * Delegates decoding a system call exit to the SyscallDecoder registered for it.
  *
  * @param syscall The syscall exit that needs to be decoded.
- * @return The result of decoding the syscall or False if any error occurred.
+ * @return The result of decoding the syscall or False if no decoder is registered or any error occurred.
  */
 bool SyscallDecoderMapper::decode(const ProcessSyscallExit& syscall) {
 	if (!SyscallDecoderMapper::enabled) {
 		return true;
 	}
-	return SyscallDecoderMapper::decoders[syscall.getPid()].decode(syscall);
+	const SyscallDispatchTable::Slot& slot = SyscallDispatchTable::get(syscall.getSyscall());
+	if (slot.exit == nullptr) {
+		return false;
+	}
+	return slot.exit(SyscallDecoderMapper::decoders[syscall.getPid()].getDecoder(slot.exitDecoder), syscall);
+}
+
+/**
+ * Gives a new process the file descriptors of its parent, before it issues any system call.
+ *
+ * @param parent The PID of the process that forked.
+ * @param child  The PID of the new process.
+ */
+void SyscallDecoderMapper::fork(pid_t parent, pid_t child) {
+	if (!SyscallDecoderMapper::enabled) {
+		return;
+	}
+	// The child is inserted first, the insertion may rehash the map and invalidate any iterator to the parent
+	ProcessSyscallDecoderMapper& childDecoders = SyscallDecoderMapper::decoders.try_emplace(child).first->second;
+	auto it = SyscallDecoderMapper::decoders.find(parent);
+	if (it != SyscallDecoderMapper::decoders.end()) {
+		childDecoders.inherit(it->second);
+	}
+}
+
+/**
+ * Notifies the decoders of a process that it successfully executed a new program.
+ *
+ * @param pid The PID of the process.
+ */
+void SyscallDecoderMapper::exec(pid_t pid) {
+	if (!SyscallDecoderMapper::enabled) {
+		return;
+	}
+	auto it = SyscallDecoderMapper::decoders.find(pid);
+	if (it != SyscallDecoderMapper::decoders.end()) {
+		it->second.exec();
+	}
 }
 
 /**
@@ -39,11 +94,19 @@ void SyscallDecoderMapper::printReport() {
 	if (!SyscallDecoderMapper::enabled) {
 		return;
 	}
+	// The reports count the bytes written, including the payloads still queued
+	PayloadWriter::stop();
 	cout << "------------------ SYSCALL DECODERS REPORT START ------------------" << endl;
-	for (auto process : SyscallDecoderMapper::decoders) {
-		cout << "------------------ PID " << process.first << " START ------------------" << endl;
-		process.second.printReport();
-		cout << "------------------ PID " << process.first << " STOP ------------------" << endl;
+	vector<pid_t> pids;
+	for (const auto& process : SyscallDecoderMapper::decoders) {
+		pids.push_back(process.first);
+	}
+	sort(pids.begin(), pids.end());
+	for (pid_t pid : pids) {
+		cout << "------------------ PID " << pid << " START ------------------" << endl;
+		SyscallDecoderMapper::decoders.at(pid).printReport();
+		cout << "------------------ PID " << pid << " STOP ------------------" << endl;
 	}
+	PayloadWriter::printReport();
 	cout << "------------------ SYSCALL DECODERS REPORT STOP ------------------" << endl;
 }
@@ -1,19 +1,22 @@
 #ifndef PTRACER_SYSCALLDECODERMAPPER_H
 #define PTRACER_SYSCALLDECODERMAPPER_H
 
-#include <map>
+#include <unordered_map>
 #include "ProcessSyscallEntry.h"
 #include "decoders/ProcessSyscallDecoderMapper.h"
 #include "decoders/SyscallDecoder.h"
 
 class SyscallDecoderMapper {
 public:
+	static void init();
 	static bool decode(const ProcessSyscallEntry& syscall);
 	static bool decode(const ProcessSyscallExit& syscall);
+	static void fork(pid_t parent, pid_t child);
+	static void exec(pid_t pid);
 	static void printReport();
 	inline static bool enabled;
 private:
-	static std::map<pid_t, ProcessSyscallDecoderMapper> decoders;
+	static std::unordered_map<pid_t, ProcessSyscallDecoderMapper> decoders;
 };
 
 #endif //PTRACER_SYSCALLDECODERMAPPER_H
@@ -0,0 +1,221 @@
+/*
+ * When backtraces are disabled every association is just a system call number of the traced executable, hence the
+ * learned automaton is fully described by which system call can follow which: a row for every system call plus one
+ * for the threads that have not executed any yet. Every check is then a single bit test on the row of the last
+ * system call of the thread, without building and looking up a ProcessSyscallEntryDTO.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include "SyscallMatrix.h"
+#include "Tracer.h"
+
+using namespace std;
+
+const int SyscallMatrix::INITIAL = MAX_SYSCALL_NUMBER + 1;
+const unsigned int SyscallMatrix::ROWS = MAX_SYSCALL_NUMBER + 2;
+const unsigned int SyscallMatrix::WORDS = (MAX_SYSCALL_NUMBER + 1 + 63) / 64;
+
+/**
+ * Converts an automaton in a matrix, it is possible only if the automaton has been learned without backtraces:
+ * every association belongs to the same executable and has the synthetic frame of its system call, every transition
+ * leads to the state of its label and no initial state is also an association.
+ *
+ * @param automaton    The NFA whose states are the association numbers.
+ * @param associations The associations of automaton.
+ * @param result       Where the matrix will be written.
+ * @return True if the automaton has been converted, False if it cannot be represented by a matrix.
+ */
+bool SyscallMatrix::fromAutomaton(const CompactAutomaton& automaton, const Mapper& associations, SyscallMatrix& result) {
+	SyscallMatrix matrix;
+	map<int, int> labelRows;
+	if (associations.getAssociations().size() != 1) {
+		return false;
+	}
+	const auto& executableIt = *associations.getAssociations().begin();
+	matrix.executable = executableIt.first;
+	for (const auto& i : executableIt.second.left) {
+		int syscall = i.second.getSyscall();
+		if (!i.second.hasSyntheticFrame() || syscall < 0 || syscall >= SyscallMatrix::INITIAL || matrix.rowLabels[syscall] >= 0) {
+			return false;
+		}
+		matrix.rowLabels[syscall] = (int) i.first;
+		labelRows[(int) i.first] = syscall;
+	}
+	matrix.initials = set<int>(automaton.getInitialStates().begin(), automaton.getInitialStates().end());
+	for (int state : matrix.initials) {
+		if (labelRows.find(state) != labelRows.end()) {
+			return false;
+		}
+	}
+	for (unsigned int state = 0; state < automaton.getStateCount(); state++) {
+		auto labelRow = labelRows.find((int) state);
+		// Every transition leads to an association, so any other state is unreachable
+		if (matrix.initials.find((int) state) == matrix.initials.end() && labelRow == labelRows.end()) {
+			continue;
+		}
+		int row = labelRow != labelRows.end() ? labelRow->second : SyscallMatrix::INITIAL;
+		unsigned int first = automaton.getFirstTransition((int) state);
+		for (unsigned int i = first; i < first + automaton.getOutDegree((int) state); i++) {
+			auto target = labelRows.find(automaton.getTransitionLabel(i));
+			if (target == labelRows.end() || automaton.getTransitionTarget(i) != automaton.getTransitionLabel(i)) {
+				return false;
+			}
+			matrix.allow(row, target->second);
+		}
+		if (automaton.isFinalState((int) state)) {
+			matrix.finals[row] = 1;
+		}
+	}
+	result = std::move(matrix);
+	return true;
+}
+
+/**
+ * Reads a matrix written by SyscallMatrix::serialize on a machine with the same byte order.
+ *
+ * @param data   The serialised matrix.
+ * @param size   The size of data.
+ * @param result Where the matrix will be written.
+ * @return True if data is a valid matrix for this MAX_SYSCALL_NUMBER, False otherwise.
+ */
+bool SyscallMatrix::deserialize(const char* data, unsigned long size, SyscallMatrix& result) {
+	uint32_t counts[4];
+	SyscallMatrix matrix;
+	if (size < sizeof(counts)) {
+		return false;
+	}
+	memcpy(counts, data, sizeof(counts));
+	if (counts[0] != SyscallMatrix::ROWS || counts[1] != SyscallMatrix::WORDS ||
+	    size != sizeof(counts) + SyscallMatrix::ROWS * (SyscallMatrix::WORDS * sizeof(uint64_t) + sizeof(int) + 1) +
+	            (unsigned long) counts[2] * sizeof(int) + counts[3]) {
+		return false;
+	}
+	data += sizeof(counts);
+	memcpy(matrix.bits.data(), data, matrix.bits.size() * sizeof(uint64_t));
+	data += matrix.bits.size() * sizeof(uint64_t);
+	memcpy(matrix.rowLabels.data(), data, matrix.rowLabels.size() * sizeof(int));
+	data += matrix.rowLabels.size() * sizeof(int);
+	memcpy(matrix.finals.data(), data, matrix.finals.size());
+	data += matrix.finals.size();
+	for (uint32_t i = 0; i < counts[2]; i++, data += sizeof(int)) {
+		int state;
+		memcpy(&state, data, sizeof(int));
+		matrix.initials.insert(state);
+	}
+	matrix.executable.assign(data, counts[3]);
+	result = std::move(matrix);
+	return true;
+}
+
+/**
+ * Appends the matrix to a buffer: rows, words per row, initial states and executable name length as 32 bit
+ * integers, then the bits, the row labels, the final rows, the initial states and the executable name.
+ *
+ * @param out The buffer where the matrix will be appended.
+ */
+void SyscallMatrix::serialize(string& out) const {
+	uint32_t counts[4] = { SyscallMatrix::ROWS, SyscallMatrix::WORDS, (uint32_t) this->initials.size(), (uint32_t) this->executable.size() };
+	vector<int> initialStates(this->initials.begin(), this->initials.end());
+	out.append((const char*) counts, sizeof(counts));
+	out.append((const char*) this->bits.data(), this->bits.size() * sizeof(uint64_t));
+	out.append((const char*) this->rowLabels.data(), this->rowLabels.size() * sizeof(int));
+	out.append((const char*) this->finals.data(), this->finals.size());
+	out.append((const char*) initialStates.data(), initialStates.size() * sizeof(int));
+	out += this->executable;
+}
+
+/**
+ * Builds a copy of the matrix where some labels are never observed, as CompactAutomaton::withTransparentLabels does:
+ * every row can be followed by the system calls that follow it through any path of transparent system calls and it
+ * is final if any row of such paths is final.
+ *
+ * @param transparentLabels The association numbers that will never be observed.
+ * @return The matrix used to check the observed system calls only.
+ */
+SyscallMatrix SyscallMatrix::withTransparentLabels(const set<int>& transparentLabels) const {
+	SyscallMatrix result = *this;
+	vector<int> transparentRows;
+	for (int row = 0; row < SyscallMatrix::INITIAL; row++) {
+		if (this->rowLabels[row] >= 0 && transparentLabels.find(this->rowLabels[row]) != transparentLabels.end()) {
+			transparentRows.push_back(row);
+		}
+	}
+	if (transparentRows.empty()) {
+		return result;
+	}
+	vector<unsigned char> closure(SyscallMatrix::ROWS);
+	vector<int> pending;
+	for (int row = 0; row <= SyscallMatrix::INITIAL; row++) {
+		uint64_t* resultRow = result.bits.data() + (unsigned long) row * SyscallMatrix::WORDS;
+		fill(closure.begin(), closure.end(), 0);
+		closure[row] = 1;
+		pending.assign(1, row);
+		while (!pending.empty()) {
+			int current = pending.back();
+			pending.pop_back();
+			result.finals[row] |= this->finals[current];
+			for (unsigned int i = 0; i < SyscallMatrix::WORDS; i++) {
+				resultRow[i] |= this->bits[(unsigned long) current * SyscallMatrix::WORDS + i];
+			}
+			for (int transparent : transparentRows) {
+				int next = current;
+				if (!closure[transparent] && this->step(next, transparent)) {
+					closure[transparent] = 1;
+					pending.push_back(transparent);
+				}
+			}
+		}
+		for (int transparent : transparentRows) {
+			resultRow[transparent / 64] &= ~(1ULL << (transparent % 64));
+		}
+	}
+	return result;
+}
+
+bool SyscallMatrix::isFinal(int row) const {
+	return this->finals[row] != 0;
+}
+
+/**
+ * Gets the states of the automaton that correspond to a row.
+ *
+ * @param row A system call number or SyscallMatrix::INITIAL.
+ * @return The initial states for SyscallMatrix::INITIAL, the association of the system call otherwise.
+ */
+set<int> SyscallMatrix::getStates(int row) const {
+	if (row == SyscallMatrix::INITIAL) {
+		return this->initials;
+	}
+	return this->rowLabels[row] >= 0 ? set<int>({ this->rowLabels[row] }) : set<int>();
+}
+
+/**
+ * Gets the row that corresponds to a set of states of the automaton, the inverse of SyscallMatrix::getStates.
+ *
+ * @param states The states of the automaton.
+ * @return The row of states, -1 if they do not correspond to any row.
+ */
+int SyscallMatrix::getRow(const set<int>& states) const {
+	if (states == this->initials) {
+		return SyscallMatrix::INITIAL;
+	}
+	if (states.size() != 1) {
+		return -1;
+	}
+	auto it = find(this->rowLabels.begin(), this->rowLabels.begin() + SyscallMatrix::INITIAL, *states.begin());
+	return it != this->rowLabels.begin() + SyscallMatrix::INITIAL ? (int) (it - this->rowLabels.begin()) : -1;
+}
+
+const string& SyscallMatrix::getExecutable() const {
+	return this->executable;
+}
+
+unsigned int SyscallMatrix::getTransitionCount() const {
+	unsigned int count = 0;
+	for (uint64_t word : this->bits) {
+		count += (unsigned int) __builtin_popcountll(word);
+	}
+	return count;
+}
@@ -0,0 +1,60 @@
+#ifndef PTRACER_SYSCALLMATRIX_H
+#define PTRACER_SYSCALLMATRIX_H
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+#include "CompactAutomaton.h"
+#include "Mapper.h"
+
+// Automaton learned without backtraces, stored as a bit matrix of the system calls that can follow each system call
+class SyscallMatrix {
+public:
+	// Row of a traced thread that has not executed any system call yet
+	static const int INITIAL;
+	SyscallMatrix() = default;
+	static bool fromAutomaton(const CompactAutomaton& automaton, const Mapper& associations, SyscallMatrix& result);
+	static bool deserialize(const char* data, unsigned long size, SyscallMatrix& result);
+	void serialize(std::string& out) const;
+	[[nodiscard]] SyscallMatrix withTransparentLabels(const std::set<int>& transparentLabels) const;
+
+	/**
+	 * Moves a traced thread from the row of its last system call to the row of the next one.
+	 *
+	 * @param row     The row of the last system call, it becomes syscall if the transition exists.
+	 * @param syscall The system call number.
+	 * @return True if syscall can follow the last system call, False otherwise.
+	 */
+	inline bool step(int& row, long syscall) const {
+		if (syscall < 0 || syscall >= SyscallMatrix::INITIAL ||
+		    !((this->bits[(unsigned long) row * SyscallMatrix::WORDS + syscall / 64] >> (syscall % 64)) & 1)) {
+			return false;
+		}
+		row = (int) syscall;
+		return true;
+	}
+
+	[[nodiscard]] bool isFinal(int row) const;
+	[[nodiscard]] std::set<int> getStates(int row) const;
+	[[nodiscard]] int getRow(const std::set<int>& states) const;
+	[[nodiscard]] const std::string& getExecutable() const;
+	[[nodiscard]] unsigned int getTransitionCount() const;
+
+private:
+	static const unsigned int ROWS;
+	static const unsigned int WORDS;
+	// ROWS x WORDS words, bit s of row r is set if the system call s can follow the system call r
+	std::vector<uint64_t> bits = std::vector<uint64_t>(SyscallMatrix::ROWS * SyscallMatrix::WORDS, 0);
+	std::vector<unsigned char> finals = std::vector<unsigned char>(SyscallMatrix::ROWS, 0);
+	// Association number of the system call of every row, -1 if it has none
+	std::vector<int> rowLabels = std::vector<int>(SyscallMatrix::ROWS, -1);
+	// Initial states of the automaton, they are the SyscallMatrix::INITIAL row
+	std::set<int> initials;
+	// The only executable of the associations, the system calls of any other executable are never authorised
+	std::string executable;
+	inline void allow(int row, int syscall) {
+		this->bits[(unsigned long) row * SyscallMatrix::WORDS + syscall / 64] |= 1ULL << (syscall % 64);
+	}
+};
+
+#endif //PTRACER_SYSCALLMATRIX_H
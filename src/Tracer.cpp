@@ -28,11 +28,15 @@
 #include <string.h>
 #include <memory>
 #include <sys/syscall.h>
+#include <sys/uio.h>
 #include <elf.h>
 #include <future>
+#include <atomic>
+#include <climits>
 #include "Backtracer.h"
 #include "Launcher.h"
 #include "SyscallDecoderMapper.h"
+#include "SeccompFilter.h"
 #include "SyscallNameResolver.h"
 #include "Tracer.h"
 #include "TracingManager.h"
@@ -40,6 +44,7 @@
 using namespace std;
 
 const unsigned int Tracer::MAXIMUM_PROCESS_NAME_LENGTH = 256; // Could be expanded up to PATH_MAX
+atomic<bool> Tracer::vmReadv { true };
 
 /**
  * Construct a Tracer that will exec a new traced process according to the provided parameters.
@@ -151,12 +156,16 @@ Tracer::Tracer(const Tracer& tracer, const int pid, const int spid) : tracedExec
                                                                       args(tracer.args),
                                                                       backtrace(tracer.backtrace),
                                                                       ptraceOptions(tracer.ptraceOptions),
+                                                                      seccomp(tracer.seccomp),
+                                                                      stackDepth(tracer.stackDepth),
+                                                                      excludedModules(tracer.excludedModules),
                                                                       backtracer(Backtracer::getInstance()) {
 	assert(pid > 0 && pid < Tracer::MAX_PID);
 	assert(spid > 0 && spid < Tracer::MAX_PID);
 	assert(pid != spid || (tracer.ptraceOptions & (PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK)));
 	assert(pid == spid || (tracer.ptraceOptions & PTRACE_O_TRACECLONE));
 	assert(!tracer.tracedExecutable.empty());
+	this->backtracer->setLimits(this->stackDepth, this->excludedModules);
 	this->tracedPid = pid;
 	this->tracedSpid = spid;
 	this->running = true;
@@ -297,16 +306,16 @@ int Tracer::handle(int status) {
 		this->handleExecve(regs);
 		assert(regs->syscall() == SYS_execve);
 		assert(!regs->returnValue());
-		if (ptrace(PTRACE_SYSCALL, this->tracedSpid, nullptr, 0)) {
+		this->entryState = nullptr;
+		this->terminationState = nullptr;
+		if (this->resume()) {
 			PERROR("Ptrace error while trying to proceed from an execve exit notification of SPID " + to_string(this->tracedSpid));
 			return Tracer::PTRACE_ERROR;
 		}
-		this->entryState = nullptr;
-		this->terminationState = nullptr;
 		return Tracer::EXECVE_SYSCALL;
 	}
 	if (!this->running) {
-		if (ptrace(PTRACE_SYSCALL, this->tracedSpid, nullptr, 0)) {
+		if (this->resume()) {
 			PERROR("Ptrace error occurred while trying to continue from a special case of SPID " + to_string(this->tracedSpid));
 			return Tracer::PTRACE_ERROR;
 		}
@@ -315,11 +324,11 @@ int Tracer::handle(int status) {
 	assert(this->terminationState == nullptr);
 	switch (returnValue = this->handleSpecialCases(status, regs)) {
 		case Tracer::SYSCALL_HANDLED:
-			if (ptrace(PTRACE_SYSCALL, this->tracedSpid, nullptr, 0)) {
+			this->entryState = nullptr;
+			if (this->resume()) {
 				PERROR("Ptrace error occurred while trying to continue from a special caseof SPID " + to_string(this->tracedSpid));
 				return Tracer::PTRACE_ERROR;
 			}
-			this->entryState = nullptr;
 			return 0;
 		case Tracer::EXECVE_SYSCALL:
 			if (!this->syscallExit(status, regs)) {
@@ -327,7 +336,7 @@ int Tracer::handle(int status) {
 			}
 			return Tracer::PTRACE_ERROR;
 		case Tracer::IMMINENT_EXIT:
-			if (ptrace(PTRACE_SYSCALL, this->tracedSpid, nullptr, 0)) {
+			if (this->resume()) {
 				PERROR("Ptrace error while trying to proceed from a termination notification of SPID " + to_string(this->tracedSpid));
 				return Tracer::PTRACE_ERROR;
 			}
@@ -337,6 +346,14 @@ int Tracer::handle(int status) {
 		default:
 			return returnValue;
 	}
+	// With a seccomp filter only the syscalls that need to be checked stop the tracee, this stop replaces the syscall entry one
+	if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_SECCOMP << 8))) {
+		if (this->entryState) {
+			cerr << "The syscall number " << this->entryState->getSyscall() << " of SPID " << this->tracedSpid << " is assumed to never return" << endl;
+			this->entryState = nullptr;
+		}
+		return this->syscallEntry(status, regs);
+	}
 	// Only System call traps have bit 7 in the signal number
 	if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
 		if (this->handleSignal(status) == nullptr) {
@@ -381,6 +398,56 @@ int Tracer::proceed() {
 	return 0;
 }
 
+/**
+ * Let the Tracee proceed without executing the System call it is stopped at, the System call fails with EPERM.
+ * The syscall exit notification is still generated.
+ *
+ * @return Returns: 0 If there were no errors.
+ *                  Tracer::PTRACE_ERROR If a ptrace error occurred.
+ *                  Tracer::GENERIC_ERROR If this tracee is dead or it is not waiting for a green light.
+ */
+int Tracer::deny() {
+	assert(TracingManager::workerSpid == syscall(SYS_gettid));
+	assert(this->tracedSpid > 0 && this->tracedSpid < Tracer::MAX_PID);
+	assert(this->tracedPid > 0 && this->tracedPid < Tracer::MAX_PID);
+	if (!this->running) {
+		cerr << "Impossible to deny a syscall of a dead tracee! Tracee SPID: " << this->tracedSpid << endl;
+		return Tracer::GENERIC_ERROR;
+	} else if (!this->attached) {
+		cerr << "Impossible to deny a syscall of a not attached tracee! Tracee SPID: " << this->tracedSpid << endl;
+		return Tracer::GENERIC_ERROR;
+	}
+	assert(this->entryState != nullptr);
+	assert(this->entryState->authorised && this->entryState->denied);
+	Registers regs;
+	if (ptrace(PTRACE_GETREGSET, this->tracedSpid, NT_PRSTATUS, regs.getIovec())) {
+		PERROR("Ptrace error occurred while trying to GETREGS from the process SPID " + to_string(this->tracedSpid) + " in order to deny a syscall");
+		return Tracer::PTRACE_ERROR;
+	}
+	// A syscall number equal to -1 makes the kernel skip the syscall leaving the return value untouched
+	regs.setSyscall(-1);
+	regs.setReturnValue(-EPERM);
+	if (ptrace(PTRACE_SETREGSET, this->tracedSpid, NT_PRSTATUS, regs.getIovec())) {
+		PERROR("Ptrace error occurred while trying to SETREGS in the process SPID " + to_string(this->tracedSpid) + " in order to deny a syscall");
+		return Tracer::PTRACE_ERROR;
+	}
+#ifdef ARCH_AARCH64
+	int syscallNumber = -1;
+	iovec syscallIo = { &syscallNumber, sizeof(syscallNumber) };
+	if (ptrace(PTRACE_SETREGSET, this->tracedSpid, NT_ARM_SYSTEM_CALL, &syscallIo)) {
+		PERROR("Ptrace error occurred while trying to change the syscall number of the process SPID " + to_string(this->tracedSpid));
+		return Tracer::PTRACE_ERROR;
+	}
+#endif
+	cout << "The syscall number " << this->entryState->getSyscall() << " of SPID " << this->tracedSpid << " has been denied" << endl;
+	if (this->resume()) {
+		PERROR("Ptrace error occurred while trying to continue from the denied syscall number " + to_string(this->entryState->getSyscall()) +
+		       " entry notification in SPID " + to_string(this->tracedSpid));
+		return Tracer::PTRACE_ERROR;
+	}
+	return 0;
+}
+
 /**
  * Initialize the Tracer: Starts the tracee according to program and args if a SPID has not been provided,
  * otherwise performs an attach to the already running tracee.
@@ -444,7 +511,7 @@ int Tracer::init(int status) {
 	//cout << "Tracer SPID: " << this->_traced_spid << " first syscall number: " << regs.nsyscall() << " return: " << regs.ret_arg() << endl;
 #endif
 	// Entry notification received, go ahead
-	if (ptrace(PTRACE_SYSCALL, this->tracedSpid, nullptr, 0)) {
+	if (this->resume()) {
 		PERROR("Ptrace error occurred while trying to SYSCALL after the first system call of SPID " + to_string(this->tracedSpid));
 		return Tracer::PTRACE_ERROR;
 	}
@@ -489,6 +556,37 @@ void Tracer::waitForAttach() {
 	}
 }
 
+/**
+ * Sets a seccomp filter that will be installed in the tracee before its execution begins.
+ * From then on the tracee is resumed with PTRACE_CONT and stops only on the syscalls trapped by the filter,
+ * it can only be used when the Tracer executes the tracee.
+ *
+ * @param filter The BPF program generated by SeccompFilter::compile.
+ */
+void Tracer::setSeccompFilter(vector<sock_filter> filter) {
+	assert(!this->running && !this->attached);
+	assert(this->ptraceOptions >= 0);
+	this->seccompFilter = move(filter);
+	this->seccomp = !this->seccompFilter.empty();
+	if (this->seccomp) {
+		this->ptraceOptions |= PTRACE_O_TRACESECCOMP;
+	}
+}
+
+/**
+ * Limits the stack frames of every syscall, and hence of its association, to the innermost ones that matter.
+ * The limits are inherited by the Tracers of the new threads and processes, it must be called before Tracer::init.
+ *
+ * @param depth           The maximum number of frames, 0 for no limit.
+ * @param excludedModules The frames of the modules which path contains one of these strings are dropped.
+ */
+void Tracer::setStackLimits(unsigned int depth, vector<string> excludedModules) {
+	assert(!this->attached);
+	this->stackDepth = depth;
+	this->excludedModules = move(excludedModules);
+	this->backtracer->setLimits(this->stackDepth, this->excludedModules);
+}
+
 /**
  * Extracts a NULL terminated string from the tracee address space.
  *
@@ -528,32 +626,110 @@ string Tracer::extractString(unsigned long long int address, unsigned int maxLen
 	return resultStr;
 }
 
+/**
+ * Copies bytes from the tracee address space in a new buffer.
+ *
+ * @param address   Starting address in the tracee memory.
+ * @param maxLength The number of bytes to copy.
+ * @return The bytes, to be released with delete[], or nullptr if they cannot be read.
+ */
 unsigned char* Tracer::extractBytes(unsigned long long int address, unsigned int maxLength) const {
 	if (maxLength <= 0 || address <= 0) {
 		return nullptr;
 	}
-	assert(maxLength > 0 && address > 0);
+	unique_ptr<unsigned char[]> buffer(new unsigned char[maxLength]);
+	if (!this->readMemory(address, buffer.get(), maxLength)) {
+		return nullptr;
+	}
+	return buffer.release();
+}
+
+/**
+ * Copies bytes from the tracee address space straight where they are needed, with process_vm_readv when the kernel
+ * allows it and one word at a time with ptrace otherwise.
+ *
+ * @param address     Starting address in the tracee memory.
+ * @param destination Where the bytes will be copied, it must hold length bytes.
+ * @param length      The number of bytes to copy.
+ * @return True if every byte has been copied, False otherwise.
+ */
+bool Tracer::readMemory(unsigned long long int address, void* destination, size_t length) const {
 	assert(this->running);
 	assert(this->attached);
 	assert(this->tracedPid > 0 && this->tracedPid < Tracer::MAX_PID);
 	assert(this->tracedSpid > 0 && this->tracedSpid < Tracer::MAX_PID);
+	if (length == 0 || address == 0) {
+		return length == 0;
+	}
+	size_t done = 0;
+	while (Tracer::vmReadv && done < length) {
+		iovec local { (char*) destination + done, length - done };
+		iovec remote { (void*) (address + done), length - done };
+		ssize_t result = process_vm_readv(this->tracedSpid, &local, 1, &remote, 1, 0);
+		if (result > 0) {
+			done += (size_t) result;
+			continue;
+		}
+		if (result < 0 && errno == ENOSYS) {
+			Tracer::vmReadv = false;
+		}
+		// Either an unreadable page, which ptrace reports too, or process_vm_readv is not allowed
+		break;
+	}
 	union chunk_t {
 		long value;
 		char chars[sizeof(long)];
 	} chunk;
-	unsigned char* buffer = new unsigned char[maxLength];
-	unsigned int i = 0;
-	errno = 0;
-	do {
-		chunk.value = ptrace(PTRACE_PEEKDATA, this->tracedSpid, address + i, nullptr);
+	while (done < length) {
+		errno = 0;
+		chunk.value = ptrace(PTRACE_PEEKDATA, this->tracedSpid, address + done, nullptr);
 		if (errno) {
 			PERROR("Error while extracting bytes from SPID " + to_string(this->tracedSpid));
-			return nullptr;
+			return false;
 		}
-		memcpy(buffer + i, chunk.chars, min(maxLength - i, (unsigned int) sizeof(chunk)));
-		i += sizeof(chunk);
-	} while (i < maxLength);
-	return buffer;
+		memcpy((char*) destination + done, chunk.chars, min(length - done, sizeof(chunk)));
+		done += sizeof(chunk);
+	}
+	return true;
+}
+
+/**
+ * Gathers scattered areas of the tracee address space one after the other, with a single process_vm_readv for up to
+ * IOV_MAX areas when the kernel allows it.
+ *
+ * @param segments    The tracee memory areas, in order.
+ * @param count       The number of areas.
+ * @param destination Where the bytes will be copied, it must hold the length of every area.
+ * @return True if every byte has been copied, False otherwise.
+ */
+bool Tracer::readMemory(const iovec* segments, size_t count, void* destination) const {
+	char* output = (char*) destination;
+	size_t segment = 0;
+	while (Tracer::vmReadv && segment < count) {
+		size_t batch = min(count - segment, (size_t) IOV_MAX);
+		size_t length = 0;
+		for (size_t i = segment; i < segment + batch; i++) {
+			length += segments[i].iov_len;
+		}
+		iovec local { output, length };
+		ssize_t result = process_vm_readv(this->tracedSpid, &local, 1, segments + segment, batch, 0);
+		if (result < 0 && errno == ENOSYS) {
+			Tracer::vmReadv = false;
+		}
+		if (result != (ssize_t) length) {
+			// The areas of an incomplete batch are read again one at a time
+			break;
+		}
+		output += length;
+		segment += batch;
+	}
+	for (; segment < count; segment++) {
+		if (!this->readMemory((unsigned long long) segments[segment].iov_base, output, segments[segment].iov_len)) {
+			return false;
+		}
+		output += segments[segment].iov_len;
+	}
+	return true;
 }
 
 /**
@@ -580,6 +756,14 @@ int Tracer::execProgram() {
 			PERROR("Ptrace error while trying to set TRACEME in the child SPID " + to_string(this->tracedSpid));
 			return Tracer::PTRACE_ERROR;
 		}
+		if (this->seccomp) {
+			// Wait for the ptrace options to be set, otherwise the traced syscalls would fail with ENOSYS
+			raise(SIGSTOP);
+			if (!SeccompFilter::install(this->seccompFilter)) {
+				PERROR("Impossible to install the seccomp filter in the child");
+				_exit(-1);
+			}
+		}
 		// The following will notify the parent that a sys_entry happened
 		execvp(this->program, const_cast<char**>(this->args));
 		PERROR("Impossible to execute the child process");
@@ -590,10 +774,22 @@ int Tracer::execProgram() {
 	this->tracedSpid = pid;
 	this->running = true;
 	this->attached = true;
+	this->firstExec = this->seccomp;
 	this->conditionAttach.notify_all();
 	return 0;
 }
 
+/**
+ * Lets the tracee go on until its next notification.
+ * With a seccomp filter the tracee is stopped at a syscall exit only if it has been stopped at its entry.
+ *
+ * @param signal The signal to deliver to the tracee, 0 if none.
+ * @return The ptrace return value.
+ */
+long Tracer::resume(int signal) const {
+	return ptrace(this->seccomp && this->entryState == nullptr ? PTRACE_CONT : PTRACE_SYSCALL, this->tracedSpid, nullptr, signal);
+}
+
 /**
  * Attach through ptrace to the tracee.
  * If Tracer::_attach_callback is specified it will be called.
@@ -699,6 +895,8 @@ int Tracer::handleSpecialCases(int status, shared_ptr<Registers> regs) {
 			returnValue = TracingManager::handleChildren(*this, this->tracedPid, (pid_t) this->entryState->returnValue);
 		} else if (this->ptraceOptions & (PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK)) {
 			this->entryState->childPid = (pid_t) this->entryState->returnValue;
+			// Also a child created with CLONE_FILES gets a copy, the table is not shared
+			SyscallDecoderMapper::fork(this->tracedPid, this->entryState->childPid);
 			returnValue = TracingManager::handleChildren(*this,
 			                                             (pid_t) this->entryState->returnValue,
 			                                             (pid_t) this->entryState->returnValue);
@@ -732,6 +930,7 @@ int Tracer::handleSpecialCases(int status, shared_ptr<Registers> regs) {
 			return Tracer::NOT_SPECIAL;
 		}
 		this->entryState->childPid = childSpid;
+		SyscallDecoderMapper::fork(this->tracedPid, childSpid);
 		returnValue = TracingManager::handleChildren(*this, childSpid, childSpid);
 		if (!returnValue) {
 			return Tracer::SYSCALL_HANDLED;
@@ -739,9 +938,19 @@ int Tracer::handleSpecialCases(int status, shared_ptr<Registers> regs) {
 			return returnValue;
 		}
 	}
+	// The execve of Tracer::execProgram, where the seccomp filter is already installed, is not part of the traced program
+	if (this->firstExec && status >> 8 == (SIGTRAP | (PTRACE_EVENT_SECCOMP << 8))) {
+		assert(this->entryState == nullptr);
+		return Tracer::SYSCALL_HANDLED;
+	}
+	if (this->firstExec && status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+		this->firstExec = false;
+		return Tracer::SYSCALL_HANDLED;
+	}
 	if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
 		if (!this->handleExecve(regs)) {
 			this->entryState->returnValue = regs->returnValue();
+			SyscallDecoderMapper::exec(this->tracedPid);
 			cout << "Handled execve for SPID " << this->tracedSpid << ", which returned " << this->entryState->returnValue << endl;
 			return Tracer::SYSCALL_HANDLED;
 		}
@@ -769,7 +978,7 @@ int Tracer::syscallEntry(int status, shared_ptr<Registers> regs) {
 	assert(this->tracedSpid > 0 && this->tracedSpid < Tracer::MAX_PID);
 	assert(!this->entryState);
 	assert(TracingManager::workerSpid == syscall(SYS_gettid));
-	assert(WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP | 0x80));
+	assert(WIFSTOPPED(status) && (WSTOPSIG(status) == (SIGTRAP | 0x80) || status >> 8 == (SIGTRAP | (PTRACE_EVENT_SECCOMP << 8))));
 	assert(!WIFEXITED(status));
 	this->exitState = nullptr;
 	this->entryState = make_shared<ProcessSyscallEntry>(this->tracedExecutable, this->tracedPid, this->tracedSpid);
@@ -824,7 +1033,15 @@ int Tracer::syscallExit(int status, shared_ptr<Registers> regs) {
 	assert(this->entryState->regs != nullptr);
 	assert(!this->entryState->stackFrames.empty());
 	assert(!WIFEXITED(status));
-	if (this->entryState->getSyscall() != regs->syscall()) {
+	// A denied syscall has not been executed, its number is no longer valid and the return value must be EPERM
+	if (this->entryState->denied && regs->returnValue() != -EPERM) {
+		regs->setReturnValue(-EPERM);
+		if (ptrace(PTRACE_SETREGSET, this->tracedSpid, NT_PRSTATUS, regs->getIovec())) {
+			PERROR("Ptrace error occurred while trying to set the return value of a denied syscall in SPID " + to_string(this->tracedSpid));
+			return Tracer::PTRACE_ERROR;
+		}
+	}
+	if (!this->entryState->denied && this->entryState->getSyscall() != regs->syscall()) {
 		cerr << "Received a different syscall number then expected in SPID " << this->tracedSpid << endl;
 		cerr << "Received: " << regs->syscall() << endl;
 		cerr << "Expected: " << this->entryState->getSyscall() << endl;
@@ -846,14 +1063,14 @@ int Tracer::syscallExit(int status, shared_ptr<Registers> regs) {
 	assert(regs->returnValue() != -ENOSYS);                        // In a real scenario this is possible but not in debug mode
 	// Syscall decoding needs to happen here since it might require extracting memory from the tracee and that can be done only from the tracer SPID
 	SyscallDecoderMapper::decode(*this->exitState.get());
-	if (ptrace(PTRACE_SYSCALL, this->tracedSpid, nullptr, 0)) {
-		PERROR("Ptrace error occurred while trying to continue from the syscall number " + to_string(this->entryState->getSyscall()) +
-		       " exit notification of SPID " + to_string(this->tracedSpid));
-		return Tracer::PTRACE_ERROR;
-	}
 	//cout << "System call number " << this->_current_state->nsyscall << " of SPID " << this->_traced_spid <<
 	//     " return value: " << this->_current_state->return_value << endl;
 	this->entryState = nullptr;
+	if (this->resume()) {
+		PERROR("Ptrace error occurred while trying to continue from the syscall number " + to_string(regs->syscall()) +
+		       " exit notification of SPID " + to_string(this->tracedSpid));
+		return Tracer::PTRACE_ERROR;
+	}
 	return Tracer::WAIT_FOR_AUTHORISATION;
 }
 
@@ -1033,7 +1250,7 @@ shared_ptr<siginfo_t> Tracer::handleSignal(int status) const {
 		PERROR("Ptrace error occurred while trying to set the signal info of " + to_string(this->tracedSpid));
 		return nullptr;
 	}
-	if (ptrace(PTRACE_SYSCALL, this->tracedSpid, nullptr, signal_info->si_signo)) {
+	if (this->resume(signal_info->si_signo)) {
 		PERROR("Ptrace error occurred while trying to restart the SPID " + to_string(this->tracedSpid) + " after a signal reception");
 		return nullptr;
 	}
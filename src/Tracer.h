@@ -7,12 +7,15 @@
                                   " -> " + message).c_str()); \
                           errno = 0; \
                         } while (false);
+#include <atomic>
 #include <vector>
 #include <linux/limits.h>
 #include <signal.h>
 #include <mutex>
 #include <condition_variable>
 #include <boost/integer_traits.hpp>
+#include <linux/filter.h>
+#include <sys/uio.h>
 #include "Backtracer.h"
 #include "Registers.h"
 #include "ProcessTermination.h"
@@ -61,14 +64,21 @@ public:
   [[nodiscard]] bool isTracing() const;
   int handle(int status);
   int proceed();
+  int deny();
   int init(int status = -1);
   void set_options(bool follow_children, bool follow_threads, bool ptrace_jail, bool no_backtrace);
   void waitForAttach();
+  void setSeccompFilter(std::vector<sock_filter> filter);
+  void setStackLimits(unsigned int depth, std::vector<std::string> excludedModules);
 	[[nodiscard]] std::string extractString(unsigned long long int address, unsigned int maxLength) const;
 	[[nodiscard]] unsigned char* extractBytes(unsigned long long int address, unsigned int maxLength) const;
+	bool readMemory(unsigned long long int address, void* destination, size_t length) const;
+	bool readMemory(const iovec* segments, size_t count, void* destination) const;
 
 	static const unsigned int MAXIMUM_PROCESS_NAME_LENGTH;
 private:
+	// Cleared the first time the kernel does not implement process_vm_readv
+	static std::atomic<bool> vmReadv;
 	const std::unique_ptr<Backtracer> backtracer;
   std::string tracedExecutable;
   pid_t tracedPid = -1;
@@ -82,9 +92,18 @@ private:
   char const* const* args;
   bool backtrace;
   int ptraceOptions = -1;
+  // Seccomp filter installed in the tracee, when present only the syscalls it traps are notified
+  std::vector<sock_filter> seccompFilter;
+  bool seccomp = false;
+  // Maximum number of stack frames and modules which frames are dropped, see Tracer::setStackLimits
+  unsigned int stackDepth = 0;
+  std::vector<std::string> excludedModules;
+  // True until the execve that starts the program given to Tracer::execProgram has been performed
+  bool firstExec = false;
   std::mutex attachMutex;
   std::condition_variable conditionAttach;
   int execProgram();
+  long resume(int signal = 0) const;
   bool attach();
   int handleSpecialCases(int status, std::shared_ptr<Registers> regs);
   int syscallEntry(int status, std::shared_ptr<Registers> regs);
@@ -79,6 +79,17 @@ shared_ptr<ProcessNotification> TracingManager::nextNotification() {
   return TracingManager::notificationQueue.pop();
 }
 
+/**
+ * Like TracingManager::nextNotification, but it stops waiting after a timeout.
+ *
+ * @param notification Where the first ProcessState in the queue will be stored.
+ * @param timeoutMs    The maximum time to wait for a notification.
+ * @return True if a notification has been taken from the queue, False if the timeout expired.
+ */
+bool TracingManager::nextNotification(shared_ptr<ProcessNotification>& notification, unsigned int timeoutMs) {
+  return TracingManager::notificationQueue.timed_pop(notification, timeoutMs);
+}
+
 /**
  * Method called only by ProcessState::authorize in order to unblock the tracer of SPID
  * until the next syscall.
@@ -106,6 +117,22 @@ bool TracingManager::authorize(shared_ptr<ProcessSyscallEntry> state) {
   return true;
 }
 
+/**
+ * Lets the tracer of SPID proceed skipping the System call it is stopped at, the tracee will see it failing with EPERM.
+ * As TracingManager::authorize it can be called from any thread but the worker one.
+ *
+ * @param state The System call entry that will be denied.
+ * @return True if the syscall has already been authorised or the worker thread was successfully notified, False otherwise.
+ */
+bool TracingManager::deny(shared_ptr<ProcessSyscallEntry> state) {
+  assert(state != nullptr);
+  if (state->isAuthorised()) {
+    return true;
+  }
+  state->denied = true;
+  return TracingManager::authorize(state);
+}
+
 /**
  * Used to add a new Tracer that will be initialised and then managed.
  * If the insertion fail it means that it was not possible to deliver a SIGUSR2
@@ -393,7 +420,7 @@ void TracingManager::handleAuthorised(int signal) {
       continue;
     }
     current_state->authorise();
-    if (current_state->getTracer()->proceed() == Tracer::PTRACE_ERROR) {
+    if ((current_state->isDenied() ? current_state->getTracer()->deny() : current_state->getTracer()->proceed()) == Tracer::PTRACE_ERROR) {
       cerr << "Impossible to successfully authorize the state: " << endl;
       current_state->print();
     }
@@ -14,7 +14,9 @@ public:
   static bool init(std::shared_ptr<Tracer> tracer = nullptr);
   static bool start();
   static std::shared_ptr<ProcessNotification> nextNotification();
+  static bool nextNotification(std::shared_ptr<ProcessNotification>& notification, unsigned int timeoutMs);
   static bool authorize(std::shared_ptr<ProcessSyscallEntry> state);
+  static bool deny(std::shared_ptr<ProcessSyscallEntry> state);
   static bool addTracer(std::shared_ptr<Tracer> tracer);
   static bool kill_process(int spid = -1);
   static bool isRunning();
@@ -0,0 +1,148 @@
+/*
+ * The TransitionCache memoises the transitions of a CompactAutomaton, every set of states is interned and
+ * identified by a progressive ID so that a transition is a lookup of the pair (state set ID, label).
+ * In a steady state loop (poll -> read -> write -> poll) the same pairs recur constantly and the automaton
+ * is not even queried.
+ * The cache must be invalidated every time the automaton changes.
+ * A long trace may still visit a lot of different sets of states: once TransitionCache::isFull the owner clears the
+ * cache, interning again the sets of states it is still using.
+ */
+
+#include <algorithm>
+#include <assert.h>
+#include <sstream>
+#include "TransitionCache.h"
+
+using namespace std;
+
+// Default number of cached transitions, it must be a power of two
+const unsigned int TransitionCache::DEFAULT_MAX_ENTRIES = 1 << 12;
+// Default number of interned sets of states before the cache is full
+const unsigned int TransitionCache::DEFAULT_MAX_SETS = 1 << 16;
+// Value of a cached transition that does not lead to any state
+const unsigned int TransitionCache::NO_TRANSITION = ~0U;
+// Key of an empty entry, it cannot be generated by a valid (state set ID, label) pair
+static const unsigned long long EMPTY_KEY = ~0ULL;
+
+/**
+ * @param automaton  The automaton whose transitions will be cached, it must outlive the cache.
+ * @param maxEntries The maximum number of cached transitions, rounded up to a power of two.
+ * @param maxSets    The number of interned sets of states after which the cache is full.
+ */
+TransitionCache::TransitionCache(const CompactAutomaton& automaton, unsigned int maxEntries, unsigned int maxSets)
+		: automaton(automaton), maxSets(maxSets) {
+	unsigned int size = 1;
+	while (size < maxEntries) {
+		size <<= 1;
+	}
+	this->entries.assign(size, { EMPTY_KEY, TransitionCache::NO_TRANSITION });
+}
+
+/**
+ * Gets the ID of a set of states, the first time a set is seen a new ID is assigned to it.
+ *
+ * @param states The sorted set of states.
+ * @return The ID of the set.
+ */
+unsigned int TransitionCache::intern(const StateSet& states) {
+	auto it = this->ids.find(states);
+	if (it != this->ids.end()) {
+		return it->second;
+	}
+	auto id = (unsigned int) this->sets.size();
+	this->sets.push_back(states);
+	this->finals.push_back(-1);
+	this->ids.emplace(states, id);
+	return id;
+}
+
+const StateSet& TransitionCache::getStates(unsigned int id) const {
+	return this->sets.at(id);
+}
+
+/**
+ * Computes the set of states reachable from a set of states reading a label, the automaton is queried only
+ * if this transition is not cached.
+ *
+ * @param from  The ID of the current set of states.
+ * @param label The transition label.
+ * @param to    Where the ID of the destination set of states will be written.
+ * @return True if at least one destination state exists, False otherwise.
+ */
+bool TransitionCache::step(unsigned int from, int label, unsigned int& to) {
+	assert(from < this->sets.size());
+	unsigned long long key = ((unsigned long long) from << 32) | (unsigned int) label;
+	Entry& entry = this->entries[boost::hash<unsigned long long>()(key) & (this->entries.size() - 1)];
+	if (entry.key == key) {
+		this->hits++;
+		to = entry.to;
+		return to != TransitionCache::NO_TRANSITION;
+	}
+	this->misses++;
+	to = this->automaton.step(this->sets[from], label, this->scratch) ? this->intern(this->scratch) : TransitionCache::NO_TRANSITION;
+	entry = { key, to };
+	return to != TransitionCache::NO_TRANSITION;
+}
+
+/**
+ * Tells if at least one of the states of a set is final.
+ *
+ * @param id The ID of the set of states.
+ * @return True if the set contains a final state, False otherwise.
+ */
+bool TransitionCache::isFinal(unsigned int id) {
+	assert(id < this->sets.size());
+	if (this->finals[id] < 0) {
+		this->finals[id] = this->automaton.isFinal(this->sets[id]) ? 1 : 0;
+	}
+	return this->finals[id];
+}
+
+/**
+ * Tells if the interned sets of states reached their limit, the cache keeps working but it should be cleared as soon
+ * as the IDs in use can be interned again.
+ *
+ * @return True if the cache should be cleared, False otherwise.
+ */
+bool TransitionCache::isFull() const {
+	return this->sets.size() >= this->maxSets;
+}
+
+/**
+ * Drops every cached transition and finality, it must be called every time the automaton transitions or
+ * final states change while its states keep their meaning.
+ * The interned sets of states are kept.
+ */
+void TransitionCache::invalidate() {
+	fill(this->entries.begin(), this->entries.end(), Entry { EMPTY_KEY, TransitionCache::NO_TRANSITION });
+	fill(this->finals.begin(), this->finals.end(), -1);
+}
+
+/**
+ * Drops everything, included the interned sets of states: every ID previously returned becomes invalid.
+ */
+void TransitionCache::clear() {
+	this->invalidate();
+	this->sets.clear();
+	this->finals.clear();
+	this->ids.clear();
+}
+
+unsigned long TransitionCache::getHits() const {
+	return this->hits;
+}
+
+unsigned long TransitionCache::getMisses() const {
+	return this->misses;
+}
+
+TransitionCache::operator string() const {
+	stringstream result;
+	unsigned long total = this->hits + this->misses;
+	result << "Transition cache hits: " << this->hits << " misses: " << this->misses;
+	if (total > 0) {
+		result << " hit ratio: " << (100 * this->hits / total) << "%";
+	}
+	result << " interned state sets: " << this->sets.size() << endl;
+	return result.str();
+}
@@ -0,0 +1,53 @@
+#ifndef PTRACER_TRANSITIONCACHE_H
+#define PTRACER_TRANSITIONCACHE_H
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/functional/hash.hpp>
+#include "CompactAutomaton.h"
+
+struct StateSetHash {
+	std::size_t operator()(const StateSet& states) const {
+		return boost::hash_range(states.begin(), states.end());
+	}
+};
+
+class TransitionCache {
+public:
+	static const unsigned int DEFAULT_MAX_ENTRIES;
+	static const unsigned int DEFAULT_MAX_SETS;
+	explicit TransitionCache(const CompactAutomaton& automaton, unsigned int maxEntries = DEFAULT_MAX_ENTRIES,
+	                         unsigned int maxSets = DEFAULT_MAX_SETS);
+	unsigned int intern(const StateSet& states);
+	[[nodiscard]] const StateSet& getStates(unsigned int id) const;
+	bool step(unsigned int from, int label, unsigned int& to);
+	bool isFinal(unsigned int id);
+	[[nodiscard]] bool isFull() const;
+	void invalidate();
+	void clear();
+	[[nodiscard]] unsigned long getHits() const;
+	[[nodiscard]] unsigned long getMisses() const;
+	operator std::string() const;
+
+private:
+	// Value of a cached transition that does not lead to any state
+	static const unsigned int NO_TRANSITION;
+	struct Entry {
+		unsigned long long key;
+		unsigned int to;
+	};
+	const CompactAutomaton& automaton;
+	// Number of interned sets of states after which the owner is expected to clear the cache
+	const unsigned int maxSets;
+	// Direct mapped table of (state set ID, label) -> state set ID, a collision overwrites the older entry
+	std::vector<Entry> entries;
+	std::vector<StateSet> sets;
+	std::unordered_map<StateSet, unsigned int, StateSetHash> ids;
+	// For every state set ID: -1 if unknown, 0 if not final, 1 if final
+	std::vector<signed char> finals;
+	StateSet scratch;
+	unsigned long hits = 0;
+	unsigned long misses = 0;
+};
+
+#endif //PTRACER_TRANSITIONCACHE_H
@@ -78,4 +78,23 @@ unsigned long long int Registers::argument(unsigned short int i) const {
  */
 unsigned long long int Registers::flags() const {
 	return this->pstate;
-}
\ No newline at end of file
+}
+
+/**
+ * Sets the System Call number register, the kernel reads the number of the syscall being executed from
+ * NT_ARM_SYSTEM_CALL so in order to skip a syscall that regset must be changed too.
+ *
+ * @param number The new System Call number.
+ */
+void Registers::setSyscall(int number) {
+	this->regs[8] = (unsigned long long int) (long long int) number;
+}
+
+/**
+ * Sets the System Call Return Value.
+ *
+ * @param value The new System Call Return Value.
+ */
+void Registers::setReturnValue(long long int value) {
+	this->regs[0] = (unsigned long long int) value;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cxxabi.h>
 #include <iostream>
 #include "BacktracerImpl.h"
@@ -8,7 +9,10 @@ using namespace std;
 const unsigned int BacktracerImpl::MAX_FRAMES = 1024;
 
 void BacktracerImpl::init(pid_t pid) {
-	this->unwinder = make_unique<UnwinderFromPid>(BacktracerImpl::MAX_FRAMES, pid, ArchEnum::ARCH_ARM64);
+	// Excluded frames are dropped after the unwinding, so it can stop at the maximum depth only without them
+	unsigned int maxFrames = this->maxDepth > 0 && this->excludedModules.empty() ? min(this->maxDepth, BacktracerImpl::MAX_FRAMES)
+	                                                                             : BacktracerImpl::MAX_FRAMES;
+	this->unwinder = make_unique<UnwinderFromPid>(maxFrames, pid, ArchEnum::ARCH_ARM64);
 	this->pid = pid;
 }
 
@@ -22,13 +26,20 @@ std::vector<StackFrame> BacktracerImpl::unwind() {
 	this->unwinder->SetRegs(regs);
 	this->unwinder->Unwind();
 	for (FrameData& i : unwinder->ConsumeFrames()) {
+		string moduleName = i.map_info != nullptr ? (string) i.map_info->name() : "";
+		if (this->maxDepth > 0 && frames.size() >= this->maxDepth) {
+			break;
+		}
+		if (this->isExcluded(moduleName)) {
+			continue;
+		}
 		string functionName = (string) i.function_name;
 		char* demangled_name = abi::__cxa_demangle(i.function_name.c_str(), nullptr, nullptr, nullptr);
 		if (demangled_name != nullptr) {
 			functionName = string(demangled_name);
 			free(demangled_name);
 		}
-		frames.emplace_back(i.pc, i.rel_pc, i.sp, functionName, i.function_offset);
+		frames.emplace_back(i.pc, i.rel_pc, i.sp, functionName, i.function_offset, moduleName);
 	}
 	return frames;
 }
@@ -1,5 +1,8 @@
+#include <algorithm>
 #include <assert.h>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include "BacktracerImpl.h"
 
 using namespace std;
@@ -13,6 +16,8 @@ BacktracerImpl::BacktracerImpl() : Backtracer() {
 
 void BacktracerImpl::init(pid_t pid) {
 	assert(pid >= 0);
+	this->pid = pid;
+	this->modules.clear();
 	this->_info = (UPT_info*) _UPT_create(pid);
 	if (this->_address_space == nullptr && (this->_address_space = unw_create_addr_space(&_UPT_accessors, 0)) == nullptr) {
 		throw new runtime_error("Error while initialising the libunwind address space");
@@ -29,14 +34,25 @@ std::vector<StackFrame> BacktracerImpl::unwind() {
 	unw_proc_info_t info;
 	unsigned long long relativePc = 0;
 	char functionName[BacktracerImpl::MAX_FUNCTION_NAME_LENGTH];
+	unsigned int maxFrames = this->maxDepth > 0 ? min(this->maxDepth, BacktracerImpl::MAX_FRAMES) : BacktracerImpl::MAX_FRAMES;
+	unsigned int steps = 0;
+	string moduleName;
 	if (unw_init_remote(&it, this->_address_space, this->_info)) {
 		throw new runtime_error("Error during the remote cursor initialization for remote unwinding");
 	}
+	// The modules may have changed since the previous unwinding, they are read again at the first unknown address
+	this->modulesLoaded = false;
 	do {
 		functionName[0] = '\0';
 		if (unw_get_reg(&it, UNW_REG_IP, &pc) != UNW_ESUCCESS) {
 			throw new runtime_error("Error during call backtrace retrieval: impossible to retrieve the instruction pointer");
 		}
+		if (!this->excludedModules.empty()) {
+			moduleName = this->findModule(pc);
+			if (this->isExcluded(moduleName)) {
+				continue;
+			}
+		}
 		if (unw_get_reg(&it, UNW_REG_SP, &sp) != UNW_ESUCCESS) {
 			throw new runtime_error("Error during call backtrace retrieval: impossible to retrieve a stack pointer");
 		}
@@ -49,11 +65,52 @@ std::vector<StackFrame> BacktracerImpl::unwind() {
 		} else {
 			cerr << "Error during retrieval of function entry point" << endl;
 		}
-		frames.emplace_back(pc, relativePc, sp, string(functionName), offset);
-	} while (unw_step(&it) > 0 && frames.size() < BacktracerImpl::MAX_FRAMES);
+		frames.emplace_back(pc, relativePc, sp, string(functionName), offset, moduleName);
+	} while (frames.size() < maxFrames && ++steps < BacktracerImpl::MAX_FRAMES && unw_step(&it) > 0);
 	return frames;
 }
 
+/**
+ * Finds the module mapped at an address of the tracee.
+ *
+ * @param pc The address.
+ * @return The module path, empty if the address is not mapped or the mapping is anonymous.
+ */
+string BacktracerImpl::findModule(unw_word_t pc) {
+	for (unsigned int attempt = 0; attempt < 2; attempt++) {
+		auto it = this->modules.upper_bound(pc);
+		if (it != this->modules.begin() && pc < (--it)->second.first) {
+			return it->second.second;
+		}
+		if (this->modulesLoaded) {
+			break;
+		}
+		this->loadModules();
+	}
+	return "";
+}
+
+/**
+ * Reads the modules mapped in the tracee from /proc/<pid>/maps.
+ */
+void BacktracerImpl::loadModules() {
+	ifstream maps("/proc/" + to_string(this->pid) + "/maps");
+	string line;
+	this->modules.clear();
+	this->modulesLoaded = true;
+	while (getline(maps, line)) {
+		istringstream fields(line);
+		string range, permissions, offset, device, inode, path;
+		fields >> range >> permissions >> offset >> device >> inode;
+		getline(fields >> ws, path);
+		size_t separator = range.find('-');
+		if (path.empty() || separator == string::npos) {
+			continue;
+		}
+		this->modules[stoull(range.substr(0, separator), nullptr, 16)] = { stoull(range.substr(separator + 1), nullptr, 16), path };
+	}
+}
+
 BacktracerImpl::~BacktracerImpl() {
 	if (this->_address_space != nullptr) {
 		unw_destroy_addr_space(this->_address_space);
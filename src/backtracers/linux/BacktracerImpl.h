@@ -1,6 +1,7 @@
 #ifndef PTRACER_BACKTRACERIMPL_H
 #define PTRACER_BACKTRACERIMPL_H
 #include <libunwind-ptrace.h>
+#include <map>
 #include "../../Backtracer.h"
 #include "../../StackFrame.h"
 
@@ -16,6 +17,12 @@ private:
 	static const unsigned int MAX_FUNCTION_NAME_LENGTH;
 	unw_addr_space_t _address_space = nullptr;
 	struct UPT_info* _info = nullptr;
+	pid_t pid = -1;
+	// Mapped modules in the form < start_address, < end_address, path > >, read only when some modules are excluded
+	std::map<unw_word_t, std::pair<unw_word_t, std::string>> modules;
+	bool modulesLoaded = false;
+	std::string findModule(unw_word_t pc);
+	void loadModules();
 };
 
 #endif //PTRACER_BACKTRACERIMPL_H
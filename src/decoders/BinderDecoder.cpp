@@ -4,6 +4,7 @@
 #include <iostream>
 #include <sys/syscall.h>
 #include "BinderDecoder.h"
+#include "SyscallDispatchTable.h"
 #include "../Tracer.h"
 #include "../utils/Hexdump.hpp"
 
@@ -26,16 +27,18 @@ set<pair<unsigned int, string>> BinderDecoder::flatBinderObjectFlags = { pair<un
 																																				 pair<unsigned int, string>(FLAT_BINDER_FLAG_TXN_SECURITY_CTX, "FLAT_BINDER_FLAG_TXN_SECURITY_CTX"),
 																																				 pair<unsigned int, string>(BINDER_BUFFER_FLAG_HAS_PARENT, "BINDER_BUFFER_FLAG_HAS_PARENT")};
 
-void BinderDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
+void BinderDecoder::registerAt() {
 	if (BinderDecoder::binderProtocols.empty()) {
 		BinderDecoder::initProtocols();
 	}
 	if (BinderDecoder::binderCodes.empty()) {
 		BinderDecoder::initCodes();
 	}
-	shared_ptr<SyscallDecoder> thisDecoder(new BinderDecoder());
-	mapper.registerEntrySyscallDecoder(SYS_ioctl, thisDecoder);
-	mapper.registerExitSyscallDecoder(SYS_ioctl, thisDecoder);
+	int thisDecoder = SyscallDispatchTable::registerDecoder<BinderDecoder>([](ProcessSyscallDecoderMapper&) -> SyscallDecoder* {
+		return new BinderDecoder();
+	});
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_ioctl, thisDecoder);
+	SyscallDispatchTable::registerExitSyscallDecoder(SYS_ioctl, thisDecoder);
 }
 
 bool BinderDecoder::decode(const ProcessSyscallEntry& syscall) {
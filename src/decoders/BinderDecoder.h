@@ -65,7 +65,7 @@ struct BinderVersion {
 
 class BinderDecoder : public SyscallDecoder {
 public:
-	static void registerAt(ProcessSyscallDecoderMapper& mapper);
+	static void registerAt();
 	bool decode(const ProcessSyscallEntry& syscall) override;
 	bool decode(const ProcessSyscallExit& syscall) override;
 	void printReport() const override;
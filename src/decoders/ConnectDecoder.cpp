@@ -3,6 +3,7 @@
 #include <iostream>
 #include <sys/syscall.h>
 #include "ConnectDecoder.h"
+#include "SyscallDispatchTable.h"
 #include "../Tracer.h"
 
 using namespace std;
@@ -28,12 +29,14 @@ bool ConnectDecoder::decode(const ProcessSyscallExit& syscall) {
 	return true;
 }
 
-void ConnectDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
+void ConnectDecoder::registerAt() {
 	if (ConnectDecoder::socketFamilies.empty()) {
 		ConnectDecoder::initFamilies();
 	}
-	shared_ptr<SyscallDecoder> thisDecoder(new ConnectDecoder());
-	mapper.registerEntrySyscallDecoder(SYS_connect, thisDecoder);
+	int thisDecoder = SyscallDispatchTable::registerDecoder<ConnectDecoder>([](ProcessSyscallDecoderMapper&) -> SyscallDecoder* {
+		return new ConnectDecoder();
+	});
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_connect, thisDecoder);
 }
 
 /**
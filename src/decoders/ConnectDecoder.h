@@ -13,7 +13,7 @@ struct ConnectCall {
 
 class ConnectDecoder : public SyscallDecoder {
 public:
-	static void registerAt(ProcessSyscallDecoderMapper& mapper);
+	static void registerAt();
 	bool decode(const ProcessSyscallEntry& syscall) override;
 	bool decode(const ProcessSyscallExit& syscall) override;
 	void printReport() const override;
@@ -0,0 +1,122 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/syscall.h>
+#include "DescriptorDecoder.h"
+#include "SyscallDispatchTable.h"
+#include "../Tracer.h"
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+
+using namespace std;
+
+const set<int> DescriptorDecoder::DESCRIPTOR_SYSCALLS = {SYS_close,
+#ifdef SYS_close_range
+                                                         SYS_close_range,
+#endif
+                                                         SYS_dup,
+#ifdef SYS_dup2
+                                                         SYS_dup2,
+#endif
+                                                         SYS_dup3,
+                                                         SYS_fcntl,
+#ifdef SYS_pipe
+                                                         SYS_pipe,
+#endif
+                                                         SYS_pipe2};
+
+/**
+ * @param fds The file descriptors of the process.
+ */
+DescriptorDecoder::DescriptorDecoder(shared_ptr<FdTable> fds) : fds(std::move(fds)) {
+}
+
+void DescriptorDecoder::registerAt() {
+	int thisDecoder = SyscallDispatchTable::registerDecoder<DescriptorDecoder>([](ProcessSyscallDecoderMapper& mapper) -> SyscallDecoder* {
+		return new DescriptorDecoder(mapper.getFdTable());
+	});
+	for (int syscall : DescriptorDecoder::DESCRIPTOR_SYSCALLS) {
+		// The table changes only if the system call succeeds
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
+	}
+}
+
+bool DescriptorDecoder::decode(const ProcessSyscallEntry& syscall) {
+	this->active[syscall.getSpid()] = { syscall.argument(0), syscall.argument(1), syscall.argument(2) };
+	return true;
+}
+
+bool DescriptorDecoder::decode(const ProcessSyscallExit& syscall) {
+	auto it = this->active.find(syscall.getSpid());
+	if (it == this->active.end()) {
+		cerr << "Cannot find a matching system call entry for the received file descriptor system call!" << endl;
+		return false;
+	}
+	array<unsigned long long, 3> arguments = it->second;
+	this->active.erase(it);
+	long long result = (long long) syscall.getReturnValue();
+	int fd = (int) arguments[0];
+	switch (syscall.getSyscall()) {
+		case SYS_close:
+			// The file descriptor is released even if close is interrupted
+			if (result == 0 || result == -EINTR) {
+				this->fds->close(fd);
+				this->closed++;
+			}
+			break;
+#ifdef SYS_close_range
+		case SYS_close_range:
+			if (result == 0) {
+				this->fds->closeRange((unsigned int) arguments[0], (unsigned int) arguments[1], arguments[2] & CLOSE_RANGE_CLOEXEC);
+			}
+			break;
+#endif
+		case SYS_fcntl:
+			if (result < 0) {
+				break;
+			}
+			if (arguments[1] == F_DUPFD || arguments[1] == F_DUPFD_CLOEXEC) {
+				this->fds->duplicate(fd, (int) result, arguments[1] == F_DUPFD_CLOEXEC);
+				this->duplicated++;
+			} else if (arguments[1] == F_SETFD) {
+				this->fds->setCloexec(fd, arguments[2] & FD_CLOEXEC);
+			}
+			break;
+#ifdef SYS_pipe
+		case SYS_pipe:
+#endif
+		case SYS_pipe2: {
+			int ends[2];
+			if (result != 0 || !syscall.getTracer()->readMemory(arguments[0], ends, sizeof(ends))) {
+				break;
+			}
+			// pipe has no flags argument, its second argument is not meaningful
+			bool cloexec = syscall.getSyscall() == SYS_pipe2 && (arguments[1] & O_CLOEXEC);
+			string name = "pipe:[" + to_string(ends[0]) + "," + to_string(ends[1]) + "]";
+			this->fds->open(ends[0], name, FdTable::PIPE, cloexec);
+			this->fds->open(ends[1], name, FdTable::PIPE, cloexec);
+			this->pipes++;
+			break;
+		}
+		default:
+			// dup, dup2 and dup3, only dup3 takes the O_CLOEXEC flag
+			if (result >= 0) {
+				this->fds->duplicate(fd, (int) result, syscall.getSyscall() == SYS_dup3 && (arguments[2] & O_CLOEXEC));
+				this->duplicated++;
+			}
+			break;
+	}
+	return true;
+}
+
+/**
+ * Prints how many file descriptors have been closed and duplicated and how many pipes have been created.
+ */
+void DescriptorDecoder::printReport() const {
+	cout << "------------------ DESCRIPTOR DECODER START ------------------" << endl;
+	cout << "Closed: " << this->closed << ", duplicated: " << this->duplicated << ", pipes: " << this->pipes << endl;
+	cout << "------------------ DESCRIPTOR DECODER STOP ------------------" << endl;
+}
@@ -0,0 +1,27 @@
+#ifndef PTRACER_DESCRIPTORDECODER_H
+#define PTRACER_DESCRIPTORDECODER_H
+
+#include <array>
+#include "FdTable.h"
+#include "SyscallDecoder.h"
+
+// Keeps the FdTable of the process up to date with the system calls that duplicate and close file descriptors or
+// create pipes, the ones that open files and sockets are handled by the FileDecoder and by the SocketDecoder.
+class DescriptorDecoder : public SyscallDecoder {
+public:
+	static void registerAt();
+	bool decode(const ProcessSyscallEntry& syscall) override;
+	bool decode(const ProcessSyscallExit& syscall) override;
+	void printReport() const override;
+private:
+	static const std::set<int> DESCRIPTOR_SYSCALLS;
+	// The first arguments of the system calls in progress
+	std::unordered_map<pid_t, std::array<unsigned long long, 3>> active;
+	const std::shared_ptr<FdTable> fds;
+	unsigned long closed = 0;
+	unsigned long duplicated = 0;
+	unsigned long pipes = 0;
+	explicit DescriptorDecoder(std::shared_ptr<FdTable> fds);
+};
+
+#endif //PTRACER_DESCRIPTORDECODER_H
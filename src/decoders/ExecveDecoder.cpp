@@ -2,6 +2,7 @@
 #include <iostream>
 #include <sys/syscall.h>
 #include "ExecveDecoder.h"
+#include "SyscallDispatchTable.h"
 #include "../Tracer.h"
 
 using namespace std;
@@ -28,10 +29,12 @@ bool ExecveDecoder::decode(const ProcessSyscallExit& syscall) {
 	return true;
 }
 
-void ExecveDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
-	shared_ptr<SyscallDecoder> thisDecoder(new ExecveDecoder());
-	mapper.registerEntrySyscallDecoder(SYS_execve, thisDecoder);
-	mapper.registerEntrySyscallDecoder(SYS_execveat, thisDecoder);
+void ExecveDecoder::registerAt() {
+	int thisDecoder = SyscallDispatchTable::registerDecoder<ExecveDecoder>([](ProcessSyscallDecoderMapper&) -> SyscallDecoder* {
+		return new ExecveDecoder();
+	});
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_execve, thisDecoder);
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_execveat, thisDecoder);
 }
 
 void ExecveDecoder::printReport() const {
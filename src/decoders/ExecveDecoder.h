@@ -10,7 +10,7 @@ struct ExecCall {
 
 class ExecveDecoder : public SyscallDecoder {
 public:
-	static void registerAt(ProcessSyscallDecoderMapper& mapper);
+	static void registerAt();
 	bool decode(const ProcessSyscallEntry& syscall) override;
 	bool decode(const ProcessSyscallExit& syscall) override;
 	void printReport() const override;
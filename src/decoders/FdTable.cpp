@@ -0,0 +1,189 @@
+#include "FdTable.h"
+
+using namespace std;
+
+const int FdTable::MAX_FDS = 1 << 20;
+
+/**
+ * Creates the table of a process started by ptracer, only the standard streams are open.
+ */
+FdTable::FdTable() {
+	this->open(0, "STDIN", FdTable::UNKNOWN, false);
+	this->open(1, "STDOUT", FdTable::UNKNOWN, false);
+	this->open(2, "STDERR", FdTable::UNKNOWN, false);
+}
+
+/**
+ * Looks up a file descriptor without changing the table, as on the entry of a system call that may still fail.
+ *
+ * @param fd A file descriptor of the process.
+ * @return The entry of fd, nullptr if fd is not known to be open.
+ */
+FdTable::Entry* FdTable::find(int fd) {
+	if (fd < 0 || (size_t) fd >= this->entries.size() || !this->entries[fd].open) {
+		return nullptr;
+	}
+	return &this->entries[fd];
+}
+
+const FdTable::Entry* FdTable::find(int fd) const {
+	if (fd < 0 || (size_t) fd >= this->entries.size() || !this->entries[fd].open) {
+		return nullptr;
+	}
+	return &this->entries[fd];
+}
+
+/**
+ * Gets the entry of a file descriptor a system call has just succeeded on, it is considered open even if it has not
+ * been seen opening, since it may have been inherited before tracing started.
+ *
+ * @param fd A file descriptor the kernel accepted or returned.
+ * @return The entry of fd, nullptr if fd is larger than FdTable::MAX_FDS.
+ */
+FdTable::Entry* FdTable::adopt(int fd) {
+	if (fd < 0 || fd >= FdTable::MAX_FDS) {
+		return nullptr;
+	}
+	if ((size_t) fd >= this->entries.size()) {
+		this->entries.resize(fd + 1);
+	}
+	Entry& entry = this->entries[fd];
+	entry.open = true;
+	return &entry;
+}
+
+/**
+ * @param fd A file descriptor of the process.
+ * @return The path, the socket peer or the pipe fd refers to, "fd <number>" if it is unknown.
+ */
+string FdTable::getName(int fd) const {
+	if (fd < 0 || (size_t) fd >= this->entries.size() || this->entries[fd].name.empty()) {
+		return "fd " + to_string(fd);
+	}
+	return this->entries[fd].name;
+}
+
+const vector<FdTable::Entry>& FdTable::getEntries() const {
+	return this->entries;
+}
+
+/**
+ * Records a file descriptor returned by the kernel, whatever fd referred to before has been closed.
+ *
+ * @param fd      The new file descriptor.
+ * @param name    The opened path, the socket peer or the pipe.
+ * @param kind    What fd refers to.
+ * @param cloexec True if fd is closed by execve.
+ */
+void FdTable::open(int fd, const string& name, Kind kind, bool cloexec) {
+	Entry* entry = this->adopt(fd);
+	if (entry == nullptr) {
+		return;
+	}
+	*entry = Entry();
+	entry->name = name;
+	entry->kind = kind;
+	entry->open = true;
+	entry->cloexec = cloexec;
+}
+
+/**
+ * Names a file descriptor once what it refers to is known, as a socket when it connects, its capture budget starts again.
+ *
+ * @param fd   The file descriptor.
+ * @param name The new name.
+ */
+void FdTable::rename(int fd, const string& name) {
+	Entry* entry = this->adopt(fd);
+	if (entry == nullptr) {
+		return;
+	}
+	entry->name = name;
+	FdTable::resetCapture(*entry);
+}
+
+/**
+ * Records a copy made by dup, dup2, dup3 or fcntl, it refers to the same file but it is captured on its own.
+ *
+ * @param fd      The original file descriptor.
+ * @param copy    The new file descriptor.
+ * @param cloexec True if the copy is closed by execve, the flag is never copied.
+ */
+void FdTable::duplicate(int fd, int copy, bool cloexec) {
+	if (fd == copy) {
+		return;
+	}
+	Entry* original = this->adopt(fd);
+	if (original == nullptr) {
+		return;
+	}
+	// Both are taken by value, the vector may grow
+	string name = original->name;
+	Kind kind = original->kind;
+	this->open(copy, name, kind, cloexec);
+}
+
+void FdTable::setCloexec(int fd, bool cloexec) {
+	Entry* entry = this->adopt(fd);
+	if (entry != nullptr) {
+		entry->cloexec = cloexec;
+	}
+}
+
+/**
+ * Clears the entry of a closed file descriptor, so that it is ready for the next one with the same number.
+ */
+void FdTable::close(int fd) {
+	if (fd >= 0 && (size_t) fd < this->entries.size()) {
+		this->entries[fd] = Entry();
+	}
+}
+
+/**
+ * Applies a close_range.
+ *
+ * @param first       The first file descriptor.
+ * @param last        The last file descriptor, included.
+ * @param cloexecOnly True if the file descriptors are only marked to be closed by execve (CLOSE_RANGE_CLOEXEC).
+ */
+void FdTable::closeRange(unsigned int first, unsigned int last, bool cloexecOnly) {
+	for (size_t fd = first; fd <= last && fd < this->entries.size(); fd++) {
+		if (cloexecOnly) {
+			this->entries[fd].cloexec = true;
+		} else {
+			this->entries[fd] = Entry();
+		}
+	}
+}
+
+/**
+ * Copies the table of the parent into the one of a new child, the capture starts again since the child writes its
+ * own payload files.
+ *
+ * @param parent The table of the process that forked.
+ */
+void FdTable::inherit(const FdTable& parent) {
+	this->entries = parent.entries;
+	for (Entry& entry : this->entries) {
+		FdTable::resetCapture(entry);
+		entry.readFile = -1;
+		entry.writeFile = -1;
+	}
+}
+
+/**
+ * Closes the file descriptors marked with O_CLOEXEC, after a successful execve.
+ */
+void FdTable::exec() {
+	for (Entry& entry : this->entries) {
+		if (entry.cloexec) {
+			entry = Entry();
+		}
+	}
+}
+
+void FdTable::resetCapture(Entry& entry) {
+	entry.selected = -1;
+	entry.captured = 0;
+	entry.counters = nullptr;
+}
@@ -0,0 +1,58 @@
+#ifndef PTRACER_FDTABLE_H
+#define PTRACER_FDTABLE_H
+
+#include <string>
+#include <vector>
+
+struct IoCounters;
+
+// File descriptors of a traced process, shared by all its decoders: a dense vector indexed by file descriptor, kept up
+// to date from the system calls that create, duplicate and close them, and copied to the children on fork. The entry
+// of a closed file descriptor is cleared and reused by the next one with the same number, as the kernel does.
+class FdTable {
+public:
+	enum Kind {
+		UNKNOWN,
+		PATH,
+		SOCKET,
+		PIPE
+	};
+	struct Entry {
+		// The opened path, the socket peer or the pipe, empty if unknown
+		std::string name;
+		Kind kind = UNKNOWN;
+		bool open = false;
+		bool cloexec = false;
+		// PayloadCapture state, it starts again when the file descriptor is reused or renamed:
+		// -1 not decided yet, 0 filtered out, 1 captured
+		int selected = -1;
+		unsigned long captured = 0;
+		// Counters of the name in metadata only mode, nullptr until the first transfer
+		IoCounters* counters = nullptr;
+		// PayloadWriter file identifiers of the content read and written, -1 if nothing has been captured yet
+		int readFile = -1;
+		int writeFile = -1;
+	};
+	// Larger file descriptors are not tracked, it is the default limit of the kernel (fs.nr_open)
+	static const int MAX_FDS;
+	FdTable();
+	Entry* find(int fd);
+	[[nodiscard]] const Entry* find(int fd) const;
+	Entry* adopt(int fd);
+	[[nodiscard]] std::string getName(int fd) const;
+	[[nodiscard]] const std::vector<Entry>& getEntries() const;
+	void open(int fd, const std::string& name, Kind kind, bool cloexec);
+	void rename(int fd, const std::string& name);
+	void duplicate(int fd, int copy, bool cloexec);
+	void setCloexec(int fd, bool cloexec);
+	void close(int fd);
+	void closeRange(unsigned int first, unsigned int last, bool cloexecOnly);
+	void inherit(const FdTable& parent);
+	void exec();
+
+private:
+	std::vector<Entry> entries;
+	static void resetCapture(Entry& entry);
+};
+
+#endif //PTRACER_FDTABLE_H
@@ -1,33 +1,39 @@
 #include <cassert>
 #include <chrono>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <sys/syscall.h>
 #include "FileDecoder.h"
+#include "SyscallDispatchTable.h"
+#include "PayloadWriter.h"
 #include "../Tracer.h"
 
 using namespace std;
 
 const filesystem::path FileDecoder::root{"./FileDecoder"};
 
-//TODO: sendfile
-
 const set<int> FileDecoder::READ_SYSCALLS = {SYS_read,
                                              SYS_recvfrom,
 																						 SYS_pread64,
-                                             // SYS_recvmsg, TODO: Need to interpret msghdr*
-                                             // SYS_recvmmsg, TODO: Need to interpret mmsghdr*
+                                             SYS_readv,
+                                             SYS_preadv,
+                                             SYS_preadv2,
+                                             SYS_recvmsg,
+                                             SYS_recvmmsg,
 #ifdef SYS_recv
 																						 SYS_recv
 #endif
 };
 
 const set<int> FileDecoder::WRITE_SYSCALLS = {SYS_write,
-// TODO: SYS_sendmsg,
-// TODO: SYS_sendmmsg, Need to interpret const struct msghdr* msg
-// TODO: SYS_pwritev, SYS_pwritev2
 		                                          SYS_sendto,
 		                                          SYS_pwrite64,
+		                                          SYS_writev,
+		                                          SYS_pwritev,
+		                                          SYS_pwritev2,
+		                                          SYS_sendmsg,
+		                                          SYS_sendmmsg,
 #ifdef SYS_send
 																							SYS_send
 #endif
@@ -35,40 +41,45 @@ const set<int> FileDecoder::WRITE_SYSCALLS = {SYS_write,
 
 const set<int> FileDecoder::OPEN_SYSCALLS = {SYS_openat,
 																						 SYS_openat2,
-																						 SYS_name_to_handle_at,
 #ifdef SYS_creat
 																						 SYS_creat,
 #endif
 // TODO: Missing open_by_handle_at
-// TODO: Implement dup, dup2 and dup3
-// TODO: Implement pipe for redirections
 #ifdef SYS_open
 																						 SYS_open,
 #endif
 };
 
-void FileDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
-	if (!filesystem::is_directory(root)) {
+void FileDecoder::registerAt() {
+	if (!PayloadWriter::isArchive() && !PayloadCapture::isMetadataOnly() && !filesystem::is_directory(root)) {
 		filesystem::create_directory(root);
 	}
-	shared_ptr<SyscallDecoder> thisDecoder(new FileDecoder());
+	int thisDecoder = SyscallDispatchTable::registerDecoder<FileDecoder>([](ProcessSyscallDecoderMapper& mapper) -> SyscallDecoder* {
+		return new FileDecoder(mapper.getFdTable(), mapper.getCapture());
+	});
 	for (int syscall : FileDecoder::READ_SYSCALLS) {
 		// It is necessary to first save the buffer address and then read it when the syscall will be completed
-		mapper.registerEntrySyscallDecoder(syscall, thisDecoder);
-		mapper.registerExitSyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
 	}
 	for (int syscall : FileDecoder::WRITE_SYSCALLS) {
-		mapper.registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		if (PayloadCapture::isMetadataOnly()) {
+			// Only the return value tells how many bytes have been written
+			SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
+		}
 	}
 	for (int syscall : FileDecoder::OPEN_SYSCALLS) {
-		mapper.registerEntrySyscallDecoder(syscall, thisDecoder);
-		mapper.registerExitSyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
 	}
-	//TODO: Also mmap can be used to read a file
+	// The files read and written through mmap are followed by the MappingDecoder
 }
 
 bool FileDecoder::decode(const ProcessSyscallEntry& syscall) {
-	if (FileDecoder::READ_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::READ_SYSCALLS.end()) {
+	if (IoVector::VECTORED_SYSCALLS.find(syscall.getSyscall()) != IoVector::VECTORED_SYSCALLS.end()) {
+		return this->decodeVectorEntry(syscall);
+	} else if (FileDecoder::READ_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::READ_SYSCALLS.end()) {
 		return this->decodeReadEntry(syscall);
 	} else if (FileDecoder::WRITE_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::WRITE_SYSCALLS.end()) {
 		return this->decodeWrite(syscall);
@@ -79,8 +90,12 @@ bool FileDecoder::decode(const ProcessSyscallEntry& syscall) {
 }
 
 bool FileDecoder::decode(const ProcessSyscallExit& syscall) {
-	if (FileDecoder::READ_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::READ_SYSCALLS.end()) {
+	if (IoVector::VECTORED_SYSCALLS.find(syscall.getSyscall()) != IoVector::VECTORED_SYSCALLS.end()) {
+		return this->decodeVectorExit(syscall);
+	} else if (FileDecoder::READ_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::READ_SYSCALLS.end()) {
 		return this->decodeReadExit(syscall);
+	} else if (FileDecoder::WRITE_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::WRITE_SYSCALLS.end()) {
+		return this->decodeWriteExit(syscall);
 	} else {
 		assert(FileDecoder::OPEN_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::OPEN_SYSCALLS.end());
 		return this->decodeOpenExit(syscall);
@@ -88,50 +103,81 @@ bool FileDecoder::decode(const ProcessSyscallExit& syscall) {
 }
 
 /**
- * Prints a report of all the opened paths observed.
+ * Prints a report of the file descriptors still open, of the content extracted and of the paths that could not be opened.
  */
 void FileDecoder::printReport() const {
 	cout << "------------------ FILE DECODER START ------------------" << endl;
-	for (const shared_ptr<PathFD>& pathFd : this->paths) {
-		if (pathFd->fd >= 0) {
-			cout << "File Descriptor: " << pathFd->fd << " <---> " << pathFd->path << endl;
-			if (pathFd->readStream != nullptr) {
-				cout << "Read content extracted in: " << *pathFd->readPath << ", bytes: " << filesystem::file_size(*pathFd->readPath) << endl;
-			}
-			if (pathFd->writeStream != nullptr) {
-				cout << "Write content extracted in: " << *pathFd->writePath << ", bytes: " << filesystem::file_size(*pathFd->writePath) << endl;
-			}
-		} else {
-			cout << "Attempt to open path: " << pathFd->path << " failed with error: " << pathFd->fd << ", " << strerror(-pathFd->fd) << endl;
+	const vector<FdTable::Entry>& entries = this->fds->getEntries();
+	for (size_t fd = 0; fd < entries.size(); fd++) {
+		if (entries[fd].open) {
+			cout << "File Descriptor: " << fd << " <---> " << this->fds->getName((int) fd) << endl;
 		}
 	}
+	for (const ExtractedContent& content : this->extracted) {
+		cout << (content.read ? "Read" : "Write") << " content of File Descriptor " << content.fd << " (" << content.name
+		     << ") extracted in: " << content.path << ", bytes: " << PayloadWriter::getWritten(content.file) << endl;
+	}
+	for (const auto& failure : this->failures) {
+		cout << "Attempt to open path: " << failure.first << " failed " << failure.second.attempts << " times, last error: "
+		     << failure.second.error << ", " << strerror(-failure.second.error) << endl;
+	}
 	cout << "------------------ FILE DECODER STOP ------------------" << endl;
 }
 
-FileDecoder::FileDecoder() {
-	// Pre-create entries for STDIN, STDOUT and STDERR
-	shared_ptr<PathFD> path;
-	path = this->paths.emplace_back(make_shared<PathFD>("STDIN", 0));
-	this->activePaths[0] = path;
-	path = this->paths.emplace_back(make_shared<PathFD>("STDOUT", 1));
-	this->activePaths[1] = path;
-	path = this->paths.emplace_back(make_shared<PathFD>("STDERR", 2));
-	this->activePaths[2] = path;
+/**
+ * @param fds     The file descriptors of the process, the opened ones are added to it.
+ * @param capture The payload budgets of the process.
+ */
+FileDecoder::FileDecoder(shared_ptr<FdTable> fds, shared_ptr<PayloadCapture> capture) : fds(std::move(fds)), capture(std::move(capture)) {
 }
 
-void FileDecoder::makeOfstream(int fd, pid_t pid, const string& operation, filesystem::path** path, ofstream** stream) {
-	filesystem::path pidRoot(FileDecoder::root / to_string(pid));
-	filesystem::create_directory(pidRoot);
+/**
+ * Registers at the PayloadWriter a new file where the content read or written through a file descriptor is saved.
+ *
+ * @param fd        The file descriptor.
+ * @param pid       The process that owns fd.
+ * @param operation Either read or write.
+ * @param path      Where the path of the new file will be stored.
+ * @return The PayloadWriter file identifier.
+ */
+int FileDecoder::makeOutFile(int fd, pid_t pid, const string& operation, filesystem::path& path) {
 	// All file descriptors are unique per process per execution, but once closed can be reused
 	string timestamp = to_string(duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count());
-	*path = new filesystem::path(pidRoot / (to_string(fd) + "-" + operation + "-" + timestamp));
-	*stream = new ofstream(**path, ios::out | ios::binary);
+	// The directories are created by the PayloadWriter, if needed
+	path = FileDecoder::root / to_string(pid) / (to_string(fd) + "-" + operation + "-" + timestamp);
+	return PayloadWriter::open(path, pid, fd, operation == "read" ? PayloadArchive::READ : PayloadArchive::WRITE);
 }
 
 bool FileDecoder::decodeOpenEntry(const ProcessSyscallEntry& syscall) {
-	string path = syscall.getTracer()->extractString(syscall.argument(1), 2048);
-	shared_ptr<PathFD> pathFD = this->paths.emplace_back(make_shared<PathFD>(move(path), -1));
-	this->awaitingFD[syscall.getSpid()] = pathFD;
+	const Tracer& tracer = *syscall.getTracer();
+	unsigned long long flags = 0;
+	unsigned short pathArgument = 1;
+	switch (syscall.getSyscall()) {
+#ifdef SYS_open
+		case SYS_open:
+			// open(pathname, flags, mode)
+			pathArgument = 0;
+			flags = syscall.argument(1);
+			break;
+#endif
+#ifdef SYS_creat
+		case SYS_creat:
+			pathArgument = 0;
+			break;
+#endif
+		case SYS_openat2:
+			// openat2(dirfd, pathname, how, size), the flags are the first field of the open_how structure
+			if (!tracer.readMemory(syscall.argument(2), &flags, sizeof(flags))) {
+				flags = 0;
+			}
+			break;
+		default:
+			// openat(dirfd, pathname, flags, mode)
+			flags = syscall.argument(2);
+			break;
+	}
+	string path = tracer.extractString(syscall.argument(pathArgument), 2048);
+	this->awaitingFD[syscall.getSpid()] = (OpenParameters) { std::move(path), (flags & O_CLOEXEC) != 0 };
 	return true;
 }
 
@@ -141,10 +187,13 @@ bool FileDecoder::decodeOpenExit(const ProcessSyscallExit& syscall) {
 		cerr << "Received a syscall exit that does not match any open syscall entry!" << endl;
 		return false;
 	}
-	shared_ptr<PathFD> path = it->second;
-	path->fd = syscall.getReturnValue();
-	if (path->fd >= 0) {
-		this->activePaths[path->fd] = path;
+	int fd = (int) syscall.getReturnValue();
+	if (fd >= 0) {
+		this->fds->open(fd, it->second.path, FdTable::PATH, it->second.cloexec);
+	} else {
+		FailedOpen& failure = this->failures[it->second.path];
+		failure.error = fd;
+		failure.attempts++;
 	}
 	this->awaitingFD.erase(it);
 	return true;
@@ -164,56 +213,146 @@ bool FileDecoder::decodeReadExit(const ProcessSyscallExit& syscall) {
 	}
 	ReadParameters readParameters = parametersIt->second;
 	this->awaitingRead.erase(parametersIt);
+	if (PayloadCapture::isMetadataOnly()) {
+		this->capture->account(readParameters.fd, true, returnValue);
+		return true;
+	}
 	if (returnValue < 0 || readParameters.len <= 0) {
 		// TODO: It should be reported, for now ignore
 		return true;
 	}
-	auto it = this->activePaths.find(readParameters.fd);
-	shared_ptr<PathFD> path;
-	if (it == this->activePaths.end()) {
-		// This FD does not correspond with a file
-		// TODO: Better integrate this with sockets
-		path = this->paths.emplace_back(make_shared<PathFD>("socket-" + to_string(readParameters.fd), readParameters.fd));
-		this->activePaths[path->fd] = path;
-	} else {
-		path = it->second;
+	// The system call returns the number of bytes read, 0 at the end of the file
+	if (returnValue == 0) {
+		return true;
 	}
-	if (path->readStream == nullptr) {
-		this->makeOfstream(readParameters.fd, syscall.getPid(), "read", &path->readPath, &path->readStream);
+	// The read succeeded, so the file descriptor is open even if it has not been seen opening
+	this->fds->adopt(readParameters.fd);
+	iovec segment { (void*) readParameters.buffer, (size_t) returnValue };
+	return this->capturePayload(*syscall.getTracer(), syscall.getPid(), readParameters.fd, true, &segment, 1);
+}
+
+//TODO: read and write are too similar -> unify in one parametrized function
+bool FileDecoder::decodeWrite(const ProcessSyscallEntry& syscall) {
+	if (PayloadCapture::isMetadataOnly()) {
+		// The buffer is never read, the exit tells how many bytes have been written
+		this->awaitingWrite[syscall.getSpid()] = (int) syscall.argument(0);
+		return true;
 	}
-	// The system call will return the number of read bytes or 0 if the buffer has been filled
-	ssize_t len = returnValue ? returnValue : readParameters.len;
-	char* extracted = (char*) (syscall.getTracer()->extractBytes(readParameters.buffer, len));
-	if (!extracted) {
+	iovec segment { (void*) syscall.argument(1), (size_t) syscall.argument(2) };
+	return this->capturePayload(*syscall.getTracer(), syscall.getPid(), (int) syscall.argument(0), false, &segment, 1);
+}
+
+/**
+ * Counts the bytes written by a write system call, only in metadata only mode.
+ *
+ * @param syscall The write system call exit.
+ * @return True if the matching entry has been found, False otherwise.
+ */
+bool FileDecoder::decodeWriteExit(const ProcessSyscallExit& syscall) {
+	auto it = this->awaitingWrite.find(syscall.getSpid());
+	if (it == this->awaitingWrite.end()) {
+		cerr << "Cannot find a matching system call entry for the received write system call!" << endl;
 		return false;
 	}
-	path->readStream->write(extracted, len);
-	path->readStream->flush();
-	delete[] extracted;
+	this->capture->account(it->second, false, (long long) syscall.getReturnValue());
+	this->awaitingWrite.erase(it);
 	return true;
 }
 
-//TODO: read and write are too similar -> unify in one parametrized function
-bool FileDecoder::decodeWrite(const ProcessSyscallEntry& syscall) {
-	auto it = this->activePaths.find(syscall.argument(0));
-	shared_ptr<PathFD> path;
-	if (it == this->activePaths.end()) {
-		// This FD does not correspond with a file
-		// TODO: Better integrate this with sockets
-		path = this->paths.emplace_back(make_shared<PathFD>("socket-" + to_string(syscall.argument(0)), syscall.argument(0)));
-		this->activePaths[path->fd] = path;
-	} else {
-		path = it->second;
+/**
+ * Reads the buffers of a scatter-gather system call: a write is captured right away, a read once it is completed.
+ * In metadata only mode the buffers are never read, the exit only counts the bytes transferred.
+ *
+ * @param syscall One of IoVector::VECTORED_SYSCALLS.
+ * @return True if the buffers have been read, False otherwise.
+ */
+bool FileDecoder::decodeVectorEntry(const ProcessSyscallEntry& syscall) {
+	IoVector vector;
+	if (!vector.decodeEntry(syscall, !PayloadCapture::isMetadataOnly())) {
+		cerr << "Impossible to read the buffers of the scatter-gather system call " << syscall.getSyscall() << endl;
+		return false;
 	}
-	if (path->writeStream == nullptr) {
-		this->makeOfstream(syscall.argument(0), syscall.getPid(), "write", &path->writePath, &path->writeStream);
+	if (FileDecoder::WRITE_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::WRITE_SYSCALLS.end() && !PayloadCapture::isMetadataOnly()) {
+		return this->capturePayload(*syscall.getTracer(), syscall.getPid(), vector.getFd(), false, vector.getSegments().data(), vector.getSegments().size());
 	}
-	char* extracted = (char*) (syscall.getTracer()->extractBytes(syscall.argument(1), syscall.argument(2)));
-	if (!extracted) {
+	this->awaitingVector[syscall.getSpid()] = std::move(vector);
+	return true;
+}
+
+/**
+ * Captures, or counts in metadata only mode, the bytes transferred by a scatter-gather system call.
+ *
+ * @param syscall The exit of a system call decoded by FileDecoder::decodeVectorEntry.
+ * @return True if the bytes transferred have been captured, False otherwise.
+ */
+bool FileDecoder::decodeVectorExit(const ProcessSyscallExit& syscall) {
+	auto it = this->awaitingVector.find(syscall.getSpid());
+	if (it == this->awaitingVector.end()) {
+		cerr << "Cannot find a matching system call entry for the received scatter-gather system call!" << endl;
 		return false;
 	}
-	path->writeStream->write(extracted, syscall.argument(2));
-	path->writeStream->flush();
-	delete[] extracted;
+	IoVector vector = std::move(it->second);
+	this->awaitingVector.erase(it);
+	bool read = FileDecoder::READ_SYSCALLS.find(syscall.getSyscall()) != FileDecoder::READ_SYSCALLS.end();
+	if (!vector.decodeExit(syscall)) {
+		cerr << "Impossible to read the messages transferred by the system call " << syscall.getSyscall() << endl;
+		return false;
+	}
+	long long result = (long long) syscall.getReturnValue();
+	if (PayloadCapture::isMetadataOnly()) {
+		this->capture->account(vector.getFd(), read, result < 0 ? result : (long long) vector.getLength());
+		return true;
+	}
+	if (vector.getLength() == 0) {
+		return true;
+	}
+	this->fds->adopt(vector.getFd());
+	return this->capturePayload(*syscall.getTracer(), syscall.getPid(), vector.getFd(), read, vector.getSegments().data(), vector.getSegments().size());
+}
+
+/**
+ * Reads from the tracee the bytes of a payload allowed by the capture policy and queues them at the PayloadWriter.
+ * The output file is registered only when the first bytes are captured, a file descriptor not known to be open is
+ * skipped: a write is captured at its entry, before the kernel tells if the file descriptor is valid.
+ *
+ * @param tracer   The tracer of the thread that transfers the payload.
+ * @param pid      The process that owns the file descriptor.
+ * @param fd       The file descriptor the payload is transferred through.
+ * @param read     True if the payload has been read by the tracee, False if it has been written.
+ * @param segments The payload areas in the tracee, a single one unless the system call is a scatter-gather one.
+ * @param count    The number of areas.
+ * @return True if the allowed bytes have been captured, False if they cannot be read.
+ */
+bool FileDecoder::capturePayload(const Tracer& tracer, pid_t pid, int fd, bool read, const iovec* segments, size_t count) {
+	unsigned long length = 0;
+	for (size_t i = 0; i < count; i++) {
+		length += segments[i].iov_len;
+	}
+	PayloadCapture::Ranges ranges = this->capture->plan(fd, length);
+	FdTable::Entry* entry = this->fds->find(fd);
+	if (ranges.empty() || entry == nullptr) {
+		return true;
+	}
+	int& file = read ? entry->readFile : entry->writeFile;
+	if (file < 0) {
+		ExtractedContent& content = this->extracted.emplace_back();
+		content.fd = fd;
+		content.name = this->fds->getName(fd);
+		content.read = read;
+		content.file = file = FileDecoder::makeOutFile(fd, pid, read ? "read" : "write", content.path);
+	}
+	// The bytes go from the tracee memory straight to the PayloadWriter staging area
+	for (const auto& range : ranges) {
+		if (range.first == 0 && range.second == length) {
+			if (!PayloadWriter::capture(file, tracer, segments, count)) {
+				return false;
+			}
+			continue;
+		}
+		IoVector::Segments slice = IoVector::slice(segments, count, range.first, range.second);
+		if (!PayloadWriter::capture(file, tracer, slice.data(), slice.size())) {
+			return false;
+		}
+	}
 	return true;
-}
\ No newline at end of file
+}
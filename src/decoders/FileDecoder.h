@@ -2,26 +2,32 @@
 #define PTRACER_FILEDECODER_H
 
 #include <filesystem>
-#include <fstream>
+#include <map>
 #include <utility>
+#include "FdTable.h"
+#include "IoVector.h"
+#include "PayloadCapture.h"
 #include "SyscallDecoder.h"
 
-struct PathFD {
+struct OpenParameters {
 	std::string path;
-	int fd;
-	std::filesystem::path* readPath = nullptr;
-	std::ofstream* readStream = nullptr;
-	std::filesystem::path* writePath = nullptr;
-	std::ofstream* writeStream = nullptr;
+	bool cloexec;
+};
 
-	PathFD(std::string path, int fd) : path(std::move(path)), fd(fd) {}
+// A file where the content read or written through a file descriptor is saved
+struct ExtractedContent {
+	int fd;
+	std::string name;
+	bool read;
+	std::filesystem::path path;
+	// PayloadWriter file identifier
+	int file;
+};
 
-	~PathFD() {
-		delete readPath;
-		delete readStream;
-		delete writePath;
-		delete writeStream;
-	}
+struct FailedOpen {
+	// The error of the last attempt
+	int error;
+	unsigned long attempts;
 };
 
 struct ReadParameters {
@@ -32,7 +38,7 @@ struct ReadParameters {
 
 class FileDecoder : public SyscallDecoder {
 public:
-	static void registerAt(ProcessSyscallDecoderMapper& mapper);
+	static void registerAt();
 	bool decode(const ProcessSyscallEntry& syscall) override;
 	bool decode(const ProcessSyscallExit& syscall) override;
 	void printReport() const override;
@@ -41,17 +47,27 @@ private:
 	static const std::set<int> WRITE_SYSCALLS;
 	static const std::set<int> READ_SYSCALLS;
 	static const std::set<int> OPEN_SYSCALLS;
-	static void makeOfstream(int fd, pid_t pid, const std::string& operation, std::filesystem::path** path, std::ofstream** stream);
-	std::vector<std::shared_ptr<PathFD>> paths;
-	std::map<int, std::shared_ptr<PathFD>> activePaths;
-	std::unordered_map<pid_t, std::shared_ptr<PathFD>> awaitingFD;
+	static int makeOutFile(int fd, pid_t pid, const std::string& operation, std::filesystem::path& path);
+	std::vector<ExtractedContent> extracted;
+	std::map<std::string, FailedOpen> failures;
+	std::unordered_map<pid_t, OpenParameters> awaitingFD;
 	std::unordered_map<pid_t, ReadParameters> awaitingRead;
-	FileDecoder();
+	// File descriptor of the write system calls in progress, only in metadata only mode
+	std::unordered_map<pid_t, int> awaitingWrite;
+	// Scatter-gather reads in progress, and writes only in metadata only mode
+	std::unordered_map<pid_t, IoVector> awaitingVector;
+	const std::shared_ptr<FdTable> fds;
+	const std::shared_ptr<PayloadCapture> capture;
+	FileDecoder(std::shared_ptr<FdTable> fds, std::shared_ptr<PayloadCapture> capture);
 	bool decodeOpenEntry(const ProcessSyscallEntry& syscall);
 	bool decodeOpenExit(const ProcessSyscallExit& syscall);
 	bool decodeReadEntry(const ProcessSyscallEntry& syscall);
 	bool decodeReadExit(const ProcessSyscallExit& syscall);
 	bool decodeWrite(const ProcessSyscallEntry& syscall);
+	bool decodeWriteExit(const ProcessSyscallExit& syscall);
+	bool decodeVectorEntry(const ProcessSyscallEntry& syscall);
+	bool decodeVectorExit(const ProcessSyscallExit& syscall);
+	bool capturePayload(const Tracer& tracer, pid_t pid, int fd, bool read, const iovec* segments, size_t count);
 };
 
 #endif //PTRACER_FILEDECODER_H
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include "IoVector.h"
+#include "../Tracer.h"
+
+using namespace std;
+
+const set<int> IoVector::VECTORED_SYSCALLS = {SYS_readv,
+                                              SYS_writev,
+                                              SYS_preadv,
+                                              SYS_pwritev,
+                                              SYS_preadv2,
+                                              SYS_pwritev2,
+                                              SYS_recvmsg,
+                                              SYS_sendmsg,
+                                              SYS_recvmmsg,
+                                              SYS_sendmmsg};
+
+const set<int> IoVector::MESSAGE_SYSCALLS = {SYS_recvmsg, SYS_sendmsg};
+
+const set<int> IoVector::MULTI_MESSAGE_SYSCALLS = {SYS_recvmmsg, SYS_sendmmsg};
+
+/**
+ * Selects a byte range of a payload scattered in several areas.
+ *
+ * @param segments The payload areas, in order.
+ * @param count    The number of areas.
+ * @param offset   Where the range starts in the payload.
+ * @param length   The range size.
+ * @return The areas of the range, shorter if the payload ends before the range.
+ */
+IoVector::Segments IoVector::slice(const iovec* segments, size_t count, unsigned long offset, unsigned long length) {
+	Segments result;
+	for (size_t i = 0; i < count && length > 0; i++) {
+		if (offset >= segments[i].iov_len) {
+			offset -= segments[i].iov_len;
+			continue;
+		}
+		size_t part = min(segments[i].iov_len - offset, (size_t) length);
+		result.push_back({ (char*) segments[i].iov_base + offset, part });
+		length -= part;
+		offset = 0;
+	}
+	return result;
+}
+
+/**
+ * Reads the buffers declared by a scatter-gather system call, the file descriptor is always the first argument.
+ *
+ * @param syscall One of IoVector::VECTORED_SYSCALLS.
+ * @param buffers True to read the iovec arrays, False if only the number of bytes transferred is needed.
+ * @return True if the buffers have been read, False if the tracee memory cannot be read.
+ */
+bool IoVector::decodeEntry(const ProcessSyscallEntry& syscall, bool buffers) {
+	const Tracer& tracer = *syscall.getTracer();
+	this->syscall = syscall.getSyscall();
+	this->fd = (int) syscall.argument(0);
+	this->segments.clear();
+	this->messageEnds.clear();
+	this->length = 0;
+	if (IoVector::MULTI_MESSAGE_SYSCALLS.find(this->syscall) != IoVector::MULTI_MESSAGE_SYSCALLS.end()) {
+		// Like the kernel, at most IOV_MAX messages are transferred
+		this->messagesAddress = syscall.argument(1);
+		this->messageCount = min(syscall.argument(2), (unsigned long long) IOV_MAX);
+		if (!buffers || this->messageCount == 0) {
+			return true;
+		}
+		vector<mmsghdr> headers(this->messageCount);
+		if (!tracer.readMemory(this->messagesAddress, headers.data(), headers.size() * sizeof(mmsghdr))) {
+			return false;
+		}
+		for (const mmsghdr& header : headers) {
+			if (!this->readSegments(tracer, (unsigned long long) header.msg_hdr.msg_iov, header.msg_hdr.msg_iovlen)) {
+				return false;
+			}
+			this->messageEnds.push_back(this->segments.size());
+		}
+	} else if (!buffers) {
+		return true;
+	} else if (IoVector::MESSAGE_SYSCALLS.find(this->syscall) != IoVector::MESSAGE_SYSCALLS.end()) {
+		msghdr header = {};
+		if (!tracer.readMemory(syscall.argument(1), &header, sizeof(header)) ||
+		    !this->readSegments(tracer, (unsigned long long) header.msg_iov, header.msg_iovlen)) {
+			return false;
+		}
+	} else if (!this->readSegments(tracer, syscall.argument(1), syscall.argument(2))) {
+		return false;
+	}
+	for (const iovec& segment : this->segments) {
+		this->length += segment.iov_len;
+	}
+	return true;
+}
+
+/**
+ * Restricts the buffers to the bytes the system call has transferred.
+ *
+ * @param syscall The exit of the system call decoded by IoVector::decodeEntry.
+ * @return True if the bytes transferred are known, False if the lengths of the messages cannot be read.
+ */
+bool IoVector::decodeExit(const ProcessSyscallExit& syscall) {
+	long long result = (long long) syscall.getReturnValue();
+	vector<unsigned int> messageLengths;
+	if (result > 0 && IoVector::MULTI_MESSAGE_SYSCALLS.find(this->syscall) != IoVector::MULTI_MESSAGE_SYSCALLS.end()) {
+		// The result is the number of messages, the kernel stores the length of each one in its msg_len
+		vector<mmsghdr> headers(min((size_t) result, this->messageCount));
+		if (!headers.empty() && !syscall.getTracer()->readMemory(this->messagesAddress, headers.data(), headers.size() * sizeof(mmsghdr))) {
+			return false;
+		}
+		for (const mmsghdr& header : headers) {
+			messageLengths.push_back(header.msg_len);
+		}
+	}
+	this->keepTransferred(result, messageLengths);
+	return true;
+}
+
+int IoVector::getFd() const {
+	return this->fd;
+}
+
+/**
+ * @return The bytes declared after IoVector::decodeEntry, the bytes transferred after IoVector::decodeExit.
+ */
+unsigned long IoVector::getLength() const {
+	return this->length;
+}
+
+/**
+ * @return The tracee areas of the payload, empty if the buffers have not been read.
+ */
+const IoVector::Segments& IoVector::getSegments() const {
+	return this->segments;
+}
+
+/**
+ * Cuts the buffers to the bytes transferred, the first bytes of every message for recvmmsg and sendmmsg.
+ *
+ * @param result         The return value of the system call.
+ * @param messageLengths Only recvmmsg and sendmmsg: the msg_len of every message transferred.
+ */
+void IoVector::keepTransferred(long long result, const vector<unsigned int>& messageLengths) {
+	if (result < 0) {
+		this->segments.clear();
+		this->length = 0;
+		return;
+	}
+	if (IoVector::MULTI_MESSAGE_SYSCALLS.find(this->syscall) == IoVector::MULTI_MESSAGE_SYSCALLS.end()) {
+		this->length = (unsigned long) result;
+		this->segments = IoVector::slice(this->segments.data(), this->segments.size(), 0, this->length);
+		return;
+	}
+	Segments transferred;
+	this->length = 0;
+	for (size_t i = 0; i < messageLengths.size(); i++) {
+		this->length += messageLengths[i];
+		if (i < this->messageEnds.size()) {
+			size_t first = i == 0 ? 0 : this->messageEnds[i - 1];
+			Segments message = IoVector::slice(this->segments.data() + first, this->messageEnds[i] - first, 0, messageLengths[i]);
+			transferred.insert(transferred.end(), message.begin(), message.end());
+		}
+	}
+	this->segments = std::move(transferred);
+}
+
+/**
+ * Appends the areas of an iovec array of the tracee.
+ *
+ * @param tracer  The tracer of the thread that issued the system call.
+ * @param address The iovec array in the tracee.
+ * @param count   The number of iovec, the kernel rejects more than IOV_MAX of them.
+ * @return True if the array has been read, False otherwise.
+ */
+bool IoVector::readSegments(const Tracer& tracer, unsigned long long address, size_t count) {
+	if (count == 0 || count > IOV_MAX) {
+		return true;
+	}
+	size_t first = this->segments.size();
+	this->segments.resize(first + count);
+	return tracer.readMemory(address, this->segments.data() + first, count * sizeof(iovec));
+}
@@ -0,0 +1,42 @@
+#ifndef PTRACER_IOVECTOR_H
+#define PTRACER_IOVECTOR_H
+
+#include <set>
+#include <vector>
+#include <sys/uio.h>
+#include "../ProcessSyscallEntry.h"
+#include "../ProcessSyscallExit.h"
+
+// Buffers of a scatter-gather system call (readv, writev, preadv, pwritev, recvmsg, sendmsg, recvmmsg and sendmmsg):
+// the iovec arrays, directly or through the msghdr and mmsghdr structures, are read from the tracee at the entry and
+// restricted to the bytes actually transferred at the exit, so that the payload is captured as a single stream.
+class IoVector {
+	friend class IoVectorTest;
+public:
+	typedef std::vector<iovec> Segments;
+	static const std::set<int> VECTORED_SYSCALLS;
+	static Segments slice(const iovec* segments, size_t count, unsigned long offset, unsigned long length);
+	bool decodeEntry(const ProcessSyscallEntry& syscall, bool buffers);
+	bool decodeExit(const ProcessSyscallExit& syscall);
+	[[nodiscard]] int getFd() const;
+	[[nodiscard]] unsigned long getLength() const;
+	[[nodiscard]] const Segments& getSegments() const;
+
+private:
+	static const std::set<int> MESSAGE_SYSCALLS;
+	static const std::set<int> MULTI_MESSAGE_SYSCALLS;
+	int syscall = -1;
+	int fd = -1;
+	Segments segments;
+	// Bytes declared at the entry, transferred after the exit
+	unsigned long length = 0;
+	// Only recvmmsg and sendmmsg: the mmsghdr array and, if the buffers have been read, where the segments of every
+	// message end
+	unsigned long long messagesAddress = 0;
+	size_t messageCount = 0;
+	std::vector<size_t> messageEnds;
+	bool readSegments(const Tracer& tracer, unsigned long long address, size_t count);
+	void keepTransferred(long long result, const std::vector<unsigned int>& messageLengths);
+};
+
+#endif //PTRACER_IOVECTOR_H
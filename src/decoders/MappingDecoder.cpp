@@ -0,0 +1,170 @@
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "MappingDecoder.h"
+#include "SyscallDispatchTable.h"
+#include "../Tracer.h"
+
+using namespace std;
+
+const set<int> MappingDecoder::MAPPING_SYSCALLS = {SYS_mmap, SYS_munmap, SYS_mremap, SYS_msync, SYS_madvise};
+
+const map<int, string> MappingDecoder::ADVICES = {{MADV_NORMAL,     "NORMAL"},
+                                                  {MADV_RANDOM,     "RANDOM"},
+                                                  {MADV_SEQUENTIAL, "SEQUENTIAL"},
+                                                  {MADV_WILLNEED,   "WILLNEED"},
+                                                  {MADV_DONTNEED,   "DONTNEED"},
+                                                  {MADV_REMOVE,     "REMOVE"},
+                                                  {MADV_DONTFORK,   "DONTFORK"},
+                                                  {MADV_DOFORK,     "DOFORK"},
+                                                  {MADV_HUGEPAGE,   "HUGEPAGE"},
+                                                  {MADV_NOHUGEPAGE, "NOHUGEPAGE"},
+#ifdef MADV_FREE
+                                                  {MADV_FREE,       "FREE"},
+#endif
+#ifdef MADV_COLD
+                                                  {MADV_COLD,       "COLD"},
+                                                  {MADV_PAGEOUT,    "PAGEOUT"},
+#endif
+#ifdef MADV_POPULATE_READ
+                                                  {MADV_POPULATE_READ,  "POPULATE_READ"},
+                                                  {MADV_POPULATE_WRITE, "POPULATE_WRITE"},
+#endif
+};
+
+/**
+ * @param fds      The file descriptors of the process, the mappings are named after the mapped file descriptor.
+ * @param mappings The file mappings of the process.
+ * @param capture  The I/O counters of the process in metadata only mode.
+ */
+MappingDecoder::MappingDecoder(shared_ptr<FdTable> fds, shared_ptr<MappingTable> mappings, shared_ptr<PayloadCapture> capture)
+		: fds(std::move(fds)), mappings(std::move(mappings)), capture(std::move(capture)) {
+}
+
+void MappingDecoder::registerAt() {
+	int thisDecoder = SyscallDispatchTable::registerDecoder<MappingDecoder>([](ProcessSyscallDecoderMapper& mapper) -> SyscallDecoder* {
+		return new MappingDecoder(mapper.getFdTable(), mapper.getMappingTable(), mapper.getCapture());
+	});
+	for (int syscall : MappingDecoder::MAPPING_SYSCALLS) {
+		// The mappings change only if the system call succeeds, mmap and mremap return the address at the exit
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
+	}
+}
+
+bool MappingDecoder::decode(const ProcessSyscallEntry& syscall) {
+	this->active[syscall.getSpid()] = { syscall.argument(0), syscall.argument(1), syscall.argument(2), syscall.argument(3),
+	                                    syscall.argument(4) };
+	return true;
+}
+
+bool MappingDecoder::decode(const ProcessSyscallExit& syscall) {
+	auto it = this->active.find(syscall.getSpid());
+	if (it == this->active.end()) {
+		cerr << "Cannot find a matching system call entry for the received memory mapping system call!" << endl;
+		return false;
+	}
+	array<unsigned long long, 5> arguments = it->second;
+	this->active.erase(it);
+	// mmap and mremap return an address, the errors are the last 4095 values
+	unsigned long long result = syscall.getReturnValue();
+	if (result >= (unsigned long long) -4095) {
+		return true;
+	}
+	switch (syscall.getSyscall()) {
+		case SYS_mmap: {
+			// mmap(addr, length, prot, flags, fd, offset)
+			int flags = (int) arguments[3];
+			int fd = (int) arguments[4];
+			if ((flags & MAP_ANONYMOUS) || fd < 0) {
+				// It may replace a file mapping
+				this->mappings->unmap(result, arguments[1]);
+				break;
+			}
+			this->mappings->map(result, arguments[1], this->fds->getName(fd), (int) arguments[2], flags & MAP_SHARED);
+			if (PayloadCapture::isMetadataOnly()) {
+				this->capture->accountMapping(fd, arguments[1]);
+			}
+			break;
+		}
+		case SYS_munmap:
+			this->mappings->unmap(arguments[0], arguments[1]);
+			break;
+		case SYS_mremap:
+			// mremap(old_address, old_size, new_size, flags, new_address)
+			this->mappings->remap(arguments[0], arguments[1], result, arguments[2]);
+			break;
+		case SYS_msync:
+			this->mappings->sync(arguments[0], arguments[1]);
+			break;
+		default:
+			// madvise(addr, length, advice)
+			this->mappings->advise(arguments[0], arguments[1], (int) arguments[2]);
+			break;
+	}
+	return true;
+}
+
+/**
+ * Prints, for every mapped file, how much of it has been mapped, with which protections, how it has been synced and
+ * advised and for how long its mappings lasted.
+ */
+void MappingDecoder::printReport() const {
+	cout << "------------------ MAPPING DECODER START ------------------" << endl;
+	MappingTable::Clock::time_point now = MappingTable::Clock::now();
+	// The oldest mapping still alive of every file
+	map<string, MappingTable::Clock::time_point> oldest;
+	for (const auto& i : this->mappings->getMappings()) {
+		auto inserted = oldest.emplace(i.second.name, i.second.created);
+		if (!inserted.second && i.second.created < inserted.first->second) {
+			inserted.first->second = i.second.created;
+		}
+	}
+	auto milliseconds = [](MappingTable::Clock::duration duration) {
+		return chrono::duration_cast<chrono::milliseconds>(duration).count();
+	};
+	for (const auto& i : this->mappings->getStatistics()) {
+		const MappingTable::Statistics& statistics = i.second;
+		cout << i.first << ": " << statistics.mappedBytes << " bytes in " << statistics.mappings << " mappings, "
+		     << MappingDecoder::formatProt(statistics.prot) << ", " << statistics.shared << " shared, peak " << statistics.peakBytes
+		     << " bytes";
+		if (statistics.remaps > 0) {
+			cout << ", " << statistics.remaps << " remaps";
+		}
+		if (statistics.syncs > 0) {
+			cout << ", msync " << statistics.syncedBytes << " bytes in " << statistics.syncs << " calls";
+		}
+		for (const auto& advice : statistics.advices) {
+			auto name = MappingDecoder::ADVICES.find(advice.first);
+			cout << ", MADV_" << (name != MappingDecoder::ADVICES.end() ? name->second : to_string(advice.first)) << ": " << advice.second;
+		}
+		if (statistics.ended > 0) {
+			cout << ", " << statistics.ended << " unmapped after " << milliseconds(statistics.lifetime) / statistics.ended
+			     << " ms on average, " << milliseconds(statistics.longest) << " ms at most";
+		}
+		auto alive = oldest.find(i.first);
+		if (alive != oldest.end()) {
+			cout << ", " << statistics.currentBytes << " bytes still mapped for " << milliseconds(now - alive->second) << " ms";
+		}
+		cout << endl;
+	}
+	cout << "------------------ MAPPING DECODER STOP ------------------" << endl;
+}
+
+/**
+ * @param prot PROT_* flags.
+ * @return The flags as in /proc/<pid>/maps, as "r-x".
+ */
+string MappingDecoder::formatProt(int prot) {
+	string result = "---";
+	if (prot & PROT_READ) {
+		result[0] = 'r';
+	}
+	if (prot & PROT_WRITE) {
+		result[1] = 'w';
+	}
+	if (prot & PROT_EXEC) {
+		result[2] = 'x';
+	}
+	return result;
+}
@@ -0,0 +1,34 @@
+#ifndef PTRACER_MAPPINGDECODER_H
+#define PTRACER_MAPPINGDECODER_H
+
+#include <array>
+#include <map>
+#include <string>
+#include "FdTable.h"
+#include "MappingTable.h"
+#include "PayloadCapture.h"
+#include "SyscallDecoder.h"
+
+// Follows the files accessed through memory mappings (mmap, munmap, mremap, msync and madvise), which are read and
+// written without any system call: the MappingTable of the process records which files are mapped, with which
+// protections and sizes and for how long, so that the I/O of memory-mapped workloads can be attributed without sampling
+// the page faults.
+class MappingDecoder : public SyscallDecoder {
+public:
+	static void registerAt();
+	bool decode(const ProcessSyscallEntry& syscall) override;
+	bool decode(const ProcessSyscallExit& syscall) override;
+	void printReport() const override;
+private:
+	static const std::set<int> MAPPING_SYSCALLS;
+	static const std::map<int, std::string> ADVICES;
+	// The first arguments of the system calls in progress
+	std::unordered_map<pid_t, std::array<unsigned long long, 5>> active;
+	const std::shared_ptr<FdTable> fds;
+	const std::shared_ptr<MappingTable> mappings;
+	const std::shared_ptr<PayloadCapture> capture;
+	MappingDecoder(std::shared_ptr<FdTable> fds, std::shared_ptr<MappingTable> mappings, std::shared_ptr<PayloadCapture> capture);
+	static std::string formatProt(int prot);
+};
+
+#endif //PTRACER_MAPPINGDECODER_H
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <set>
+#include <unistd.h>
+#include "MappingTable.h"
+
+using namespace std;
+
+const unsigned long long MappingTable::PAGE_BYTES = (unsigned long long) sysconf(_SC_PAGESIZE);
+
+/**
+ * Records a new file mapping, whatever was mapped in its range before has been replaced.
+ *
+ * @param start  The address returned by mmap.
+ * @param length The length requested, the kernel rounds it up to whole pages.
+ * @param name   The path or the socket peer of the mapped file descriptor.
+ * @param prot   The PROT_* flags of the mapping.
+ * @param shared True if the writes reach the file (MAP_SHARED).
+ */
+void MappingTable::map(unsigned long long start, unsigned long long length, const string& name, int prot, bool shared) {
+	this->unmap(start, length);
+	unsigned long long end = start + MappingTable::pageAlign(length);
+	if (end <= start) {
+		return;
+	}
+	unsigned long id = this->nextId++;
+	this->mappings[start] = { end, name, prot, shared, id, MappingTable::Clock::now() };
+	this->pieces[id] = 1;
+	Statistics& statistics = this->statistics[name];
+	statistics.mappings++;
+	statistics.mappedBytes += end - start;
+	statistics.currentBytes += end - start;
+	statistics.peakBytes = max(statistics.peakBytes, statistics.currentBytes);
+	statistics.prot |= prot;
+	statistics.shared += shared ? 1 : 0;
+}
+
+/**
+ * Removes a range from the mappings, the mappings that only partially overlap it are split.
+ *
+ * @param start  The first address.
+ * @param length The length, rounded up to whole pages.
+ */
+void MappingTable::unmap(unsigned long long start, unsigned long long length) {
+	unsigned long long end = start + MappingTable::pageAlign(length);
+	this->split(start);
+	this->split(end);
+	auto it = this->mappings.lower_bound(start);
+	while (it != this->mappings.end() && it->first < end) {
+		auto next = std::next(it);
+		this->erase(it, false);
+		it = next;
+	}
+}
+
+/**
+ * Moves, grows or shrinks a mapping after a successful mremap, the mapping keeps its name, protections and age.
+ *
+ * @param oldStart  The address of the mapping.
+ * @param oldLength The length of the mapped range to move.
+ * @param newStart  The address returned by mremap, it may be the same.
+ * @param newLength The new length.
+ * @return True if the range was a file mapping, False otherwise.
+ */
+bool MappingTable::remap(unsigned long long oldStart, unsigned long long oldLength, unsigned long long newStart,
+                         unsigned long long newLength) {
+	unsigned long long oldEnd = oldStart + MappingTable::pageAlign(oldLength);
+	this->split(oldStart);
+	this->split(oldEnd);
+	auto it = this->mappings.find(oldStart);
+	if (it == this->mappings.end() || oldEnd <= oldStart) {
+		// Whatever was mapped at the destination has been replaced all the same
+		this->unmap(newStart, newLength);
+		return false;
+	}
+	// The kernel only moves ranges within a single mapping
+	Mapping moved = it->second;
+	while (it != this->mappings.end() && it->first < oldEnd) {
+		auto next = std::next(it);
+		this->erase(it, true);
+		it = next;
+	}
+	this->unmap(newStart, newLength);
+	moved.end = newStart + MappingTable::pageAlign(newLength);
+	this->mappings[newStart] = moved;
+	this->pieces[moved.id]++;
+	Statistics& statistics = this->statistics[moved.name];
+	statistics.remaps++;
+	statistics.currentBytes += moved.end - newStart;
+	statistics.peakBytes = max(statistics.peakBytes, statistics.currentBytes);
+	return true;
+}
+
+/**
+ * Counts an msync for every file mapped in its range.
+ */
+void MappingTable::sync(unsigned long long start, unsigned long long length) {
+	set<string> names;
+	this->visit(start, length, [this, &names](const Mapping& mapping, unsigned long long bytes) {
+		Statistics& statistics = this->statistics[mapping.name];
+		statistics.syncedBytes += bytes;
+		statistics.syncs += names.insert(mapping.name).second ? 1 : 0;
+	});
+}
+
+/**
+ * Counts an madvise for every file mapped in its range.
+ *
+ * @param advice The MADV_* advice.
+ */
+void MappingTable::advise(unsigned long long start, unsigned long long length, int advice) {
+	set<string> names;
+	this->visit(start, length, [this, &names, advice](const Mapping& mapping, unsigned long long) {
+		if (names.insert(mapping.name).second) {
+			this->statistics[mapping.name].advices[advice]++;
+		}
+	});
+}
+
+/**
+ * Copies the mappings of the parent into the ones of a new child, the statistics and the lifetimes start again.
+ *
+ * @param parent The table of the process that forked.
+ */
+void MappingTable::inherit(const MappingTable& parent) {
+	MappingTable::Clock::time_point now = MappingTable::Clock::now();
+	this->mappings = parent.mappings;
+	this->pieces = parent.pieces;
+	this->nextId = parent.nextId;
+	this->statistics.clear();
+	for (auto& i : this->mappings) {
+		i.second.created = now;
+		Statistics& statistics = this->statistics[i.second.name];
+		statistics.currentBytes += i.second.end - i.first;
+		statistics.peakBytes = statistics.currentBytes;
+		statistics.prot |= i.second.prot;
+	}
+}
+
+/**
+ * Ends all the mappings, after a successful execve.
+ */
+void MappingTable::exec() {
+	while (!this->mappings.empty()) {
+		this->erase(this->mappings.begin(), false);
+	}
+}
+
+const map<unsigned long long, MappingTable::Mapping>& MappingTable::getMappings() const {
+	return this->mappings;
+}
+
+const map<string, MappingTable::Statistics>& MappingTable::getStatistics() const {
+	return this->statistics;
+}
+
+unsigned long long MappingTable::pageAlign(unsigned long long length) {
+	return (length + MappingTable::PAGE_BYTES - 1) & ~(MappingTable::PAGE_BYTES - 1);
+}
+
+/**
+ * Splits the mapping containing an address, so that a mapping starts at it.
+ */
+void MappingTable::split(unsigned long long address) {
+	auto it = this->mappings.upper_bound(address);
+	if (it == this->mappings.begin()) {
+		return;
+	}
+	--it;
+	if (it->first < address && address < it->second.end) {
+		Mapping tail = it->second;
+		it->second.end = address;
+		this->mappings[address] = tail;
+		this->pieces[tail.id]++;
+	}
+}
+
+/**
+ * Removes a piece of a mapping, the mapping ends with its last piece.
+ *
+ * @param it    The piece.
+ * @param moved True if the piece is moved by mremap, so the mapping goes on.
+ */
+void MappingTable::erase(std::map<unsigned long long, Mapping>::iterator it, bool moved) {
+	const Mapping& mapping = it->second;
+	Statistics& statistics = this->statistics[mapping.name];
+	statistics.currentBytes -= mapping.end - it->first;
+	auto pieces = this->pieces.find(mapping.id);
+	if (pieces != this->pieces.end() && --pieces->second == 0) {
+		this->pieces.erase(pieces);
+		if (!moved) {
+			MappingTable::Clock::duration lifetime = MappingTable::Clock::now() - mapping.created;
+			statistics.ended++;
+			statistics.lifetime += lifetime;
+			statistics.longest = max(statistics.longest, lifetime);
+		}
+	}
+	this->mappings.erase(it);
+}
+
+/**
+ * Calls visitor(mapping, bytes) for every mapping overlapping a range, with the number of bytes overlapping.
+ */
+template<typename Visitor>
+void MappingTable::visit(unsigned long long start, unsigned long long length, Visitor visitor) {
+	unsigned long long end = start + MappingTable::pageAlign(length);
+	auto it = this->mappings.upper_bound(start);
+	if (it != this->mappings.begin() && std::prev(it)->second.end > start) {
+		--it;
+	}
+	for (; it != this->mappings.end() && it->first < end; ++it) {
+		visitor(it->second, min(end, it->second.end) - max(start, it->first));
+	}
+}
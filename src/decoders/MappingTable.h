@@ -0,0 +1,70 @@
+#ifndef PTRACER_MAPPINGTABLE_H
+#define PTRACER_MAPPINGTABLE_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+// File mappings of a traced process, kept up to date from mmap, munmap and mremap like the kernel does with its VMAs:
+// a mapping partially unmapped is split, a mapping placed over others replaces them. Only the mappings of files are
+// kept, the statistics are grouped by the name of the mapped file descriptor. The table is copied to the children on
+// fork and emptied on execve.
+class MappingTable {
+public:
+	typedef std::chrono::steady_clock Clock;
+	struct Mapping {
+		// Excluded
+		unsigned long long end;
+		std::string name;
+		int prot;
+		bool shared;
+		// Identifies the mmap the mapping comes from, the pieces of a split mapping share it
+		unsigned long id;
+		Clock::time_point created;
+	};
+	struct Statistics {
+		unsigned long mappings = 0;
+		unsigned long mappedBytes = 0;
+		// Bytes mapped now and at most at the same time
+		unsigned long currentBytes = 0;
+		unsigned long peakBytes = 0;
+		// Union of the PROT_* flags of all the mappings
+		int prot = 0;
+		unsigned long shared = 0;
+		unsigned long remaps = 0;
+		unsigned long syncs = 0;
+		unsigned long syncedBytes = 0;
+		// < MADV_* advice, calls >
+		std::map<int, unsigned long> advices;
+		// Lifetimes of the mappings completely unmapped
+		unsigned long ended = 0;
+		Clock::duration lifetime {};
+		Clock::duration longest {};
+	};
+	void map(unsigned long long start, unsigned long long length, const std::string& name, int prot, bool shared);
+	void unmap(unsigned long long start, unsigned long long length);
+	bool remap(unsigned long long oldStart, unsigned long long oldLength, unsigned long long newStart, unsigned long long newLength);
+	void sync(unsigned long long start, unsigned long long length);
+	void advise(unsigned long long start, unsigned long long length, int advice);
+	void inherit(const MappingTable& parent);
+	void exec();
+	[[nodiscard]] const std::map<unsigned long long, Mapping>& getMappings() const;
+	[[nodiscard]] const std::map<std::string, Statistics>& getStatistics() const;
+
+private:
+	static const unsigned long long PAGE_BYTES;
+	// < start, mapping >, the mappings never overlap
+	std::map<unsigned long long, Mapping> mappings;
+	// < id, pieces of the mapping >
+	std::unordered_map<unsigned long, unsigned long> pieces;
+	std::map<std::string, Statistics> statistics;
+	unsigned long nextId = 0;
+	static unsigned long long pageAlign(unsigned long long length);
+	void split(unsigned long long address);
+	void erase(std::map<unsigned long long, Mapping>::iterator it, bool moved);
+	template<typename Visitor>
+	void visit(unsigned long long start, unsigned long long length, Visitor visitor);
+};
+
+#endif //PTRACER_MAPPINGTABLE_H
@@ -2,6 +2,7 @@
 #include <sys/syscall.h>
 #include <sys/ioctl.h>
 #include "OpenDecoder.h"
+#include "SyscallDispatchTable.h"
 #include "../Tracer.h"
 
 using namespace std;
@@ -24,18 +25,20 @@ bool OpenDecoder::decode(const ProcessSyscallExit& syscall) {
 	return true;
 }
 
-void OpenDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
-	shared_ptr<SyscallDecoder> thisDecoder(new OpenDecoder());
-	mapper.registerEntrySyscallDecoder(SYS_openat, thisDecoder);
-	mapper.registerExitSyscallDecoder(SYS_openat, thisDecoder);
-	mapper.registerEntrySyscallDecoder(SYS_openat2, thisDecoder);
-	mapper.registerExitSyscallDecoder(SYS_openat2, thisDecoder);
-	mapper.registerEntrySyscallDecoder(SYS_name_to_handle_at, thisDecoder);
-	mapper.registerExitSyscallDecoder(SYS_name_to_handle_at, thisDecoder);
+void OpenDecoder::registerAt() {
+	int thisDecoder = SyscallDispatchTable::registerDecoder<OpenDecoder>([](ProcessSyscallDecoderMapper&) -> SyscallDecoder* {
+		return new OpenDecoder();
+	});
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_openat, thisDecoder);
+	SyscallDispatchTable::registerExitSyscallDecoder(SYS_openat, thisDecoder);
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_openat2, thisDecoder);
+	SyscallDispatchTable::registerExitSyscallDecoder(SYS_openat2, thisDecoder);
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_name_to_handle_at, thisDecoder);
+	SyscallDispatchTable::registerExitSyscallDecoder(SYS_name_to_handle_at, thisDecoder);
 	// TODO: Missing open_by_handle_at
 #ifdef SYS_open
-	mapper.registerEntrySyscallDecoder(SYS_open, thisDecoder);
-	mapper.registerExitSyscallDecoder(SYS_open, thisDecoder);
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_open, thisDecoder);
+	SyscallDispatchTable::registerExitSyscallDecoder(SYS_open, thisDecoder);
 #endif
 }
 
@@ -0,0 +1,234 @@
+/*
+ * Layout of a payload archive:
+ * MAGIC, then the records in capture order, each one a RecordHeader followed by its payload. The first record of
+ * every stream is preceded by a record of stream PayloadArchive::STREAM_RECORD holding its StreamHeader and name.
+ * When the run ends the index is appended: for every stream its StreamHeader, the name length (uint32_t) and the name,
+ * then the IndexEntry of every payload record and finally the Trailer. An archive without a valid Trailer, because
+ * ptracer has been killed, is read by scanning its records up to the first incomplete one.
+ */
+
+#include <cstring>
+#include <iostream>
+#include "PayloadArchive.h"
+
+using namespace std;
+
+const char PayloadArchive::MAGIC[8] = { 'P', 'T', 'R', 'A', 'R', 'C', 'H', '1' };
+const char PayloadArchive::INDEX_MAGIC[8] = { 'P', 'T', 'R', 'I', 'N', 'D', 'X', '1' };
+const uint32_t PayloadArchive::STREAM_RECORD = UINT32_MAX;
+
+/**
+ * @param path The archive written by the PayloadWriter.
+ */
+PayloadArchive::PayloadArchive(const string& path) : path(path) {
+}
+
+/**
+ * Reads the streams and the records of the archive, from its index if it has been completed.
+ *
+ * @return True if the archive has been read, False if it is not a payload archive.
+ */
+bool PayloadArchive::open() {
+	char magic[sizeof(PayloadArchive::MAGIC)];
+	this->file.open(this->path, ios::in | ios::binary);
+	if (!this->file.read(magic, sizeof(magic)) || memcmp(magic, PayloadArchive::MAGIC, sizeof(magic)) != 0) {
+		cerr << this->path << " is not a payload archive" << endl;
+		return false;
+	}
+	if (this->readIndex()) {
+		this->indexed = true;
+		return true;
+	}
+	cerr << "The archive " << this->path << " has no index, probably ptracer did not terminate, its records will be scanned" << endl;
+	this->streams.clear();
+	this->entries.clear();
+	this->file.clear();
+	return this->scan();
+}
+
+/**
+ * Rebuilds the content of a stream.
+ *
+ * @param stream One of the streams returned by PayloadArchive::getStreams.
+ * @param output Where the stream content will be written, its parent directories are created.
+ * @return True if the whole stream has been written, False otherwise.
+ */
+bool PayloadArchive::extract(const Stream& stream, const filesystem::path& output) {
+	vector<char> buffer;
+	error_code error;
+	if (output.has_parent_path()) {
+		filesystem::create_directories(output.parent_path(), error);
+	}
+	ofstream out(output, ios::out | ios::binary | ios::trunc);
+	if (!out.good()) {
+		cerr << "Impossible to create " << output << endl;
+		return false;
+	}
+	for (const IndexEntry& entry : this->entries) {
+		if (entry.stream != stream.header.id) {
+			continue;
+		}
+		RecordHeader header = {};
+		this->file.seekg((streamoff) entry.position);
+		if (!this->file.read((char*) &header, sizeof(header)) || header.stream != entry.stream || header.length != entry.length) {
+			cerr << "Corrupted record at position " << entry.position << " of " << this->path << endl;
+			this->file.clear();
+			return false;
+		}
+		buffer.resize(header.length);
+		if (!this->file.read(buffer.data(), header.length)) {
+			cerr << "Truncated record at position " << entry.position << " of " << this->path << endl;
+			this->file.clear();
+			return false;
+		}
+		out.seekp((streamoff) header.offset);
+		out.write(buffer.data(), header.length);
+	}
+	out.flush();
+	return out.good();
+}
+
+const vector<PayloadArchive::Stream>& PayloadArchive::getStreams() const {
+	return this->streams;
+}
+
+/**
+ * @return True if the archive has been read from its index, False if it has been scanned.
+ */
+bool PayloadArchive::isIndexed() const {
+	return this->indexed;
+}
+
+/**
+ * Serialises the record that defines a stream.
+ *
+ * @param header    The stream identification.
+ * @param name      The stream name.
+ * @param timestamp When the first payload of the stream has been captured.
+ * @return The record, header included.
+ */
+string PayloadArchive::makeStreamRecord(const StreamHeader& header, const string& name, uint64_t timestamp) {
+	RecordHeader record { PayloadArchive::STREAM_RECORD, (uint32_t) (sizeof(header) + name.size()), 0, timestamp };
+	string result((const char*) &record, sizeof(record));
+	result.append((const char*) &header, sizeof(header));
+	result.append(name);
+	return result;
+}
+
+/**
+ * Serialises the index of an archive.
+ *
+ * @param streams       Every stream defined in the archive.
+ * @param entries       Every payload record of the archive.
+ * @param indexPosition Where the index will be written.
+ * @return The index, trailer included.
+ */
+string PayloadArchive::makeIndex(const vector<Stream>& streams, const vector<IndexEntry>& entries, uint64_t indexPosition) {
+	string result;
+	for (const Stream& stream : streams) {
+		uint32_t nameLength = (uint32_t) stream.name.size();
+		result.append((const char*) &stream.header, sizeof(stream.header));
+		result.append((const char*) &nameLength, sizeof(nameLength));
+		result.append(stream.name);
+	}
+	result.append((const char*) entries.data(), entries.size() * sizeof(IndexEntry));
+	Trailer trailer { indexPosition, streams.size(), entries.size(), {} };
+	memcpy(trailer.magic, PayloadArchive::INDEX_MAGIC, sizeof(trailer.magic));
+	result.append((const char*) &trailer, sizeof(trailer));
+	return result;
+}
+
+/**
+ * Reads the index appended at the end of the archive.
+ *
+ * @return True if the index has been read, False if the archive has no valid index.
+ */
+bool PayloadArchive::readIndex() {
+	Trailer trailer = {};
+	this->file.seekg(0, ios::end);
+	streamoff size = this->file.tellg();
+	if (size < (streamoff) (sizeof(PayloadArchive::MAGIC) + sizeof(trailer))) {
+		return false;
+	}
+	this->file.seekg(size - (streamoff) sizeof(trailer));
+	if (!this->file.read((char*) &trailer, sizeof(trailer)) || memcmp(trailer.magic, PayloadArchive::INDEX_MAGIC, sizeof(trailer.magic)) != 0 ||
+	    trailer.indexPosition >= (uint64_t) size || trailer.entryCount > (uint64_t) size / sizeof(IndexEntry)) {
+		return false;
+	}
+	this->file.seekg((streamoff) trailer.indexPosition);
+	for (uint64_t i = 0; i < trailer.streamCount; i++) {
+		StreamHeader header = {};
+		uint32_t nameLength = 0;
+		if (!this->file.read((char*) &header, sizeof(header)) || !this->file.read((char*) &nameLength, sizeof(nameLength)) ||
+		    nameLength > (uint64_t) size) {
+			return false;
+		}
+		string name(nameLength, '\0');
+		if (!this->file.read(name.data(), nameLength) || header.id != i) {
+			return false;
+		}
+		this->addStream(header, std::move(name));
+	}
+	this->entries.resize(trailer.entryCount);
+	if (!this->file.read((char*) this->entries.data(), (streamsize) (trailer.entryCount * sizeof(IndexEntry)))) {
+		return false;
+	}
+	for (const IndexEntry& entry : this->entries) {
+		if (entry.stream >= this->streams.size()) {
+			return false;
+		}
+		this->streams[entry.stream].bytes += entry.length;
+	}
+	return true;
+}
+
+/**
+ * Reads the records one after the other, it stops at the first incomplete or unknown one.
+ *
+ * @return True if at least the archive header has been read, False otherwise.
+ */
+bool PayloadArchive::scan() {
+	this->file.seekg(0, ios::end);
+	uint64_t size = (uint64_t) this->file.tellg();
+	uint64_t position = sizeof(PayloadArchive::MAGIC);
+	this->file.seekg((streamoff) position);
+	while (position + sizeof(RecordHeader) <= size) {
+		RecordHeader record = {};
+		if (!this->file.read((char*) &record, sizeof(record)) || position + sizeof(record) + record.length > size) {
+			break;
+		}
+		if (record.stream == PayloadArchive::STREAM_RECORD) {
+			StreamHeader header = {};
+			if (record.length < sizeof(header) || !this->file.read((char*) &header, sizeof(header))) {
+				break;
+			}
+			string name(record.length - sizeof(header), '\0');
+			if (!this->file.read(name.data(), (streamsize) name.size()) || header.id != this->streams.size()) {
+				break;
+			}
+			this->addStream(header, std::move(name));
+		} else if (record.stream < this->streams.size()) {
+			this->entries.push_back({ position, record.stream, record.length });
+			this->streams[record.stream].bytes += record.length;
+			this->file.seekg(record.length, ios::cur);
+		} else {
+			break;
+		}
+		position += sizeof(record) + record.length;
+	}
+	if (position < size) {
+		cerr << "The archive " << this->path << " is readable only up to position " << position << " of " << size << endl;
+	}
+	this->file.clear();
+	return true;
+}
+
+/**
+ * Adds a stream, the streams are numbered in the order they have been defined.
+ */
+void PayloadArchive::addStream(const StreamHeader& header, string name) {
+	Stream stream;
+	stream.header = header;
+	stream.name = std::move(name);
+	this->streams.push_back(std::move(stream));
+}
@@ -0,0 +1,75 @@
+#ifndef PTRACER_PAYLOADARCHIVE_H
+#define PTRACER_PAYLOADARCHIVE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Single append-only file holding the payloads of every traced file descriptor, written by the PayloadWriter in place
+// of one file per file descriptor. Every payload is a record tagged with its stream, the offset in the stream and the
+// time it has been captured; the index of the records is appended when the run ends.
+class PayloadArchive {
+public:
+	static const char MAGIC[8];
+	static const char INDEX_MAGIC[8];
+	// Stream of the records that define a new stream
+	static const uint32_t STREAM_RECORD;
+	enum Direction : uint32_t {
+		READ = 0,
+		WRITE = 1
+	};
+	struct RecordHeader {
+		uint32_t stream;
+		uint32_t length;
+		// Position of the payload in its stream
+		uint64_t offset;
+		// Nanoseconds since the epoch when the payload has been captured
+		uint64_t timestamp;
+	};
+	// Followed by the stream name, which is the path the payload would have been written to without the archive
+	struct StreamHeader {
+		uint32_t id;
+		int32_t pid;
+		int32_t fd;
+		uint32_t direction;
+	};
+	struct IndexEntry {
+		// Position of the record header in the archive
+		uint64_t position;
+		uint32_t stream;
+		uint32_t length;
+	};
+	// Last bytes of a complete archive
+	struct Trailer {
+		uint64_t indexPosition;
+		uint64_t streamCount;
+		uint64_t entryCount;
+		char magic[8];
+	};
+	struct Stream {
+		StreamHeader header;
+		std::string name;
+		uint64_t bytes = 0;
+	};
+	explicit PayloadArchive(const std::string& path);
+	bool open();
+	bool extract(const Stream& stream, const std::filesystem::path& output);
+	[[nodiscard]] const std::vector<Stream>& getStreams() const;
+	[[nodiscard]] bool isIndexed() const;
+	static std::string makeStreamRecord(const StreamHeader& header, const std::string& name, uint64_t timestamp);
+	static std::string makeIndex(const std::vector<Stream>& streams, const std::vector<IndexEntry>& entries, uint64_t indexPosition);
+
+private:
+	const std::string path;
+	std::ifstream file;
+	std::vector<Stream> streams;
+	std::vector<IndexEntry> entries;
+	bool indexed = false;
+	bool readIndex();
+	bool scan();
+	void addStream(const StreamHeader& header, std::string name);
+};
+
+#endif //PTRACER_PAYLOADARCHIVE_H
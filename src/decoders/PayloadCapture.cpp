@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <fnmatch.h>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "PayloadCapture.h"
+
+using namespace std;
+
+PayloadCapture::Policy PayloadCapture::policy;
+bool PayloadCapture::limited = false;
+
+/**
+ * Sets the capture policy of every traced process, it must be called before tracing starts.
+ *
+ * @param policy The budgets and the filters, with no budget and no filter everything is captured.
+ */
+void PayloadCapture::setPolicy(const Policy& policy) {
+	PayloadCapture::policy = policy;
+	PayloadCapture::limited = policy.syscallBytes > 0 || policy.fdBytes > 0 || policy.processBytes > 0 ||
+	                          !policy.include.empty() || !policy.exclude.empty();
+}
+
+/**
+ * @return True if the decoders must only count the bytes transferred, without reading them.
+ */
+bool PayloadCapture::isMetadataOnly() {
+	return PayloadCapture::policy.metadataOnly;
+}
+
+/**
+ * @param window Either head, tail or head-tail.
+ * @return The corresponding window.
+ * @throw runtime_error If window is not valid.
+ */
+PayloadCapture::Window PayloadCapture::parseWindow(const string& window) {
+	if (window == "head") {
+		return PayloadCapture::HEAD;
+	} else if (window == "tail") {
+		return PayloadCapture::TAIL;
+	} else if (window == "head-tail") {
+		return PayloadCapture::HEAD_TAIL;
+	}
+	throw runtime_error("The capture window can be either head, tail or head-tail");
+}
+
+/**
+ * @param fds The file descriptors of the process, they hold the budget already used and the counters of each one.
+ */
+PayloadCapture::PayloadCapture(shared_ptr<FdTable> fds) : fds(std::move(fds)) {
+}
+
+/**
+ * Charges a payload to the budgets of its file descriptor and of the process.
+ *
+ * @param fd     The file descriptor the payload is transferred through.
+ * @param length The payload size, as the tracee declares it.
+ * @return The ranges of the payload that must be read from the tracee, in increasing order; none if it must not be
+ *         captured at all, as when fd is not known to be open.
+ */
+PayloadCapture::Ranges PayloadCapture::plan(int fd, unsigned long length) {
+	if (!PayloadCapture::limited) {
+		this->captured += length;
+		return { { 0, length } };
+	}
+	FdTable::Entry* entry = this->fds->find(fd);
+	if (entry == nullptr) {
+		this->skipped += length;
+		return {};
+	}
+	unsigned long allowance = this->select(*entry) ? length : 0;
+	if (PayloadCapture::policy.syscallBytes > 0) {
+		allowance = min(allowance, PayloadCapture::policy.syscallBytes);
+	}
+	if (PayloadCapture::policy.fdBytes > 0) {
+		allowance = min(allowance, PayloadCapture::policy.fdBytes - min(entry->captured, PayloadCapture::policy.fdBytes));
+	}
+	if (PayloadCapture::policy.processBytes > 0) {
+		allowance = min(allowance, PayloadCapture::policy.processBytes - min(this->captured, PayloadCapture::policy.processBytes));
+	}
+	entry->captured += allowance;
+	this->captured += allowance;
+	this->skipped += length - allowance;
+	if (allowance == 0) {
+		return {};
+	} else if (allowance == length || PayloadCapture::policy.window == PayloadCapture::HEAD) {
+		return { { 0, allowance } };
+	} else if (PayloadCapture::policy.window == PayloadCapture::TAIL) {
+		return { { length - allowance, allowance } };
+	}
+	unsigned long head = (allowance + 1) / 2;
+	Ranges ranges { { 0, head } };
+	if (allowance > head) {
+		ranges.emplace_back(length - (allowance - head), allowance - head);
+	}
+	return ranges;
+}
+
+/**
+ * Counts a completed transfer in metadata only mode, nothing is read from the tracee.
+ *
+ * @param fd     The file descriptor the bytes have been transferred through.
+ * @param read   True if the bytes have been read by the tracee, False if they have been written.
+ * @param result The system call return value, the number of bytes transferred or a negative error.
+ */
+void PayloadCapture::account(int fd, bool read, long long result) {
+	// A failed transfer does not tell if fd is open
+	IoCounters* selected = this->getCounters(fd, result >= 0);
+	if (selected == nullptr) {
+		return;
+	}
+	IoCounters& counters = *selected;
+	if (result < 0) {
+		counters.errors++;
+		return;
+	}
+	(read ? counters.readBytes : counters.writtenBytes) += (unsigned long) result;
+	(read ? counters.reads : counters.writes)++;
+	counters.sizes[result == 0 ? 0 : 64 - __builtin_clzll((unsigned long long) result)]++;
+	this->captured += (unsigned long) result;
+}
+
+/**
+ * Counts a memory mapping of a file in metadata only mode, its pages are read and written without system calls.
+ *
+ * @param fd     The mapped file descriptor.
+ * @param length The length of the mapping.
+ */
+void PayloadCapture::accountMapping(int fd, unsigned long length) {
+	IoCounters* counters = this->getCounters(fd, true);
+	if (counters != nullptr) {
+		counters->mappings++;
+		counters->mappedBytes += length;
+	}
+}
+
+/**
+ * @param fd A file descriptor of the process.
+ * @return The path or the socket peer fd refers to, "fd <number>" if it has not been named.
+ */
+string PayloadCapture::getName(int fd) const {
+	return this->fds->getName(fd);
+}
+
+/**
+ * Prints how many bytes have been captured and how many have been left in the tracee, in metadata only mode the
+ * transfers of every path and socket peer, the busiest first.
+ */
+void PayloadCapture::printReport() const {
+	if (PayloadCapture::policy.metadataOnly) {
+		vector<pair<string, const IoCounters*>> sorted;
+		for (const auto& i : this->counters) {
+			sorted.emplace_back(i.first, &i.second);
+		}
+		sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+			return a.second->readBytes + a.second->writtenBytes > b.second->readBytes + b.second->writtenBytes;
+		});
+		cout << "Bytes transferred: " << this->captured << ", through " << sorted.size() << " paths and peers" << endl;
+		for (const auto& i : sorted) {
+			cout << i.first << ": read " << i.second->readBytes << " bytes in " << i.second->reads << " calls, written "
+			     << i.second->writtenBytes << " bytes in " << i.second->writes << " calls, " << i.second->errors << " errors, sizes:";
+			for (unsigned int bucket = 0; bucket < IO_HISTOGRAM_BUCKETS; bucket++) {
+				if (i.second->sizes[bucket] > 0) {
+					cout << " <" << (1ULL << bucket) << ": " << i.second->sizes[bucket];
+				}
+			}
+			if (i.second->mappings > 0) {
+				cout << ", mapped " << i.second->mappedBytes << " bytes in " << i.second->mappings << " mappings";
+			}
+			cout << endl;
+		}
+		return;
+	}
+	cout << "Payload bytes captured: " << this->captured;
+	if (PayloadCapture::limited) {
+		cout << ", not read because of the capture policy: " << this->skipped << ", file descriptors filtered out: " << this->filtered;
+	}
+	cout << endl;
+}
+
+/**
+ * Applies the filters to a file descriptor the first time its bytes are transferred.
+ *
+ * @param entry The file descriptor.
+ * @return True if its transfers have to be captured or counted, False otherwise.
+ */
+bool PayloadCapture::select(FdTable::Entry& entry) {
+	if (entry.selected < 0) {
+		entry.selected = PayloadCapture::isSelected(entry.name) ? 1 : 0;
+		this->filtered += entry.selected ? 0 : 1;
+	}
+	return entry.selected;
+}
+
+/**
+ * @param fd        A file descriptor of the process.
+ * @param succeeded True if a system call on fd has just succeeded, so that fd is open even if it has not been seen opening.
+ * @return The metadata only mode counters of the name of fd, nullptr if it is filtered out or not valid.
+ */
+IoCounters* PayloadCapture::getCounters(int fd, bool succeeded) {
+	FdTable::Entry* entry = succeeded ? this->fds->adopt(fd) : this->fds->find(fd);
+	if (entry == nullptr || !this->select(*entry)) {
+		return nullptr;
+	}
+	if (entry->counters == nullptr) {
+		// The elements of an unordered_map never move
+		entry->counters = &this->counters[this->fds->getName(fd)];
+	}
+	return entry->counters;
+}
+
+/**
+ * Applies the include and exclude filters.
+ *
+ * @param name The path or the socket peer of a file descriptor, empty if unknown.
+ * @return True if the payloads of the file descriptor have to be captured, False otherwise.
+ */
+bool PayloadCapture::isSelected(const string& name) {
+	auto matches = [&name](const string& pattern) {
+		return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+	};
+	if (any_of(PayloadCapture::policy.exclude.begin(), PayloadCapture::policy.exclude.end(), matches)) {
+		return false;
+	}
+	return PayloadCapture::policy.include.empty() ||
+	       any_of(PayloadCapture::policy.include.begin(), PayloadCapture::policy.include.end(), matches);
+}
@@ -0,0 +1,79 @@
+#ifndef PTRACER_PAYLOADCAPTURE_H
+#define PTRACER_PAYLOADCAPTURE_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "FdTable.h"
+
+// Bucket i counts the transfers of less than 2^i bytes and at least 2^(i-1)
+static const unsigned int IO_HISTOGRAM_BUCKETS = 64;
+
+// Bytes moved through a path or a socket peer in metadata only mode
+struct IoCounters {
+	unsigned long readBytes = 0;
+	unsigned long writtenBytes = 0;
+	unsigned long reads = 0;
+	unsigned long writes = 0;
+	unsigned long errors = 0;
+	// Memory mappings of the file, accessed without system calls
+	unsigned long mappings = 0;
+	unsigned long mappedBytes = 0;
+	std::array<unsigned long, IO_HISTOGRAM_BUCKETS> sizes {};
+};
+
+// Decides which bytes of the payloads transferred by a traced process are captured, so that the decoders read from
+// the tracee only what the capture policy allows: the budgets bound the bytes of every system call, file descriptor
+// and process, and the filters select the file descriptors by path or socket peer. The state of every file descriptor is
+// kept in the FdTable of the process.
+// In metadata only mode no payload is captured: only the bytes moved through every path or socket peer are counted,
+// from the system call return values.
+class PayloadCapture {
+public:
+	// Which bytes of a system call payload larger than the system call budget are captured
+	enum Window {
+		HEAD,
+		TAIL,
+		HEAD_TAIL
+	};
+	// 0 means unlimited
+	struct Policy {
+		unsigned long syscallBytes = 0;
+		unsigned long fdBytes = 0;
+		unsigned long processBytes = 0;
+		Window window = HEAD;
+		// Glob patterns matched against the path of a file or the peer of a socket
+		std::vector<std::string> include;
+		std::vector<std::string> exclude;
+		bool metadataOnly = false;
+	};
+	// < offset in the payload, length >
+	typedef std::vector<std::pair<unsigned long, unsigned long>> Ranges;
+	static void setPolicy(const Policy& policy);
+	static Window parseWindow(const std::string& window);
+	static bool isMetadataOnly();
+	explicit PayloadCapture(std::shared_ptr<FdTable> fds);
+	Ranges plan(int fd, unsigned long length);
+	void account(int fd, bool read, long long result);
+	void accountMapping(int fd, unsigned long length);
+	[[nodiscard]] std::string getName(int fd) const;
+	void printReport() const;
+
+private:
+	static Policy policy;
+	static bool limited;
+	const std::shared_ptr<FdTable> fds;
+	unsigned long captured = 0;
+	unsigned long skipped = 0;
+	unsigned long filtered = 0;
+	// Metadata only mode counters by path or socket peer, "fd <number>" if the file descriptor has not been named
+	std::unordered_map<std::string, IoCounters> counters;
+	static bool isSelected(const std::string& name);
+	bool select(FdTable::Entry& entry);
+	IoCounters* getCounters(int fd, bool succeeded);
+};
+
+#endif //PTRACER_PAYLOADCAPTURE_H
@@ -0,0 +1,623 @@
+/*
+ * The decoders run on the tracing thread while the tracee is stopped, so they only copy their payloads, in chunks of
+ * PayloadWriter::CHUNK_BYTES, from the tracee memory in the staging ring with process_vm_readv and queue them: the writer
+ * thread takes every queued payload at once, when enough bytes have been queued or when the flush interval expires,
+ * and writes the payloads of every file with vectored writes at the offset where the previous batch stopped.
+ * In archive mode every payload becomes a record of the single PayloadArchive, preceded by the definition of its stream
+ * the first time, and the index is appended when the writer thread stops.
+ * When ptracer is built with liburing (PTRACER_IO_URING) the writes of a batch are submitted together to an io_uring,
+ * otherwise, or if the kernel does not support it, they are issued with pwritev.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef PTRACER_IO_URING
+#include <liburing.h>
+#endif
+#include "IoVector.h"
+#include "PayloadWriter.h"
+#include "../Tracer.h"
+
+using namespace std;
+
+// Size of the staging ring: beyond this amount of queued bytes the decoders wait for the writer, so that the memory
+// used stays bounded whatever the size of the payloads
+const unsigned long PayloadWriter::MAX_PENDING_BYTES = 64UL << 20;
+// Amount of queued bytes that wakes up the writer before the flush interval expires
+const unsigned long PayloadWriter::BATCH_BYTES = 1UL << 20;
+// Maximum time a payload stays in memory
+const unsigned int PayloadWriter::FLUSH_INTERVAL_MS = 200;
+// Larger payloads are split, so that they never need more than a slice of the staging ring
+const unsigned long PayloadWriter::CHUNK_BYTES = 1UL << 20;
+// Writes submitted to the io_uring at once
+const unsigned int PayloadWriter::RING_ENTRIES = 64;
+
+boost::mutex PayloadWriter::mutex;
+boost::condition_variable PayloadWriter::ready;
+boost::condition_variable PayloadWriter::space;
+boost::condition_variable PayloadWriter::drained;
+deque<PayloadWriter::Payload> PayloadWriter::pending;
+unsigned long PayloadWriter::pendingBytes = 0;
+unsigned char* PayloadWriter::staging = nullptr;
+unsigned long PayloadWriter::stagingHead = 0;
+unsigned long PayloadWriter::stagingUsed = 0;
+unsigned int PayloadWriter::flushRequests = 0;
+bool PayloadWriter::writing = false;
+bool PayloadWriter::stopping = false;
+vector<filesystem::path> PayloadWriter::paths;
+vector<PayloadArchive::StreamHeader> PayloadWriter::streams;
+filesystem::path PayloadWriter::archivePath;
+vector<unsigned long> PayloadWriter::written;
+unsigned long PayloadWriter::batches = 0;
+unsigned long PayloadWriter::writeCalls = 0;
+unsigned long PayloadWriter::producerWaits = 0;
+unique_ptr<boost::thread> PayloadWriter::thread;
+vector<int> PayloadWriter::descriptors;
+vector<off_t> PayloadWriter::offsets;
+atomic<bool> PayloadWriter::ringReady { false };
+int PayloadWriter::archiveDescriptor = -1;
+uint64_t PayloadWriter::archiveOffset = 0;
+vector<long> PayloadWriter::archiveIds;
+vector<PayloadArchive::Stream> PayloadWriter::archiveStreams;
+vector<PayloadArchive::IndexEntry> PayloadWriter::archiveIndex;
+#ifdef PTRACER_IO_URING
+static struct io_uring ring;
+#endif
+
+/**
+ * Writes every payload in a single archive instead of a file per stream, it must be called before any stream is opened.
+ *
+ * @param path The archive, it is replaced if it exists.
+ */
+void PayloadWriter::setArchive(const filesystem::path& path) {
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	assert(PayloadWriter::paths.empty());
+	PayloadWriter::archivePath = path;
+}
+
+bool PayloadWriter::isArchive() {
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	return !PayloadWriter::archivePath.empty();
+}
+
+/**
+ * Registers a stream of payloads, the writer thread is started by the first call. Unless in archive mode the stream
+ * is written in path, which is created, or truncated, together with its parent directories before the first payload
+ * is written; in archive mode path only names the stream.
+ *
+ * @param path      The output file.
+ * @param pid       The process that transferred the payloads.
+ * @param fd        The file descriptor the payloads have been transferred through.
+ * @param direction Whether the payloads have been read or written by the process.
+ * @return The file identifier to be used with PayloadWriter::write.
+ */
+int PayloadWriter::open(const filesystem::path& path, pid_t pid, int fd, PayloadArchive::Direction direction) {
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	if (PayloadWriter::staging == nullptr) {
+		// Its pages are allocated only once used
+		void* area = mmap(nullptr, PayloadWriter::MAX_PENDING_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (area == MAP_FAILED) {
+			cerr << "Impossible to map the payload staging area, no payload will be captured: " << strerror(errno) << endl;
+		} else {
+			PayloadWriter::staging = (unsigned char*) area;
+		}
+	}
+	if (PayloadWriter::thread == nullptr) {
+		PayloadWriter::stopping = false;
+		PayloadWriter::thread = make_unique<boost::thread>(&PayloadWriter::run);
+	}
+	PayloadWriter::paths.push_back(path);
+	PayloadWriter::streams.push_back({ 0, pid, fd, direction });
+	PayloadWriter::written.push_back(0);
+	return (int) PayloadWriter::paths.size() - 1;
+}
+
+/**
+ * Copies a payload from the tracee memory in the staging ring and queues it, it returns as soon as the payload is
+ * queued unless the ring is full. Larger payloads are copied and queued PayloadWriter::CHUNK_BYTES at a time.
+ *
+ * @param file    A file identifier returned by PayloadWriter::open.
+ * @param tracer  The tracer of the thread that transfers the payload, it must be stopped.
+ * @param address The payload address in the tracee.
+ * @param length  The payload size in bytes.
+ * @return True if the whole payload has been queued, False if it cannot be read.
+ */
+bool PayloadWriter::capture(int file, const Tracer& tracer, unsigned long long address, size_t length) {
+	iovec segment { (void*) address, length };
+	return PayloadWriter::capture(file, tracer, &segment, 1);
+}
+
+/**
+ * Copies a payload scattered in several areas of the tracee memory, as the ones of readv or sendmsg, in the staging
+ * ring and queues it as if it was contiguous. Every chunk of PayloadWriter::CHUNK_BYTES is gathered from its areas with
+ * a single vectored read.
+ *
+ * @param file     A file identifier returned by PayloadWriter::open.
+ * @param tracer   The tracer of the thread that transfers the payload, it must be stopped.
+ * @param segments The payload areas in the tracee, in order.
+ * @param count    The number of areas.
+ * @return True if the whole payload has been queued, False if it cannot be read.
+ */
+bool PayloadWriter::capture(int file, const Tracer& tracer, const iovec* segments, size_t count) {
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	assert(file >= 0 && (unsigned long) file < PayloadWriter::paths.size());
+	if (PayloadWriter::staging == nullptr) {
+		return false;
+	}
+	// Tracee areas of the chunk being copied, the mutex is released while waiting for space in the ring
+	vector<iovec> gathered;
+	size_t segment = 0;
+	size_t segmentDone = 0;
+	while (segment < count) {
+		size_t chunk = 0;
+		gathered.clear();
+		while (segment < count && chunk < PayloadWriter::CHUNK_BYTES) {
+			size_t length = min(segments[segment].iov_len - segmentDone, (size_t) PayloadWriter::CHUNK_BYTES - chunk);
+			if (length > 0) {
+				gathered.push_back({ (char*) segments[segment].iov_base + segmentDone, length });
+			}
+			chunk += length;
+			segmentDone += length;
+			if (segmentDone == segments[segment].iov_len) {
+				segment++;
+				segmentDone = 0;
+			}
+		}
+		if (chunk == 0) {
+			break;
+		}
+		size_t reserved;
+		unsigned char* data = PayloadWriter::reserve(chunk, lock, reserved);
+		uint64_t timestamp = (uint64_t) chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+		// The payload is queued before being copied so that the reservations are released in order, the elements of a
+		// deque do not move when other elements are added or removed at its ends
+		Payload& payload = PayloadWriter::pending.emplace_back(Payload { file, data, 0, reserved, timestamp, false });
+		lock.unlock();
+		bool read = tracer.readMemory(gathered.data(), gathered.size(), data);
+		lock.lock();
+		// Even if empty the payload stays queued, to release its reservation
+		payload.length = read ? chunk : 0;
+		payload.copied = true;
+		if (!read) {
+			PayloadWriter::ready.notify_one();
+			return false;
+		}
+		PayloadWriter::pendingBytes += chunk;
+		if (PayloadWriter::pendingBytes >= PayloadWriter::BATCH_BYTES || PayloadWriter::flushRequests > 0) {
+			PayloadWriter::ready.notify_one();
+		}
+	}
+	return true;
+}
+
+/**
+ * Reserves a contiguous slice of the staging ring, it waits for the writer thread if the ring is full.
+ * It must be called holding PayloadWriter::mutex.
+ *
+ * @param length   The slice size, at most PayloadWriter::CHUNK_BYTES.
+ * @param lock     The lock of PayloadWriter::mutex, released while waiting.
+ * @param reserved Where the number of bytes to release once the slice is written will be stored.
+ * @return The slice.
+ */
+unsigned char* PayloadWriter::reserve(size_t length, boost::mutex::scoped_lock& lock, size_t& reserved) {
+	assert(length <= PayloadWriter::CHUNK_BYTES && PayloadWriter::CHUNK_BYTES * 2 <= PayloadWriter::MAX_PENDING_BYTES);
+	bool waited = false;
+	while (true) {
+		if (PayloadWriter::stagingUsed == 0) {
+			PayloadWriter::stagingHead = 0;
+		}
+		// A slice never wraps around, the end of the ring is skipped instead
+		bool wrap = PayloadWriter::stagingHead + length > PayloadWriter::MAX_PENDING_BYTES;
+		reserved = length + (wrap ? PayloadWriter::MAX_PENDING_BYTES - PayloadWriter::stagingHead : 0);
+		if (PayloadWriter::stagingUsed + reserved <= PayloadWriter::MAX_PENDING_BYTES) {
+			if (wrap) {
+				PayloadWriter::stagingHead = 0;
+			}
+			break;
+		}
+		PayloadWriter::producerWaits += waited ? 0 : 1;
+		waited = true;
+		PayloadWriter::ready.notify_one();
+		PayloadWriter::space.wait(lock);
+	}
+	unsigned char* slice = PayloadWriter::staging + PayloadWriter::stagingHead;
+	PayloadWriter::stagingHead += length;
+	PayloadWriter::stagingUsed += reserved;
+	return slice;
+}
+
+/**
+ * Waits until every payload queued so far has been written.
+ */
+void PayloadWriter::flush() {
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	if (PayloadWriter::thread == nullptr) {
+		return;
+	}
+	PayloadWriter::flushRequests++;
+	PayloadWriter::ready.notify_one();
+	while (!PayloadWriter::pending.empty() || PayloadWriter::writing) {
+		PayloadWriter::drained.wait(lock);
+	}
+	PayloadWriter::flushRequests--;
+}
+
+/**
+ * Writes every queued payload and stops the writer thread, a following PayloadWriter::open starts it again.
+ */
+void PayloadWriter::stop() {
+	{
+		boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+		if (PayloadWriter::thread == nullptr) {
+			return;
+		}
+		PayloadWriter::stopping = true;
+		PayloadWriter::ready.notify_one();
+	}
+	PayloadWriter::thread->join();
+	PayloadWriter::thread = nullptr;
+}
+
+/**
+ * @param file A file identifier returned by PayloadWriter::open.
+ * @return The number of bytes written in file so far, flush before to include the queued ones.
+ */
+unsigned long PayloadWriter::getWritten(int file) {
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	return file >= 0 && (unsigned long) file < PayloadWriter::written.size() ? PayloadWriter::written[file] : 0;
+}
+
+/**
+ * Prints how many payloads have been coalesced in each write.
+ */
+void PayloadWriter::printReport() {
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	unsigned long total = 0;
+	for (unsigned long bytes : PayloadWriter::written) {
+		total += bytes;
+	}
+	cout << "Payloads: " << total << " bytes in " << PayloadWriter::paths.size() << " streams, written by "
+	     << PayloadWriter::writeCalls << " writes in " << PayloadWriter::batches << " batches"
+	     << (PayloadWriter::ringReady ? " through io_uring" : "")
+	     << (PayloadWriter::archivePath.empty() ? "" : " in the archive " + PayloadWriter::archivePath.string()) << ", the tracer waited for the writer "
+	     << PayloadWriter::producerWaits << " times" << endl;
+}
+
+/**
+ * Writer thread entry point, it writes a batch every time enough bytes are queued, the flush interval expires or
+ * a flush is requested, until it is stopped.
+ */
+void PayloadWriter::run() {
+	vector<Payload> batch;
+#ifdef PTRACER_IO_URING
+	PayloadWriter::ringReady = io_uring_queue_init(PayloadWriter::RING_ENTRIES, &ring, 0) == 0;
+	if (!PayloadWriter::ringReady) {
+		cerr << "io_uring is not available, the payloads will be written with pwritev" << endl;
+	}
+#endif
+	while (true) {
+		{
+			boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+			if (PayloadWriter::pendingBytes < PayloadWriter::BATCH_BYTES && PayloadWriter::flushRequests == 0 && !PayloadWriter::stopping) {
+				PayloadWriter::ready.timed_wait(lock, boost::posix_time::milliseconds(PayloadWriter::FLUSH_INTERVAL_MS));
+			}
+			if (PayloadWriter::pending.empty()) {
+				PayloadWriter::drained.notify_all();
+				if (PayloadWriter::stopping) {
+					break;
+				}
+				continue;
+			}
+			// Only the payloads before the first one still being copied can be written
+			auto copied = find_if(PayloadWriter::pending.begin(), PayloadWriter::pending.end(), [](const Payload& payload) {
+				return !payload.copied;
+			});
+			if (copied == PayloadWriter::pending.begin()) {
+				PayloadWriter::ready.timed_wait(lock, boost::posix_time::milliseconds(PayloadWriter::FLUSH_INTERVAL_MS));
+				continue;
+			}
+			batch.assign(make_move_iterator(PayloadWriter::pending.begin()), make_move_iterator(copied));
+			PayloadWriter::pending.erase(PayloadWriter::pending.begin(), copied);
+			for (const Payload& payload : batch) {
+				PayloadWriter::pendingBytes -= payload.length;
+			}
+			PayloadWriter::writing = true;
+		}
+		PayloadWriter::writeBatch(batch);
+		boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+		for (const Payload& payload : batch) {
+			PayloadWriter::stagingUsed -= payload.reserved;
+		}
+		batch.clear();
+		PayloadWriter::writing = false;
+		PayloadWriter::space.notify_all();
+		PayloadWriter::drained.notify_all();
+	}
+#ifdef PTRACER_IO_URING
+	if (PayloadWriter::ringReady) {
+		io_uring_queue_exit(&ring);
+	}
+#endif
+	for (int& fd : PayloadWriter::descriptors) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		fd = -1;
+	}
+	if (PayloadWriter::archiveDescriptor >= 0) {
+		PayloadWriter::writeIndex();
+		close(PayloadWriter::archiveDescriptor);
+		PayloadWriter::archiveDescriptor = -1;
+	}
+}
+
+/**
+ * Writes a batch of payloads: the consecutive payloads of the same file, or all of them in archive mode, are written
+ * by a single vectored write, in the order they have been queued.
+ *
+ * @param batch The payloads taken from the queue.
+ */
+void PayloadWriter::writeBatch(vector<Payload>& batch) {
+	vector<Chunk> chunks;
+	map<int, unsigned long> collected;
+	// Archive record headers, they must not move until written
+	deque<string> records;
+	if (PayloadWriter::isArchive()) {
+		PayloadWriter::collectArchive(batch, chunks, collected, records);
+	} else {
+		PayloadWriter::collectFiles(batch, chunks, collected);
+	}
+#ifdef PTRACER_IO_URING
+	if (PayloadWriter::ringReady) {
+		PayloadWriter::writeRing(chunks);
+	} else {
+		for (const Chunk& chunk : chunks) {
+			PayloadWriter::writeChunk(chunk, 0);
+		}
+	}
+#else
+	for (const Chunk& chunk : chunks) {
+		PayloadWriter::writeChunk(chunk, 0);
+	}
+#endif
+	boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+	PayloadWriter::batches++;
+	PayloadWriter::writeCalls += chunks.size();
+	for (const auto& i : collected) {
+		PayloadWriter::written[i.first] += i.second;
+	}
+}
+
+/**
+ * Groups the payloads of a batch by file, the files are opened the first time.
+ *
+ * @param batch     The payloads taken from the queue.
+ * @param chunks    Where the writes will be added.
+ * @param collected Where the bytes of every file that will be written are added.
+ */
+void PayloadWriter::collectFiles(vector<Payload>& batch, vector<Chunk>& chunks, map<int, unsigned long>& collected) {
+	map<int, vector<iovec>> vectors;
+	for (Payload& payload : batch) {
+		if (payload.length > 0) {
+			vectors[payload.file].push_back({ payload.data, payload.length });
+		}
+	}
+	for (auto& i : vectors) {
+		int fd = PayloadWriter::getDescriptor(i.first);
+		if (fd < 0) {
+			continue;
+		}
+		size_t length = 0;
+		for (const iovec& vector : i.second) {
+			length += vector.iov_len;
+		}
+		PayloadWriter::addChunks(i.first, fd, PayloadWriter::offsets[i.first], i.second, chunks);
+		PayloadWriter::offsets[i.first] += (off_t) length;
+		collected[i.first] += length;
+	}
+}
+
+/**
+ * Turns the payloads of a batch in archive records, the archive is created the first time.
+ *
+ * @param batch     The payloads taken from the queue.
+ * @param chunks    Where the writes will be added.
+ * @param collected Where the bytes of every stream that will be written are added.
+ * @param records   Where the record headers will be stored.
+ */
+void PayloadWriter::collectArchive(vector<Payload>& batch, vector<Chunk>& chunks, map<int, unsigned long>& collected, deque<string>& records) {
+	vector<iovec> vectors;
+	if (PayloadWriter::archiveDescriptor < 0) {
+		filesystem::path path;
+		{
+			boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+			path = PayloadWriter::archivePath;
+		}
+		// An archive closed by a previous writer thread is continued, its index will be overwritten
+		PayloadWriter::archiveDescriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (PayloadWriter::archiveOffset == 0 ? O_TRUNC : 0), 0644);
+		if (PayloadWriter::archiveDescriptor < 0) {
+			cerr << "Impossible to open the archive " << path << ", the payloads will be lost: " << strerror(errno) << endl;
+			return;
+		}
+		if (PayloadWriter::archiveOffset == 0) {
+			records.emplace_back(PayloadArchive::MAGIC, sizeof(PayloadArchive::MAGIC));
+			vectors.push_back({ records.back().data(), records.back().size() });
+		}
+	}
+	uint64_t start = PayloadWriter::archiveOffset;
+	// The archive header, if any, is the only vector so far
+	PayloadWriter::archiveOffset += vectors.empty() ? 0 : vectors.front().iov_len;
+	for (Payload& payload : batch) {
+		if (payload.length == 0) {
+			continue;
+		}
+		if ((unsigned long) payload.file >= PayloadWriter::archiveIds.size()) {
+			PayloadWriter::archiveIds.resize(payload.file + 1, -1);
+			PayloadWriter::offsets.resize(payload.file + 1, 0);
+		}
+		long& id = PayloadWriter::archiveIds[payload.file];
+		if (id < 0) {
+			PayloadArchive::Stream stream;
+			{
+				boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+				stream.header = PayloadWriter::streams[payload.file];
+				stream.name = PayloadWriter::paths[payload.file].lexically_normal().string();
+			}
+			id = (long) PayloadWriter::archiveStreams.size();
+			stream.header.id = (uint32_t) id;
+			records.push_back(PayloadArchive::makeStreamRecord(stream.header, stream.name, payload.timestamp));
+			vectors.push_back({ records.back().data(), records.back().size() });
+			PayloadWriter::archiveOffset += records.back().size();
+			PayloadWriter::archiveStreams.push_back(std::move(stream));
+		}
+		PayloadArchive::RecordHeader header { (uint32_t) id, (uint32_t) payload.length, (uint64_t) PayloadWriter::offsets[payload.file], payload.timestamp };
+		PayloadWriter::archiveIndex.push_back({ PayloadWriter::archiveOffset, (uint32_t) id, (uint32_t) payload.length });
+		records.emplace_back((const char*) &header, sizeof(header));
+		vectors.push_back({ records.back().data(), records.back().size() });
+		vectors.push_back({ payload.data, payload.length });
+		PayloadWriter::archiveOffset += sizeof(header) + payload.length;
+		PayloadWriter::offsets[payload.file] += (off_t) payload.length;
+		collected[payload.file] += payload.length;
+	}
+	PayloadWriter::addChunks(-1, PayloadWriter::archiveDescriptor, (off_t) start, vectors, chunks);
+}
+
+/**
+ * Splits the vectors written at consecutive offsets in chunks of at most IOV_MAX vectors.
+ *
+ * @param file    The file written, -1 for the archive.
+ * @param fd      Its file descriptor.
+ * @param offset  Where the first vector will be written.
+ * @param vectors The data to write.
+ * @param chunks  Where the chunks will be added.
+ */
+void PayloadWriter::addChunks(int file, int fd, off_t offset, const vector<iovec>& vectors, vector<Chunk>& chunks) {
+	for (size_t first = 0; first < vectors.size(); first += IOV_MAX) {
+		Chunk chunk { file, fd, offset, {}, 0 };
+		chunk.vectors.assign(vectors.begin() + (long) first, vectors.begin() + (long) min(first + IOV_MAX, vectors.size()));
+		for (const iovec& vector : chunk.vectors) {
+			chunk.length += vector.iov_len;
+		}
+		offset += (off_t) chunk.length;
+		chunks.push_back(std::move(chunk));
+	}
+}
+
+/**
+ * Appends the index of the archive after its last record, it is overwritten if more records are written later.
+ */
+void PayloadWriter::writeIndex() {
+	string index = PayloadArchive::makeIndex(PayloadWriter::archiveStreams, PayloadWriter::archiveIndex, PayloadWriter::archiveOffset);
+	Chunk chunk { -1, PayloadWriter::archiveDescriptor, (off_t) PayloadWriter::archiveOffset, { { index.data(), index.size() } }, index.size() };
+	if (PayloadWriter::writeChunk(chunk, 0)) {
+		cout << "Archive index of " << PayloadWriter::archiveStreams.size() << " streams and " << PayloadWriter::archiveIndex.size()
+		     << " records written" << endl;
+	}
+}
+
+/**
+ * Opens a file the first time a payload has to be written in it.
+ *
+ * @param file A file identifier returned by PayloadWriter::open.
+ * @return The file descriptor, -1 if the file cannot be opened.
+ */
+int PayloadWriter::getDescriptor(int file) {
+	if ((unsigned long) file >= PayloadWriter::descriptors.size()) {
+		PayloadWriter::descriptors.resize(file + 1, -1);
+		PayloadWriter::offsets.resize(file + 1, 0);
+	}
+	// A file closed by a previous writer thread is opened again without truncating it
+	if (PayloadWriter::descriptors[file] < 0 && PayloadWriter::offsets[file] >= 0) {
+		filesystem::path path;
+		error_code error;
+		{
+			boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+			path = PayloadWriter::paths[file];
+		}
+		if (path.has_parent_path()) {
+			filesystem::create_directories(path.parent_path(), error);
+		}
+		PayloadWriter::descriptors[file] = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (PayloadWriter::offsets[file] == 0 ? O_TRUNC : 0), 0644);
+		if (PayloadWriter::descriptors[file] < 0) {
+			cerr << "Impossible to open " << path << ", its payloads will be lost: " << strerror(errno) << endl;
+			// It is not tried again
+			PayloadWriter::offsets[file] = -1;
+		}
+	}
+	return PayloadWriter::descriptors[file];
+}
+
+/**
+ * Writes a chunk with pwritev, until every byte has been written or an error occurs.
+ *
+ * @param chunk The payloads to write.
+ * @param done  The bytes of chunk already written.
+ * @return True if the chunk has been written completely, False otherwise.
+ */
+bool PayloadWriter::writeChunk(const Chunk& chunk, size_t done) {
+	while (done < chunk.length) {
+		// The bytes left are always sliced from the whole chunk, whatever the previous writes stopped at
+		IoVector::Segments vectors = IoVector::slice(chunk.vectors.data(), chunk.vectors.size(), done, chunk.length - done);
+		ssize_t result = pwritev(chunk.fd, vectors.data(), (int) vectors.size(), chunk.offset + (off_t) done);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result <= 0) {
+			boost::mutex::scoped_lock lock(PayloadWriter::mutex);
+			cerr << "Error occurred while writing the payloads in " << (chunk.file < 0 ? PayloadWriter::archivePath : PayloadWriter::paths[chunk.file])
+			     << ": " << strerror(errno) << endl;
+			return false;
+		}
+		done += (size_t) result;
+	}
+	return true;
+}
+
+#ifdef PTRACER_IO_URING
+/**
+ * Submits the chunks to the io_uring, PayloadWriter::RING_ENTRIES at a time, and waits for their completion.
+ * A chunk written partially is completed with pwritev.
+ *
+ * @param chunks The payloads to write.
+ */
+void PayloadWriter::writeRing(vector<Chunk>& chunks) {
+	for (size_t first = 0; first < chunks.size(); first += PayloadWriter::RING_ENTRIES) {
+		size_t last = min(first + PayloadWriter::RING_ENTRIES, chunks.size());
+		for (size_t i = first; i < last; i++) {
+			io_uring_sqe* entry = io_uring_get_sqe(&ring);
+			io_uring_prep_writev(entry, chunks[i].fd, chunks[i].vectors.data(), (unsigned int) chunks[i].vectors.size(), (unsigned long long) chunks[i].offset);
+			io_uring_sqe_set_data(entry, (void*) i);
+		}
+		int submitted = io_uring_submit(&ring);
+		for (int i = 0; i < max(submitted, 0); i++) {
+			io_uring_cqe* completion;
+			if (io_uring_wait_cqe(&ring, &completion) < 0) {
+				break;
+			}
+			size_t chunk = (size_t) io_uring_cqe_get_data(completion);
+			int result = completion->res;
+			io_uring_cqe_seen(&ring, completion);
+			if (result < 0 || (size_t) result < chunks[chunk].length) {
+				PayloadWriter::writeChunk(chunks[chunk], result > 0 ? (size_t) result : 0);
+			}
+		}
+		if (submitted < (int) (last - first)) {
+			cerr << "io_uring submission failed, the payloads will be written with pwritev" << endl;
+			io_uring_queue_exit(&ring);
+			PayloadWriter::ringReady = false;
+			for (size_t i = first + max(submitted, 0); i < chunks.size(); i++) {
+				PayloadWriter::writeChunk(chunks[i], 0);
+			}
+			return;
+		}
+	}
+}
+#endif
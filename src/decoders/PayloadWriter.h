@@ -0,0 +1,109 @@
+#ifndef PTRACER_PAYLOADWRITER_H
+#define PTRACER_PAYLOADWRITER_H
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <vector>
+#include <sys/uio.h>
+#include <boost/thread.hpp>
+#include "PayloadArchive.h"
+
+class Tracer;
+
+// Writes the payloads captured by the decoders on a dedicated thread, so that the tracees never wait for the disk:
+// the payloads are copied from the tracee memory straight in a bounded staging area and every batch is written with a
+// few large vectored writes, either in a file per stream or, in archive mode, in a single PayloadArchive
+class PayloadWriter {
+public:
+	static const unsigned long MAX_PENDING_BYTES;
+	static const unsigned long BATCH_BYTES;
+	static const unsigned int FLUSH_INTERVAL_MS;
+	static const unsigned long CHUNK_BYTES;
+	static void setArchive(const std::filesystem::path& path);
+	static bool isArchive();
+	static int open(const std::filesystem::path& path, pid_t pid, int fd, PayloadArchive::Direction direction);
+	static bool capture(int file, const Tracer& tracer, unsigned long long address, size_t length);
+	static bool capture(int file, const Tracer& tracer, const iovec* segments, size_t count);
+	static void flush();
+	static void stop();
+	static unsigned long getWritten(int file);
+	static void printReport();
+
+private:
+	friend class PayloadWriterTest;
+	struct Payload {
+		int file;
+		// In PayloadWriter::staging
+		unsigned char* data;
+		// 0 if the payload could not be read, it only gives its reservation back
+		size_t length;
+		// Staging bytes released once the payload is written, the payload and the end of the area skipped before it
+		size_t reserved;
+		uint64_t timestamp;
+		// False while the payload is copied from the tracee, the writer thread only takes the copied payloads
+		bool copied;
+	};
+	// Consecutive payloads of a file written by a single vectored write
+	struct Chunk {
+		// -1 for the archive
+		int file;
+		int fd;
+		off_t offset;
+		std::vector<iovec> vectors;
+		size_t length;
+	};
+	static const unsigned int RING_ENTRIES;
+	// Guards every member below up to PayloadWriter::thread
+	static boost::mutex mutex;
+	static boost::condition_variable ready;
+	static boost::condition_variable space;
+	static boost::condition_variable drained;
+	static std::deque<Payload> pending;
+	static unsigned long pendingBytes;
+	// Ring of PayloadWriter::MAX_PENDING_BYTES, the reservations are released in the order they have been made
+	static unsigned char* staging;
+	static unsigned long stagingHead;
+	static unsigned long stagingUsed;
+	static unsigned int flushRequests;
+	static bool writing;
+	static bool stopping;
+	static std::vector<std::filesystem::path> paths;
+	static std::vector<PayloadArchive::StreamHeader> streams;
+	// Empty unless in archive mode, it cannot change once a file has been opened
+	static std::filesystem::path archivePath;
+	static std::vector<unsigned long> written;
+	static unsigned long batches;
+	static unsigned long writeCalls;
+	static unsigned long producerWaits;
+	static std::unique_ptr<boost::thread> thread;
+	// Owned by the writer thread: file descriptor, -1 if not opened yet, and next write offset of every file
+	static std::vector<int> descriptors;
+	static std::vector<off_t> offsets;
+	// Set by the writer thread, PayloadWriter::printReport may read it from any thread
+	static std::atomic<bool> ringReady;
+	// Owned by the writer thread in archive mode: the archive, the archive stream of every file, -1 if not defined
+	// yet, and what the index will list
+	static int archiveDescriptor;
+	static uint64_t archiveOffset;
+	static std::vector<long> archiveIds;
+	static std::vector<PayloadArchive::Stream> archiveStreams;
+	static std::vector<PayloadArchive::IndexEntry> archiveIndex;
+	static unsigned char* reserve(size_t length, boost::mutex::scoped_lock& lock, size_t& reserved);
+	static void run();
+	static void writeBatch(std::vector<Payload>& batch);
+	static void collectFiles(std::vector<Payload>& batch, std::vector<Chunk>& chunks, std::map<int, unsigned long>& collected);
+	static void collectArchive(std::vector<Payload>& batch, std::vector<Chunk>& chunks, std::map<int, unsigned long>& collected,
+	                           std::deque<std::string>& records);
+	static void addChunks(int file, int fd, off_t offset, const std::vector<iovec>& vectors, std::vector<Chunk>& chunks);
+	static void writeIndex();
+	static int getDescriptor(int file);
+	static bool writeChunk(const Chunk& chunk, size_t done);
+#ifdef PTRACER_IO_URING
+	static void writeRing(std::vector<Chunk>& chunks);
+#endif
+};
+
+#endif //PTRACER_PAYLOADWRITER_H
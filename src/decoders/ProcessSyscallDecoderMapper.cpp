@@ -1,84 +1,71 @@
-#include "BinderDecoder.h"
-#include "ExecveDecoder.h"
-#include "FileDecoder.h"
 #include "ProcessSyscallDecoderMapper.h"
-#include "PtraceDecoder.h"
-#include "SocketDecoder.h"
-#include "../SyscallNameResolver.h"
+#include "SyscallDispatchTable.h"
 
 using namespace std;
 
 /**
- * Asks to all the Decoders to register themselves to this instance.
+ * Creates the state shared by the decoders of a process, the decoders themselves are created by
+ * ProcessSyscallDecoderMapper::getDecoder when they are first needed.
  */
-ProcessSyscallDecoderMapper::ProcessSyscallDecoderMapper() {
-	SocketDecoder::registerAt(*this);
-	FileDecoder::registerAt(*this);
-	PtraceDecoder::registerAt(*this);
-	ExecveDecoder::registerAt(*this);
-#ifdef ARCH_AARCH64
-	BinderDecoder::registerAt(*this);
-#endif
-
+ProcessSyscallDecoderMapper::ProcessSyscallDecoderMapper() : fds(make_shared<FdTable>()), mappings(make_shared<MappingTable>()),
+                                                             capture(make_shared<PayloadCapture>(fds)) {
 }
 
 /**
- * Registers a new SyscallDecoder for a specific syscall number.
- *
- * @param syscall The number of the syscall that should be delegated to this decoder.
- * @param factory The SyscallDecoder that will be delegated to handle syscall.
+ * @param decoder The index of a decoder in the SyscallDispatchTable.
+ * @return The decoder of this process, created if this is the first system call of the process it handles.
  */
-bool ProcessSyscallDecoderMapper::registerEntrySyscallDecoder(unsigned int syscall, shared_ptr<SyscallDecoder> decoder) {
-	auto it = ProcessSyscallDecoderMapper::entrySyscallDecoders.emplace(syscall, decoder);
-	if (!it.second) {
-		throw runtime_error("A Syscall Entry Decoder for syscall " + to_string(syscall) + " is already registered");
+SyscallDecoder& ProcessSyscallDecoderMapper::getDecoder(int decoder) {
+	if ((size_t) decoder >= this->decoders.size()) {
+		this->decoders.resize(SyscallDispatchTable::getDecoderCount());
 	}
-	ProcessSyscallDecoderMapper::decoders.insert(decoder);
-	return true;
-}
-
-bool ProcessSyscallDecoderMapper::registerExitSyscallDecoder(unsigned int syscall, std::shared_ptr<SyscallDecoder> decoder) {
-	auto it = ProcessSyscallDecoderMapper::exitSyscallDecoders.emplace(syscall, decoder);
-	if (!it.second) {
-		throw runtime_error("A Syscall Exit Decoder for syscall " + to_string(syscall) + " is already registered");
+	shared_ptr<SyscallDecoder>& instance = this->decoders[decoder];
+	if (instance == nullptr) {
+		instance.reset(SyscallDispatchTable::create(decoder, *this));
 	}
-	ProcessSyscallDecoderMapper::decoders.insert(decoder);
-	return true;
+	return *instance;
 }
 
 /**
- * Delegates decoding the received entry syscall to the registered SyscallDecoder (if any).
- *
- * @param syscall The syscall entry that shall be handled.
- * @return True if the syscall has been decoded successfully, False an error occurred.
+ * Iterates over the syscalls decoders used by the process and prints a report for each of those.
  */
-bool ProcessSyscallDecoderMapper::decode(const ProcessSyscallEntry& syscall) {
-	auto decoderIt = ProcessSyscallDecoderMapper::entrySyscallDecoders.find(syscall.getSyscall());
-	if (decoderIt == ProcessSyscallDecoderMapper::entrySyscallDecoders.end()) {
-		return false;
+void ProcessSyscallDecoderMapper::printReport() const {
+	for (auto& decoder : this->decoders) {
+		if (decoder != nullptr) {
+			decoder->printReport();
+		}
 	}
-	return decoderIt->second->decode(syscall);
+	this->capture->printReport();
 }
 
 /**
- * Delegates decoding the received exit syscall to the registered SyscallDecoder (if any).
+ * Starts from the file descriptors and the mappings of the parent, it must be called before the new process issues any
+ * system call.
  *
- * @param syscall The syscall exit that shall be handled.
- * @return True if the syscall has been decoded successfully, False an error occurred.
+ * @param parent The decoders of the process that forked this one.
  */
-bool ProcessSyscallDecoderMapper::decode(const ProcessSyscallExit& syscall) {
-	auto decoderIt = ProcessSyscallDecoderMapper::exitSyscallDecoders.find(syscall.getSyscall());
-	if (decoderIt == ProcessSyscallDecoderMapper::exitSyscallDecoders.end()) {
-		return false;
-	}
-	return decoderIt->second->decode(syscall);
+void ProcessSyscallDecoderMapper::inherit(const ProcessSyscallDecoderMapper& parent) {
+	this->fds->inherit(*parent.fds);
+	this->mappings->inherit(*parent.mappings);
 }
 
 /**
- * Iterates over all the registered syscalls decoders and prints a report for each of those.
+ * Closes the file descriptors marked with O_CLOEXEC and ends all the mappings after the process successfully executed a
+ * new program.
  */
-void ProcessSyscallDecoderMapper::printReport() const {
- 	for (auto& syscall : this->decoders) {
-		syscall->printReport();
-	}
+void ProcessSyscallDecoderMapper::exec() {
+	this->fds->exec();
+	this->mappings->exec();
+}
+
+const shared_ptr<FdTable>& ProcessSyscallDecoderMapper::getFdTable() const {
+	return this->fds;
+}
+
+const shared_ptr<MappingTable>& ProcessSyscallDecoderMapper::getMappingTable() const {
+	return this->mappings;
+}
+
+const shared_ptr<PayloadCapture>& ProcessSyscallDecoderMapper::getCapture() const {
+	return this->capture;
 }
\ No newline at end of file
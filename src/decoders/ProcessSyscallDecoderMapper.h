@@ -1,26 +1,35 @@
 #ifndef PTRACER_PROCESSSYSCALLDECODERMAPPER_H
 #define PTRACER_PROCESSSYSCALLDECODERMAPPER_H
 
-#include <map>
-#include <unordered_map>
-#include <set>
+#include <memory>
+#include <vector>
 #include "../ProcessSyscallEntry.h"
 #include "../ProcessSyscallExit.h"
+#include "FdTable.h"
+#include "MappingTable.h"
+#include "PayloadCapture.h"
 
 class SyscallDecoder;
 
 class ProcessSyscallDecoderMapper {
 public:
 	ProcessSyscallDecoderMapper();
-	bool registerEntrySyscallDecoder(unsigned int syscall, std::shared_ptr<SyscallDecoder> decoder);
-	bool registerExitSyscallDecoder(unsigned int syscall, std::shared_ptr<SyscallDecoder> decoder);
-	bool decode(const ProcessSyscallEntry& syscall);
-	bool decode(const ProcessSyscallExit& syscall);
+	SyscallDecoder& getDecoder(int decoder);
 	void printReport() const;
+	void inherit(const ProcessSyscallDecoderMapper& parent);
+	void exec();
+	[[nodiscard]] const std::shared_ptr<FdTable>& getFdTable() const;
+	[[nodiscard]] const std::shared_ptr<MappingTable>& getMappingTable() const;
+	[[nodiscard]] const std::shared_ptr<PayloadCapture>& getCapture() const;
 private:
-	std::unordered_map<unsigned int, std::shared_ptr<SyscallDecoder>> entrySyscallDecoders;
-	std::unordered_map<unsigned int, std::shared_ptr<SyscallDecoder>> exitSyscallDecoders;
-	std::set<std::shared_ptr<SyscallDecoder>> decoders;
+	// File descriptors of this process, shared by all the decoders
+	std::shared_ptr<FdTable> fds;
+	// File mappings of this process
+	std::shared_ptr<MappingTable> mappings;
+	// Payload budgets of this process, shared by the decoders that capture payloads
+	std::shared_ptr<PayloadCapture> capture;
+	// Indexed as the SyscallDispatchTable decoders, nullptr until the process issues a system call handled by the decoder
+	std::vector<std::shared_ptr<SyscallDecoder>> decoders;
 };
 
 
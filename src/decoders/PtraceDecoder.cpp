@@ -2,6 +2,7 @@
 #include <linux/ptrace.h>
 #include <sys/syscall.h>
 #include "PtraceDecoder.h"
+#include "SyscallDispatchTable.h"
 
 using namespace std;
 
@@ -22,12 +23,14 @@ bool PtraceDecoder::decode(const ProcessSyscallExit& syscall) {
 	return true;
 }
 
-void PtraceDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
+void PtraceDecoder::registerAt() {
 	if (PtraceDecoder::ptraceCommands.empty()) {
 		PtraceDecoder::initCommands();
 	}
-	shared_ptr<SyscallDecoder> thisDecoder(new PtraceDecoder());
-	mapper.registerEntrySyscallDecoder(SYS_ptrace, thisDecoder);
+	int thisDecoder = SyscallDispatchTable::registerDecoder<PtraceDecoder>([](ProcessSyscallDecoderMapper&) -> SyscallDecoder* {
+		return new PtraceDecoder();
+	});
+	SyscallDispatchTable::registerEntrySyscallDecoder(SYS_ptrace, thisDecoder);
 }
 
 /**
@@ -1,9 +1,10 @@
 #include <assert.h>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <sys/syscall.h>
+#include "PayloadWriter.h"
 #include "ReadWriteDecoder.h"
+#include "SyscallDispatchTable.h"
 #include "../Tracer.h"
 
 using namespace std;
@@ -11,11 +12,13 @@ using namespace std;
 const filesystem::path ReadWriteDecoder::root{"./ReadWriteDecoder"};
 
 const set<int> ReadWriteDecoder::WRITE_SYSCALLS = {SYS_write,
-																									 // SYS_sendmsg,
-																									 // SYS_sendmmsg, Need to interpret const struct msghdr* msg
-																									 // SYS_preadv
 																									 SYS_sendto,
-																									 SYS_pread64,
+																									 SYS_pwrite64,
+																									 SYS_writev,
+																									 SYS_pwritev,
+																									 SYS_pwritev2,
+																									 SYS_sendmsg,
+																									 SYS_sendmmsg,
 #ifdef SYS_send
 																							     SYS_send
 #endif
@@ -23,72 +26,171 @@ const set<int> ReadWriteDecoder::WRITE_SYSCALLS = {SYS_write,
 
 const set<int> ReadWriteDecoder::READ_SYSCALLS = {SYS_read,
 																								  SYS_recvfrom,
+																								  SYS_pread64,
+																								  SYS_readv,
+																								  SYS_preadv,
+																								  SYS_preadv2,
 	                                                SYS_recvmsg,
-	                                                SYS_recvmmsg
+	                                                SYS_recvmmsg,
 #ifdef SYS_recv
 																							    SYS_recv
 #endif
 };
 
+/**
+ * @param capture The payload budgets of the process.
+ */
+ReadWriteDecoder::ReadWriteDecoder(shared_ptr<PayloadCapture> capture) : capture(std::move(capture)) {
+}
+
 bool ReadWriteDecoder::decode(const ProcessSyscallEntry& syscall) {
-	ofstream* out;
-	if (ReadWriteDecoder::isWrite(syscall.getSyscall())) {
-		out = ReadWriteDecoder::getOfstream(syscall, this->writeOutputs, "-write");
-	} else {
-		out = ReadWriteDecoder::getOfstream(syscall, this->readOutputs, "-read");
+	bool vectored = IoVector::VECTORED_SYSCALLS.find(syscall.getSyscall()) != IoVector::VECTORED_SYSCALLS.end();
+	if (PayloadCapture::isMetadataOnly()) {
+		// The buffer is never read, the exit tells how many bytes have been transferred
+		if (vectored) {
+			IoVector vector;
+			vector.decodeEntry(syscall, false);
+			this->awaitingVector[syscall.getSpid()] = std::move(vector);
+		} else {
+			this->awaiting[syscall.getSpid()] = (int) syscall.argument(0);
+		}
+		return true;
+	}
+	if (vectored) {
+		IoVector vector;
+		if (!vector.decodeEntry(syscall, true)) {
+			cerr << "Impossible to read the buffers of the scatter-gather system call " << syscall.getSyscall() << endl;
+			return false;
+		}
+		if (ReadWriteDecoder::isCapturedAtExit(syscall.getSyscall())) {
+			// The buffers are filled, or the messages are sent, only up to the length known at the exit
+			this->awaitingVector[syscall.getSpid()] = std::move(vector);
+			return true;
+		}
+		return this->capturePayload(syscall, vector.getFd(), vector.getSegments().data(), vector.getSegments().size());
 	}
-	assert(out->is_open());
 	// TODO: Validate those parameters, what if they are corrupted?
 	if (syscall.argument(2) <= 0) {
 		cerr << "Found potentially corrupted syscall parameters, read/write parameters will not be checked" << endl;
 		return false;
 	}
-	char* extracted = (char*) syscall.getTracer()->extractBytes(syscall.argument(1), syscall.argument(2));
-	if (!extracted) {
+	iovec segment { (void*) syscall.argument(1), (size_t) syscall.argument(2) };
+	return this->capturePayload(syscall, (int) syscall.argument(0), &segment, 1);
+}
+
+/**
+ * Counts the bytes transferred by a system call in metadata only mode, otherwise captures the bytes transferred by the
+ * scatter-gather system calls that are captured at the exit.
+ *
+ * @param syscall The exit syscall notification
+ * @return True if the matching entry has been found and the payload captured, False otherwise.
+ */
+bool ReadWriteDecoder::decode(const ProcessSyscallExit& syscall) {
+	auto vectorIt = this->awaitingVector.find(syscall.getSpid());
+	if (vectorIt != this->awaitingVector.end()) {
+		long long result = (long long) syscall.getReturnValue();
+		IoVector vector = std::move(vectorIt->second);
+		this->awaitingVector.erase(vectorIt);
+		if (!vector.decodeExit(syscall)) {
+			cerr << "Impossible to read the lengths of the messages of the system call " << syscall.getSyscall() << endl;
+			return false;
+		}
+		if (!PayloadCapture::isMetadataOnly()) {
+			return this->capturePayload(syscall, vector.getFd(), vector.getSegments().data(), vector.getSegments().size());
+		}
+		this->capture->account(vector.getFd(), !ReadWriteDecoder::isWrite(syscall.getSyscall()), result < 0 ? result : (long long) vector.getLength());
+		return true;
+	}
+	auto it = this->awaiting.find(syscall.getSpid());
+	if (it == this->awaiting.end()) {
+		cerr << "Cannot find a matching system call entry for the received read or write system call!" << endl;
 		return false;
 	}
-	out->write(extracted, syscall.argument(2));
-	out->flush();
-	delete[] extracted;
+	this->capture->account(it->second, !ReadWriteDecoder::isWrite(syscall.getSyscall()), (long long) syscall.getReturnValue());
+	this->awaiting.erase(it);
 	return true;
 }
 
 /**
- * This decoder does not handle exit syscall notifications.
+ * Queues at the PayloadWriter the bytes of a payload allowed by the capture policy, only those are read from the tracee.
  *
- * @param syscall The exit syscall notification
- * @return Always true.
+ * @param syscall  The read or write system call, either its entry or its exit.
+ * @param fd       The file descriptor the payload is transferred through.
+ * @param segments The payload areas in the tracee, a single one unless the system call is a scatter-gather one.
+ * @param count    The number of areas.
+ * @return True if the allowed bytes have been captured, False if they cannot be read.
  */
-bool ReadWriteDecoder::decode(const ProcessSyscallExit& syscall) {
+template<typename T>
+bool ReadWriteDecoder::capturePayload(const T& syscall, int fd, const iovec* segments, size_t count) {
+	unsigned long length = 0;
+	for (size_t i = 0; i < count; i++) {
+		length += segments[i].iov_len;
+	}
+	if (length == 0) {
+		// Nothing has been transferred, as in a failed system call
+		return true;
+	}
+	PayloadCapture::Ranges ranges = this->capture->plan(fd, length);
+	if (ranges.empty()) {
+		return true;
+	}
+	int out;
+	if (ReadWriteDecoder::isWrite(syscall.getSyscall())) {
+		out = ReadWriteDecoder::getOutFile(syscall.getPid(), fd, this->writeOutputs, "-write");
+	} else {
+		out = ReadWriteDecoder::getOutFile(syscall.getPid(), fd, this->readOutputs, "-read");
+	}
+	// The payload is written by the PayloadWriter thread, the tracee does not wait for the disk
+	for (const auto& range : ranges) {
+		IoVector::Segments slice = IoVector::slice(segments, count, range.first, range.second);
+		if (!PayloadWriter::capture(out, *syscall.getTracer(), slice.data(), slice.size())) {
+			return false;
+		}
+	}
 	return true;
 }
 
-ofstream* ReadWriteDecoder::getOfstream(const ProcessSyscallEntry& syscall, map<int, OutFile>& map, string append) {
-	ofstream* out;
-	auto it = map.find(syscall.argument(0));
+/**
+ * Gets the output file of a file descriptor, it is registered at the PayloadWriter the first time.
+ *
+ * @param pid    The process the file descriptor belongs to.
+ * @param fd     The file descriptor used by the read or write system call.
+ * @param map    The output files of the read or of the write system calls.
+ * @param append The suffix of the output file name.
+ * @return The PayloadWriter file identifier.
+ */
+int ReadWriteDecoder::getOutFile(pid_t pid, int fd, map<int, OutFile>& map, string append) {
+	int out;
+	auto it = map.find(fd);
 	if (it == map.end()) {
-		filesystem::path pidRoot(ReadWriteDecoder::root / to_string(syscall.getPid()));
-		filesystem::create_directory(pidRoot);
-		// All file descriptors are unique per process per execution
-		filesystem::path path(pidRoot / (to_string(syscall.argument(0)) + append));
-		auto pair = map.emplace((int) syscall.argument(0), (OutFile) {path, ofstream(path, ios::out | ios::binary)});
-		out = &pair.first->second.outStream;
+		// All file descriptors are unique per process per execution, the directories are created by the PayloadWriter
+		filesystem::path path(ReadWriteDecoder::root / to_string(pid) / (to_string(fd) + append));
+		out = PayloadWriter::open(path, pid, fd, append == "-read" ? PayloadArchive::READ : PayloadArchive::WRITE);
+		map.emplace(fd, (OutFile) {path, out});
 	} else {
-		out = &it->second.outStream;
+		out = it->second.file;
 	}
 	return out;
 }
 
-void ReadWriteDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
-	if (!filesystem::is_directory(root)) {
+void ReadWriteDecoder::registerAt() {
+	if (!PayloadWriter::isArchive() && !PayloadCapture::isMetadataOnly() && !filesystem::is_directory(root)) {
 		filesystem::create_directory(root);
 	}
-	shared_ptr<SyscallDecoder> thisDecoder(new ReadWriteDecoder());
+	int thisDecoder = SyscallDispatchTable::registerDecoder<ReadWriteDecoder>([](ProcessSyscallDecoderMapper& mapper) -> SyscallDecoder* {
+		return new ReadWriteDecoder(mapper.getCapture());
+	});
 	for (int syscall : ReadWriteDecoder::WRITE_SYSCALLS) {
-		mapper.registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		if (PayloadCapture::isMetadataOnly() || ReadWriteDecoder::isCapturedAtExit(syscall)) {
+			SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
+		}
 	}
 	for (int syscall : ReadWriteDecoder::READ_SYSCALLS) {
-		mapper.registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		if (PayloadCapture::isMetadataOnly() || ReadWriteDecoder::isCapturedAtExit(syscall)) {
+			SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
+		}
 	}
 }
 
@@ -98,12 +200,12 @@ void ReadWriteDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
 void ReadWriteDecoder::printReport() const {
 	cout << "------------------ READ DECODER START ------------------" << endl;
 	for (auto& i : this->readOutputs) {
-		cout << "File Descriptor " << i.first << " read content extracted in: " << i.second.path << ", bytes: " << filesystem::file_size(i.second.path) << endl;
+		cout << "File Descriptor " << i.first << " read content extracted in: " << i.second.path << ", bytes: " << PayloadWriter::getWritten(i.second.file) << endl;
 	}
 	cout << "------------------ READ DECODER END ------------------" << endl;
 	cout << "------------------ WRITE DECODER START ------------------" << endl;
 	for (auto& i : this->writeOutputs) {
-		cout << "File Descriptor " << i.first << " written content extracted in: " << i.second.path << ", bytes: " << filesystem::file_size(i.second.path) << endl;
+		cout << "File Descriptor " << i.first << " written content extracted in: " << i.second.path << ", bytes: " << PayloadWriter::getWritten(i.second.file) << endl;
 	}
 	cout << "------------------ WRITE DECODER END ------------------" << endl;
 }
@@ -114,4 +216,16 @@ bool ReadWriteDecoder::isWrite(int syscall) {
 	}
 	assert(ReadWriteDecoder::READ_SYSCALLS.find(syscall) != ReadWriteDecoder::READ_SYSCALLS.end());
 	return false;
-}
\ No newline at end of file
+}
+
+/**
+ * @param syscall A read or write system call.
+ * @return True if the payload of syscall is known only at the exit: the buffers of the scatter-gather reads and the
+ *         messages of sendmmsg, which may send fewer of them than requested.
+ */
+bool ReadWriteDecoder::isCapturedAtExit(int syscall) {
+	if (IoVector::VECTORED_SYSCALLS.find(syscall) == IoVector::VECTORED_SYSCALLS.end()) {
+		return false;
+	}
+	return !ReadWriteDecoder::isWrite(syscall) || syscall == SYS_sendmmsg;
+}
@@ -2,18 +2,20 @@
 #define PTRACER_READWRITEDECODER_H
 
 #include <filesystem>
-#include <fstream>
 #include <set>
+#include "IoVector.h"
+#include "PayloadCapture.h"
 #include "SyscallDecoder.h"
 
 struct OutFile {
 	std::filesystem::path path;
-	std::ofstream outStream;
+	// PayloadWriter file identifier
+	int file;
 };
 
 class ReadWriteDecoder : public SyscallDecoder {
 public:
-	static void registerAt(ProcessSyscallDecoderMapper& mapper);
+	static void registerAt();
 	bool decode(const ProcessSyscallEntry& syscall) override;
 	bool decode(const ProcessSyscallExit& syscall) override;
 	void printReport() const override;
@@ -23,8 +25,17 @@ private:
 	static const std::filesystem::path root;
 	std::map<int, OutFile> readOutputs;
 	std::map<int, OutFile> writeOutputs;
+	// File descriptor of the system calls in progress, only in metadata only mode
+	std::unordered_map<pid_t, int> awaiting;
+	// Scatter-gather system calls in progress, in metadata only mode or if they are captured at the exit
+	std::unordered_map<pid_t, IoVector> awaitingVector;
+	const std::shared_ptr<PayloadCapture> capture;
+	explicit ReadWriteDecoder(std::shared_ptr<PayloadCapture> capture);
 	static inline bool isWrite(int syscall);
-	static std::ofstream* getOfstream(const ProcessSyscallEntry& syscall, std::map<int, OutFile>& map, std::string append);
+	static bool isCapturedAtExit(int syscall);
+	template<typename T>
+	bool capturePayload(const T& syscall, int fd, const iovec* segments, size_t count);
+	static int getOutFile(pid_t pid, int fd, std::map<int, OutFile>& map, std::string append);
 };
 
 #endif //PTRACER_READWRITEDECODER_H
@@ -1,51 +1,135 @@
 #include <arpa/inet.h>
 #include <boost/format.hpp>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <sys/syscall.h>
 #include <sys/un.h>
 #include "SocketDecoder.h"
+#include "SyscallDispatchTable.h"
 #include "../Tracer.h"
 
 using namespace std;
 
 unordered_map<unsigned short, std::string> SocketDecoder::socketFamilies;
 
+/**
+ * @param fds The file descriptors of the process, the created sockets are added to it and named after their peer.
+ */
+SocketDecoder::SocketDecoder(shared_ptr<FdTable> fds) : fds(std::move(fds)) {
+}
+
 bool SocketDecoder::decode(const ProcessSyscallEntry& syscall) {
-	// TODO: Malicious tracees could set very big length to try to make the tracer crash
-	auto* addr = (sockaddr*) syscall.getTracer()->extractBytes(syscall.argument(1), syscall.argument(2));
-	if (!addr) {
+	if (syscall.getSyscall() != SYS_connect) {
+		this->creating[syscall.getSpid()] = { syscall.argument(0), syscall.argument(1), syscall.argument(2), syscall.argument(3) };
+		return true;
+	}
+	// The address length is set by the tracee, no address is larger than a sockaddr_storage
+	unsigned int length = (unsigned int) min(syscall.argument(2), (unsigned long long) sizeof(sockaddr_storage));
+	if (length < sizeof(sa_family_t)) {
+		return false;
+	}
+	auto* extracted = syscall.getTracer()->extractBytes(syscall.argument(1), length);
+	if (!extracted) {
 		return false;
 	}
-	unique_ptr<AddressParameters> parameters = make_unique<AddressParameters>(SocketDecoder::makeCall(syscall, addr));
-	this->active[syscall.getSpid()] = &parameters->errorCode;
+	// The address is copied in a zeroed sockaddr_storage, makeCall may read more bytes than the tracee passed
+	sockaddr_storage storage = {};
+	memcpy(&storage, extracted, length);
+	delete[] extracted;
+	auto* addr = (sockaddr*) &storage;
+	unique_ptr<AddressParameters> parameters = make_unique<AddressParameters>(SocketDecoder::makeCall((int) syscall.argument(0), addr));
+	this->active[syscall.getSpid()] = parameters.get();
 	this->calls.push_back(move(parameters));
-	delete[] addr;
 	return true;
 }
 
 /**
- * This decoder does not handle exit syscall notifications.
+ * Stores the result of a connect and names the connected socket after its peer.
  *
  * @param syscall The exit syscall notification
  * @return Always true.
  */
 bool SocketDecoder::decode(const ProcessSyscallExit& syscall) {
-	assert(this->active.find(syscall.getSpid()) != this->active.end());
-	*(this->active.find(syscall.getSpid())->second) = (int) syscall.getReturnValue();
+	if (syscall.getSyscall() != SYS_connect) {
+		return this->decodeCreationExit(syscall);
+	}
+	auto it = this->active.find(syscall.getSpid());
+	assert(it != this->active.end());
+	AddressParameters* parameters = it->second;
+	parameters->errorCode = (int) syscall.getReturnValue();
+	this->active.erase(it);
+	// A non blocking connect completes later, the peer is already known
+	if (parameters->errorCode == 0 || parameters->errorCode == -EINPROGRESS) {
+		this->fds->rename(parameters->sfd, SocketDecoder::makeName(*parameters));
+	}
 	return true;
 }
 
-void SocketDecoder::registerAt(ProcessSyscallDecoderMapper& mapper) {
+/**
+ * Adds the sockets created by socket, socketpair, accept and accept4 to the file descriptors of the process, an
+ * accepted socket is named after its peer.
+ *
+ * @param syscall The exit syscall notification
+ * @return True if the system call entry has been found, False otherwise.
+ */
+bool SocketDecoder::decodeCreationExit(const ProcessSyscallExit& syscall) {
+	auto it = this->creating.find(syscall.getSpid());
+	if (it == this->creating.end()) {
+		cerr << "Cannot find a matching system call entry for the received socket system call!" << endl;
+		return false;
+	}
+	array<unsigned long long, 4> arguments = it->second;
+	this->creating.erase(it);
+	long long result = (long long) syscall.getReturnValue();
+	const Tracer& tracer = *syscall.getTracer();
+	if (result < 0) {
+		return true;
+	}
+	switch (syscall.getSyscall()) {
+		case SYS_socket:
+			// socket(domain, type, protocol), the socket is named once it connects
+			this->fds->open((int) result, "", FdTable::SOCKET, arguments[1] & SOCK_CLOEXEC);
+			break;
+		case SYS_socketpair: {
+			// socketpair(domain, type, protocol, sv)
+			int ends[2];
+			if (tracer.readMemory(arguments[3], ends, sizeof(ends))) {
+				string name = "socketpair:[" + to_string(ends[0]) + "," + to_string(ends[1]) + "]";
+				this->fds->open(ends[0], name, FdTable::SOCKET, arguments[1] & SOCK_CLOEXEC);
+				this->fds->open(ends[1], name, FdTable::SOCKET, arguments[1] & SOCK_CLOEXEC);
+			}
+			break;
+		}
+		default: {
+			// accept(sockfd, addr, addrlen) and accept4(sockfd, addr, addrlen, flags), the peer is optional
+			string name;
+			socklen_t length = 0;
+			sockaddr_storage storage = {};
+			if (arguments[1] != 0 && tracer.readMemory(arguments[2], &length, sizeof(length)) && length >= sizeof(sa_family_t) &&
+			    tracer.readMemory(arguments[1], &storage, min((size_t) length, sizeof(storage)))) {
+				name = SocketDecoder::makeName(SocketDecoder::makeCall((int) result, (sockaddr*) &storage));
+			}
+			this->fds->open((int) result, name, FdTable::SOCKET, syscall.getSyscall() == SYS_accept4 && (arguments[3] & SOCK_CLOEXEC));
+			break;
+		}
+	}
+	return true;
+}
+
+void SocketDecoder::registerAt() {
 	if (SocketDecoder::socketFamilies.empty()) {
 		SocketDecoder::initFamilies();
 	}
-	shared_ptr<SyscallDecoder> thisDecoder(new SocketDecoder());
-	mapper.registerEntrySyscallDecoder(SYS_connect, thisDecoder);
-	mapper.registerExitSyscallDecoder(SYS_connect, thisDecoder);
-	//mapper.registerEntrySyscallDecoder(SYS_bind, thisDecoder);
-	//mapper.registerEntrySyscallDecoder(SYS_accept, thisDecoder);
-	//TODO:  Investigate socketpair
-	//TODO: Finish to integrate bind and accept
+	int thisDecoder = SyscallDispatchTable::registerDecoder<SocketDecoder>([](ProcessSyscallDecoderMapper& mapper) -> SyscallDecoder* {
+		return new SocketDecoder(mapper.getFdTable());
+	});
+	for (int syscall : { SYS_connect, SYS_socket, SYS_socketpair, SYS_accept, SYS_accept4 }) {
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
+	}
+	//SyscallDispatchTable::registerEntrySyscallDecoder(SYS_bind, thisDecoder);
+	//TODO: Finish to integrate bind
 }
 
 /**
@@ -81,9 +165,19 @@ void SocketDecoder::initFamilies() {
 	SocketDecoder::socketFamilies[AF_IEEE802154] = "IEEE 802.15.4 WPAN";
 }
 
-AddressParameters SocketDecoder::makeCall(const ProcessSyscallEntry& entry, sockaddr* addr) {
+/**
+ * @param parameters A socket address.
+ * @return The address and port, or the path of a UNIX socket, as the file descriptor of the socket is named.
+ */
+string SocketDecoder::makeName(const AddressParameters& parameters) {
+	if (parameters.family == SocketDecoder::socketFamilies[AF_UNIX]) {
+		return parameters.address;
+	}
+	return parameters.address + ":" + to_string(parameters.port);
+}
+
+AddressParameters SocketDecoder::makeCall(int sfd, sockaddr* addr) {
 	char address[40] = "Erroneous Address";
-	int sfd = entry.argument(0);
 	string family = SocketDecoder::socketFamilies[addr->sa_family];
 	switch (addr->sa_family) {
 		case AF_INET: {
@@ -3,6 +3,8 @@
 
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <array>
+#include "FdTable.h"
 #include "SyscallDecoder.h"
 
 struct AddressParameters {
@@ -15,16 +17,22 @@ struct AddressParameters {
 
 class SocketDecoder : public SyscallDecoder {
 public:
-	static void registerAt(ProcessSyscallDecoderMapper& mapper);
+	static void registerAt();
 	bool decode(const ProcessSyscallEntry& syscall) override;
 	bool decode(const ProcessSyscallExit& syscall) override;
 	void printReport() const override;
 private:
 	static std::unordered_map<unsigned short, std::string> socketFamilies;
 	static void initFamilies();
-	static AddressParameters makeCall(const ProcessSyscallEntry& entry, sockaddr* addr);
+	static AddressParameters makeCall(int sfd, sockaddr* addr);
+	static std::string makeName(const AddressParameters& parameters);
 	std::vector<std::unique_ptr<AddressParameters>> calls;
-	std::unordered_map<pid_t, int*> active;
+	std::unordered_map<pid_t, AddressParameters*> active;
+	// The arguments of the socket, socketpair, accept and accept4 in progress
+	std::unordered_map<pid_t, std::array<unsigned long long, 4>> creating;
+	const std::shared_ptr<FdTable> fds;
+	explicit SocketDecoder(std::shared_ptr<FdTable> fds);
+	bool decodeCreationExit(const ProcessSyscallExit& syscall);
 };
 
 #endif //PTRACER_SOCKETDECODER_H
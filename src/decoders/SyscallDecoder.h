@@ -6,6 +6,7 @@
 
 class SyscallDecoder {
 public:
+	virtual ~SyscallDecoder() = default;
 	virtual bool decode(const ProcessSyscallEntry& syscall) = 0;
 	virtual bool decode(const ProcessSyscallExit& syscall) = 0;
 	virtual void printReport() const = 0;
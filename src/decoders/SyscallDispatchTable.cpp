@@ -0,0 +1,89 @@
+#include <stdexcept>
+#include "BinderDecoder.h"
+#include "DescriptorDecoder.h"
+#include "ExecveDecoder.h"
+#include "FileDecoder.h"
+#include "MappingDecoder.h"
+#include "PtraceDecoder.h"
+#include "SocketDecoder.h"
+#include "SyscallDispatchTable.h"
+#include "TransferDecoder.h"
+
+using namespace std;
+
+const SyscallDispatchTable::Slot SyscallDispatchTable::NOT_DECODED;
+
+vector<SyscallDispatchTable::DecoderType> SyscallDispatchTable::decoders;
+
+vector<SyscallDispatchTable::Slot> SyscallDispatchTable::slots;
+
+/**
+ * Asks to all the Decoders to register themselves, it must be called once after the capture policy has been set.
+ */
+void SyscallDispatchTable::init() {
+	SocketDecoder::registerAt();
+	FileDecoder::registerAt();
+	DescriptorDecoder::registerAt();
+	MappingDecoder::registerAt();
+	TransferDecoder::registerAt();
+	PtraceDecoder::registerAt();
+	ExecveDecoder::registerAt();
+#ifdef ARCH_AARCH64
+	BinderDecoder::registerAt();
+#endif
+}
+
+/**
+ * Delegates the entries of a system call to a decoder.
+ *
+ * @param syscall The number of the syscall that should be delegated to the decoder.
+ * @param decoder The index returned by SyscallDispatchTable::registerDecoder.
+ */
+void SyscallDispatchTable::registerEntrySyscallDecoder(unsigned int syscall, int decoder) {
+	Slot& slot = SyscallDispatchTable::getSlot(syscall);
+	if (slot.entry != nullptr) {
+		throw runtime_error("A Syscall Entry Decoder for syscall " + to_string(syscall) + " is already registered");
+	}
+	slot.entryDecoder = decoder;
+	slot.entry = SyscallDispatchTable::decoders.at(decoder).entry;
+}
+
+void SyscallDispatchTable::registerExitSyscallDecoder(unsigned int syscall, int decoder) {
+	Slot& slot = SyscallDispatchTable::getSlot(syscall);
+	if (slot.exit != nullptr) {
+		throw runtime_error("A Syscall Exit Decoder for syscall " + to_string(syscall) + " is already registered");
+	}
+	slot.exitDecoder = decoder;
+	slot.exit = SyscallDispatchTable::decoders.at(decoder).exit;
+}
+
+/**
+ * @param syscall A system call number.
+ * @return The decoders of syscall, SyscallDispatchTable::NOT_DECODED if it has none.
+ */
+const SyscallDispatchTable::Slot& SyscallDispatchTable::get(int syscall) {
+	if (syscall < 0 || (size_t) syscall >= SyscallDispatchTable::slots.size()) {
+		return SyscallDispatchTable::NOT_DECODED;
+	}
+	return SyscallDispatchTable::slots[syscall];
+}
+
+/**
+ * @param decoder The index of a decoder.
+ * @param mapper  The decoders of the process the new decoder belongs to.
+ * @return A new instance of the decoder.
+ */
+SyscallDecoder* SyscallDispatchTable::create(int decoder, ProcessSyscallDecoderMapper& mapper) {
+	return SyscallDispatchTable::decoders[decoder].factory(mapper);
+}
+
+size_t SyscallDispatchTable::getDecoderCount() {
+	return SyscallDispatchTable::decoders.size();
+}
+
+SyscallDispatchTable::Slot& SyscallDispatchTable::getSlot(unsigned int syscall) {
+	if (syscall >= SyscallDispatchTable::slots.size()) {
+		SyscallDispatchTable::slots.resize(syscall + 1);
+	}
+	return SyscallDispatchTable::slots[syscall];
+}
@@ -0,0 +1,74 @@
+#ifndef PTRACER_SYSCALLDISPATCHTABLE_H
+#define PTRACER_SYSCALLDISPATCHTABLE_H
+
+#include <vector>
+#include "SyscallDecoder.h"
+
+// Decoders of every system call, shared by all the traced processes: an array indexed by system call number holding the
+// index of the entry and exit decoders and direct functions calling them. The decoders register themselves once, when
+// the decoding is enabled, and every ProcessSyscallDecoderMapper creates its own instance of a decoder only when the
+// process issues the first system call handled by it.
+class SyscallDispatchTable {
+public:
+	// Creates the decoder of a process, from the state shared by all the decoders of the process
+	typedef SyscallDecoder* (*Factory)(ProcessSyscallDecoderMapper& mapper);
+	typedef bool (*EntryHandler)(SyscallDecoder& decoder, const ProcessSyscallEntry& syscall);
+	typedef bool (*ExitHandler)(SyscallDecoder& decoder, const ProcessSyscallExit& syscall);
+	// The decoders are -1 and the handlers nullptr if the system call is not decoded
+	struct Slot {
+		int entryDecoder = -1;
+		int exitDecoder = -1;
+		EntryHandler entry = nullptr;
+		ExitHandler exit = nullptr;
+	};
+	static void init();
+	template<typename Decoder>
+	static int registerDecoder(Factory factory);
+	static void registerEntrySyscallDecoder(unsigned int syscall, int decoder);
+	static void registerExitSyscallDecoder(unsigned int syscall, int decoder);
+	static const Slot& get(int syscall);
+	static SyscallDecoder* create(int decoder, ProcessSyscallDecoderMapper& mapper);
+	static size_t getDecoderCount();
+
+private:
+	struct DecoderType {
+		Factory factory;
+		EntryHandler entry;
+		ExitHandler exit;
+	};
+	static const Slot NOT_DECODED;
+	// Indexed by decoder, in registration order
+	static std::vector<DecoderType> decoders;
+	// Indexed by system call number
+	static std::vector<Slot> slots;
+	static Slot& getSlot(unsigned int syscall);
+	template<typename Decoder>
+	static bool decodeEntry(SyscallDecoder& decoder, const ProcessSyscallEntry& syscall);
+	template<typename Decoder>
+	static bool decodeExit(SyscallDecoder& decoder, const ProcessSyscallExit& syscall);
+};
+
+/**
+ * Adds a decoder, its system calls are then registered with its index.
+ *
+ * @tparam Decoder The decoder class, its decode methods are called without going through the virtual table.
+ * @param factory  Creates the decoder of a process.
+ * @return The index of the decoder.
+ */
+template<typename Decoder>
+int SyscallDispatchTable::registerDecoder(Factory factory) {
+	SyscallDispatchTable::decoders.push_back({ factory, &SyscallDispatchTable::decodeEntry<Decoder>, &SyscallDispatchTable::decodeExit<Decoder> });
+	return (int) SyscallDispatchTable::decoders.size() - 1;
+}
+
+template<typename Decoder>
+bool SyscallDispatchTable::decodeEntry(SyscallDecoder& decoder, const ProcessSyscallEntry& syscall) {
+	return static_cast<Decoder&>(decoder).Decoder::decode(syscall);
+}
+
+template<typename Decoder>
+bool SyscallDispatchTable::decodeExit(SyscallDecoder& decoder, const ProcessSyscallExit& syscall) {
+	return static_cast<Decoder&>(decoder).Decoder::decode(syscall);
+}
+
+#endif //PTRACER_SYSCALLDISPATCHTABLE_H
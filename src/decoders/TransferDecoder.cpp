@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <iostream>
+#include <sys/syscall.h>
+#include "TransferDecoder.h"
+#include "SyscallDispatchTable.h"
+#include "../Tracer.h"
+
+using namespace std;
+
+const set<int> TransferDecoder::TRANSFER_SYSCALLS = {SYS_sendfile,
+                                                     SYS_splice,
+                                                     SYS_tee,
+                                                     SYS_copy_file_range,
+                                                     SYS_vmsplice};
+
+const int TransferDecoder::MEMORY = -1;
+
+/**
+ * @param capture The file descriptor names of the process, and its I/O counters in metadata only mode.
+ */
+TransferDecoder::TransferDecoder(shared_ptr<PayloadCapture> capture) : capture(std::move(capture)) {
+}
+
+void TransferDecoder::registerAt() {
+	int thisDecoder = SyscallDispatchTable::registerDecoder<TransferDecoder>([](ProcessSyscallDecoderMapper& mapper) -> SyscallDecoder* {
+		return new TransferDecoder(mapper.getCapture());
+	});
+	for (int syscall : TransferDecoder::TRANSFER_SYSCALLS) {
+		// The entry holds the file descriptors and the offsets, the exit the number of bytes transferred
+		SyscallDispatchTable::registerEntrySyscallDecoder(syscall, thisDecoder);
+		SyscallDispatchTable::registerExitSyscallDecoder(syscall, thisDecoder);
+	}
+}
+
+bool TransferDecoder::decode(const ProcessSyscallEntry& syscall) {
+	TransferParameters parameters { TransferDecoder::MEMORY, -1, -1, -1 };
+	switch (syscall.getSyscall()) {
+		case SYS_sendfile:
+			// sendfile(out_fd, in_fd, offset, count)
+			parameters.destination = (int) syscall.argument(0);
+			parameters.source = (int) syscall.argument(1);
+			parameters.sourceOffset = TransferDecoder::readOffset(syscall, syscall.argument(2));
+			break;
+		case SYS_splice:
+		case SYS_copy_file_range:
+			// splice(fd_in, off_in, fd_out, off_out, len, flags), the same for copy_file_range
+			parameters.source = (int) syscall.argument(0);
+			parameters.sourceOffset = TransferDecoder::readOffset(syscall, syscall.argument(1));
+			parameters.destination = (int) syscall.argument(2);
+			parameters.destinationOffset = TransferDecoder::readOffset(syscall, syscall.argument(3));
+			break;
+		case SYS_tee:
+			parameters.source = (int) syscall.argument(0);
+			parameters.destination = (int) syscall.argument(1);
+			break;
+		default:
+			// vmsplice(fd, iov, nr_segs, flags), usually the pages of the tracee are spliced in a pipe
+			parameters.destination = (int) syscall.argument(0);
+			break;
+	}
+	this->active[syscall.getSpid()] = parameters;
+	return true;
+}
+
+bool TransferDecoder::decode(const ProcessSyscallExit& syscall) {
+	auto it = this->active.find(syscall.getSpid());
+	if (it == this->active.end()) {
+		cerr << "Cannot find a matching system call entry for the received transfer system call!" << endl;
+		return false;
+	}
+	TransferParameters parameters = it->second;
+	this->active.erase(it);
+	long long result = (long long) syscall.getReturnValue();
+	string source = parameters.source == TransferDecoder::MEMORY ? "memory" : this->capture->getName(parameters.source);
+	TransferStatistics& statistics = this->transfers[{ source, this->capture->getName(parameters.destination) }];
+	statistics.calls++;
+	if (result < 0) {
+		// Nothing has been transferred, the error may even come from a descriptor that is not open
+		statistics.errors++;
+		return true;
+	}
+	statistics.bytes += (unsigned long) result;
+	TransferDecoder::extend(statistics.source, parameters.sourceOffset, result);
+	TransferDecoder::extend(statistics.destination, parameters.destinationOffset, result);
+	if (PayloadCapture::isMetadataOnly()) {
+		// The bytes are read from the source and written in the destination, as if the tracee copied them
+		if (parameters.source != TransferDecoder::MEMORY) {
+			this->capture->account(parameters.source, true, result);
+		}
+		this->capture->account(parameters.destination, false, result);
+	}
+	return true;
+}
+
+/**
+ * Prints a report of the bytes copied by the kernel between every pair of paths or socket peers.
+ */
+void TransferDecoder::printReport() const {
+	cout << "------------------ TRANSFER DECODER START ------------------" << endl;
+	for (const auto& i : this->transfers) {
+		const TransferStatistics& statistics = i.second;
+		cout << i.first.first << " ---> " << i.first.second << ": " << statistics.bytes << " bytes in " << statistics.calls
+		     << " calls, " << statistics.errors << " errors";
+		if (statistics.source.start >= 0) {
+			cout << ", source offsets [" << statistics.source.start << ", " << statistics.source.end << ")";
+		}
+		if (statistics.destination.start >= 0) {
+			cout << ", destination offsets [" << statistics.destination.start << ", " << statistics.destination.end << ")";
+		}
+		cout << endl;
+	}
+	cout << "------------------ TRANSFER DECODER STOP ------------------" << endl;
+}
+
+/**
+ * @param syscall The transfer system call.
+ * @param address The address of an off_t or loff_t argument.
+ * @return The offset, -1 if the argument is NULL, so the file position is used, or cannot be read.
+ */
+long long TransferDecoder::readOffset(const ProcessSyscallEntry& syscall, unsigned long long address) {
+	long long offset = -1;
+	if (address == 0 || !syscall.getTracer()->readMemory(address, &offset, sizeof(offset))) {
+		return -1;
+	}
+	return offset;
+}
+
+/**
+ * Adds the bytes transferred at an explicit offset to the offsets touched in a file.
+ *
+ * @param range  The offsets touched so far.
+ * @param offset Where the transfer started, -1 if the file position has been used.
+ * @param length The bytes transferred.
+ */
+void TransferDecoder::extend(OffsetRange& range, long long offset, long long length) {
+	if (offset < 0) {
+		return;
+	}
+	range.start = range.start < 0 ? offset : min(range.start, offset);
+	range.end = max(range.end, offset + length);
+}
@@ -0,0 +1,54 @@
+#ifndef PTRACER_TRANSFERDECODER_H
+#define PTRACER_TRANSFERDECODER_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include "PayloadCapture.h"
+#include "SyscallDecoder.h"
+
+// Offsets of a file touched by the transfers, -1 if the file position has been used instead of an explicit offset
+struct OffsetRange {
+	long long start = -1;
+	long long end = -1;
+};
+
+struct TransferStatistics {
+	unsigned long calls = 0;
+	unsigned long bytes = 0;
+	unsigned long errors = 0;
+	OffsetRange source;
+	OffsetRange destination;
+};
+
+// Parameters of a transfer in progress, the offsets are the values pointed by the system call arguments at the entry
+struct TransferParameters {
+	int source;
+	int destination;
+	long long sourceOffset;
+	long long destinationOffset;
+};
+
+// Accounts the copies made by the kernel without passing through the tracee memory (sendfile, splice, tee,
+// copy_file_range and vmsplice): only the file descriptors, the offsets and the return values are read, never the
+// payloads.
+class TransferDecoder : public SyscallDecoder {
+public:
+	static void registerAt();
+	bool decode(const ProcessSyscallEntry& syscall) override;
+	bool decode(const ProcessSyscallExit& syscall) override;
+	void printReport() const override;
+private:
+	static const std::set<int> TRANSFER_SYSCALLS;
+	// Source of vmsplice, which moves the pages of the tracee in a pipe
+	static const int MEMORY;
+	std::unordered_map<pid_t, TransferParameters> active;
+	// < source, destination > names
+	std::map<std::pair<std::string, std::string>, TransferStatistics> transfers;
+	const std::shared_ptr<PayloadCapture> capture;
+	explicit TransferDecoder(std::shared_ptr<PayloadCapture> capture);
+	static long long readOffset(const ProcessSyscallEntry& syscall, unsigned long long address);
+	static void extend(OffsetRange& range, long long offset, long long length);
+};
+
+#endif //PTRACER_TRANSFERDECODER_H
@@ -1,6 +1,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include "ProcessSyscallEntryDto.h"
+#include "../SyscallNameResolver.h"
 
 using namespace std;
 
@@ -68,6 +69,21 @@ string ProcessSyscallEntryDTO::serialize() const {
 	return flat;
 }
 
+int ProcessSyscallEntryDTO::getSyscall() const {
+	return this->syscall;
+}
+
+/**
+ * Checks if the backtrace is the single frame that the Tracer records when backtraces are disabled, in that case
+ * the system call number alone identifies this object.
+ *
+ * @return True if the only frame is the synthetic one of the system call, False otherwise.
+ */
+bool ProcessSyscallEntryDTO::hasSyntheticFrame() const {
+	return this->frames.size() == 1 &&
+	       this->frames.front() == StackFrameDTO(StackFrame(0, 0, 0, SyscallNameResolver::resolve((unsigned int) this->syscall), 0));
+}
+
 /**
  * Define the equality check that Bimap will use to find a ProcessSyscallEntryDTO
  *
@@ -9,6 +9,8 @@ public:
 	ProcessSyscallEntryDTO(const ProcessSyscallEntry& syscall);
 	ProcessSyscallEntryDTO(const std::string flat, const std::string& executableName);
 	[[nodiscard]] std::string serialize() const;
+	[[nodiscard]] int getSyscall() const;
+	[[nodiscard]] bool hasSyntheticFrame() const;
 	bool operator==(const ProcessSyscallEntryDTO& that) const;
 	bool operator!=(const ProcessSyscallEntryDTO& that) const;
 	bool operator<(const ProcessSyscallEntryDTO& that) const;
@@ -1,10 +1,14 @@
 #include <iostream>
 #include "Launcher.h"
+#include "PolicyCommands.h"
 
 using namespace std;
 
 int main(int argc, const char** argv) {
 	try {
+		if (argc > 1 && PolicyCommands::exists(argv[1])) {
+			return PolicyCommands::run(argv[1], argc - 1, argv + 1);
+		}
 		Launcher launcher(argc, argv);
 		launcher.start();
 	} catch (runtime_error& e) {
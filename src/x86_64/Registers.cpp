@@ -98,4 +98,22 @@ unsigned long long int Registers::argument(unsigned short int i) const {
  */
 unsigned long long int Registers::flags() const {
 	return this->eflags;
-}
\ No newline at end of file
+}
+
+/**
+ * Sets the System Call number, at a syscall entry -1 makes the kernel skip the system call.
+ *
+ * @param number The new System Call number.
+ */
+void Registers::setSyscall(int number) {
+	this->orig_rax = (unsigned long long int) (long long int) number;
+}
+
+/**
+ * Sets the System Call Return Value.
+ *
+ * @param value The new System Call Return Value.
+ */
+void Registers::setReturnValue(long long int value) {
+	this->rax = (unsigned long long int) value;
+}
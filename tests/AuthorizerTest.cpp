@@ -0,0 +1,84 @@
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "Authorizer.h"
+#include "Test.h"
+
+using namespace std;
+
+// Drives an Authorizer with the notifications of a traced process that forks, as the Tracer would
+class AuthorizerTest {
+public:
+	static const pid_t PARENT = 100;
+	static const pid_t CHILD = 101;
+	static const string EXECUTABLE;
+
+	/**
+	 * A syscall entry already authorised, so that proceeding does not need the TracingManager worker thread.
+	 */
+	static shared_ptr<ProcessSyscallEntry> entry(pid_t spid, int syscall) {
+		shared_ptr<ProcessSyscallEntry> result = make_shared<ProcessSyscallEntry>(AuthorizerTest::EXECUTABLE, spid, spid);
+		shared_ptr<Registers> regs = make_shared<Registers>();
+		regs->setSyscall(syscall);
+		result->setRegisters(regs);
+		result->authorise();
+		return result;
+	}
+
+	/**
+	 * The parent calls getpid and fork, then the child calls getpid. After the fork has proceeded the Tracer stores
+	 * the child in its entry and reports the new tracee.
+	 */
+	static void fork(Authorizer& authorizer) {
+		authorizer.process(AuthorizerTest::entry(AuthorizerTest::PARENT, SYS_getpid));
+		shared_ptr<ProcessSyscallEntry> clone = AuthorizerTest::entry(AuthorizerTest::PARENT, SYS_clone);
+		authorizer.process(clone);
+		clone->returnValue = AuthorizerTest::CHILD;
+		clone->childPid = AuthorizerTest::CHILD;
+		authorizer.newTracee(AuthorizerTest::PARENT, AuthorizerTest::CHILD);
+		authorizer.process(AuthorizerTest::entry(AuthorizerTest::CHILD, SYS_getpid));
+	}
+
+	/**
+	 * Learns the fork and then checks it again in shadow mode, while the shadow thread is held until the Tracer has
+	 * gone past the fork.
+	 */
+	static void shadowFork(const string& graphPath, const string& associationsPath) {
+		{
+			Authorizer learner(graphPath, associationsPath, true, false, Authorizer::ASK, 0, "", false,
+			                   SequenceModel::create("ngram", 3));
+			AuthorizerTest::fork(learner);
+			learner.terminate();
+		}
+		Authorizer shadow(graphPath, associationsPath, false, false, Authorizer::SHADOW, 0, "", false,
+		                  SequenceModel::create("ngram", 3));
+		promise<void> released;
+		shared_future<void> release = released.get_future().share();
+		shadow.shadowQueue.push([release]() {
+			release.wait();
+		});
+		AuthorizerTest::fork(shadow);
+		released.set_value();
+		shadow.terminate();
+		CHECK(shadow.shadowChecks == 3);
+		CHECK(shadow.shadowNotAuthorised == 0);
+		CHECK(shadow.shadowNotFinal == 0);
+	}
+};
+
+const string AuthorizerTest::EXECUTABLE = "/usr/bin/forking";
+
+/**
+ * The child of a fork checked in shadow mode starts from the history of its parent, as in enforce mode.
+ */
+int main() {
+	char directory[] = "/tmp/ptracer-authorizer-XXXXXX";
+	CHECK(mkdtemp(directory) != nullptr);
+	string graphPath = string(directory) + "/model";
+	string associationsPath = string(directory) + "/associations";
+	AuthorizerTest::shadowFork(graphPath, associationsPath);
+	filesystem::remove_all(directory);
+	return TEST_RESULT();
+}
@@ -0,0 +1,49 @@
+#include "CompactAutomaton.h"
+#include "Test.h"
+
+using namespace std;
+
+/**
+ * An NFA where label 0 leads from 0 to both 1 and 2, label 1 from 1 to 3 and label 2 from 2 to 3, only 3 is final.
+ */
+int main() {
+	map<int, map<int, set<int>>> transitions = {
+		{ 0, { { 0, { 1, 2 } } } },
+		{ 1, { { 1, { 3 } } } },
+		{ 2, { { 2, { 3 } } } }
+	};
+	CompactAutomaton automaton({ 0 }, { 3 }, transitions, 4, 3);
+	StateSet states;
+	CHECK(!automaton.isDeterministic());
+	CHECK(automaton.getTransitionCount() == 4);
+	CHECK(automaton.step(automaton.getInitialStates(), 0, states));
+	CHECK(states == StateSet({ 1, 2 }));
+	CHECK(!automaton.isFinal(states));
+	StateSet accepting;
+	CHECK(automaton.step(states, 2, accepting));
+	CHECK(accepting == StateSet({ 3 }));
+	CHECK(automaton.isFinal(accepting));
+	// Labels out of the alphabet and missing transitions
+	CHECK(!automaton.step(states, 0, accepting));
+	CHECK(!automaton.step(states, 3, accepting));
+	CHECK(!automaton.step(states, -1, accepting));
+
+	CompactAutomaton deterministic;
+	// { 0 }, { 1, 2 } and { 3 } do not fit in 2 states
+	CHECK(!automaton.determinize(2, deterministic));
+	CHECK(automaton.determinize(CompactAutomaton::DEFAULT_MAX_DFA_STATES, deterministic));
+	CHECK(deterministic.isDeterministic());
+	CHECK(deterministic.getStateCount() == 3);
+	StateSet dfaStates;
+	CHECK(deterministic.step(deterministic.getInitialStates(), 0, dfaStates) && dfaStates.size() == 1);
+	CHECK(deterministic.expand(dfaStates) == set<int>({ 1, 2 }));
+	StateSet dfaFinal;
+	CHECK(deterministic.step(dfaStates, 1, dfaFinal) && deterministic.isFinal(dfaFinal));
+	CHECK(deterministic.step(dfaStates, 2, states) && states == dfaFinal);
+	CHECK(!deterministic.step(dfaFinal, 0, states));
+	// The final states are given as states of the NFA
+	deterministic.setFinalStates({ 2 });
+	CHECK(deterministic.isFinal(dfaStates));
+	CHECK(!deterministic.isFinal(dfaFinal));
+	return TEST_RESULT();
+}
@@ -0,0 +1,44 @@
+#include "decoders/FdTable.h"
+#include "Test.h"
+
+using namespace std;
+
+int main() {
+	FdTable table;
+	// Only the standard streams are open
+	CHECK(table.find(1) != nullptr);
+	CHECK(table.getName(2) == "STDERR");
+	CHECK(table.find(3) == nullptr);
+	CHECK(table.find(-1) == nullptr);
+	// A lookup never grows the table
+	CHECK(table.find(1000) == nullptr);
+	CHECK(table.getName(1000) == "fd 1000");
+	CHECK(table.getEntries().size() == 3);
+	table.open(4, "/tmp/file", FdTable::PATH, true);
+	CHECK(table.find(3) == nullptr);
+	CHECK(table.find(4) != nullptr && table.find(4)->kind == FdTable::PATH);
+	// A copy refers to the same file, without the close on exec flag
+	table.duplicate(4, 7, false);
+	CHECK(table.getName(7) == "/tmp/file");
+	CHECK(!table.find(7)->cloexec);
+	// A file descriptor inherited before tracing started is open once a system call succeeds on it
+	CHECK(table.adopt(9) != nullptr);
+	CHECK(table.find(9) != nullptr);
+	CHECK(table.getName(9) == "fd 9");
+	CHECK(table.adopt(FdTable::MAX_FDS) == nullptr);
+	table.close(7);
+	CHECK(table.find(7) == nullptr);
+	CHECK(table.getName(7) == "fd 7");
+	table.rename(9, "socket:1.2.3.4:80");
+	CHECK(table.getName(9) == "socket:1.2.3.4:80");
+	// The child starts with the descriptors of the parent, execve closes the ones marked with O_CLOEXEC
+	FdTable child;
+	child.inherit(table);
+	child.exec();
+	CHECK(child.find(4) == nullptr);
+	CHECK(child.getName(9) == "socket:1.2.3.4:80");
+	CHECK(table.find(4) != nullptr);
+	table.closeRange(0, 100, false);
+	CHECK(table.find(0) == nullptr && table.find(9) == nullptr);
+	return TEST_RESULT();
+}
@@ -0,0 +1,101 @@
+#include <sys/syscall.h>
+#include "decoders/IoVector.h"
+#include "Test.h"
+
+using namespace std;
+
+static char buffer[16];
+
+static iovec at(size_t offset, size_t length) {
+	return { buffer + offset, length };
+}
+
+static bool same(const IoVector::Segments& segments, const IoVector::Segments& expected) {
+	if (segments.size() != expected.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < segments.size(); i++) {
+		if (segments[i].iov_base != expected[i].iov_base || segments[i].iov_len != expected[i].iov_len) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Restricts the buffers read at the entry of a system call to those transferred, as IoVector::decodeExit does
+class IoVectorTest {
+public:
+	/**
+	 * @param messageEnds Only recvmmsg and sendmmsg: where the segments of every message end.
+	 */
+	static IoVector entry(int syscall, const IoVector::Segments& segments, const vector<size_t>& messageEnds) {
+		IoVector buffers;
+		buffers.syscall = syscall;
+		buffers.segments = segments;
+		buffers.messageEnds = messageEnds;
+		buffers.messageCount = messageEnds.size();
+		for (const iovec& segment : segments) {
+			buffers.length += segment.iov_len;
+		}
+		return buffers;
+	}
+
+	static IoVector exit(IoVector buffers, long long result, const vector<unsigned int>& messageLengths) {
+		buffers.keepTransferred(result, messageLengths);
+		return buffers;
+	}
+};
+
+/**
+ * Three areas of 3, 0 and 5 bytes, as a readv with an empty buffer in the middle.
+ */
+int main() {
+	iovec segments[] = { at(0, 3), at(3, 0), at(8, 5) };
+	// Everything
+	CHECK(same(IoVector::slice(segments, 3, 0, 8), { at(0, 3), at(8, 5) }));
+	// More than available, as a length declared larger than the buffers
+	CHECK(same(IoVector::slice(segments, 3, 0, 100), { at(0, 3), at(8, 5) }));
+	// A short read stops in the middle of the last area
+	CHECK(same(IoVector::slice(segments, 3, 0, 5), { at(0, 3), at(8, 2) }));
+	// It starts in the middle of the first area
+	CHECK(same(IoVector::slice(segments, 3, 1, 4), { at(1, 2), at(8, 2) }));
+	// It starts exactly at the end of an area
+	CHECK(same(IoVector::slice(segments, 3, 3, 5), { at(8, 5) }));
+	CHECK(same(IoVector::slice(segments, 3, 6, 2), { at(11, 2) }));
+	// Nothing
+	CHECK(IoVector::slice(segments, 3, 0, 0).empty());
+	CHECK(IoVector::slice(segments, 3, 8, 1).empty());
+	CHECK(IoVector::slice(segments, 0, 0, 1).empty());
+
+	IoVector::Segments readv = { at(0, 3), at(3, 0), at(8, 5) };
+	// A short readv keeps only the bytes read
+	IoVector buffers = IoVectorTest::exit(IoVectorTest::entry(SYS_readv, readv, {}), 4, {});
+	CHECK(buffers.getLength() == 4);
+	CHECK(same(buffers.getSegments(), { at(0, 3), at(8, 1) }));
+	// A failed or an empty one nothing
+	buffers = IoVectorTest::exit(IoVectorTest::entry(SYS_readv, readv, {}), -11, {});
+	CHECK(buffers.getLength() == 0);
+	CHECK(buffers.getSegments().empty());
+	buffers = IoVectorTest::exit(IoVectorTest::entry(SYS_readv, readv, {}), 0, {});
+	CHECK(buffers.getLength() == 0);
+	CHECK(buffers.getSegments().empty());
+
+	// Three messages of 3, 4 and 2 bytes, the second one in two areas
+	IoVector::Segments messages = { at(0, 3), at(4, 2), at(6, 2), at(10, 2) };
+	buffers = IoVectorTest::exit(IoVectorTest::entry(SYS_recvmmsg, messages, { 1, 3, 4 }), 3, { 3, 4, 2 });
+	CHECK(buffers.getLength() == 9);
+	CHECK(same(buffers.getSegments(), messages));
+	// Every message is cut to its msg_len
+	buffers = IoVectorTest::exit(IoVectorTest::entry(SYS_recvmmsg, messages, { 1, 3, 4 }), 3, { 1, 3, 0 });
+	CHECK(buffers.getLength() == 4);
+	CHECK(same(buffers.getSegments(), { at(0, 1), at(4, 2), at(6, 1) }));
+	// A sendmmsg that sent only the first two messages
+	buffers = IoVectorTest::exit(IoVectorTest::entry(SYS_sendmmsg, messages, { 1, 3, 4 }), 2, { 3, 4 });
+	CHECK(buffers.getLength() == 7);
+	CHECK(same(buffers.getSegments(), { at(0, 3), at(4, 2), at(6, 2) }));
+	// A failed one
+	buffers = IoVectorTest::exit(IoVectorTest::entry(SYS_sendmmsg, messages, { 1, 3, 4 }), -1, {});
+	CHECK(buffers.getLength() == 0);
+	CHECK(buffers.getSegments().empty());
+	return TEST_RESULT();
+}
@@ -0,0 +1,51 @@
+#include <sys/mman.h>
+#include <unistd.h>
+#include "decoders/MappingTable.h"
+#include "Test.h"
+
+using namespace std;
+
+int main() {
+	const unsigned long long page = (unsigned long long) sysconf(_SC_PAGESIZE);
+	MappingTable table;
+	table.map(10 * page, 4 * page, "/db", PROT_READ, true);
+	CHECK(table.getStatistics().at("/db").currentBytes == 4 * page);
+	// Unmapping the second page splits the mapping, which is still alive
+	table.unmap(11 * page, page);
+	CHECK(table.getMappings().size() == 2);
+	CHECK(table.getStatistics().at("/db").currentBytes == 3 * page);
+	CHECK(table.getStatistics().at("/db").ended == 0);
+	// A single msync and madvise over both pieces
+	table.sync(10 * page, 4 * page);
+	CHECK(table.getStatistics().at("/db").syncs == 1);
+	CHECK(table.getStatistics().at("/db").syncedBytes == 3 * page);
+	table.advise(10 * page, 4 * page, MADV_WILLNEED);
+	CHECK(table.getStatistics().at("/db").advices.at(MADV_WILLNEED) == 1);
+	// The last two pages are moved and grown
+	CHECK(table.remap(12 * page, 2 * page, 40 * page, 5 * page));
+	CHECK(table.getStatistics().at("/db").currentBytes == 6 * page);
+	CHECK(table.getStatistics().at("/db").peakBytes == 6 * page);
+	CHECK(table.getMappings().count(40 * page) == 1 && table.getMappings().at(40 * page).end == 45 * page);
+	CHECK(table.getStatistics().at("/db").remaps == 1);
+	// A length is rounded up to whole pages
+	table.map(60 * page, 1, "/log", PROT_READ | PROT_WRITE, false);
+	CHECK(table.getMappings().at(60 * page).end == 61 * page);
+	// A MAP_FIXED mapping over everything replaces all of them
+	table.map(0, 100 * page, "/other", PROT_READ, false);
+	CHECK(table.getMappings().size() == 1);
+	CHECK(table.getStatistics().at("/db").currentBytes == 0);
+	CHECK(table.getStatistics().at("/db").ended == 1);
+	CHECK(table.getStatistics().at("/log").ended == 1);
+	// The child starts with the mappings of the parent, execve ends them
+	MappingTable child;
+	child.inherit(table);
+	CHECK(child.getStatistics().at("/other").currentBytes == 100 * page);
+	CHECK(child.getStatistics().count("/db") == 0);
+	table.exec();
+	CHECK(table.getMappings().empty());
+	CHECK(table.getStatistics().at("/other").ended == 1);
+	CHECK(child.getMappings().size() == 1);
+	// Nothing is mapped there anymore
+	CHECK(!table.remap(5 * page, page, 6 * page, page));
+	return TEST_RESULT();
+}
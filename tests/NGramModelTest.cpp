@@ -0,0 +1,63 @@
+#include <cstdlib>
+#include <fstream>
+#include <unistd.h>
+#include "NGramModel.h"
+#include "Test.h"
+
+using namespace std;
+
+// Offset of the name length of the first executable, after the magic, the version, the size and the executable count
+static const streamoff FIRST_EXECUTABLE = sizeof(NGramModel::MAGIC) + 3 * sizeof(uint32_t);
+
+/**
+ * Overwrites some bytes of a file.
+ */
+static void patch(const string& path, streamoff offset, const void* data, size_t length) {
+	fstream file(path, ios::in | ios::out | ios::binary);
+	file.seekp(offset);
+	file.write((const char*) data, (streamsize) length);
+}
+
+/**
+ * A model with the windows of a single executable is read back, the lengths of a corrupted one are rejected before
+ * anything is allocated for them.
+ */
+int main() {
+	char path[] = "/tmp/ptracer-ngram-XXXXXX";
+	int fd = mkstemp(path);
+	CHECK(fd >= 0);
+	close(fd);
+	string executable = "/usr/bin/true";
+	NGramModel model(2);
+	CHECK(model.learn(executable, { 1, 2 }));
+	CHECK(model.learn(executable, { 2, 3 }));
+	CHECK(model.save(path));
+
+	NGramModel loaded(2);
+	CHECK(loaded.load(path));
+	CHECK(loaded.getSize() == 2);
+	CHECK(loaded.accepts(executable, { 1, 2 }));
+	CHECK(!loaded.accepts(executable, { 3, 1 }));
+	// Another size of the windows
+	NGramModel other(3);
+	CHECK(!other.load(path));
+
+	// A name longer than the file
+	uint32_t nameLength = 0xFFFFFFFF;
+	patch(path, FIRST_EXECUTABLE, &nameLength, sizeof(nameLength));
+	NGramModel longName(2);
+	CHECK(!longName.load(path));
+	// More windows than the file can hold
+	CHECK(model.save(path));
+	uint64_t count = 1ULL << 60;
+	patch(path, FIRST_EXECUTABLE + (streamoff) (sizeof(uint32_t) + executable.size()), &count, sizeof(count));
+	NGramModel manyWindows(2);
+	CHECK(!manyWindows.load(path));
+	// Truncated in the middle of the windows
+	CHECK(model.save(path));
+	CHECK(truncate(path, FIRST_EXECUTABLE + (off_t) (sizeof(uint32_t) + executable.size() + sizeof(uint64_t) + 4)) == 0);
+	NGramModel truncated(2);
+	CHECK(!truncated.load(path));
+	unlink(path);
+	return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "decoders/IoVector.h"
+#include "decoders/PayloadWriter.h"
+#include "Test.h"
+
+using namespace std;
+
+// Bytes written at most by every pwritev, 0 for no limit, and the pwritev calls
+static size_t writeLimit = 0;
+static unsigned int writeCalls = 0;
+
+/**
+ * Replaces the pwritev of the C library, so that the kernel really writes at most writeLimit bytes at a time, as it may
+ * on a full disk or with a file size limit.
+ */
+extern "C" ssize_t pwritev(int fd, const iovec* vectors, int count, off_t offset) {
+	writeCalls++;
+	IoVector::Segments limited = IoVector::slice(vectors, (size_t) count, 0, writeLimit > 0 ? writeLimit : ULONG_MAX);
+	return syscall(SYS_pwritev, fd, limited.data(), limited.size(), (unsigned long) offset, 0UL);
+}
+
+// Reaches the chunks of PayloadWriter, which are only written by its thread
+class PayloadWriterTest {
+public:
+	/**
+	 * Writes the vectors at the beginning of a file, as PayloadWriter::writeChunk does after a partial write of done bytes.
+	 */
+	static bool resume(int fd, const vector<iovec>& vectors, size_t done) {
+		PayloadWriter::Chunk chunk { -1, fd, 0, vectors, 0 };
+		for (const iovec& vector : vectors) {
+			chunk.length += vector.iov_len;
+		}
+		return PayloadWriter::writeChunk(chunk, done);
+	}
+};
+
+/**
+ * A write interrupted at every byte of a chunk, across vectors of different sizes and an empty one, is completed
+ * from where it stopped, as well as a chunk the kernel writes a few bytes at a time.
+ */
+int main() {
+	string first = "abc", third = "defgh", fourth = "ij";
+	vector<iovec> vectors = { { first.data(), first.size() }, { nullptr, 0 }, { third.data(), third.size() },
+	                          { fourth.data(), fourth.size() } };
+	string expected = first + third + fourth;
+	for (size_t done = 0; done <= expected.size(); done++) {
+		char path[] = "/tmp/ptracer-payload-XXXXXX";
+		int fd = mkstemp(path);
+		CHECK(fd >= 0);
+		unlink(path);
+		// The bytes written before the interruption
+		CHECK(pwrite(fd, expected.data(), done, 0) == (ssize_t) done);
+		CHECK(PayloadWriterTest::resume(fd, vectors, done));
+		string written(expected.size() + 1, '\0');
+		CHECK(pread(fd, written.data(), written.size(), 0) == (ssize_t) expected.size());
+		written.resize(expected.size());
+		CHECK(written == expected);
+		close(fd);
+	}
+	// Real short writes of 1 to 4 bytes at a time
+	for (writeLimit = 1; writeLimit <= 4; writeLimit++) {
+		char path[] = "/tmp/ptracer-payload-XXXXXX";
+		int fd = mkstemp(path);
+		CHECK(fd >= 0);
+		unlink(path);
+		writeCalls = 0;
+		CHECK(PayloadWriterTest::resume(fd, vectors, 0));
+		CHECK(writeCalls == (expected.size() + writeLimit - 1) / writeLimit);
+		string written(expected.size() + 1, '\0');
+		CHECK(pread(fd, written.data(), written.size(), 0) == (ssize_t) expected.size());
+		written.resize(expected.size());
+		CHECK(written == expected);
+		close(fd);
+	}
+	return TEST_RESULT();
+}
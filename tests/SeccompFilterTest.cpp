@@ -0,0 +1,51 @@
+#include <sys/syscall.h>
+#include "SeccompFilter.h"
+#include "Test.h"
+
+using namespace std;
+
+/**
+ * Two states, both with outgoing transitions, and a label for every case of SeccompFilter::fromAutomaton.
+ */
+int main() {
+	map<int, map<int, set<int>>> transitions = {
+		// read (label 0) loops everywhere, write (label 1) moves from 0 to 1, getpid has two labels (2 and 3) both
+		// looping, close (label 4) loops on 0 but can also move to 1, exit (label 5) loops everywhere
+		{ 0, { { 0, { 0 } }, { 1, { 1 } }, { 2, { 0 } }, { 3, { 0 } }, { 4, { 0, 1 } }, { 5, { 0 } } } },
+		{ 1, { { 0, { 1 } }, { 1, { 1 } }, { 2, { 1 } }, { 3, { 1 } }, { 4, { 1 } }, { 5, { 1 } } } }
+	};
+	CompactAutomaton automaton({ 0 }, { 0, 1 }, transitions, 2, 6);
+	map<int, set<int>> syscallLabels = {
+		{ SYS_read, { 0 } },
+		{ SYS_write, { 1 } },
+		{ SYS_getpid, { 2, 3 } },
+		{ SYS_close, { 4 } },
+		{ SYS_exit, { 5 } }
+	};
+	SeccompFilter filter = SeccompFilter::fromAutomaton(automaton, syscallLabels);
+	CHECK(filter.getAction(SYS_read) == SeccompFilter::ALLOW);
+	// It would move the automaton from 0 to 1
+	CHECK(filter.getAction(SYS_write) == SeccompFilter::TRACE);
+	// Its labels also encode the stack, each one must still be checked
+	CHECK(filter.getAction(SYS_getpid) == SeccompFilter::TRACE);
+	// One of its transitions from 0 is not a self-loop
+	CHECK(filter.getAction(SYS_close) == SeccompFilter::TRACE);
+	CHECK(filter.getAction(SYS_exit) == SeccompFilter::TRACE);
+	CHECK(filter.getAction(SYS_mmap) == SeccompFilter::KILL);
+	CHECK(filter.getAction(-1) == SeccompFilter::KILL);
+	CHECK(filter.count(SeccompFilter::ALLOW) == 1);
+	CHECK(!filter.compile().empty());
+	// With the other violation policies the system calls never allowed must still reach them
+	SeccompFilter traced = SeccompFilter::fromAutomaton(automaton, syscallLabels, SeccompFilter::TRACE);
+	CHECK(traced.getAction(SYS_read) == SeccompFilter::ALLOW);
+	CHECK(traced.getAction(SYS_write) == SeccompFilter::TRACE);
+	CHECK(traced.getAction(SYS_mmap) == SeccompFilter::TRACE);
+	CHECK(traced.getAction(-1) == SeccompFilter::TRACE);
+	CHECK(traced.count(SeccompFilter::KILL) == 0);
+	SeccompFilter denied = SeccompFilter::fromAutomaton(automaton, syscallLabels, SeccompFilter::DENY);
+	CHECK(denied.getAction(SYS_mmap) == SeccompFilter::DENY);
+	CHECK(denied.getAction(SYS_close) == SeccompFilter::TRACE);
+	CHECK(denied.count(SeccompFilter::KILL) == 0);
+	CHECK(!denied.compile().empty());
+	return TEST_RESULT();
+}
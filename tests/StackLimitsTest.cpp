@@ -0,0 +1,44 @@
+#include <sstream>
+#include "Mapper.h"
+#include "StackLimits.h"
+#include "Test.h"
+
+using namespace std;
+
+/**
+ * The limits survive the round trip through their serialised form and through an associations file.
+ */
+int main() {
+	StackLimits unlimited;
+	StackLimits limits;
+	limits.depth = 8;
+	limits.excludedModules = { "libc.so", "/opt/my app/lib" };
+	StackLimits parsed;
+	CHECK(unlimited.isUnlimited());
+	CHECK(!limits.isUnlimited());
+	CHECK(StackLimits::parse(limits.serialize(), parsed) && parsed == limits);
+	CHECK(StackLimits::parse(unlimited.serialize(), parsed) && parsed == unlimited);
+	CHECK(limits.serialize().find('\t') == string::npos && limits.serialize().find('\n') == string::npos);
+	CHECK(!StackLimits::parse("", parsed));
+	CHECK(!StackLimits::parse("deep", parsed));
+	// Only the depth
+	StackLimits shallow;
+	shallow.depth = 8;
+	CHECK(shallow != limits);
+	CHECK(StackLimits::parse(shallow.serialize(), parsed) && parsed == shallow);
+
+	stringstream empty;
+	Mapper associations("", empty);
+	associations.setStackLimits(limits);
+	stringstream written;
+	associations.write(written);
+	Mapper copy("", written);
+	CHECK(copy.getStackLimits() == limits);
+	// Associations learned with the whole stack traces are written as before the limits existed
+	stringstream unlimitedWritten;
+	Mapper("", empty).write(unlimitedWritten);
+	CHECK(unlimitedWritten.str().find(StackLimits::HEADER) == string::npos);
+	Mapper unlimitedCopy("", unlimitedWritten);
+	CHECK(unlimitedCopy.getStackLimits().isUnlimited());
+	return TEST_RESULT();
+}
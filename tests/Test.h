@@ -0,0 +1,22 @@
+#ifndef PTRACER_TEST_H
+#define PTRACER_TEST_H
+
+#include <iostream>
+
+// Minimal checks for the unit tests: a failed check is reported and the test executable exits with 1, so that ctest
+// marks it as failed. Unlike assert, the checks are kept in release builds.
+namespace Test {
+	inline int failures = 0;
+}
+
+#define CHECK(condition)                                                                                           \
+	do {                                                                                                             \
+		if (!(condition)) {                                                                                            \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl;                   \
+			Test::failures++;                                                                                            \
+		}                                                                                                              \
+	} while (0)
+
+#define TEST_RESULT() (Test::failures == 0 ? 0 : 1)
+
+#endif //PTRACER_TEST_H
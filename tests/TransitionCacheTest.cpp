@@ -0,0 +1,44 @@
+#include "TransitionCache.h"
+#include "Test.h"
+
+using namespace std;
+
+/**
+ * A chain of states 0 -> 1 -> 2 -> 0 on label 0, where only 2 is final, label 1 leads nowhere.
+ */
+int main() {
+	map<int, map<int, set<int>>> transitions = {
+		{ 0, { { 0, { 1 } } } },
+		{ 1, { { 0, { 2 } } } },
+		{ 2, { { 0, { 0 } } } }
+	};
+	CompactAutomaton automaton({ 0 }, { 2 }, transitions, 3, 2);
+	TransitionCache cache(automaton, 16, 2);
+	unsigned int initial = cache.intern(automaton.getInitialStates());
+	CHECK(cache.intern(automaton.getInitialStates()) == initial);
+	CHECK(!cache.isFull());
+	unsigned int to;
+	CHECK(cache.step(initial, 0, to));
+	CHECK(cache.getStates(to) == StateSet({ 1 }));
+	CHECK(!cache.isFinal(to));
+	CHECK(!cache.step(initial, 1, to));
+	CHECK(cache.getMisses() == 2);
+	// The same transition again is a hit
+	CHECK(cache.step(initial, 0, to));
+	CHECK(cache.getHits() == 1);
+	// The limit is reached by the second set of states
+	CHECK(cache.isFull());
+	CHECK(cache.step(to, 0, to));
+	CHECK(cache.getStates(to) == StateSet({ 2 }));
+	CHECK(cache.isFinal(to));
+	// Once cleared, only the sets interned again are known
+	StateSet current = cache.getStates(to);
+	cache.clear();
+	CHECK(!cache.isFull());
+	to = cache.intern(current);
+	CHECK(to == 0);
+	CHECK(cache.isFinal(to));
+	CHECK(cache.step(to, 0, to));
+	CHECK(cache.getStates(to) == StateSet({ 0 }));
+	return TEST_RESULT();
+}